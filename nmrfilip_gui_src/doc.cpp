@@ -197,6 +197,10 @@ NFGSerDocument::NFGSerDocument()
 	SerNMRData.MarkNMRDataOldCallback = MarkNMRDataOldCallbackFn;
 	SerNMRData.ChangeProcParamCallback = ChangeProcParamCallbackFn;
 	SerNMRData.AuxPointer = this;
+	SerNMRData.CompactRawData = 1;	/// keeps the memory footprint low with several documents open, the time domain data plot gets the complete data loaded again
+	SerNMRData.LoadMode = RAW_LOAD_MMAP;	/// just the pages of the steps in use take memory, the datafile is read instead where the mapping is not available
+	
+	UseCache = false;
 	
 	SelectedGraphType = 0;
 	Graph = NULL;
@@ -260,6 +264,10 @@ NFGSerDocument::~NFGSerDocument()
 	delete GraphSpectrum;
 	delete GraphEvaluation;
 	
+	/// Nothing is written unless the chunk set or the chunk averages differ from the cached ones
+	if (UseCache)
+		NFGNMRData::SaveNMRDataCache(&SerNMRData);
+	
 	NFGNMRData::FreeNMRData(&SerNMRData);
 	SerNMRData.ErrorReport = NULL;	/// not really necessary here
 	SerNMRData.ErrorReportCustom = NULL;	/// not really necessary here
@@ -296,6 +304,11 @@ bool NFGSerDocument::DoOpenDocument(const wxString& filename)
 	else	/// expecting "Fid File"
 		SerNMRData.SerName = strdup(wxString(path).Append("fid").char_str(*wxConvFileName));
 
+	/// Restore the already processed data if there is a cache created before (e.g. by nmrfilipcli --cache)
+	UseCache = (NFGNMRData::LoadNMRDataCache(&SerNMRData) != DATA_EMPTY);
+	
+	AcqusModTime = AcqusModTimeQuery();
+	
 	/// Call CheckProcParam here for all params to get reasonable proc param values and preload the data.
 	NFGNMRData::CheckProcParam(&SerNMRData, PROC_PARAM_FirstChunk, PARAM_LONG, &(params.FirstChunk), NULL);
 	NFGNMRData::CheckProcParam(&SerNMRData, PROC_PARAM_LastChunk, PARAM_LONG, &(params.LastChunk), NULL);
@@ -629,6 +642,9 @@ ProcParams NFGSerDocument::SetProcParams(ProcParams Parameters, bool NoRefresh,
 {
 	long Val = 0;
 	int RetVal = DATA_OK;
+	size_t MaxChunkLength = 0;
+	size_t i = 0;
+	double ChunkSumsSize = 0.0;
 	
 	/// coerce the parameters (beyond what NMRFilip LIB does) to improve user experience
 	if (Parameters.FirstChunk < 0) 
@@ -681,6 +697,16 @@ ProcParams NFGSerDocument::SetProcParams(ProcParams Parameters, bool NoRefresh,
 
 	params = Parameters;
 	
+	/// the cumulative chunk sums pay off just while the first and last chunk are adjusted with Auto-Apply on; they hold ChunkCount + 1 rows of the longest chunk 
+	/// in 64-bit integers per step, i.e. over 4 times the compacted raw data, so they are not used for the datasets where they would exceed CHUNK_SUMS_MAX_SIZE
+	if (SerNMRData.ChunkSet != NULL)
+		for (i = 0; i < ChunkNoRange(&SerNMRData); i++) 
+			if (ChunkIndexRange(&SerNMRData, i) > MaxChunkLength)
+				MaxChunkLength = ChunkIndexRange(&SerNMRData, i);
+	
+	ChunkSumsSize = ((double) StepNoRange(&SerNMRData))*((double) (ChunkNoRange(&SerNMRData) + 1))*2.0*((double) MaxChunkLength)*sizeof(int64_t);
+	SerNMRData.CumulativeChunkSums = (params.AutoApply && params.UseFirstLastChunk && (MaxChunkLength > 0) && (ChunkSumsSize <= CHUNK_SUMS_MAX_SIZE))?(1):(0);
+	
 	if (params.UseFirstLastChunk) {
 		RetVal |= NFGNMRData::SetProcParam(&SerNMRData, PROC_PARAM_FirstChunk, PARAM_LONG, &(params.FirstChunk), NULL);
 		RetVal |= NFGNMRData::SetProcParam(&SerNMRData, PROC_PARAM_LastChunk, PARAM_LONG, &(params.LastChunk), NULL);
@@ -1669,11 +1695,31 @@ wxString NFGSerDocument::PathStringQuery()
 	return PathName.GetPath(wxPATH_GET_VOLUME | wxPATH_GET_SEPARATOR);
 }
 
+wxDateTime NFGSerDocument::AcqusModTimeQuery()
+{
+	wxFileName AcqusName = PathName;
+	AcqusName.SetFullName("acqus");
+	
+	if (!AcqusName.FileExists())
+		return wxInvalidDateTime;
+	
+	return AcqusName.GetModTime();
+}
+
 void NFGSerDocument::ReloadData()
 {
 	long Val = 0;
+	wxDateTime ModTime = AcqusModTimeQuery();
+	
+	/// Unless the acquisition has been restarted (acqus rewritten), just the steps appended to the datafile are loaded, 
+	/// which keeps the processed data of the other steps while monitoring a running acquisition. 
+	/// ReloadNMRDataIncremental reloads the data completely by itself if the datafile has not just grown.
+	if (ModTime.IsValid() && AcqusModTime.IsValid() && (ModTime == AcqusModTime))
+		NFGNMRData::ReloadNMRDataIncremental(&SerNMRData);
+	else
+		NFGNMRData::ReloadNMRData(&SerNMRData);
 	
-	NFGNMRData::ReloadNMRData(&SerNMRData);
+	AcqusModTime = ModTime;
 	
 	if (params.UseFirstLastChunk) {
 		NFGNMRData::GetProcParam(&SerNMRData, PROC_PARAM_FirstChunk, PARAM_LONG, &(params.FirstChunk), NULL);
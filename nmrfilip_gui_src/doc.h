@@ -120,6 +120,8 @@ class NFGTextDocument : public wxDocument
 #define PROC_PARAM_UseFirstLastChunkPoint	256
 #define PROC_PARAM_UseFilter	512
 
+#define CHUNK_SUMS_MAX_SIZE	268435456.0	/// in B, the cumulative chunk sums are not used for datasets needing more
+
 extern "C" {
 	char *NFGErrorReport(void *NMRDataStruct, int ErrorNumber, char *Activity);
 	char *NFGErrorReportCustom(void *NMRDataStruct, char *ErrorDesc, char *Activity);
@@ -135,6 +137,8 @@ class NFGSerDocument : public wxDocument
 	protected:
 		NMRData SerNMRData;
 		wxFileName PathName;
+		bool UseCache;	/// the processed data cache was present when opening the dataset, so it is kept up to date
+		wxDateTime AcqusModTime;	/// modification time of the acqus file when the data were (re)loaded completely last time
 	
 		unsigned char SelectedGraphType;
 		NFGGraph *Graph;	/// just a pointer to selected graph
@@ -235,6 +239,7 @@ class NFGSerDocument : public wxDocument
 		AcquParams* AcquInfoQuery();
 		wxString PathStringQuery();
 		
+		wxDateTime AcqusModTimeQuery();
 		void ReloadData();
 		void CheckGraphData();
 		
@@ -28,6 +28,7 @@ CheckNMRDataFunc NFGNMRData::CheckNMRData;
 FreeNMRDataFunc NFGNMRData::FreeNMRData;
 RefreshNMRDataFunc NFGNMRData::RefreshNMRData;
 ReloadNMRDataFunc NFGNMRData::ReloadNMRData;
+ReloadNMRDataIncrementalFunc NFGNMRData::ReloadNMRDataIncremental;
 
 CheckProcParamFunc NFGNMRData::CheckProcParam;
 GetProcParamFunc NFGNMRData::GetProcParam;
@@ -41,7 +42,12 @@ ReadUserlistFunc NFGNMRData::ReadUserlist;
 WriteUserlistFunc NFGNMRData::WriteUserlist;
 FreeUserlistFunc NFGNMRData::FreeUserlist;
 
+LoadNMRDataCacheFunc NFGNMRData::LoadNMRDataCache;
+SaveNMRDataCacheFunc NFGNMRData::SaveNMRDataCache;
+
 CleanupOnExitFunc NFGNMRData::CleanupOnExit;
+LoadDFTWisdomFunc NFGNMRData::LoadDFTWisdom;
+GetDFTZoomFunc NFGNMRData::GetDFTZoom;
 
 
 /// Round to the nearest integer, round half up, errors ignored
@@ -106,11 +112,20 @@ void NFGNMRData::GetTDDAmpRPtBB(NMRData* NMRDataPtr, size_t No, double &minx, do
 	maxx = NFGMSTD fmax(TDDTime(NMRDataPtr, No, 0), TDDTime(NMRDataPtr, No, TDDIndexRange(NMRDataPtr, No) - 1)); 
 	miny = 0.0; /// checking for actual minimum omited
 	maxy = 0.0; 
-	for (size_t i = 0; i < TDDIndexRange(NMRDataPtr, No); i++) {
-		/// computes upper estimation first for faster execution
-		if (((unsigned long) std::labs(TDDReal(NMRDataPtr, No, i)) + (unsigned long) std::labs(TDDImag(NMRDataPtr, No, i))) > ((unsigned long) maxy))
-			if (TDDAmp(NMRDataPtr, No, i) > maxy) 
-				maxy = TDDAmp(NMRDataPtr, No, i); 
+	if (TDDIsFloat64(NMRDataPtr, No)) {
+		for (size_t i = 0; i < TDDIndexRange(NMRDataPtr, No); i++) {
+			/// computes upper estimation first for faster execution
+			if ((std::fabs(TDDRealFloat64(NMRDataPtr, No, i)) + std::fabs(TDDImagFloat64(NMRDataPtr, No, i))) > maxy)
+				if (TDDAmp(NMRDataPtr, No, i) > maxy) 
+					maxy = TDDAmp(NMRDataPtr, No, i); 
+		}
+	} else {
+		for (size_t i = 0; i < TDDIndexRange(NMRDataPtr, No); i++) {
+			/// computes upper estimation first for faster execution
+			if (((unsigned long) std::labs(TDDRealInt32(NMRDataPtr, No, i)) + (unsigned long) std::labs(TDDImagInt32(NMRDataPtr, No, i))) > ((unsigned long) maxy))
+				if (TDDAmp(NMRDataPtr, No, i) > maxy) 
+					maxy = TDDAmp(NMRDataPtr, No, i); 
+		}
 	} 
 } 
 void NFGNMRData::GetTDDAmpPts(NMRData* NMRDataPtr, size_t No, wxPoint* PointArray, NFGScale Scale) { 
@@ -37,6 +37,7 @@ namespace NFGNMRData
 	extern FreeNMRDataFunc FreeNMRData;
 	extern RefreshNMRDataFunc RefreshNMRData;
 	extern ReloadNMRDataFunc ReloadNMRData;
+	extern ReloadNMRDataIncrementalFunc ReloadNMRDataIncremental;
 
 	extern CheckProcParamFunc CheckProcParam;
 	extern GetProcParamFunc GetProcParam;
@@ -50,7 +51,12 @@ namespace NFGNMRData
 	extern WriteUserlistFunc WriteUserlist;
 	extern FreeUserlistFunc FreeUserlist;
 
+	extern LoadNMRDataCacheFunc LoadNMRDataCache;
+	extern SaveNMRDataCacheFunc SaveNMRDataCache;
+
 	extern CleanupOnExitFunc CleanupOnExit;
+	extern LoadDFTWisdomFunc LoadDFTWisdom;
+	extern GetDFTZoomFunc GetDFTZoom;
 
 
 	long long llroundnu(double val);
@@ -180,6 +180,13 @@
 #define PROC_PARAM_SetStepFlag			20
 #define PROC_PARAM_ClearStepFlag		21
 
+#define PROC_PARAM_ProcThreads			22	/** does not affect the results, can be set before the data are loaded **/
+#define PROC_PARAM_DFTMemoryBudget		23	/** in MiB, does not affect the results, can be set before the data are loaded, applies from the next DFT data allocation **/
+#define PROC_PARAM_DFTDownconvert		24	/** transform just the filtered band, can be set before the data are loaded **/
+#define PROC_PARAM_Apodization			25	/** APODIZATION_... window applied before the DFT **/
+#define PROC_PARAM_ApodizationParam		26	/** parameter of the apodization window, see APODIZATION_... **/
+#define PROC_PARAM_DFTLengthTolerance		27	/** in %, DFTLength is rounded up to a 2^a*3^b*5^c*7^d size if it grows by this much at most, 0 keeps DFTLength as set, can be set before the data are loaded **/
+
 
 /** NMR data types **/
 #define CHECK_AcquParams	0
@@ -245,12 +252,62 @@
 #define PARAM_SET_MASK		(PARAM_SET_SWh | PARAM_SET_ByteOrder | PARAM_SET_PointLine | PARAM_SET_TimeDomain | PARAM_SET_Freq)
 
 
+/** Raw data types - values of $DTYPA **/
+#define RAW_TYPE_INT32		0
+#define RAW_TYPE_FLOAT64	2
+
+
+/** Datafile loading modes **/
+#define RAW_LOAD_READ		0	/** read and convert the steps into allocated memory on their first use **/
+#define RAW_LOAD_MMAP		1	/** map the datafile into memory, convert the byte order in place if needed (falls back to RAW_LOAD_READ if unavailable) **/
+
+/** Apodization windows (NMRData.Apodization) over the N points n = 0 .. N - 1 of the processed part of the chunk average, p being ApodizationParam **/
+#define APODIZATION_None	0
+#define APODIZATION_Exponential	1	/** exp(-pi*p*t), t = n/SW_h - Lorentzian line broadening by p [Hz] **/
+#define APODIZATION_Gaussian	2	/** exp(-(pi*p*t)^2/(4*ln(2))), t = n/SW_h - Gaussian line broadening by p [Hz] (FWHM) **/
+#define APODIZATION_SineBell	3	/** sin(p + (180 - p)*n/(N - 1)), p [deg] - 0 for the sine bell, 90 for the cosine bell **/
+#define APODIZATION_Kaiser	4	/** I0(p*sqrt(1 - (2*n/(N - 1) - 1)^2))/I0(p) - Kaiser window of shape p **/
+#define APODIZATION_Max		4
+
+/** DFT planning rigor (NMRData.DFTPlanner) **/
+#define DFT_PLANNER_ESTIMATE	0	/** FFTW_ESTIMATE - no measurements, the plan is created at once **/
+#define DFT_PLANNER_MEASURE	1	/** FFTW_MEASURE - the plan is chosen by timing several candidates, worth it with the wisdom stored **/
+#define DFT_PLANNER_PATIENT	2	/** FFTW_PATIENT - even more candidates are timed **/
+
+/** Floating-point type of the DFT data - the library and its users must be built with the same SINGLE_PRECISION setting **/
+#if SINGLE_PRECISION
+typedef float NMRReal;
+#else
+typedef double NMRReal;
+#endif
+
+
 typedef struct {
 	intptr_t start;
 	size_t length;	/** in 2x long (Re, Im) (8 B) **/
+	intptr_t offset;	/** of the chunk in the stored step data, equals start unless the raw data are compacted **/
 } SignalWindow;
 
 
+/** Index of the "##NAME=" lines of an acqus-style text **/
+typedef struct {
+	size_t NameStart;	/** offset of NAME in the indexed text **/
+	size_t NameLength;
+	size_t Next;	/** next entry in the same bucket (in the order of the text), PARAM_INDEX_NONE if last **/
+} ParamIndexEntry;
+
+typedef struct {
+	char *Text;	/** indexed text, NULL if there is no valid index **/
+	size_t TextLength;
+	ParamIndexEntry *Entries;
+	size_t EntryCount;
+	size_t *Buckets;	/** first entry of each bucket, PARAM_INDEX_NONE if empty **/
+	size_t BucketCount;	/** power of 2 **/
+} ParamIndex;
+
+#define PARAM_INDEX_NONE	SIZE_MAX
+
+
 typedef struct {
 	unsigned long Flags;	/** flags of valid data parts **/
 	unsigned long StepFlag;	/** user flag indicating step usability **/
@@ -260,28 +317,31 @@ typedef struct {
 	double Freq;
 	
 	/** Raw data of the step **/
-	int32_t *RawData;
-	size_t RawDataLength; 	/** in 2x long (Re, Im) (8 B) **/
+	unsigned char RawDataType;	/** RAW_TYPE_INT32 or RAW_TYPE_FLOAT64 **/
+	int32_t *RawData;	/** used if RawDataType == RAW_TYPE_INT32, NULL otherwise **/
+	double *RawDataFloat64;	/** used if RawDataType == RAW_TYPE_FLOAT64, NULL otherwise **/
+	size_t RawDataLength; 	/** in complex points (Re, Im) of the respective type **/
 
 	/** Chunk average **/
 	double *ChunkAvgData;	/** pointer to start of the whole (Re, Im) chunk average field **/
 	double *ChunkAvgAmp;	/** pointer to start of the whole chunk average amplitude field **/
 	size_t ChunkAvgLength;	/** in 2x double (Re, Im) (16 B) - length of the whole chunk average field **/
+	int64_t *ChunkSums;	/** cumulative (Re, Im) sums of the integer chunks, row i holds the sum of chunks 0 .. i-1, (ChunkCount + 1) rows **/
+	size_t ChunkSumLength;	/** in 2x int64_t (Re, Im) (16 B) - length of a single row of ChunkSums, 0 if the sums are not valid **/
 
 	/** Echo peaks envelope **/
 	double *EchoPeaksEnvelope;
 	size_t EchoPeaksEnvelopeLength;	/** in 2x long (Re, Im) (8 B) **/
 
 	/** DFT data **/
-	double *DFTInput;	/** pointer to start of the whole (Re, Im) DFT input field **/
-	size_t DFTInputLength;	/** in 2x double (Re, Im) (16 B) - length of the whole DFT input field **/
+	double DFTInputFirst[2];	/** first (Re, Im) point of the DFT input, the input itself is transformed in place of the output **/
 	
 	/** NOTE: 
 	1. Output data are not normalized.
 	2. Use the corresponding macro for data access or see the FFTW Reference for a description of the output ordering. **/
-	double *DFTOutput;	/** pointer to start of the whole (Re, Im) DFT output field **/
-	double *DFTOutAmp;	/** pointer to start of the whole DFT amplitude field **/
-	size_t DFTLength;	/** in 2x double (Re, Im) (16 B) - length of the whole DFT field **/
+	NMRReal *DFTOutput;	/** pointer to start of the whole (Re, Im) DFT output field **/
+	NMRReal *DFTOutAmp;	/** pointer to start of the whole DFT amplitude field **/
+	size_t DFTLength;	/** in 2x NMRReal (Re, Im) - length of the whole DFT field **/
 
 	/** Phase-correction parameters and results **/
 	unsigned char PhaseCorrFlag;
@@ -289,8 +349,8 @@ typedef struct {
 	long PhaseCorr1;	/** time position of FID origin or echo center in units of 1 ns **/
 	long PhaseCorr1Ref;	/** reference point in chunk average data (-1 for proc start, 0 for data start) **/
 
-	double *DFTPhaseCorrOutput;	/** pointer to start of the whole (Re, Im) phase- and offset-corrected DFT output **/
-	double *DFTPhaseCorrOutAmp;	/** pointer to start of the whole phase- and offset-corrected DFT amplitude **/
+	NMRReal *DFTPhaseCorrOutput;	/** pointer to start of the whole (Re, Im) phase- and offset-corrected DFT output **/
+	NMRReal *DFTPhaseCorrOutAmp;	/** pointer to start of the whole phase- and offset-corrected DFT amplitude **/
 
 	/** Evaluation parameters **/
 	double ChunkAvgAmpMax;	/** maximum of amplitude of the processed part of the chunk average **/
@@ -401,6 +461,8 @@ typedef struct {
 	/** Parameter file **/
 	char *AcqusData;
 	size_t AcqusLength;
+	ParamIndex AcqusIndex;	/** index of AcqusData, rebuilt on the first use after (re)loading **/
+	ParamIndex TextIndex;	/** index of the last other acqus-style text (views, etc.) **/
 	
 	/** Datafile **/
 	char *SerName;
@@ -408,11 +470,42 @@ typedef struct {
 	char DTypA;	/** $DTYPA - raw data are integers (0) or doubles (2) **/
 	
 	/** Raw data loaded from ser file **/
-	int32_t *DataSpace;
+	int32_t *DataSpace;	/** either allocated memory or the start of the datafile mapping **/
 	size_t DataSize;
+	unsigned char *DataLoaded;	/** flags of lines already read into the allocated memory, NULL if the datafile is mapped **/
+	
+	/** Datafile mapping **/
+	unsigned char LoadMode;	/** RAW_LOAD_READ (default) or RAW_LOAD_MMAP - the latter only for datafiles not truncated or rewritten while mapped **/
+	void *DataMap;	/** start of the datafile mapping, NULL if the datafile is not mapped **/
+	size_t DataMapLength;	/** in bytes **/
+	unsigned char *DataMapDecoded;	/** flags of pages (RawMapPageSize) already converted to the host byte order, NULL if no conversion is needed **/
+	
+	/** Compacted raw data **/
+	unsigned char CompactRawData;	/** keep just the chunks of all steps once the chunk set is known, the complete raw data are loaded again on demand **/
+	
+	/** Chunk averaging **/
+	unsigned char CumulativeChunkSums;	/** keep the cumulative sums of the integer chunks, so that changing FirstChunk or LastChunk does not sum the chunks again (released by the next chunk averaging once disabled); they take ChunkCount + 1 rows of the longest chunk in int64_t per step, over 4 times the int32 chunks **/
+	int32_t *ChunkSpace;	/** chunks of all steps packed together, NULL if the raw data are not compacted **/
+	size_t ChunkSpaceSize;	/** in 4 B units **/
+	
+	/** Datafile reading **/
+	size_t ReadBlockSize;	/** size of a single read request in bytes (rounded down to a multiple of 1024) **/
+	unsigned int ReadQueueDepth;	/** how many blocks the read-ahead thread may read before they are converted, 0 disables the thread **/
+	
+	/** Parallel processing **/
+	unsigned int ProcThreads;	/** maximal number of threads processing the steps together (and executing the DFT with FFTW_THREADS), 0 for the number of processors online **/
+	
+	/** Fourier transform **/
+	unsigned char DFTPlanner;	/** DFT_PLANNER_ESTIMATE, DFT_PLANNER_MEASURE or DFT_PLANNER_PATIENT **/
+	size_t DFTMemoryBudget;	/** in MiB, 0 for no limit - larger DFT data are kept in a memory-mapped scratch file and the steps are transformed in batches fitting the budget **/
+	unsigned char DFTSpilled;	/** the DFT data spaces are mapped from the scratch file **/
+	unsigned char DFTSpillFailed;	/** the scratch file space could not be reserved, the DFT data are kept in memory until DFTMemoryBudget is set again **/
+	unsigned char DFTDownconvert;	/** narrow filtered bands are shifted to zero frequency, low-pass filtered and decimated before the (shorter) DFT, the output outside the band is zero **/
+	unsigned int DFTLengthTolerance;	/** in %, see PROC_PARAM_DFTLengthTolerance **/
+	void *DFTCache;	/** DFT plans, apodization window, scratch space etc. of this dataset kept between the transforms (private to the library), NULL until the first transform **/
 	
 	size_t TimeDomain;	/** $TD - time domain (crucial parameter) **/
-	size_t PointLine;	/** PointLine - line length in 2x long (Re, Im) (8 B), including padding zeroes **/
+	size_t PointLine;	/** PointLine - line length in complex points (Re, Im) of the type given by DTypA, including padding zeroes **/
 
 	double SWMh;	/** Sampling spectral width [MHz] (crucial parameter) **/
 	
@@ -426,6 +519,7 @@ typedef struct {
 	unsigned long ChunkStart;
 	unsigned long ChunkEnd;
 	unsigned long DFTLength;
+	unsigned long DFTLengthSet;	/** DFTLength as set, before rounding it up to the FFT-friendly size **/
 	unsigned long FilterHz;
 	unsigned long filter;
 	unsigned long filter2;
@@ -434,6 +528,9 @@ typedef struct {
 	unsigned char ScaleFirstTDPoint;
 	unsigned char RemoveOffset;
 	
+	unsigned char Apodization;	/** APODIZATION_... **/
+	long ApodizationParam;	/** in 1e-3 units of the window parameter **/
+	
 	/** Structures with pointers to data of particular steps **/
 	StepStruct *Steps;
 	size_t StepCount;
@@ -442,6 +539,9 @@ typedef struct {
 	/** Structures with pseudo-pointers to starts of particular chunks in step **/
 	SignalWindow *ChunkSet;
 	size_t ChunkCount;
+	int32_t *ChunkMask;	/** OR of the steps the chunk set was found in, so that just the steps appended later are OR-ed into it; NULL if not valid **/
+	size_t ChunkMaskLength;	/** in points **/
+	size_t ChunkMaskSteps;	/** the steps 0 .. ChunkMaskSteps - 1 are OR-ed into ChunkMask **/
 	
 	/** Sorted array of DFT envelope points **/
 	double *DFTEnvelopeArray;
@@ -520,9 +620,17 @@ typedef struct {
 
 #define TDDIndexRange(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].RawDataLength)
 #define TDDDataStart(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].RawData)
+#define TDDDataStartFloat64(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].RawDataFloat64)
+#define TDDIsFloat64(NMRDataPtr, StepNo)				((((NMRDataPtr)->Steps)[StepNo].RawDataType) == RAW_TYPE_FLOAT64)
 #define TDDTime(NMRDataPtr, StepNo, Index)				(((double) (Index) - (double) ((NMRDataPtr)->SkipPoints)) / (NMRDataPtr)->SWMh + (NMRDataPtr)->TimeOffset)
-#define TDDReal(NMRDataPtr, StepNo, Index)				((((NMRDataPtr)->Steps)[StepNo].RawData)[2*(Index) + 0])
-#define TDDImag(NMRDataPtr, StepNo, Index)				((((NMRDataPtr)->Steps)[StepNo].RawData)[2*(Index) + 1])
+/** type-specific access, use just if the raw data type is known **/
+#define TDDRealInt32(NMRDataPtr, StepNo, Index)				((((NMRDataPtr)->Steps)[StepNo].RawData)[2*(Index) + 0])
+#define TDDImagInt32(NMRDataPtr, StepNo, Index)				((((NMRDataPtr)->Steps)[StepNo].RawData)[2*(Index) + 1])
+#define TDDRealFloat64(NMRDataPtr, StepNo, Index)			((((NMRDataPtr)->Steps)[StepNo].RawDataFloat64)[2*(Index) + 0])
+#define TDDImagFloat64(NMRDataPtr, StepNo, Index)			((((NMRDataPtr)->Steps)[StepNo].RawDataFloat64)[2*(Index) + 1])
+/** generic access (double) **/
+#define TDDReal(NMRDataPtr, StepNo, Index)				((TDDIsFloat64((NMRDataPtr), (StepNo)))?(TDDRealFloat64((NMRDataPtr), (StepNo), (Index))):((double) TDDRealInt32((NMRDataPtr), (StepNo), (Index))))
+#define TDDImag(NMRDataPtr, StepNo, Index)				((TDDIsFloat64((NMRDataPtr), (StepNo)))?(TDDImagFloat64((NMRDataPtr), (StepNo), (Index))):((double) TDDImagInt32((NMRDataPtr), (StepNo), (Index))))
 
 #ifdef __cplusplus
 #define TDDAmp(NMRDataPtr, StepNo, Index)				(std::sqrt(((double) TDDReal((NMRDataPtr), (StepNo), (Index)))*((double) TDDReal((NMRDataPtr), (StepNo), (Index))) + ((double) TDDImag((NMRDataPtr), (StepNo), (Index)))*((double) TDDImag((NMRDataPtr), (StepNo), (Index)))))
@@ -535,8 +643,14 @@ typedef struct {
 #define ChunkIndexRange(NMRDataPtr, ChunkNo)				(((NMRDataPtr)->ChunkSet)[ChunkNo].length)
 #define ChunkDataStart(NMRDataPtr, ChunkNo)				(((NMRDataPtr)->ChunkSet)[ChunkNo].start)
 #define ChunkTime(NMRDataPtr, StepNo, ChunkNo, Index)			TDDTime((NMRDataPtr), (StepNo), (Index) + ChunkDataStart((NMRDataPtr), (ChunkNo))/2)
-#define ChunkReal(NMRDataPtr, StepNo, ChunkNo, Index)			((((NMRDataPtr)->Steps)[StepNo].RawData + ((NMRDataPtr)->ChunkSet)[ChunkNo].start)[2*(Index) + 0])
-#define ChunkImag(NMRDataPtr, StepNo, ChunkNo, Index)			((((NMRDataPtr)->Steps)[StepNo].RawData + ((NMRDataPtr)->ChunkSet)[ChunkNo].start)[2*(Index) + 1])
+/** type-specific access, use just if the raw data type is known **/
+#define ChunkRealInt32(NMRDataPtr, StepNo, ChunkNo, Index)		((((NMRDataPtr)->Steps)[StepNo].RawData + ((NMRDataPtr)->ChunkSet)[ChunkNo].offset)[2*(Index) + 0])
+#define ChunkImagInt32(NMRDataPtr, StepNo, ChunkNo, Index)		((((NMRDataPtr)->Steps)[StepNo].RawData + ((NMRDataPtr)->ChunkSet)[ChunkNo].offset)[2*(Index) + 1])
+#define ChunkRealFloat64(NMRDataPtr, StepNo, ChunkNo, Index)		((((NMRDataPtr)->Steps)[StepNo].RawDataFloat64 + ((NMRDataPtr)->ChunkSet)[ChunkNo].offset)[2*(Index) + 0])
+#define ChunkImagFloat64(NMRDataPtr, StepNo, ChunkNo, Index)		((((NMRDataPtr)->Steps)[StepNo].RawDataFloat64 + ((NMRDataPtr)->ChunkSet)[ChunkNo].offset)[2*(Index) + 1])
+/** generic access (double) **/
+#define ChunkReal(NMRDataPtr, StepNo, ChunkNo, Index)			((TDDIsFloat64((NMRDataPtr), (StepNo)))?(ChunkRealFloat64((NMRDataPtr), (StepNo), (ChunkNo), (Index))):((double) ChunkRealInt32((NMRDataPtr), (StepNo), (ChunkNo), (Index))))
+#define ChunkImag(NMRDataPtr, StepNo, ChunkNo, Index)			((TDDIsFloat64((NMRDataPtr), (StepNo)))?(ChunkImagFloat64((NMRDataPtr), (StepNo), (ChunkNo), (Index))):((double) ChunkImagInt32((NMRDataPtr), (StepNo), (ChunkNo), (Index))))
 
 
 
@@ -557,6 +671,8 @@ typedef struct {
 #define ChunkAvgMaxAmp(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].ChunkAvgAmpMax)
 #define ChunkAvgIntAmp(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].ChunkAvgAmpInt)
 
+#define ChunkSumRow(NMRDataPtr, StepNo, ChunkNo)			(((NMRDataPtr)->Steps)[StepNo].ChunkSums + 2*((NMRDataPtr)->Steps)[StepNo].ChunkSumLength*(ChunkNo))
+
 
 /** "raw" index **/
 #define DFTIndexRange(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].DFTLength)
@@ -580,7 +696,10 @@ typedef struct {
 #define DFTPhaseCorr1Absolute(NMRDataPtr, StepNo)			((((NMRDataPtr)->Steps)[StepNo].PhaseCorr1Ref == 0)?(((NMRDataPtr)->Steps)[StepNo].PhaseCorr1):(((NMRDataPtr)->Steps)[StepNo].PhaseCorr1 + lround((((double) ((NMRDataPtr)->ChunkStart))/(NMRDataPtr)->SWMh + (NMRDataPtr)->TimeOffset)*1.0e3)))
 #endif
 
-#define DFTFreq(NMRDataPtr, StepNo, rawIndex)				((((rawIndex) > ((NMRDataPtr)->Steps[StepNo].DFTLength / 2))?((double) (rawIndex) - (double) (NMRDataPtr)->Steps[StepNo].DFTLength):((double) (rawIndex))) * (NMRDataPtr)->SWMh / ((double) (NMRDataPtr)->Steps[StepNo].DFTLength) + (NMRDataPtr)->Steps[StepNo].Freq)
+/** The DFT output is stored in the ascending order of frequency: the raw index rawIndex holds the transform point (DFTLength/2 + 1 + rawIndex) % DFTLength, 
+    the zero frequency being at DFTZeroIndex **/
+#define DFTZeroIndex(NMRDataPtr, StepNo)				(((long) (NMRDataPtr)->Steps[StepNo].DFTLength - 1)/2)
+#define DFTFreq(NMRDataPtr, StepNo, rawIndex)				((double) ((long) (rawIndex) - DFTZeroIndex((NMRDataPtr), (StepNo))) * (NMRDataPtr)->SWMh / ((double) (NMRDataPtr)->Steps[StepNo].DFTLength) + (NMRDataPtr)->Steps[StepNo].Freq)
 
 #define DFTReal(NMRDataPtr, StepNo, rawIndex)				((((NMRDataPtr)->Steps)[StepNo].DFTOutput)[2*(rawIndex) + 0])
 #define DFTImag(NMRDataPtr, StepNo, rawIndex)				((((NMRDataPtr)->Steps)[StepNo].DFTOutput)[2*(rawIndex) + 1])
@@ -590,8 +709,8 @@ typedef struct {
 #define DFTPhaseCorrAmp(NMRDataPtr, StepNo, rawIndex)			((((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrOutAmp)[rawIndex])
 
 
-#define DFTIndexToRawIndexNoFilter(NMRDataPtr, StepNo, Index) 		((((NMRDataPtr)->Steps[StepNo].DFTLength)/2 + 1 + (Index))%((NMRDataPtr)->Steps[StepNo].DFTLength))
-#define DFTIndexToRawIndexWithFilter(NMRDataPtr, StepNo, Index) 	((((NMRDataPtr)->Steps[StepNo].DFTLength)/2 + 1 + (Index) + (NMRDataPtr)->filter)%((NMRDataPtr)->Steps[StepNo].DFTLength))
+#define DFTIndexToRawIndexNoFilter(NMRDataPtr, StepNo, Index) 		(Index)
+#define DFTIndexToRawIndexWithFilter(NMRDataPtr, StepNo, Index) 	((Index) + (NMRDataPtr)->filter)
 
 #define DFTIsProcNoFilter(NMRDataPtr, StepNo, Index)			(((Index) >= (NMRDataPtr)->filter) && ((Index) < (DFTProcNoFilterIndexRange((NMRDataPtr), (StepNo)) - (NMRDataPtr)->filter2)))
 
@@ -619,15 +738,15 @@ typedef struct {
 #define DFTMaxAmpIndex(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].DFTAmpMaxPoint)
 #define DFTMaxAmp(NMRDataPtr, StepNo)					(((NMRDataPtr)->Steps)[StepNo].DFTAmpMax)
 #define DFTMeanAmp(NMRDataPtr, StepNo)					(((NMRDataPtr)->Steps)[StepNo].DFTAmpMean)
-#define DFTAmpAtZero(NMRDataPtr, StepNo)				((((NMRDataPtr)->Steps)[StepNo].DFTOutAmp)[0])
+#define DFTAmpAtZero(NMRDataPtr, StepNo)				((((NMRDataPtr)->Steps)[StepNo].DFTOutAmp)[DFTZeroIndex((NMRDataPtr), (StepNo))])
 #define DFTMaxPhaseCorrRealIndex(NMRDataPtr, StepNo)			(((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrRealMaxPoint)
 #define DFTMaxPhaseCorrReal(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrRealMax)
 #define DFTMeanPhaseCorrReal(NMRDataPtr, StepNo)			(((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrRealMean)
-#define DFTPhaseCorrRealAtZero(NMRDataPtr, StepNo)			((((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrOutput)[0])
+#define DFTPhaseCorrRealAtZero(NMRDataPtr, StepNo)			((((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrOutput)[2*DFTZeroIndex((NMRDataPtr), (StepNo))])
 #define DFTMaxPhaseCorrAmpIndex(NMRDataPtr, StepNo)			(((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrAmpMaxPoint)
 #define DFTMaxPhaseCorrAmp(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrAmpMax)
 #define DFTMeanPhaseCorrAmp(NMRDataPtr, StepNo)				(((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrAmpMean)
-#define DFTPhaseCorrAmpAtZero(NMRDataPtr, StepNo)			((((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrOutAmp)[0])
+#define DFTPhaseCorrAmpAtZero(NMRDataPtr, StepNo)			((((NMRDataPtr)->Steps)[StepNo].DFTPhaseCorrOutAmp)[DFTZeroIndex((NMRDataPtr), (StepNo))])
 
 #ifdef __cplusplus
 #define DFTFreqToFilter(NMRDataPtr, Freq)				((((Freq) < (((NMRDataPtr)->SWMh)/2)) && ((Freq) > 0.0))?(ChooseMax(0, std::lround(std::ceil(- ((double) (NMRDataPtr)->DFTLength) / (NMRDataPtr)->SWMh * (Freq) + ((long) (NMRDataPtr)->DFTLength - 1)/2)))):(0))
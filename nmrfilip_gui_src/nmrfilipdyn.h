@@ -38,9 +38,12 @@ typedef int (*InitNMRDataFunc)(NMRData *);
 typedef int (*CheckNMRDataFunc)(NMRData *, unsigned int, long);
 typedef int (*RefreshNMRDataFunc)(NMRData *);
 typedef int (*ReloadNMRDataFunc)(NMRData *);
+typedef int (*ReloadNMRDataIncrementalFunc)(NMRData *);
 typedef int (*FreeNMRDataFunc)(NMRData *);
 
 typedef void (*CleanupOnExitFunc)();
+typedef int (*LoadDFTWisdomFunc)(const char *);
+typedef int (*GetDFTZoomFunc)(NMRData *, long, double, double, size_t, double *);
 
 typedef int (*GetProcParamFunc)(NMRData *, unsigned int, unsigned int, void *, long *);
 typedef int (*SetProcParamFunc)(NMRData *, unsigned int, unsigned int, void *, long *);
@@ -56,6 +59,10 @@ typedef int (*ReadUserlistFunc)(NMRData *, char *, UserlistParams *);
 typedef int (*WriteUserlistFunc)(NMRData *, char *, UserlistParams *);
 typedef int (*FreeUserlistFunc)(NMRData *, UserlistParams *);
 
+/** Processed data cache **/
+typedef int (*LoadNMRDataCacheFunc)(NMRData *);
+typedef int (*SaveNMRDataCacheFunc)(NMRData *);
+
 #ifdef __cplusplus
 }
 #endif
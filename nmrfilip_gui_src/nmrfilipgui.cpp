@@ -21,6 +21,7 @@
 #include "nmrfilipgui.h"
 #include <wx/clipbrd.h>
 #include <wx/filename.h>
+#include <wx/stdpaths.h>
 
 #include "nmrdata.h"
 #include "doc.h"
@@ -43,6 +44,7 @@ NMRFilipGUIApp::NMRFilipGUIApp()
 	NFGNMRData::FreeNMRData = NULL;
 	NFGNMRData::RefreshNMRData = NULL;
 	NFGNMRData::ReloadNMRData = NULL;
+	NFGNMRData::ReloadNMRDataIncremental = NULL;
 	
 	NFGNMRData::CheckProcParam = NULL;
 	NFGNMRData::GetProcParam = NULL;
@@ -54,7 +56,12 @@ NMRFilipGUIApp::NMRFilipGUIApp()
 	NFGNMRData::ReadUserlist = NULL;
 	NFGNMRData::WriteUserlist = NULL;
 
+	NFGNMRData::LoadNMRDataCache = NULL;
+	NFGNMRData::SaveNMRDataCache = NULL;
+
 	NFGNMRData::CleanupOnExit = NULL;
+	NFGNMRData::LoadDFTWisdom = NULL;
+	NFGNMRData::GetDFTZoom = NULL;
 }
 
 NMRFilipGUIApp::~NMRFilipGUIApp()
@@ -85,6 +92,7 @@ bool NMRFilipGUIApp::OnInit()
 	NFGNMRData::FreeNMRData = (FreeNMRDataFunc) NMRFilipCoreDll->GetSymbol("FreeNMRData");
 	NFGNMRData::RefreshNMRData = (RefreshNMRDataFunc) NMRFilipCoreDll->GetSymbol("RefreshNMRData");
 	NFGNMRData::ReloadNMRData = (ReloadNMRDataFunc) NMRFilipCoreDll->GetSymbol("ReloadNMRData");
+	NFGNMRData::ReloadNMRDataIncremental = (ReloadNMRDataIncrementalFunc) NMRFilipCoreDll->GetSymbol("ReloadNMRDataIncremental");
 	
 	NFGNMRData::CheckProcParam = (CheckProcParamFunc) NMRFilipCoreDll->GetSymbol("CheckProcParam");
 	NFGNMRData::GetProcParam = (GetProcParamFunc) NMRFilipCoreDll->GetSymbol("GetProcParam");
@@ -98,16 +106,23 @@ bool NMRFilipGUIApp::OnInit()
 	NFGNMRData::WriteUserlist = (WriteUserlistFunc) NMRFilipCoreDll->GetSymbol("WriteUserlist");
 	NFGNMRData::FreeUserlist = (FreeUserlistFunc) NMRFilipCoreDll->GetSymbol("FreeUserlist");
 	
+	NFGNMRData::LoadNMRDataCache = (LoadNMRDataCacheFunc) NMRFilipCoreDll->GetSymbol("LoadNMRDataCache");
+	NFGNMRData::SaveNMRDataCache = (SaveNMRDataCacheFunc) NMRFilipCoreDll->GetSymbol("SaveNMRDataCache");
+	
 	NFGNMRData::CleanupOnExit = (CleanupOnExitFunc) NMRFilipCoreDll->GetSymbol("CleanupOnExit");
+	NFGNMRData::LoadDFTWisdom = (LoadDFTWisdomFunc) NMRFilipCoreDll->GetSymbol("LoadDFTWisdom");
+	NFGNMRData::GetDFTZoom = (GetDFTZoomFunc) NMRFilipCoreDll->GetSymbol("GetDFTZoom");
 	
 	if ( 
 		(NFGNMRData::InitNMRData == NULL) || (NFGNMRData::CheckNMRData == NULL) || (NFGNMRData::FreeNMRData == NULL) || 
-		(NFGNMRData::RefreshNMRData == NULL) || (NFGNMRData::ReloadNMRData == NULL) ||
+		(NFGNMRData::RefreshNMRData == NULL) || (NFGNMRData::ReloadNMRData == NULL) || (NFGNMRData::ReloadNMRDataIncremental == NULL) ||
 		(NFGNMRData::CheckProcParam == NULL) || (NFGNMRData::GetProcParam == NULL) || (NFGNMRData::SetProcParam == NULL) ||
 		(NFGNMRData::ImportProcParams == NULL) || (NFGNMRData::DataToText == NULL) ||
 		(NFGNMRData::InitUserlist == NULL) || (NFGNMRData::ReadUserlist == NULL) || 
 		(NFGNMRData::WriteUserlist == NULL) || (NFGNMRData::FreeUserlist == NULL) || 
-		(NFGNMRData::CleanupOnExit == NULL)
+		(NFGNMRData::LoadNMRDataCache == NULL) || (NFGNMRData::SaveNMRDataCache == NULL) || 
+		(NFGNMRData::CleanupOnExit == NULL) || (NFGNMRData::LoadDFTWisdom == NULL) || 
+		(NFGNMRData::GetDFTZoom == NULL)
 	) {
 		wxLogError("Some functions of the NMRFilip core library not found.");
 		return false;
@@ -134,6 +149,11 @@ bool NMRFilipGUIApp::OnInit()
 	SetAppName("NMRFilip GUI");
 	SetAppDisplayName("NMRFilip GUI beta");
 	
+	/// the FFTW wisdom is kept in the user data directory, the core library stores it back in CleanupOnExit()
+	wxFileName WisdomFile(wxStandardPaths::Get().GetUserDataDir(), "fftw.wisdom");
+	if (WisdomFile.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL))
+		NFGNMRData::LoadDFTWisdom(WisdomFile.GetFullPath().char_str(*wxConvFileName));
+	
 	/// Create the application frame
 	frame = new NMRFilipGUIFrame(m_docManager, NULL, wxID_ANY, GetAppDisplayName(), wxPoint(0, 0), wxSize(500, 400), style);
 	
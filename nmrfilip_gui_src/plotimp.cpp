@@ -63,7 +63,7 @@ NFGGraphTDD::NFGGraphTDD(NMRData* NMRDataPtr, NFGSerDocument* document, unsigned
 	AltCurvePenBW.SetStyle(wxPENSTYLE_TRANSPARENT);
 
 	DataseriesGroupArray[1].NMRDataPointer = NMRDataPointer;
-	DataseriesGroupArray[1].WatchedNMRData = CHECK_ChunkSet;
+	DataseriesGroupArray[1].WatchedNMRData = CHECK_RawData;
 	DataseriesGroupArray[1].GetNMRPts = NFGNMRData::GetTDDRealPts;
 	DataseriesGroupArray[1].GetNMRRPtBB = NFGNMRData::GetTDDRealRPtBB;
 	DataseriesGroupArray[1].GetNMRFlag = NFGNMRData::GetStepFlag;
@@ -99,7 +99,7 @@ NFGGraphTDD::NFGGraphTDD(NMRData* NMRDataPtr, NFGSerDocument* document, unsigned
 	AltCurvePenThick.SetColour(wxColour(224, 255, 224));
 	
 	DataseriesGroupArray[0].NMRDataPointer = NMRDataPointer;
-	DataseriesGroupArray[0].WatchedNMRData = CHECK_ChunkSet;
+	DataseriesGroupArray[0].WatchedNMRData = CHECK_RawData;
 	DataseriesGroupArray[0].GetNMRPts = NFGNMRData::GetTDDImagPts;
 	DataseriesGroupArray[0].GetNMRRPtBB = NFGNMRData::GetTDDImagRPtBB;
 	DataseriesGroupArray[0].GetNMRFlag = NFGNMRData::GetStepFlag;
@@ -134,7 +134,7 @@ NFGGraphTDD::NFGGraphTDD(NMRData* NMRDataPtr, NFGSerDocument* document, unsigned
 	AltCurvePenThick.SetColour(wxColour(224, 224, 255));
 
 	DataseriesGroupArray[2].NMRDataPointer = NMRDataPointer;
-	DataseriesGroupArray[2].WatchedNMRData = CHECK_ChunkSet;
+	DataseriesGroupArray[2].WatchedNMRData = CHECK_RawData;
 	DataseriesGroupArray[2].GetNMRPts = NFGNMRData::GetTDDAmpPts;
 	DataseriesGroupArray[2].GetNMRRPtBB = NFGNMRData::GetTDDAmpRPtBB;
 	DataseriesGroupArray[2].GetNMRFlag = NFGNMRData::GetStepFlag;
@@ -514,6 +514,13 @@ void NFGGraphChunkAvg::SelectStep(unsigned long index)
 
 NFGGraphFFT::NFGGraphFFT(NMRData* NMRDataPtr, NFGSerDocument* document, unsigned char style) : NFGGraph(NMRDataPtr, document, style, Flag(CHECK_DFTPhaseCorr_ReIm) | Flag(CHECK_DFTPhaseCorr_Amp), Flag(PROC_PARAM_Filter))
 {
+	ZoomData = NULL;
+	ZoomPoints = NULL;
+	ZoomBufferLength = 0;
+	ZoomFreqMin = 0.0;
+	ZoomFreqMax = 0.0;
+	ZoomValid = false;
+	
 	DisplayedDatasets = 	(1ul << (ID_FFTReal - DatasetIDMin)) | 
 					(1ul << (ID_FFTImag - DatasetIDMin)) |
 					(1ul << (ID_FFTModule - DatasetIDMin));
@@ -670,6 +677,8 @@ NFGGraphFFT::NFGGraphFFT(NMRData* NMRDataPtr, NFGSerDocument* document, unsigned
 
 NFGGraphFFT::~NFGGraphFFT()
 {
+	std::free(ZoomData);
+	std::free(ZoomPoints);
 }
 
 wxString NFGGraphFFT::GetGraphLabel()
@@ -684,7 +693,8 @@ NFGRealRect NFGGraphFFT::GetBoundingRealRect()
 
 NFGCurveSet NFGGraphFFT::GetCurveSet()
 {
-	if (CurveSetValid)
+	/// The zoomed curves cover just the neighbourhood of the visible window, so they need to be recalculated after scrolling away
+	if (CurveSetValid && (!ZoomValid || ((VisibleRealRect.x >= ZoomFreqMin) && ((VisibleRealRect.x + VisibleRealRect.width) <= ZoomFreqMax))))
 		return CurveSet;
 	
 	NFGNMRData::CheckProcParam(NMRDataPointer, PROC_PARAM_DFTLength, PARAM_LONG, NULL, NULL);
@@ -704,12 +714,111 @@ NFGCurveSet NFGGraphFFT::GetCurveSet()
 		
 		return EmptyCurveSet;
 	}
+	
+	/// The plain DFT points are kept if the zoom is not applicable or fails
+	ZoomValid = GetZoomCurves(Start, End);
 
 	CurveSetValid = true;
+	OptimizedCurveSetValid = false;
 
 	return CurveSet;
 }
 
+/// Replaces the curve bodies (i.e. the parts not suppressed by the filter) by the spectrum evaluated by the chirp-z zoom at one point per pixel 
+/// within the visible window and one more window width on either side
+bool NFGGraphFFT::GetZoomCurves(long start, long end)
+{
+	if ((NMRDataPointer == NULL) || (NMRDataPointer->Steps == NULL) || (SelectedStep >= NMRDataPointer->StepCount) || (NMRDataPointer->DFTLength == 0))
+		return false;
+	
+	if (!(NMRDataPointer->SWMh > 0.0) || !(ScaleValue.xfactor > 0.0) || (start < 0) || (end <= start))
+		return false;
+	
+	if (!(VisibleRealRect.width * GraphFFTZoomMinRatio < NMRDataPointer->SWMh) || 
+		!(VisibleRealRect.width / NMRDataPointer->SWMh * NMRDataPointer->DFTLength * GraphFFTZoomMinPixels < GWClientSize.GetWidth()))
+		return false;
+	
+	if (CurveSet.CurveCount < 3*DataseriesGroupCount)
+		return false;
+	
+	double CoveredMin = VisibleRealRect.x - VisibleRealRect.width;
+	double CoveredMax = VisibleRealRect.x + 2.0*VisibleRealRect.width;
+	double FreqMin = NFGMSTD fmax(DFTProcNoFilterFreq(NMRDataPointer, SelectedStep, start), CoveredMin);
+	double FreqMax = NFGMSTD fmin(DFTProcNoFilterFreq(NMRDataPointer, SelectedStep, end), CoveredMax);
+	
+	if (!(FreqMax > FreqMin))
+		return false;
+	
+	size_t Count = NFGNMRData::llroundnu((FreqMax - FreqMin) * ScaleValue.xfactor) + 1;
+	if (Count < 2)
+		return false;
+	
+	if (Count > ZoomBufferLength) {
+		double* auxdata = (double*) std::realloc(ZoomData, Count*2*sizeof(double));
+		if (auxdata == NULL)
+			return false;
+		ZoomData = auxdata;
+		
+		wxPoint* auxptr = (wxPoint*) std::realloc(ZoomPoints, Count*3*sizeof(wxPoint));
+		if (auxptr == NULL)
+			return false;
+		ZoomPoints = auxptr;
+		
+		ZoomBufferLength = Count;
+	}
+	
+	if (NFGNMRData::GetDFTZoom(NMRDataPointer, SelectedStep, FreqMin, FreqMax, Count, ZoomData) != DATA_OK)
+		return false;
+	
+	/// The groups of the imaginary part, the real part and the modulus
+	for (unsigned long i = 0; i < DataseriesGroupCount; i++) {
+		/// Only the selected step is plotted - the curve body of the group i is the last of its head, tail and body
+		NFGCurve &curve = CurveSet.CurveArray[3*i + 2];
+		
+		if (!(DataseriesGroupArray[i].KeyItem.DatasetFlag & DisplayedDatasets) || (curve.PointCount == 0))
+			continue;
+		
+		wxPoint* points = ZoomPoints + i*Count;
+		wxCoord miny = 0;
+		wxCoord maxy = 0;
+		
+		for (size_t k = 0; k < Count; k++) {
+			double Freq = FreqMin + (FreqMax - FreqMin) * k / (Count - 1);
+			double Val = 0.0;
+			
+			switch (i) {
+				case 0:
+					Val = ZoomData[2*k + 1];
+					break;
+				case 1:
+					Val = ZoomData[2*k + 0];
+					break;
+				default:
+					Val = std::sqrt(ZoomData[2*k + 0]*ZoomData[2*k + 0] + ZoomData[2*k + 1]*ZoomData[2*k + 1]);
+			}
+			
+			points[k].x = NFGNMRData::llroundnu(Freq*ScaleValue.xfactor) - ScaleValue.xoffset;
+			points[k].y = NFGNMRData::llroundnu(Val*ScaleValue.yfactor) - ScaleValue.yoffset;
+			
+			if ((k == 0) || (points[k].y < miny))
+				miny = points[k].y;
+			if ((k == 0) || (points[k].y > maxy))
+				maxy = points[k].y;
+		}
+		
+		curve.PointArray = points;
+		curve.PointCount = Count;
+		curve.BufferLength = Count;
+		curve.ElisionCount = 0;
+		curve.BoundingBox = wxRect(points[0].x, miny, points[Count - 1].x - points[0].x + 1, maxy - miny + 1);
+	}
+	
+	ZoomFreqMin = CoveredMin;
+	ZoomFreqMax = CoveredMax;
+	
+	return true;
+}
+
 NFGRealRect NFGGraphFFT::GetSelectedStepBoundingRealRect()
 {
 	return NFGGraph::GetSelectedStepBoundingRealRect();
@@ -74,8 +74,25 @@ class NFGGraphChunkAvg : public NFGGraph
 
 #define GraphTypeFFT	4
 
+/// The curves are evaluated by the chirp-z zoom if the visible frequency window is narrower than 1/GraphFFTZoomMinRatio of the spectral width 
+/// and the DFT points in it are sparser than one per GraphFFTZoomMinPixels pixels
+#define GraphFFTZoomMinRatio	8
+#define GraphFFTZoomMinPixels	2
+
 class NFGGraphFFT : public NFGGraph
 {
+	private:
+		double* ZoomData;
+		wxPoint* ZoomPoints;
+		size_t ZoomBufferLength;
+		
+		/// Frequency range covered by the zoomed curves
+		double ZoomFreqMin;
+		double ZoomFreqMax;
+		bool ZoomValid;
+		
+		bool GetZoomCurves(long start, long end);
+		
 	public:
 		NFGGraphFFT(NMRData* NMRDataPtr, NFGSerDocument* document, unsigned char style);
 		~NFGGraphFFT();
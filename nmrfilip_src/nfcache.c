@@ -0,0 +1,530 @@
+/* 
+ * NMRFilip LIB - the NMR data processing software - core library
+ * Copyright (C) 2026 NMRFilip contributors
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <inttypes.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "nmrfilip.h"
+
+#include "nfload.h"
+#include "nfproc.h"
+#include "nfcache.h"
+
+
+/** Returns the name of the cache file belonging to the datafile, the caller is responsible for freeing it **/
+char *GetNMRDataCacheName(NMRData *NMRDataStruct) {
+	char *CacheName = NULL;
+
+	if ((NMRDataStruct == NULL) || (NMRDataStruct->SerName == NULL))
+		return NULL;
+
+	CacheName = (char *) malloc(strlen(NMRDataStruct->SerName) + strlen(NMRDATA_CACHE_SUFFIX) + 1);
+	if (CacheName == NULL)
+		return NULL;
+
+	strcpy(CacheName, NMRDataStruct->SerName);
+	strcat(CacheName, NMRDATA_CACHE_SUFFIX);
+
+	return CacheName;
+}
+
+/** 64-bit FNV-1a, start with Hash = 14695981039346656037 **/
+uint64_t HashCacheBytes(uint64_t Hash, const void *Data, size_t Length) {
+	const unsigned char *Bytes = (const unsigned char *) Data;
+	size_t i = 0;
+
+	for (i = 0; i < Length; i++) {
+		Hash ^= Bytes[i];
+		Hash *= UINT64_C(1099511628211);
+	}
+
+	return Hash;
+}
+
+/** Hashes the start and the end of the datafile and several evenly spaced blocks in between, so that the whole datafile need not be read **/
+int HashDatafileSample(NMRData *NMRDataStruct, uint64_t SerSize, uint64_t *Hash) {
+	unsigned char *Buffer = NULL;
+	FILE *ser = NULL;
+	uint64_t Offset[NMRDATA_CACHE_SAMPLE_COUNT + 2];
+	size_t Length[NMRDATA_CACHE_SAMPLE_COUNT + 2];
+	size_t i = 0;
+	int RetVal = DATA_OK;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	*Hash = UINT64_C(14695981039346656037);
+	*Hash = HashCacheBytes(*Hash, &SerSize, sizeof(SerSize));
+
+	Offset[0] = 0;
+	Length[0] = (SerSize < NMRDATA_CACHE_SAMPLE_EDGE)?(SerSize):(NMRDATA_CACHE_SAMPLE_EDGE);
+	Offset[1] = SerSize - Length[0];
+	Length[1] = Length[0];
+	for (i = 0; i < NMRDATA_CACHE_SAMPLE_COUNT; i++) {
+		Offset[i + 2] = (SerSize / (NMRDATA_CACHE_SAMPLE_COUNT + 1)) * (i + 1);
+		Length[i + 2] = ((SerSize - Offset[i + 2]) < NMRDATA_CACHE_SAMPLE_BLOCK)?(SerSize - Offset[i + 2]):(NMRDATA_CACHE_SAMPLE_BLOCK);
+	}
+
+	Buffer = (unsigned char *) malloc(NMRDATA_CACHE_SAMPLE_EDGE);
+	if (Buffer == NULL)
+		return MEM_ALLOC_ERROR;
+
+	ser = fopen(NMRDataStruct->SerName, "rb");
+	if (ser == NULL) {
+		free(Buffer);
+		return FILE_OPEN_ERROR;
+	}
+
+	for (i = 0; (i < NMRDATA_CACHE_SAMPLE_COUNT + 2) && (RetVal == DATA_OK); i++) {
+		if ((Offset[i] > (uint64_t) LONG_MAX) || fseek(ser, (long) Offset[i], SEEK_SET) || (fread(Buffer, 1, Length[i], ser) != Length[i]))
+			RetVal = FILE_IO_ERROR;
+		else
+			*Hash = HashCacheBytes(*Hash, Buffer, Length[i]);
+	}
+
+	fclose(ser);
+	free(Buffer);
+
+	return RetVal;
+}
+
+/** Fills in the keys binding the cache to the datafile, just the datafile name is needed **/
+int GetNMRDataCacheKeys(NMRData *NMRDataStruct, NMRDataCacheHeader *Header) {
+	struct stat SerStat;
+	int RetVal = DATA_OK;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	memset(Header, 0, sizeof(NMRDataCacheHeader));
+	memcpy(Header->Magic, NMRDATA_CACHE_MAGIC, sizeof(Header->Magic));
+	Header->Version = NMRDATA_CACHE_VERSION;
+	Header->ByteOrderMark = NMRDATA_CACHE_BOM;
+
+	if ((NMRDataStruct->SerName == NULL) || stat(NMRDataStruct->SerName, &SerStat))
+		return FILE_OPEN_ERROR;
+
+	Header->SerSize = SerStat.st_size;
+	Header->SerMTime = SerStat.st_mtime;
+
+	if ((RetVal = HashDatafileSample(NMRDataStruct, Header->SerSize, &(Header->ContentHash))) != DATA_OK)
+		return RetVal;
+
+	return DATA_OK;
+}
+
+/** Fills in the keys binding the cache to the current step set, requires the step set (but not the raw data) **/
+int GetNMRDataCacheLayout(NMRData *NMRDataStruct, NMRDataCacheHeader *Header) {
+	uint64_t Value = 0;
+	size_t i = 0;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0))
+		return DATA_EMPTY;
+
+	/** The chunk set depends also on the data layout, the digital filter artifacts and the ignored steps **/
+	Header->LayoutHash = UINT64_C(14695981039346656037);
+	Value = NMRDataStruct->PointLine;
+	Header->LayoutHash = HashCacheBytes(Header->LayoutHash, &Value, sizeof(Value));
+	Value = NMRDataStruct->TimeDomain;
+	Header->LayoutHash = HashCacheBytes(Header->LayoutHash, &Value, sizeof(Value));
+	Value = NMRDataStruct->DTypA;
+	Header->LayoutHash = HashCacheBytes(Header->LayoutHash, &Value, sizeof(Value));
+	Value = NMRDataStruct->ByteOrder;
+	Header->LayoutHash = HashCacheBytes(Header->LayoutHash, &Value, sizeof(Value));
+	Value = NMRDataStruct->SkipPoints;
+	Header->LayoutHash = HashCacheBytes(Header->LayoutHash, &Value, sizeof(Value));
+
+	for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
+		Value = StepFlag(NMRDataStruct, i) & STEP_IGNORE;
+		Header->LayoutHash = HashCacheBytes(Header->LayoutHash, &Value, sizeof(Value));
+	}
+
+	Header->StepCount = StepNoRange(NMRDataStruct);
+
+	return DATA_OK;
+}
+
+/** Reads the header and the data following it if the cache belongs to the datafile and if it is complete and intact, the caller is responsible for freeing the data. 
+    Nothing of the dataset is needed except the datafile name, so the cache is checked before the datafile gets loaded. 
+    Returns DATA_EMPTY if there is no cache and DATA_OLD if it does not match the datafile or if it is truncated or corrupt. **/
+int ReadNMRDataCache(NMRData *NMRDataStruct, NMRDataCacheHeader *Header, unsigned char **Data) {
+	FILE *cache = NULL;
+	char *CacheName = NULL;
+	NMRDataCacheHeader Current;
+	long FileLength = 0;
+	uint64_t DataLength = 0;
+	uint64_t ExpectedLength = 0;
+	int RetVal = DATA_OK;
+
+	*Data = NULL;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((CacheName = GetNMRDataCacheName(NMRDataStruct)) == NULL)
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+
+	cache = fopen(CacheName, "rb");
+	free(CacheName);
+	if (cache == NULL)
+		return DATA_EMPTY;
+
+	if ((fread(Header, sizeof(NMRDataCacheHeader), 1, cache) != 1) || (GetNMRDataCacheKeys(NMRDataStruct, &Current) != DATA_OK) ||
+		memcmp(Header->Magic, Current.Magic, sizeof(Current.Magic)) || (Header->Version != Current.Version) || (Header->ByteOrderMark != Current.ByteOrderMark) ||
+		(Header->SerSize != Current.SerSize) || (Header->SerMTime != Current.SerMTime) || (Header->ContentHash != Current.ContentHash) ||
+		(Header->StepCount == 0) || !(Header->Contents & Flag(CHECK_ChunkSet)) || 
+		fseek(cache, 0, SEEK_END) || ((FileLength = ftell(cache)) < (long) sizeof(NMRDataCacheHeader)) || fseek(cache, (long) sizeof(NMRDataCacheHeader), SEEK_SET)) {
+		fclose(cache);
+		return DATA_OLD;
+	}
+
+	/** The counts are bounded by the file length first, so that a damaged header cannot overflow the expected length **/
+	DataLength = FileLength - sizeof(NMRDataCacheHeader);
+	if ((Header->ChunkCount > DataLength/(2*sizeof(int64_t))) || (Header->StepCount > DataLength) || 
+		((Header->Contents & Flag(CHECK_ChunkAvg)) && (Header->ChunkAvgLength > DataLength/(3*sizeof(double))/Header->StepCount))) {
+		fclose(cache);
+		return DATA_OLD;
+	}
+
+	ExpectedLength = Header->ChunkCount*2*sizeof(int64_t) + Header->StepCount;
+	if (Header->Contents & Flag(CHECK_ChunkAvg))
+		ExpectedLength += Header->StepCount*Header->ChunkAvgLength*3*sizeof(double);
+
+	if ((ExpectedLength != DataLength) || (DataLength > SIZE_MAX)) {
+		fclose(cache);
+		return DATA_OLD;
+	}
+
+	*Data = (unsigned char *) malloc(DataLength);
+	if (*Data == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating processed data cache memory space");
+		fclose(cache);
+		return (MEM_ALLOC_ERROR | DATA_OLD);
+	}
+
+	if ((fread(*Data, 1, DataLength, cache) != DataLength) || (HashCacheBytes(UINT64_C(14695981039346656037), *Data, DataLength) != Header->DataHash)) {
+		free(*Data);
+		*Data = NULL;
+		RetVal = DATA_OLD;
+	}
+
+	fclose(cache);
+
+	return RetVal;
+}
+
+
+
+/** Restores the processed data from the cache as far as they correspond to the datafile and to the current processing parameters.
+    The cache is checked against the datafile first, then the chunk set is restored and the chunk averages if the chunk set is valid. 
+    The DFT results are not stored, they are obtained from the restored chunk averages again. 
+    The raw data are not loaded for the restored chunk set, a step is read just when its chunks are used (see GetChunkRawData), the empty steps are taken from the cache. 
+    It might be called again after changing the processing parameters to restore the parts invalidated by the change.
+    Returns DATA_EMPTY if there is no cache and DATA_OLD if the cache does not match the datafile or if it is damaged. **/
+EXPORT int LoadNMRDataCache(NMRData *NMRDataStruct) {
+	NMRDataCacheHeader Header;
+	NMRDataCacheHeader Current;
+	unsigned char *Data = NULL;
+	const unsigned char *Position = NULL;
+	SignalWindow *AuxChunkSet = NULL;
+	double *AuxPointerDouble = NULL;
+	int64_t Window[2] = {0, 0};
+	size_t i = 0;
+	long Val = 0;
+	int RetVal = DATA_OK;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+
+	if ((RetVal = ReadNMRDataCache(NMRDataStruct, &Header, &Data)) != DATA_OK)
+		return RetVal;
+
+	/** Nothing is read from the datafile to create the step set **/
+	if ((RetVal = CheckNMRData(NMRDataStruct, CHECK_StepSet, ALL_STEPS)) != DATA_OK) {
+		free(Data);
+		return RetVal;
+	}
+
+	if ((GetNMRDataCacheLayout(NMRDataStruct, &Current) != DATA_OK) || (Header.LayoutHash != Current.LayoutHash) || (Header.StepCount != Current.StepCount)) {
+		free(Data);
+		return DATA_OLD;
+	}
+
+	/** Chunk set and empty steps **/
+	AuxChunkSet = (SignalWindow *) malloc((Header.ChunkCount + 1)*sizeof(SignalWindow));
+	if (AuxChunkSet == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk set memory space");
+		free(Data);
+		return (MEM_ALLOC_ERROR | DATA_OLD);
+	}
+
+	for (i = 0, Position = Data; (i < Header.ChunkCount) && (RetVal == DATA_OK); i++, Position += sizeof(Window)) {
+		memcpy(Window, Position, sizeof(Window));
+
+		/** The chunks must lie within the steps, the chunk data would be read out of them otherwise **/
+		if ((Window[0] < 0) || (Window[1] < 0) || (((uint64_t) Window[0])/2 + ((uint64_t) Window[1]) > NMRDataStruct->TimeDomain/2))
+			RetVal = DATA_OLD;
+
+		AuxChunkSet[i].start = (intptr_t) Window[0];
+		AuxChunkSet[i].length = (size_t) Window[1];
+		AuxChunkSet[i].offset = AuxChunkSet[i].start;
+	}
+
+	if (RetVal == DATA_OK) {
+		if (!(NMRDataStruct->Flags & Flag(CHECK_ChunkSet))) {
+			/** The offsets of the compacted data belong to the former chunk set **/
+			if ((NMRDataStruct->ChunkSpace != NULL) && (ExpandRawData(NMRDataStruct) != DATA_OK))
+				RetVal = DATA_OLD;
+
+			if (RetVal == DATA_OK) {
+				FreeChunkSums(NMRDataStruct, ALL_STEPS);
+				FreeChunkMask(NMRDataStruct);
+				free(NMRDataStruct->ChunkSet);
+				NMRDataStruct->ChunkSet = AuxChunkSet;
+				NMRDataStruct->ChunkCount = Header.ChunkCount;
+				AuxChunkSet = NULL;
+
+				for (i = 0; i < StepNoRange(NMRDataStruct); i++)
+					StepFlag(NMRDataStruct, i) = (StepFlag(NMRDataStruct, i) & ~STEP_BLANK) | (Position[i] & STEP_BLANK);
+
+				MarkNMRDataValid(NMRDataStruct, CHECK_ChunkSet, ALL_STEPS);
+			}
+		} else {
+			/** The chunk set is valid already, the rest of the cache is usable only if it was obtained with the same one **/
+			if (Header.ChunkCount != NMRDataStruct->ChunkCount)
+				RetVal = DATA_OLD;
+
+			for (i = 0; (i < Header.ChunkCount) && (RetVal == DATA_OK); i++)
+				if ((AuxChunkSet[i].start != NMRDataStruct->ChunkSet[i].start) || (AuxChunkSet[i].length != NMRDataStruct->ChunkSet[i].length))
+					RetVal = DATA_OLD;
+		}
+	}
+
+	free(AuxChunkSet);
+	Position += Header.StepCount;
+
+	if (RetVal != DATA_OK) {
+		free(Data);
+		return RetVal;
+	}
+
+	/** Chunk averages, restored only if obtained with the current (checked) range of chunks **/
+	if (((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_FirstChunk, PARAM_LONG, &Val, NULL)) != DATA_OK) ||
+		((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &Val, NULL)) != DATA_OK)) {
+		free(Data);
+		return RetVal;
+	}
+
+	if (!(Header.Contents & Flag(CHECK_ChunkAvg)) || (NMRDataStruct->Flags & Flag(CHECK_ChunkAvg)) || 
+		(Header.FirstChunk != NMRDataStruct->FirstChunk) || (Header.LastChunk != NMRDataStruct->LastChunk)) {
+		free(Data);
+		return DATA_OK;
+	}
+
+	for (i = 0; (i < StepNoRange(NMRDataStruct)) && (RetVal == DATA_OK); i++) {
+		if (Header.ChunkAvgLength == 0) {
+			free(ChunkAvgDataStart(NMRDataStruct, i));
+			ChunkAvgDataStart(NMRDataStruct, i) = NULL;
+			free(ChunkAvgDataAmpStart(NMRDataStruct, i));
+			ChunkAvgDataAmpStart(NMRDataStruct, i) = NULL;
+			ChunkAvgIndexRange(NMRDataStruct, i) = 0;
+			continue;
+		}
+		
+		if ((Header.ChunkAvgLength != ChunkAvgIndexRange(NMRDataStruct, i)) || (ChunkAvgDataStart(NMRDataStruct, i) == NULL) || (ChunkAvgDataAmpStart(NMRDataStruct, i) == NULL)) {
+			AuxPointerDouble = ChunkAvgDataStart(NMRDataStruct, i);
+			ChunkAvgDataStart(NMRDataStruct, i) = (double *) realloc(ChunkAvgDataStart(NMRDataStruct, i), 2*Header.ChunkAvgLength*sizeof(double));
+
+			if (ChunkAvgDataStart(NMRDataStruct, i) == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk average data memory space");
+				free(AuxPointerDouble);
+				AuxPointerDouble = NULL;
+				ChunkAvgIndexRange(NMRDataStruct, i) = 0;
+				RetVal = (MEM_ALLOC_ERROR | DATA_INVALID);
+				break;
+			}
+
+			AuxPointerDouble = ChunkAvgDataAmpStart(NMRDataStruct, i);
+			ChunkAvgDataAmpStart(NMRDataStruct, i) = (double *) realloc(ChunkAvgDataAmpStart(NMRDataStruct, i), Header.ChunkAvgLength*sizeof(double));
+
+			if (ChunkAvgDataAmpStart(NMRDataStruct, i) == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk average data memory space");
+				free(AuxPointerDouble);
+				AuxPointerDouble = NULL;
+				ChunkAvgIndexRange(NMRDataStruct, i) = 0;
+				RetVal = (MEM_ALLOC_ERROR | DATA_INVALID);
+				break;
+			}
+
+			ChunkAvgIndexRange(NMRDataStruct, i) = Header.ChunkAvgLength;
+		}
+
+		memcpy(ChunkAvgDataStart(NMRDataStruct, i), Position, 2*Header.ChunkAvgLength*sizeof(double));
+		Position += 2*Header.ChunkAvgLength*sizeof(double);
+		memcpy(ChunkAvgDataAmpStart(NMRDataStruct, i), Position, Header.ChunkAvgLength*sizeof(double));
+		Position += Header.ChunkAvgLength*sizeof(double);
+	}
+
+	free(Data);
+
+	if (RetVal != DATA_OK) {
+		MarkNMRDataOld(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+		return RetVal;
+	}
+
+	MarkNMRDataValid(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+
+	return DATA_OK;
+}
+
+
+/** Stores the valid part of the chunk set and chunk averages to the cache, nothing is computed. 
+    The cache is not written if it holds the same data (or even more of them) already, so that closing a dataset without any change of the processing costs no writing. 
+    Returns DATA_EMPTY if there is nothing to store (i.e. the chunk set is not valid). **/
+EXPORT int SaveNMRDataCache(NMRData *NMRDataStruct) {
+	FILE *cache = NULL;
+	char *CacheName = NULL;
+	NMRDataCacheHeader Header;
+	NMRDataCacheHeader Stored;
+	unsigned char *Data = NULL;
+	unsigned char AuxStepFlag = 0;
+	int64_t Window[2] = {0, 0};
+	int Unchanged = 0;
+	size_t i = 0;
+	int RetVal = DATA_OK;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+
+	if (!(NMRDataStruct->Flags & Flag(CHECK_ChunkSet)) || (NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0))
+		return DATA_EMPTY;
+
+	if (((RetVal = GetNMRDataCacheKeys(NMRDataStruct, &Header)) != DATA_OK) || ((RetVal = GetNMRDataCacheLayout(NMRDataStruct, &Header)) != DATA_OK)) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Reading datafile for processed data cache");
+		return (RetVal | DATA_OLD);
+	}
+
+	Header.Contents = Flag(CHECK_ChunkSet);
+	Header.ChunkCount = ChunkNoRange(NMRDataStruct);
+
+	if (NMRDataStruct->Flags & Flag(CHECK_ChunkAvg)) {
+		Header.Contents |= Flag(CHECK_ChunkAvg);
+		Header.ChunkAvgLength = ChunkAvgIndexRange(NMRDataStruct, 0);
+		Header.FirstChunk = NMRDataStruct->FirstChunk;
+		Header.LastChunk = NMRDataStruct->LastChunk;
+
+		for (i = 0; i < StepNoRange(NMRDataStruct); i++)
+			if ((ChunkAvgIndexRange(NMRDataStruct, i) != Header.ChunkAvgLength) ||
+				((Header.ChunkAvgLength > 0) && ((ChunkAvgDataStart(NMRDataStruct, i) == NULL) || (ChunkAvgDataAmpStart(NMRDataStruct, i) == NULL))))
+				Header.Contents &= ~Flag(CHECK_ChunkAvg);
+	}
+
+	/** The stored data are determined by the datafile, the step set and the chunk range, so the same chunk set and chunk range mean the same data **/
+	if (ReadNMRDataCache(NMRDataStruct, &Stored, &Data) == DATA_OK) {
+		Unchanged = (Stored.LayoutHash == Header.LayoutHash) && (Stored.StepCount == Header.StepCount) && (Stored.ChunkCount == Header.ChunkCount);
+
+		for (i = 0; (i < Header.ChunkCount) && Unchanged; i++) {
+			memcpy(Window, Data + i*sizeof(Window), sizeof(Window));
+			Unchanged = (Window[0] == (int64_t) NMRDataStruct->ChunkSet[i].start) && (Window[1] == (int64_t) NMRDataStruct->ChunkSet[i].length);
+		}
+
+		if (Unchanged && (Header.Contents & Flag(CHECK_ChunkAvg)))
+			Unchanged = (Stored.Contents & Flag(CHECK_ChunkAvg)) && (Stored.ChunkAvgLength == Header.ChunkAvgLength) && 
+				(Stored.FirstChunk == Header.FirstChunk) && (Stored.LastChunk == Header.LastChunk);
+
+		free(Data);
+
+		if (Unchanged)
+			return DATA_OK;
+	}
+
+	if ((CacheName = GetNMRDataCacheName(NMRDataStruct)) == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating processed data cache file name");
+		return MEM_ALLOC_ERROR;
+	}
+
+	cache = fopen(CacheName, "wb");
+	if (cache == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Opening processed data cache");
+		free(CacheName);
+		return FILE_OPEN_ERROR;
+	}
+
+	/** The header gets written again with the data hash at the end **/
+	Header.DataHash = UINT64_C(14695981039346656037);
+	if (fwrite(&Header, sizeof(Header), 1, cache) != 1)
+		RetVal = FILE_IO_ERROR;
+
+	for (i = 0; (i < ChunkNoRange(NMRDataStruct)) && (RetVal == DATA_OK); i++) {
+		Window[0] = NMRDataStruct->ChunkSet[i].start;
+		Window[1] = NMRDataStruct->ChunkSet[i].length;
+		Header.DataHash = HashCacheBytes(Header.DataHash, Window, sizeof(Window));
+		if (fwrite(Window, sizeof(Window), 1, cache) != 1)
+			RetVal = FILE_IO_ERROR;
+	}
+
+	for (i = 0; (i < StepNoRange(NMRDataStruct)) && (RetVal == DATA_OK); i++) {
+		AuxStepFlag = StepFlag(NMRDataStruct, i) & STEP_BLANK;
+		Header.DataHash = HashCacheBytes(Header.DataHash, &AuxStepFlag, 1);
+		if (fwrite(&AuxStepFlag, 1, 1, cache) != 1)
+			RetVal = FILE_IO_ERROR;
+	}
+
+	if (Header.Contents & Flag(CHECK_ChunkAvg)) {
+		for (i = 0; (i < StepNoRange(NMRDataStruct)) && (RetVal == DATA_OK); i++) {
+			Header.DataHash = HashCacheBytes(Header.DataHash, ChunkAvgDataStart(NMRDataStruct, i), 2*Header.ChunkAvgLength*sizeof(double));
+			Header.DataHash = HashCacheBytes(Header.DataHash, ChunkAvgDataAmpStart(NMRDataStruct, i), Header.ChunkAvgLength*sizeof(double));
+			if ((fwrite(ChunkAvgDataStart(NMRDataStruct, i), 2*sizeof(double), Header.ChunkAvgLength, cache) != Header.ChunkAvgLength) ||
+				(fwrite(ChunkAvgDataAmpStart(NMRDataStruct, i), sizeof(double), Header.ChunkAvgLength, cache) != Header.ChunkAvgLength))
+				RetVal = FILE_IO_ERROR;
+		}
+	}
+
+	if ((RetVal == DATA_OK) && (fseek(cache, 0, SEEK_SET) || (fwrite(&Header, sizeof(Header), 1, cache) != 1)))
+		RetVal = FILE_IO_ERROR;
+
+	if (fclose(cache) != 0)
+		RetVal |= FILE_IO_ERROR;
+
+	/** An incomplete cache would be just ignored, but it is better not to leave it behind **/
+	if (RetVal != DATA_OK) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Writing processed data cache");
+		remove(CacheName);
+	}
+
+	free(CacheName);
+
+	return RetVal;
+}
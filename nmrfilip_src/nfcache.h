@@ -0,0 +1,81 @@
+/* 
+ * NMRFilip LIB - the NMR data processing software - core library
+ * Copyright (C) 2026 NMRFilip contributors
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ */
+
+#ifndef __nfcache_h__
+#define __nfcache_h__
+
+#include <stdio.h>
+
+#include "nmrfilipcmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Processed data cache stored next to the datafile (SerName with NMRDATA_CACHE_SUFFIX appended).
+    It holds the chunk set and the chunk averages together with the processing parameters they were obtained with, the DFT results are obtained from the averages again.
+    The cache is bound to the datafile by its size, modification time and a hash of its sampled content, its data are protected by a hash as well. **/
+EXPORT int LoadNMRDataCache(NMRData *NMRDataStruct);
+EXPORT int SaveNMRDataCache(NMRData *NMRDataStruct);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define NMRDATA_CACHE_SUFFIX	".nfcache"
+#define NMRDATA_CACHE_MAGIC	"NFCACHE\x1A"
+#define NMRDATA_CACHE_VERSION	4
+#define NMRDATA_CACHE_BOM	0x01020304u	/** the cache is stored in the host byte order, files from other hosts are ignored **/
+
+#define NMRDATA_CACHE_SAMPLE_EDGE	65536	/** bytes hashed at the start and at the end of the datafile **/
+#define NMRDATA_CACHE_SAMPLE_BLOCK	4096	/** bytes hashed at each of the evenly spaced positions in between **/
+#define NMRDATA_CACHE_SAMPLE_COUNT	16
+
+typedef struct {
+	char Magic[8];
+	uint32_t Version;
+	uint32_t ByteOrderMark;
+
+	/** Keys **/
+	uint64_t SerSize;
+	int64_t SerMTime;
+	uint64_t ContentHash;	/** hash of the sampled datafile content **/
+	uint64_t LayoutHash;	/** hash of the parameters determining the step and chunk layout **/
+	uint64_t StepCount;
+
+	/** Contents **/
+	uint64_t Contents;	/** Flag(CHECK_...) of the stored data **/
+	uint64_t ChunkCount;
+	uint64_t ChunkAvgLength;
+	uint64_t DataHash;	/** hash of the data following the header **/
+
+	/** Processing parameters of the stored data **/
+	uint64_t FirstChunk;
+	uint64_t LastChunk;
+} NMRDataCacheHeader;
+
+char *GetNMRDataCacheName(NMRData *NMRDataStruct);
+uint64_t HashCacheBytes(uint64_t Hash, const void *Data, size_t Length);
+int HashDatafileSample(NMRData *NMRDataStruct, uint64_t SerSize, uint64_t *Hash);
+int GetNMRDataCacheKeys(NMRData *NMRDataStruct, NMRDataCacheHeader *Header);
+int GetNMRDataCacheLayout(NMRData *NMRDataStruct, NMRDataCacheHeader *Header);
+int ReadNMRDataCache(NMRData *NMRDataStruct, NMRDataCacheHeader *Header, unsigned char **Data);
+
+#endif
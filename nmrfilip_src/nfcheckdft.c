@@ -0,0 +1,944 @@
+/*
+ * NMRFilip CHECK - the NMR data processing software - checks and benchmarks of the DFT
+ * Copyright (C) 2026 NMRFilip contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "nmrfilipcheck.h"
+
+
+#define DFT_CHECK_POINTS	64	/** frequencies of the DFT output compared with the direct sums in each checked step... **/
+#define DFT_CHECK_STEPS	4	/** ...in this many steps at most **/
+#define ZOOM_CHECK_POINTS	256	/** the zoomed spectrum is compared with this many points of the phase-corrected DFT around its maximum **/
+#define DOWNCONVERT_PADDING	64	/** the downconversion is checked with DFTLength of this many times the processed length... **/
+#define DOWNCONVERT_BAND	32	/** ...and the filtered band of this fraction of the spectral width **/
+#if SINGLE_PRECISION
+#define DOWNCONVERT_TOLERANCE	1.0e-5	/** relative to the maximum amplitude of the band, see DFT_DOWNCONVERT_ATTENUATION **/
+#else
+#define DOWNCONVERT_TOLERANCE	1.0e-6
+#endif
+#define DFT_MAX_PADDING	256	/** the DFT is checked with DFTLength up to this many times the processed length **/
+#define DFT_ROUNDING_CHECK_LENGTH	20000	/** the friendly lengths are compared with counting up to this length **/
+
+
+/** The DFT of the processed part of the chunk average at the frequency of the point RawIndex of the DFT output, summed directly in double 
+    with the window computed point by point, the angles reduced exactly in integers **/
+void ReferenceDFTPoint(NMRData *NMRDataStruct, size_t StepNo, size_t RawIndex, double *Re, double *Im) {
+	uint64_t Length = 0;
+	uint64_t Freq = 0;
+	size_t DataLength = 0;
+	size_t n = 0;
+	double Window = 0.0;
+	double Angle = 0.0;
+	double DataRe = 0.0;
+	double DataIm = 0.0;
+	
+	*Re = 0.0;
+	*Im = 0.0;
+	
+	Length = DFTIndexRange(NMRDataStruct, StepNo);
+	DataLength = ChunkAvgProcIndexRange(NMRDataStruct, StepNo);
+	if (DataLength > Length)
+		DataLength = Length;
+	
+	Freq = (uint64_t) ((((long) RawIndex - DFTZeroIndex(NMRDataStruct, StepNo)) % (long) Length + (long) Length) % (long) Length);
+	
+	for (n = 0; n < DataLength; n++) {
+		Window = GetDFTWindowPoint(NMRDataStruct, n, ChunkAvgProcIndexRange(NMRDataStruct, StepNo));
+		if ((n == 0) && NMRDataStruct->ScaleFirstTDPoint)
+			Window *= 0.5;
+		
+		DataRe = Window*ChunkAvgProcReal(NMRDataStruct, StepNo, n);
+		DataIm = Window*ChunkAvgProcImag(NMRDataStruct, StepNo, n);
+		Angle = -2.0*M_PI*((double) ((Freq*n) % Length))/((double) Length);
+		
+		*Re += DataRe*cos(Angle) - DataIm*sin(Angle);
+		*Im += DataRe*sin(Angle) + DataIm*cos(Angle);
+	}
+}
+
+/** Compares the DFT output (and its amplitude) of up to DFT_CHECK_STEPS steps with the direct sums at DFT_CHECK_POINTS frequencies and at the maximum, 
+    the deviations relative to the maximum amplitude of the step; in the SINGLE_PRECISION build this is the deviation from the double pipeline. 
+    Returns the number of the points compared. **/
+size_t GetDFTDeviation(NMRData *NMRDataStruct, double *MaxDeviation, double *MaxAmpDeviation) {
+	size_t Length = 0;
+	size_t Stride = 0;
+	size_t StepStride = 0;
+	size_t MaxIndex = 0;
+	size_t Points = 0;
+	size_t i = 0;
+	size_t k = 0;
+	double Re = 0.0;
+	double Im = 0.0;
+	double MaxAmp = 0.0;
+	double Deviation = 0.0;
+	
+	*MaxDeviation = 0.0;
+	*MaxAmpDeviation = 0.0;
+	
+	StepStride = (StepNoRange(NMRDataStruct) + DFT_CHECK_STEPS - 1)/DFT_CHECK_STEPS;
+	if (StepStride == 0)
+		StepStride = 1;
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k += StepStride) {
+		Length = DFTIndexRange(NMRDataStruct, k);
+		if ((Length == 0) || (ChunkAvgProcIndexRange(NMRDataStruct, k) == 0) || (StepFlag(NMRDataStruct, k) & STEP_BLANK))
+			continue;
+		
+		MaxAmp = 0.0;
+		MaxIndex = 0;
+		for (i = 0; i < Length; i++) {
+			if (DFTAmp(NMRDataStruct, k, i) > MaxAmp) {
+				MaxAmp = DFTAmp(NMRDataStruct, k, i);
+				MaxIndex = i;
+			}
+		}
+		
+		if (MaxAmp == 0.0)
+			continue;
+		
+		Stride = (Length > DFT_CHECK_POINTS)?(Length/DFT_CHECK_POINTS):(1);
+		for (i = 0; i < Length + Stride; i += Stride) {
+			/** the last round checks the maximum **/
+			if (i >= Length)
+				i = MaxIndex;
+			
+			ReferenceDFTPoint(NMRDataStruct, k, i, &Re, &Im);
+			Points++;
+			
+			Deviation = hypot(DFTReal(NMRDataStruct, k, i) - Re, DFTImag(NMRDataStruct, k, i) - Im)/MaxAmp;
+			if (Deviation > *MaxDeviation)
+				*MaxDeviation = Deviation;
+			
+			Deviation = fabs(DFTAmp(NMRDataStruct, k, i) - hypot(Re, Im))/MaxAmp;
+			if (Deviation > *MaxAmpDeviation)
+				*MaxAmpDeviation = Deviation;
+			
+			if (i == MaxIndex)
+				break;
+		}
+	}
+	
+	return Points;
+}
+
+void CheckDFT(NMRData *NMRDataStruct, const char *Name) {
+	size_t Points = 0;
+	size_t AmpMismatches = 0;
+	size_t i = 0;
+	size_t k = 0;
+	double MaxDeviation = 0.0;
+	double MaxAmpDeviation = 0.0;
+	NMRReal Amp = 0.0;
+	
+	if (CheckNMRData(NMRDataStruct, CHECK_DFTResult, ALL_STEPS) != DATA_OK) {
+		Check(0, "%s: DFT cannot be computed", Name);
+		return;
+	}
+	
+	Points = GetDFTDeviation(NMRDataStruct, &MaxDeviation, &MaxAmpDeviation);
+	
+	/** the amplitudes of the output must be bit for bit those of hypot **/
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		for (i = 0; i < DFTIndexRange(NMRDataStruct, k); i++) {
+			Amp = hypot(DFTReal(NMRDataStruct, k, i), DFTImag(NMRDataStruct, k, i));
+			if (memcmp(&Amp, &(DFTAmp(NMRDataStruct, k, i)), sizeof(NMRReal)) != 0)
+				AmpMismatches++;
+		}
+	}
+	Check(AmpMismatches == 0, "%s: DFT amplitudes identical to hypot of the output (%lu mismatches)", Name, (unsigned long) AmpMismatches);
+	
+	Check((Points > 0) && (MaxDeviation <= DFT_TOLERANCE), "%s: DFT output within %.0e of the double direct sums (maximum deviation %.2e of the maximum amplitude, %lu points, %s DFT)", 
+		Name, DFT_TOLERANCE, MaxDeviation, (unsigned long) Points, DFT_PRECISION);
+	Check((Points > 0) && (MaxAmpDeviation <= DFT_TOLERANCE), "%s: DFT amplitude within %.0e of the double direct sums (maximum deviation %.2e of the maximum amplitude)", 
+		Name, DFT_TOLERANCE, MaxAmpDeviation);
+}
+
+/** The DFT of the processed part of the chunk average at all the transform points in the order of the FFT (zero frequency first), 
+    summed directly in double with the angles taken from a table, Output holds 2*DFTIndexRange values **/
+int ReferenceDFT(NMRData *NMRDataStruct, size_t StepNo, double *Output) {
+	size_t Length = 0;
+	size_t DataLength = 0;
+	size_t t = 0;
+	size_t n = 0;
+	double *Cos = NULL;
+	double *Sin = NULL;
+	double Window = 0.0;
+	double DataRe = 0.0;
+	double DataIm = 0.0;
+	
+	Length = DFTIndexRange(NMRDataStruct, StepNo);
+	DataLength = ChunkAvgProcIndexRange(NMRDataStruct, StepNo);
+	if (DataLength > Length)
+		DataLength = Length;
+	
+	Cos = (double *) malloc(Length*sizeof(double));
+	Sin = (double *) malloc(Length*sizeof(double));
+	if ((Cos == NULL) || (Sin == NULL)) {
+		free(Cos);
+		free(Sin);
+		return MEM_ALLOC_ERROR;
+	}
+	
+	for (t = 0; t < Length; t++) {
+		Cos[t] = cos(-2.0*M_PI*((double) t)/((double) Length));
+		Sin[t] = sin(-2.0*M_PI*((double) t)/((double) Length));
+	}
+	
+	memset(Output, 0, 2*Length*sizeof(double));
+	for (n = 0; n < DataLength; n++) {
+		Window = GetDFTWindowPoint(NMRDataStruct, n, ChunkAvgProcIndexRange(NMRDataStruct, StepNo));
+		if ((n == 0) && NMRDataStruct->ScaleFirstTDPoint)
+			Window *= 0.5;
+		
+		DataRe = Window*ChunkAvgProcReal(NMRDataStruct, StepNo, n);
+		DataIm = Window*ChunkAvgProcImag(NMRDataStruct, StepNo, n);
+		
+		for (t = 0; t < Length; t++) {
+			Output[2*t] += DataRe*Cos[(t*n) % Length] - DataIm*Sin[(t*n) % Length];
+			Output[2*t + 1] += DataRe*Sin[(t*n) % Length] + DataIm*Cos[(t*n) % Length];
+		}
+	}
+	
+	free(Cos);
+	free(Sin);
+	
+	return DATA_OK;
+}
+
+/** Compares the DFT output stored in the ascending order of frequency with the transform in the order of the FFT mapped explicitly as before the output was stored so, 
+    i.e. the point Index of the processed range at the transform point (DFTLength/2 + 1 + Index + filter) % DFTLength and the frequency of the transform point t 
+    at t or t - DFTLength above DFTLength/2; for even and odd DFTLength by the full-length and by the pruned transform, with the filter on. 
+    The values must be within DFT_TOLERANCE of the direct sums, the frequencies and the zero frequency index must agree. **/
+void CheckDFTOrder(NMRData *NMRDataStruct, const char *Name) {
+	size_t Lengths[4];
+	size_t DataLength = 0;
+	size_t Length = 0;
+	size_t StepStride = 0;
+	size_t Points = 0;
+	size_t Mismatches = 0;
+	size_t Steps = 0;
+	size_t t = 0;
+	size_t i = 0;
+	size_t k = 0;
+	size_t l = 0;
+	long SavedLength = 0;
+	long SavedTolerance = 0;
+	long SavedFilter = 0;
+	long SavedDownconvert = 0;
+	long Val = 0;
+	double *Reference = NULL;
+	double MaxAmp = 0.0;
+	double Freq = 0.0;
+	double Deviation = 0.0;
+	double MaxDeviation = 0.0;
+	
+	if ((StepNoRange(NMRDataStruct) == 0) || (NMRDataStruct->SWMh <= 0.0))
+		return;
+	
+	SavedLength = NMRDataStruct->DFTLength;
+	SavedTolerance = NMRDataStruct->DFTLengthTolerance;
+	SavedFilter = NMRDataStruct->FilterHz;
+	SavedDownconvert = NMRDataStruct->DFTDownconvert;
+	DataLength = NMRDataStruct->ChunkEnd + 1 - NMRDataStruct->ChunkStart;
+	
+	/** even and odd, the padded ones pruned **/
+	Lengths[0] = DataLength + (DataLength % 2);
+	Lengths[1] = Lengths[0] + 1;
+	Lengths[2] = DFT_PRUNE_MIN_RATIO*Lengths[0];
+	Lengths[3] = (DFT_PRUNE_MIN_RATIO + 1)*Lengths[1];
+	
+	Val = 0;
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLengthTolerance, PARAM_LONG, &Val, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTDownconvert, PARAM_LONG, &Val, NULL);
+	
+	StepStride = (StepNoRange(NMRDataStruct) + DFT_CHECK_STEPS - 1)/DFT_CHECK_STEPS;
+	if (StepStride == 0)
+		StepStride = 1;
+	
+	for (l = 0; (l < sizeof(Lengths)/sizeof(Lengths[0])) && (MaxDeviation < INFINITY); l++) {
+		Val = (long) Lengths[l];
+		SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &Val, NULL);
+		/** the filter in points depends on DFTLength **/
+		Val = lround(1.0e6*NMRDataStruct->SWMh/8);
+		SetProcParam(NMRDataStruct, PROC_PARAM_Filter, PARAM_LONG, &Val, NULL);
+		
+		if ((NMRDataStruct->DFTLength != Lengths[l]) || (NMRDataStruct->filter == 0) || (RunStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult) != DATA_OK) || 
+			((Reference = (double *) realloc(Reference, 2*Lengths[l]*sizeof(double))) == NULL)) {
+			MaxDeviation = INFINITY;
+			break;
+		}
+		
+		for (k = 0; k < StepNoRange(NMRDataStruct); k += StepStride) {
+			Length = DFTIndexRange(NMRDataStruct, k);
+			if ((ChunkAvgProcIndexRange(NMRDataStruct, k) == 0) || (StepFlag(NMRDataStruct, k) & STEP_BLANK))
+				continue;
+			
+			if (ReferenceDFT(NMRDataStruct, k, Reference) != DATA_OK) {
+				MaxDeviation = INFINITY;
+				break;
+			}
+			
+			for (t = 0, MaxAmp = 0.0; t < Length; t++)
+				MaxAmp = ChooseMax(MaxAmp, hypot(Reference[2*t], Reference[2*t + 1]));
+			if (MaxAmp == 0.0)
+				continue;
+			
+			Steps++;
+			for (i = 0; i < DFTProcIndexRange(NMRDataStruct, k); i++, Points++) {
+				t = (Length/2 + 1 + i + NMRDataStruct->filter) % Length;
+				
+				Deviation = hypot(DFTProcReal(NMRDataStruct, k, i) - Reference[2*t], DFTProcImag(NMRDataStruct, k, i) - Reference[2*t + 1])/MaxAmp;
+				if (Deviation > MaxDeviation)
+					MaxDeviation = Deviation;
+				
+				Freq = ((t > Length/2)?((double) t - (double) Length):((double) t))*NMRDataStruct->SWMh/((double) Length) + NMRDataStruct->Steps[k].Freq;
+				if ((fabs(DFTProcFreq(NMRDataStruct, k, i) - Freq) > 1.0e-9*NMRDataStruct->SWMh) || 
+					(fabs(DFTFreq(NMRDataStruct, k, DFTIndexToRawIndexWithFilter(NMRDataStruct, k, i)) - Freq) > 1.0e-9*NMRDataStruct->SWMh))
+					Mismatches++;
+			}
+			
+			/** the whole output without the filter **/
+			for (i = 0; i < Length; i++) {
+				t = (Length/2 + 1 + i) % Length;
+				
+				Deviation = hypot(DFTProcNoFilterReal(NMRDataStruct, k, i) - Reference[2*t], DFTProcNoFilterImag(NMRDataStruct, k, i) - Reference[2*t + 1])/MaxAmp;
+				if (Deviation > MaxDeviation)
+					MaxDeviation = Deviation;
+				
+				if ((t == 0) != ((long) i == DFTZeroIndex(NMRDataStruct, k)))
+					Mismatches++;
+			}
+			
+			if (DFTFreq(NMRDataStruct, k, DFTZeroIndex(NMRDataStruct, k)) != NMRDataStruct->Steps[k].Freq)
+				Mismatches++;
+		}
+	}
+	
+	free(Reference);
+	
+	Check((Steps > 0) && (MaxDeviation <= DFT_TOLERANCE), "%s: filtered DFT of %lu, %lu, %lu and %lu points in the order of frequency within %.0e of the direct sums mapped explicitly (maximum deviation %.2e, %lu points)", 
+		Name, (unsigned long) Lengths[0], (unsigned long) Lengths[1], (unsigned long) Lengths[2], (unsigned long) Lengths[3], DFT_TOLERANCE, MaxDeviation, (unsigned long) Points);
+	Check((Steps > 0) && (Mismatches == 0), "%s: DFT frequencies and the zero frequency index identical to the explicit mapping (%lu mismatches)", Name, (unsigned long) Mismatches);
+	
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTDownconvert, PARAM_LONG, &SavedDownconvert, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLengthTolerance, PARAM_LONG, &SavedTolerance, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &SavedLength, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_Filter, PARAM_LONG, &SavedFilter, NULL);
+}
+
+/** Transforms the windowed and zero-padded processed part of the chunk average of the step out of place, from Input into Output (2*DFTIndexRange NMRReal each), 
+    in the way the DFT was obtained before it was done in place, and reorders Output into the order of frequency **/
+int ReferenceOutOfPlaceDFT(NMRData *NMRDataStruct, size_t StepNo, NMRReal *Input, NMRReal *Output) {
+	DFTCacheData *Cache = NULL;
+	DFT_FFTW(plan) Plan = NULL;
+	
+	if (((Cache = GetDFTCache(NMRDataStruct)) == NULL) || (Cache->Window.Length != ChunkAvgProcIndexRange(NMRDataStruct, StepNo)))
+		return DATA_INVALID;
+	
+	Plan = DFT_FFTW(plan_dft_1d)((int) DFTIndexRange(NMRDataStruct, StepNo), (DFT_FFTW(complex) *) Input, (DFT_FFTW(complex) *) Output, FFTW_FORWARD, FFTW_ESTIMATE);
+	if (Plan == NULL)
+		return DATA_INVALID;
+	
+	WindowReal(Input, ChunkAvgProcStart(NMRDataStruct, StepNo), Cache->Window.Coefs, ChunkAvgProcIndexRange(NMRDataStruct, StepNo), DFTIndexRange(NMRDataStruct, StepNo));
+	DFT_FFTW(execute_dft)(Plan, (DFT_FFTW(complex) *) Input, (DFT_FFTW(complex) *) Output);
+	DFT_FFTW(destroy_plan)(Plan);
+	
+	ShiftDFTOutput(Output, DFTIndexRange(NMRDataStruct, StepNo));
+	
+	return DATA_OK;
+}
+
+/** Compares the DFT transformed in place with the out-of-place transform of a separate input, and its first point kept in DFTInputFirst with the first point 
+    of that input, without and with the offset removal (the phase-corrected output must equal the reference transform rotated by the phase correction less 
+    the offset of the first input point); the pruned DFT must keep the same first point. Reports the DFT data allocated in place and with the separate input. **/
+void CheckInPlaceDFT(NMRData *NMRDataStruct, const char *Name) {
+	NMRReal *Input = NULL;
+	NMRReal *Output = NULL;
+	double *First = NULL;
+	size_t Length = 0;
+	size_t Steps = 0;
+	size_t Mismatches = 0;
+	size_t i = 0;
+	size_t k = 0;
+	long SavedLength = 0;
+	long SavedScale = 0;
+	long SavedOffset = 0;
+	long Offset = 0;
+	long Val = 0;
+	int RetVal = DATA_OK;
+	double MaxAmp = 0.0;
+	double Angle = 0.0;
+	double Re = 0.0;
+	double Im = 0.0;
+	double ReOffset = 0.0;
+	double ImOffset = 0.0;
+	double Deviation = 0.0;
+	double MaxDeviation = 0.0;
+	double MaxFirstDeviation = 0.0;
+	double MaxOffsetDeviation = 0.0;
+	
+	if (StepNoRange(NMRDataStruct) == 0)
+		return;
+	
+	SavedLength = NMRDataStruct->DFTLength;
+	SavedScale = NMRDataStruct->ScaleFirstTDPoint;
+	SavedOffset = NMRDataStruct->RemoveOffset;
+	
+	/** the processed length, transformed by the full-length DFT **/
+	Val = (long) (NMRDataStruct->ChunkEnd + 1 - NMRDataStruct->ChunkStart);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &Val, NULL);
+	
+	Length = NMRDataStruct->DFTLength;
+	Input = (NMRReal *) DFT_FFTW(malloc)(2*Length*sizeof(NMRReal));
+	Output = (NMRReal *) DFT_FFTW(malloc)(2*Length*sizeof(NMRReal));
+	First = (double *) malloc(2*StepNoRange(NMRDataStruct)*sizeof(double));
+	if ((Input == NULL) || (Output == NULL) || (First == NULL)) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	/** the offset removal turns the first point scaling off **/
+	for (Offset = 0; (Offset <= 1) && (RetVal == DATA_OK); Offset++) {
+		SetProcParam(NMRDataStruct, PROC_PARAM_RemoveOffset, PARAM_LONG, &Offset, NULL);
+		if ((RetVal = RunStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTPhaseCorr)) != DATA_OK)
+			break;
+		
+		for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+			if ((DFTIndexRange(NMRDataStruct, k) != Length) || ((RetVal = ReferenceOutOfPlaceDFT(NMRDataStruct, k, Input, Output)) != DATA_OK)) {
+				RetVal |= DATA_INVALID;
+				break;
+			}
+			
+			First[2*k] = NMRDataStruct->Steps[k].DFTInputFirst[0];
+			First[2*k + 1] = NMRDataStruct->Steps[k].DFTInputFirst[1];
+			
+			MaxAmp = 0.0;
+			for (i = 0; i < Length; i++)
+				MaxAmp = ChooseMax(MaxAmp, hypot(Output[2*i], Output[2*i + 1]));
+			if (MaxAmp == 0.0)
+				continue;
+			
+			Steps++;
+			for (i = 0; i < Length; i++) {
+				Deviation = hypot(DFTReal(NMRDataStruct, k, i) - Output[2*i], DFTImag(NMRDataStruct, k, i) - Output[2*i + 1])/MaxAmp;
+				if (Deviation > MaxDeviation)
+					MaxDeviation = Deviation;
+			}
+			
+			Deviation = hypot(NMRDataStruct->Steps[k].DFTInputFirst[0] - Input[0], NMRDataStruct->Steps[k].DFTInputFirst[1] - Input[1])/MaxAmp;
+			if (Deviation > MaxFirstDeviation)
+				MaxFirstDeviation = Deviation;
+			
+			if (!NMRDataStruct->RemoveOffset)
+				continue;
+			
+			/** the phase correction and the offset removal as in GetDFTPhaseCorrResult, of the first input point **/
+			Angle = M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, k);
+			ReOffset = (cos(Angle)*Input[0] - sin(Angle)*Input[1])*(0.5 + 0.001*DFTPhaseCorr1Relative(NMRDataStruct, k)*(NMRDataStruct->SWMh));
+			ImOffset = (cos(Angle)*Input[1] + sin(Angle)*Input[0])*(0.5 + 0.001*DFTPhaseCorr1Relative(NMRDataStruct, k)*(NMRDataStruct->SWMh));
+			
+			for (i = 0; i < Length; i++) {
+				Angle = M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, k) + 2*M_PI*0.001*DFTPhaseCorr1Relative(NMRDataStruct, k)*(DFTFreq(NMRDataStruct, k, i) - StepFreq(NMRDataStruct, k));
+				Re = cos(Angle)*Output[2*i] - sin(Angle)*Output[2*i + 1] - ReOffset;
+				Im = cos(Angle)*Output[2*i + 1] + sin(Angle)*Output[2*i] - ImOffset;
+				
+				Deviation = hypot(DFTPhaseCorrReal(NMRDataStruct, k, i) - Re, DFTPhaseCorrImag(NMRDataStruct, k, i) - Im)/MaxAmp;
+				if (Deviation > MaxOffsetDeviation)
+					MaxOffsetDeviation = Deviation;
+			}
+		}
+	}
+	
+	Check((RetVal == DATA_OK) && (Steps > 0) && (MaxDeviation <= DFT_TOLERANCE), "%s: DFT of %lu points in place within %.0e of the out-of-place transform (maximum deviation %.2e)", 
+		Name, (unsigned long) Length, DFT_TOLERANCE, MaxDeviation);
+	Check((RetVal == DATA_OK) && (Steps > 0) && (MaxFirstDeviation <= DFT_TOLERANCE), "%s: DFTInputFirst within %.0e of the first point of the out-of-place input (maximum deviation %.2e)", 
+		Name, DFT_TOLERANCE, MaxFirstDeviation);
+	Check((RetVal == DATA_OK) && (Steps > 0) && (MaxOffsetDeviation <= DFT_TOLERANCE), "%s: offset removed by DFTInputFirst within %.0e of the one of the out-of-place input (maximum deviation %.2e)", 
+		Name, DFT_TOLERANCE, MaxOffsetDeviation);
+	
+	/** the one output and one amplitude space of all the steps, formerly with the input space of the same size as the output **/
+	for (k = 0; (k < StepNoRange(NMRDataStruct)) && (RetVal == DATA_OK); k++)
+		if ((NMRDataStruct->Steps[k].DFTOutput != NMRDataStruct->Steps[0].DFTOutput + 2*k*Length) || (NMRDataStruct->Steps[k].DFTOutAmp != NMRDataStruct->Steps[0].DFTOutAmp + k*Length))
+			Mismatches++;
+	
+	Check((RetVal == DATA_OK) && (Mismatches == 0), "%s: DFT data of %lu steps allocated in place %.2f MiB, with the separate input %.2f MiB", Name, (unsigned long) StepNoRange(NMRDataStruct), 
+		((double) (StepNoRange(NMRDataStruct)*Length*3*sizeof(NMRReal)))/1048576.0, ((double) (StepNoRange(NMRDataStruct)*Length*5*sizeof(NMRReal)))/1048576.0);
+	
+	/** the pruned DFT keeps the first point as well **/
+	if (RetVal == DATA_OK) {
+		Val = (long) (DFT_PRUNE_MIN_RATIO*Length);
+		SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &Val, NULL);
+		RetVal = RunStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+		
+		for (k = 0, Mismatches = 0; (k < StepNoRange(NMRDataStruct)) && (RetVal == DATA_OK); k++)
+			if (memcmp(First + 2*k, NMRDataStruct->Steps[k].DFTInputFirst, 2*sizeof(double)) != 0)
+				Mismatches++;
+		
+		Check((RetVal == DATA_OK) && (GetPrunedDFTLength(NMRDataStruct, Length) > 0) && (Mismatches == 0), "%s: DFTInputFirst of the pruned DFT identical to the full-length one (%lu mismatches)", 
+			Name, (unsigned long) Mismatches);
+	}
+	
+	DFT_FFTW(free)(Input);
+	DFT_FFTW(free)(Output);
+	free(First);
+	
+	SetProcParam(NMRDataStruct, PROC_PARAM_RemoveOffset, PARAM_LONG, &SavedOffset, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_ScaleFirstTDPoint, PARAM_LONG, &SavedScale, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &SavedLength, NULL);
+}
+
+typedef struct {
+	NMRData *NMRDataStruct;
+	size_t StepNo;
+	double FreqStart;
+	double FreqEnd;
+	size_t Count;
+	double *Output;
+	int RetVal;
+} ZoomBenchArg;
+
+void ZoomBench(void *Arg) {
+	ZoomBenchArg *Bench = (ZoomBenchArg *) Arg;
+	
+	Bench->RetVal = GetDFTZoom(Bench->NMRDataStruct, Bench->StepNo, Bench->FreqStart, Bench->FreqEnd, Bench->Count, Bench->Output);
+}
+
+/** Compares the zoomed spectrum (GetDFTZoom) at the frequencies of ZOOM_CHECK_POINTS points of the DFT output around its maximum 
+    with the phase-corrected DFT output of up to DFT_CHECK_STEPS steps, relative to its maximum amplitude **/
+void CheckZoom(NMRData *NMRDataStruct, const char *Name) {
+	ZoomBenchArg BenchArg;
+	double Output[2*ZOOM_CHECK_POINTS];
+	size_t Length = 0;
+	size_t Count = 0;
+	size_t Start = 0;
+	size_t StepStride = 0;
+	size_t MaxIndex = 0;
+	size_t Steps = 0;
+	size_t i = 0;
+	size_t k = 0;
+	long SavedLength = 0;
+	long PaddedLength = 0;
+	double MaxAmp = 0.0;
+	double Deviation = 0.0;
+	double MaxDeviation = 0.0;
+	double Time = 0.0;
+	double DFTTime = 0.0;
+	
+	if (CheckNMRData(NMRDataStruct, CHECK_DFTPhaseCorr, ALL_STEPS) != DATA_OK) {
+		Check(0, "%s: phase-corrected DFT cannot be computed", Name);
+		return;
+	}
+	
+	StepStride = (StepNoRange(NMRDataStruct) + DFT_CHECK_STEPS - 1)/DFT_CHECK_STEPS;
+	if (StepStride == 0)
+		StepStride = 1;
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k += StepStride) {
+		Length = DFTIndexRange(NMRDataStruct, k);
+		if ((Length == 0) || (ChunkAvgProcIndexRange(NMRDataStruct, k) == 0) || (StepFlag(NMRDataStruct, k) & STEP_BLANK))
+			continue;
+		
+		MaxAmp = 0.0;
+		MaxIndex = 0;
+		for (i = 0; i < Length; i++) {
+			if (DFTPhaseCorrAmp(NMRDataStruct, k, i) > MaxAmp) {
+				MaxAmp = DFTPhaseCorrAmp(NMRDataStruct, k, i);
+				MaxIndex = i;
+			}
+		}
+		
+		if (MaxAmp == 0.0)
+			continue;
+		
+		Count = (Length < ZOOM_CHECK_POINTS)?(Length):(ZOOM_CHECK_POINTS);
+		Start = (MaxIndex > Count/2)?(MaxIndex - Count/2):(0);
+		if (Start + Count > Length)
+			Start = Length - Count;
+		
+		if (GetDFTZoom(NMRDataStruct, k, DFTFreq(NMRDataStruct, k, Start), DFTFreq(NMRDataStruct, k, Start + Count - 1), Count, Output) != DATA_OK) {
+			MaxDeviation = INFINITY;
+			break;
+		}
+		
+		Steps++;
+		for (i = 0; i < Count; i++) {
+			Deviation = hypot(Output[2*i] - DFTPhaseCorrReal(NMRDataStruct, k, Start + i), Output[2*i + 1] - DFTPhaseCorrImag(NMRDataStruct, k, Start + i))/MaxAmp;
+			if (Deviation > MaxDeviation)
+				MaxDeviation = Deviation;
+		}
+	}
+	
+	Check((Steps > 0) && (MaxDeviation <= DFT_TOLERANCE), "%s: zoomed spectrum within %.0e of the phase-corrected DFT (maximum deviation %.2e, %lu steps)", 
+		Name, DFT_TOLERANCE, MaxDeviation, (unsigned long) Steps);
+	
+	if (Bench && (Steps > 0)) {
+		/** the zoomed spectrum of the last step checked at 16 times the DFT resolution versus the DFT of 16 times DFTLength and the phase correction of a step **/
+		BenchArg.NMRDataStruct = NMRDataStruct;
+		BenchArg.StepNo = k - StepStride;
+		BenchArg.FreqStart = DFTFreq(NMRDataStruct, BenchArg.StepNo, Start);
+		BenchArg.FreqEnd = DFTFreq(NMRDataStruct, BenchArg.StepNo, Start) + (DFTFreq(NMRDataStruct, BenchArg.StepNo, Start + Count - 1) - BenchArg.FreqStart)/16.0;
+		BenchArg.Count = Count;
+		BenchArg.Output = Output;
+		BenchArg.RetVal = DATA_OK;
+		
+		Time = MeasureTime(ZoomBench, &BenchArg);
+		
+		SavedLength = NMRDataStruct->DFTLength;
+		PaddedLength = 16*SavedLength;
+		SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &PaddedLength, NULL);
+		DFTTime = MeasureStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTPhaseCorr)/((double) StepNoRange(NMRDataStruct));
+		PaddedLength = NMRDataStruct->DFTLength;
+		SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &SavedLength, NULL);
+		
+		printf("  GetDFTZoom of %lu points at 16x the resolution of the DFT  %.3f us, DFT of %lu points and phase correction  %.3f us/step\n", 
+			(unsigned long) Count, 1.0e6*Time, (unsigned long) PaddedLength, 1.0e6*DFTTime);
+	}
+}
+
+/** Obtains the DFT with DFTLength from 1 to DFT_MAX_PADDING times the processed length, i.e. by the full-length or by the pruned transform, 
+    the output must be within DFT_TOLERANCE of the direct sums for all the padding ratios **/
+void CheckPadding(NMRData *NMRDataStruct, const char *Name) {
+	size_t DataLength = 0;
+	size_t Ratio = 0;
+	size_t Points = 0;
+	long SavedLength = 0;
+	long Length = 0;
+	double Deviation = 0.0;
+	double AmpDeviation = 0.0;
+	double MaxDeviation = 0.0;
+	double Time = 0.0;
+	
+	if (StepNoRange(NMRDataStruct) == 0)
+		return;
+	
+	SavedLength = NMRDataStruct->DFTLength;
+	DataLength = NMRDataStruct->ChunkEnd + 1 - NMRDataStruct->ChunkStart;
+	
+	for (Ratio = 1; Ratio <= DFT_MAX_PADDING; Ratio *= 2) {
+		Length = (long) (Ratio*DataLength);
+		SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &Length, NULL);
+		
+		if (RunStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult) != DATA_OK) {
+			MaxDeviation = INFINITY;
+			break;
+		}
+		
+		Points = GetDFTDeviation(NMRDataStruct, &Deviation, &AmpDeviation);
+		if ((Points == 0) || (AmpDeviation > Deviation))
+			Deviation = (Points == 0)?(INFINITY):(AmpDeviation);
+		if (Deviation > MaxDeviation)
+			MaxDeviation = Deviation;
+		
+		if (Bench) {
+			Time = MeasureStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+			printf("  DFT of %lu points padded to %7lu (x%3lu, %s)  %.3f ms, %.3f us/step, deviation %.2e\n", (unsigned long) DataLength, (unsigned long) NMRDataStruct->DFTLength, 
+				(unsigned long) Ratio, (GetPrunedDFTLength(NMRDataStruct, DataLength) > 0)?("pruned"):("full"), 1.0e3*Time, 1.0e6*Time/((double) StepNoRange(NMRDataStruct)), Deviation);
+		}
+	}
+	
+	Check(MaxDeviation <= DFT_TOLERANCE, "%s: DFT padded to 1 to %u times the processed length within %.0e of the double direct sums (maximum deviation %.2e)", 
+		Name, DFT_MAX_PADDING, DFT_TOLERANCE, MaxDeviation);
+	
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &SavedLength, NULL);
+}
+
+/** Counts the mappings of the DFT scratch files in Dir listed in /proc/self/maps, Deleted those of the unlinked files; returns -1 where the list is not available **/
+long CountScratchMappings(const char *Dir, long *Deleted) {
+	FILE *Maps = NULL;
+	char *Prefix = NULL;
+	char Line[4096];
+	long Count = 0;
+	
+	*Deleted = 0;
+	
+	if ((Maps = fopen("/proc/self/maps", "r")) == NULL)
+		return -1;
+	
+	Prefix = CombinePath(Dir, "nmrfilip-dft-");
+	while (fgets(Line, sizeof(Line), Maps) != NULL) {
+		if (strstr(Line, Prefix) == NULL)
+			continue;
+		
+		Count++;
+		if (strstr(Line, "(deleted)") != NULL)
+			(*Deleted)++;
+	}
+	
+	free(Prefix);
+	fclose(Maps);
+	
+	return Count;
+}
+
+/** Obtains the DFT of the echo train with the (power of two) length whose single step output exceeds the DFTMemoryBudget of 1 MiB by the full-length transform 
+    in memory and then with the budget, i.e. kept in the scratch file in TMPDIR and transformed one step at a time; the echoes must be long enough for the DFT not to be pruned. 
+    The results must be identical, the scratch file must have been unlinked (the directory is empty while the DFT data are mapped) and its mappings must be released 
+    once the budget is lifted. **/
+void CheckDFTSpill(const EchoTrain *Train, const char *Name) {
+#ifndef __WIN32__
+	NMRData NMRDataStruct;
+	ProcResults InMemory;
+	char *ScratchDir = NULL;
+	char *SavedTmpDir = NULL;
+	size_t Length = 0;
+	long Mappings = 0;
+	long Deleted = 0;
+	long Val = 0;
+	int RetVal = DATA_OK;
+	unsigned char Spilled = 0;
+	unsigned char Removed = 0;
+	double Deviation = INFINITY;
+	double Time = 0.0;
+	double SpillTime = 0.0;
+	
+	printf("Dataset %s, DFT scratch file\n", Name);
+	
+	if (OpenEchoTrain(&NMRDataStruct, "spill", Train) != 0) {
+		Check(0, "%s: the dataset cannot be written", Name);
+		return;
+	}
+	
+	memset(&InMemory, 0, sizeof(ProcResults));
+	
+	for (Length = 1; Length*3*sizeof(NMRReal) <= DFT_MEMORY_BUDGET_UNIT; Length *= 2)
+		;
+	
+	Val = (long) Length;
+	/** ChunkEnd is limited to the echo length by the first DFT, DFTLength cannot be set below the processed length before **/
+	if ((RetVal = CheckNMRData(&NMRDataStruct, CHECK_DFTResult, ALL_STEPS)) == DATA_OK)
+		SetProcParam(&NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &Val, NULL);
+	
+	if ((RetVal == DATA_OK) && ((RetVal = RunStage(&NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult)) == DATA_OK) && 
+		(GetPrunedDFTLength(&NMRDataStruct, ChunkAvgProcIndexRange(&NMRDataStruct, 0)) == 0)) {
+		SaveProcResults(&NMRDataStruct, &InMemory);
+		if (Bench)
+			Time = MeasureStage(&NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+		
+		ScratchDir = CombinePath(WorkDir, "scratch");
+		if (getenv("TMPDIR") != NULL)
+			SavedTmpDir = strdup(getenv("TMPDIR"));
+		
+		if ((MakeDir(ScratchDir) == 0) && (setenv("TMPDIR", ScratchDir, 1) == 0)) {
+			Val = 1;
+			SetProcParam(&NMRDataStruct, PROC_PARAM_DFTMemoryBudget, PARAM_LONG, &Val, NULL);
+			
+			RetVal = RunStage(&NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+			Spilled = NMRDataStruct.DFTSpilled;
+			if (RetVal == DATA_OK)
+				Deviation = CompareProcResults(&NMRDataStruct, &InMemory);
+			
+			Mappings = CountScratchMappings(ScratchDir, &Deleted);
+			/** fails unless the directory is empty **/
+			Removed = (RemoveDir(ScratchDir) == 0);
+			
+			if (Bench && (RetVal == DATA_OK))
+				SpillTime = MeasureStage(&NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+		} else
+			RetVal = FILE_IO_ERROR;
+		
+		if (SavedTmpDir != NULL)
+			setenv("TMPDIR", SavedTmpDir, 1);
+		else
+			unsetenv("TMPDIR");
+		free(SavedTmpDir);
+	} else
+		RetVal |= DATA_INVALID;
+	
+	if ((RetVal != DATA_OK) || !Spilled) {
+		Check(0, "%s: full-length DFT of %lu points cannot be kept in the scratch file with the memory budget of 1 MiB", Name, (unsigned long) Length);
+	} else {
+		Check(Deviation == 0.0, "%s: DFT of %lu points kept in the scratch file and transformed one step at a time identical to the one in memory (maximum deviation %.2e)", 
+			Name, (unsigned long) Length, Deviation);
+		Check(Removed && ((Mappings < 0) || ((Mappings > 0) && (Deleted == Mappings))), "%s: DFT scratch file unlinked while mapped (%ld mappings, %ld of them unlinked)", 
+			Name, Mappings, Deleted);
+		
+		/** lifting the budget moves the DFT data to memory when they are allocated next time **/
+		Val = 0;
+		SetProcParam(&NMRDataStruct, PROC_PARAM_DFTMemoryBudget, PARAM_LONG, &Val, NULL);
+		RetVal = RunStage(&NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+		Mappings = CountScratchMappings(ScratchDir, &Deleted);
+		Check((RetVal == DATA_OK) && !(NMRDataStruct.DFTSpilled) && (Mappings <= 0), "%s: DFT scratch file mappings released without the budget (%ld left)", Name, ChooseMax(Mappings, 0));
+		
+		if (Bench)
+			printf("  DFT of %lu points  %.3f ms in memory, %.3f ms in the scratch file\n", (unsigned long) Length, 1.0e3*Time, 1.0e3*SpillTime);
+	}
+	
+	free(ScratchDir);
+	FreeProcResults(&InMemory);
+	CloseEchoTrain(&NMRDataStruct);
+#endif
+}
+
+/** Obtains the DFT of DOWNCONVERT_PADDING times the processed length with the filtered band of 1/DOWNCONVERT_BAND of the spectral width 
+    without and with the downconversion, the filtered band must agree within DOWNCONVERT_TOLERANCE of its maximum amplitude **/
+void CheckDownconvert(NMRData *NMRDataStruct, const char *Name) {
+	ProcResults Full;
+	size_t DataLength = 0;
+	size_t DownLength = 0;
+	size_t Offset = 0;
+	size_t i = 0;
+	size_t k = 0;
+	long SavedLength = 0;
+	long SavedFilter = 0;
+	long SavedDownconvert = 0;
+	long Val = 0;
+	int RetVal = DATA_OK;
+	double MaxAmp = 0.0;
+	double Deviation = 0.0;
+	double MaxDeviation = 0.0;
+	double FullTime = 0.0;
+	double Time = 0.0;
+	
+	if ((StepNoRange(NMRDataStruct) == 0) || (NMRDataStruct->SWMh <= 0.0))
+		return;
+	
+	memset(&Full, 0, sizeof(ProcResults));
+	
+	SavedLength = NMRDataStruct->DFTLength;
+	SavedFilter = NMRDataStruct->FilterHz;
+	SavedDownconvert = NMRDataStruct->DFTDownconvert;
+	DataLength = NMRDataStruct->ChunkEnd + 1 - NMRDataStruct->ChunkStart;
+	
+	Val = 0;
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTDownconvert, PARAM_LONG, &Val, NULL);
+	Val = (long) (DOWNCONVERT_PADDING*DataLength);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &Val, NULL);
+	Val = lround(1.0e6*NMRDataStruct->SWMh/(2*DOWNCONVERT_BAND));
+	SetProcParam(NMRDataStruct, PROC_PARAM_Filter, PARAM_LONG, &Val, NULL);
+	
+	RetVal = RunStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+	if (RetVal == DATA_OK) {
+		SaveProcResults(NMRDataStruct, &Full);
+		if (Bench)
+			FullTime = MeasureStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+		
+		Val = 1;
+		SetProcParam(NMRDataStruct, PROC_PARAM_DFTDownconvert, PARAM_LONG, &Val, NULL);
+		DownLength = GetDownconvertedDFTLength(NMRDataStruct);
+		RetVal = RunStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+	}
+	
+	if ((RetVal != DATA_OK) || (DownLength == 0)) {
+		Check(0, "%s: DFT of %lu points cannot be downconverted to the band of %lu Hz", Name, (unsigned long) NMRDataStruct->DFTLength, 2*NMRDataStruct->FilterHz);
+		MaxDeviation = INFINITY;
+	}
+	
+	for (k = 0; (k < StepNoRange(NMRDataStruct)) && (MaxDeviation < INFINITY); k++) {
+		MaxAmp = 0.0;
+		for (i = NMRDataStruct->filter; i < DFTIndexRange(NMRDataStruct, k) - NMRDataStruct->filter2; i++)
+			MaxAmp = ChooseMax(MaxAmp, hypot(Full.DFT[Offset + 2*i], Full.DFT[Offset + 2*i + 1]));
+		
+		for (i = NMRDataStruct->filter; (i < DFTIndexRange(NMRDataStruct, k) - NMRDataStruct->filter2) && (MaxAmp > 0.0); i++) {
+			Deviation = hypot(DFTReal(NMRDataStruct, k, i) - Full.DFT[Offset + 2*i], DFTImag(NMRDataStruct, k, i) - Full.DFT[Offset + 2*i + 1])/MaxAmp;
+			if (Deviation > MaxDeviation)
+				MaxDeviation = Deviation;
+		}
+		Offset += 2*DFTIndexRange(NMRDataStruct, k);
+	}
+	
+	if (MaxDeviation < INFINITY) {
+		Check(MaxDeviation <= DOWNCONVERT_TOLERANCE, "%s: DFT of %lu points downconverted to %lu points within %.0e of the full one in the band of %lu Hz (maximum deviation %.2e)", 
+			Name, (unsigned long) NMRDataStruct->DFTLength, (unsigned long) DownLength, DOWNCONVERT_TOLERANCE, 2*NMRDataStruct->FilterHz, MaxDeviation);
+		
+		if (Bench) {
+			Time = MeasureStage(NMRDataStruct, CHECK_DFTResult, CHECK_DFTResult);
+			printf("  DFT of %lu points  %.3f ms, downconverted to %lu points  %.3f ms (x%.2f)\n", (unsigned long) NMRDataStruct->DFTLength, 1.0e3*FullTime, 
+				(unsigned long) DownLength, 1.0e3*Time, FullTime/Time);
+		}
+	}
+	
+	FreeProcResults(&Full);
+	
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTDownconvert, PARAM_LONG, &SavedDownconvert, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_DFTLength, PARAM_LONG, &SavedLength, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_Filter, PARAM_LONG, &SavedFilter, NULL);
+}
+
+/** Returns 1 if the length has no prime factors other than 2, 3, 5 and 7 **/
+int IsDFTFriendly(size_t Length) {
+	const size_t Factors[] = {2, 3, 5, 7};
+	size_t i = 0;
+	
+	if (Length == 0)
+		return 0;
+	
+	for (i = 0; i < sizeof(Factors)/sizeof(Factors[0]); i++)
+		while ((Length % Factors[i]) == 0)
+			Length /= Factors[i];
+	
+	return (Length == 1);
+}
+
+/** The friendly length must be the smallest 2/3/5/7-smooth one found by counting up, the rounded length must be within DFTLengthTolerance and smooth unless kept; 
+    no tolerance keeps the length and a length within the tolerance must not be kept; the lengths rounded above LONG_MAX (the DFTLength processing parameter is a long) must be kept as well **/
+void CheckDFTLengthRounding(void) {
+	const unsigned int Tolerances[] = {0, 1, 5, 10, 25, DFT_LENGTH_MAX_TOLERANCE};
+	const size_t Limits[] = {LONG_MAX, LONG_MAX - 1, LONG_MAX/2 + 1, LONG_MAX/3};
+	NMRData NMRDataStruct;
+	size_t Length = 0;
+	size_t Reference = 0;
+	size_t Rounded = 0;
+	size_t Mismatches = 0;
+	size_t Lengths = 0;
+	size_t i = 0;
+	size_t t = 0;
+	
+	printf("DFT length rounding\n");
+	
+	InitNMRData(&NMRDataStruct);
+	
+	for (Length = 1, Reference = 1; Length <= DFT_ROUNDING_CHECK_LENGTH; Length++) {
+		if (Reference < Length)
+			for (Reference = Length; !IsDFTFriendly(Reference); Reference++)
+				;
+		
+		if (GetDFTFriendlyLength(Length) != Reference)
+			Mismatches++;
+	}
+	
+	Check(Mismatches == 0, "friendly DFT lengths of 1 to %u the smallest 2/3/5/7-smooth ones (%lu mismatches)", DFT_ROUNDING_CHECK_LENGTH, (unsigned long) Mismatches);
+	
+	for (t = 0, Mismatches = 0; t < sizeof(Tolerances)/sizeof(Tolerances[0]); t++) {
+		NMRDataStruct.DFTLengthTolerance = Tolerances[t];
+		
+		/** the lengths up to the check length and a random sample above it **/
+		for (i = 0; i < 2*DFT_ROUNDING_CHECK_LENGTH; i++, Lengths++) {
+			Length = (i < DFT_ROUNDING_CHECK_LENGTH)?(i + 1):(1 + (size_t) ((CheckRandom() >> 24) % LONG_MAX));
+			Rounded = GetRoundedDFTLength(&NMRDataStruct, Length);
+			
+			if ((Rounded < Length) || (((double) (Rounded - Length)) > 0.01*Tolerances[t]*((double) Length)) || 
+				((Rounded != Length) && !IsDFTFriendly(Rounded)) || ((Tolerances[t] == 0) && (Rounded != Length)) || 
+				((Tolerances[t] > 0) && (Rounded == Length) && !IsDFTFriendly(Length) && (((double) (GetDFTFriendlyLength(Length) - Length)) <= 0.01*Tolerances[t]*((double) Length))))
+				Mismatches++;
+		}
+	}
+	
+	Check(Mismatches == 0, "%lu rounded DFT lengths smooth and within the tolerance of 0 to %u %%, kept with no tolerance (%lu mismatches)", 
+		(unsigned long) Lengths, DFT_LENGTH_MAX_TOLERANCE, (unsigned long) Mismatches);
+	
+	NMRDataStruct.DFTLengthTolerance = DFT_LENGTH_MAX_TOLERANCE;
+	for (i = 0, Mismatches = 0; i < sizeof(Limits)/sizeof(Limits[0]); i++) {
+		Rounded = GetRoundedDFTLength(&NMRDataStruct, Limits[i]);
+		if ((Rounded < Limits[i]) || (Rounded > LONG_MAX) || ((Rounded != Limits[i]) && !IsDFTFriendly(Rounded)))
+			Mismatches++;
+	}
+	
+	Check((Mismatches == 0) && (GetRoundedDFTLength(&NMRDataStruct, LONG_MAX) == LONG_MAX), "DFT lengths up to LONG_MAX rounded within the long range with %u %% tolerance", DFT_LENGTH_MAX_TOLERANCE);
+	
+	FreeNMRData(&NMRDataStruct);
+}
@@ -0,0 +1,556 @@
+/*
+ * NMRFilip CHECK - the NMR data processing software - checks and benchmarks of the vectorized kernels
+ * Copyright (C) 2026 NMRFilip contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "nmrfilipcheck.h"
+
+
+#define KERNEL_MAX_COUNT	67	/** the kernels are compared for all point counts up to this one (covering all the vector tails)... **/
+#define KERNEL_MAX_SHIFT	3	/** ...and for the data misaligned by up to this many elements **/
+#define KERNEL_BENCH_COUNT	65536	/** points processed by a single kernel call in the benchmark (the data fit in the cache) **/
+
+/** Input data of the kernels **/
+typedef struct {
+	int32_t *Int32;
+	double *Float64;
+	float *Float32;
+	double *Window;
+	double *Sum;	/** initial values of the sums accumulated by the kernels **/
+	int64_t *Sum64;
+} KernelData;
+
+typedef void (*KernelFunc)(void);
+
+/** Runs the kernel Func of the given family on Count points of the data shifted by Shift elements, stores the results to Output and returns their size in bytes;
+    the sums are accumulated onto the initial values if Fresh is set, onto the Output as is otherwise **/
+typedef size_t (*KernelRunFunc)(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh);
+
+/** Kernel family - the portable kernel and its vectorized versions (NULL if there is none) **/
+typedef struct {
+	const char *Name;
+	KernelRunFunc Run;
+	KernelFunc Portable;
+	KernelFunc SSE2;
+	KernelFunc AVX2;
+} KernelFamily;
+
+#if SIMD_X86
+#define SIMD_KERNEL(Func)	((KernelFunc) (Func))
+#else
+#define SIMD_KERNEL(Func)	NULL
+#endif
+
+
+/** Kernel families **/
+
+size_t RunSwapInt32(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	((SwapInt32Func) Func)((int32_t *) Output, (const unsigned char *) (Data->Int32 + Shift), 2*Count);
+	return 2*Count*sizeof(int32_t);
+}
+
+size_t RunSwapFloat64(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	((SwapFloat64Func) Func)((double *) Output, (const unsigned char *) (Data->Float64 + Shift), 2*Count);
+	return 2*Count*sizeof(double);
+}
+
+size_t RunOrMaskInt32(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	if (Fresh)
+		memcpy(Output, Data->Int32, Count*sizeof(int32_t));
+	((OrMaskInt32Func) Func)((int32_t *) Output, Data->Int32 + Shift, Count);
+	return Count*sizeof(int32_t);
+}
+
+size_t RunOrMaskFloat64(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	if (Fresh)
+		memcpy(Output, Data->Int32, Count*sizeof(int32_t));
+	((OrMaskFloat64Func) Func)((int32_t *) Output, Data->Float64 + Shift, Count);
+	return Count*sizeof(int32_t);
+}
+
+size_t RunAccumulateInt32(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	if (Fresh)
+		memcpy(Output, Data->Sum, 2*Count*sizeof(double));
+	((AccumulateInt32Func) Func)((double *) Output, Data->Int32 + Shift, 2*Count);
+	return 2*Count*sizeof(double);
+}
+
+size_t RunAccumulateInt32Int64(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	if (Fresh)
+		memcpy(Output, Data->Sum64, 2*Count*sizeof(int64_t));
+	((AccumulateInt32Int64Func) Func)((int64_t *) Output, Data->Int32 + Shift, 2*Count);
+	return 2*Count*sizeof(int64_t);
+}
+
+size_t RunMaxNormInt32(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	*((uint64_t *) Output) = ((MaxNormInt32Func) Func)(Data->Int32 + Shift, Count);
+	return sizeof(uint64_t);
+}
+
+/** Thresholds: the norm of a point in the last quarter (found there or sooner), one above the maximum (not found) and zero (found at once);
+    just the scan of all the points is measured **/
+size_t RunFindNormInt32(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	const int32_t *Points = Data->Int32 + Shift;
+	uint64_t Threshold = 0;
+	size_t i = 0;
+	
+	if (!Fresh) {
+		((size_t *) Output)[0] = ((FindNormInt32Func) Func)(Points, Count, UINT64_MAX);
+		return sizeof(size_t);
+	}
+	
+	if (Count > 0) {
+		i = Count - 1 - Count/4;
+		Threshold = (uint64_t) ((int64_t) Points[2*i]*Points[2*i]) + (uint64_t) ((int64_t) Points[2*i + 1]*Points[2*i + 1]);
+	}
+	
+	((size_t *) Output)[0] = ((FindNormInt32Func) Func)(Points, Count, Threshold);
+	((size_t *) Output)[1] = ((FindNormInt32Func) Func)(Points, Count, MaxNormInt32Portable(Points, Count) + 1);
+	((size_t *) Output)[2] = ((FindNormInt32Func) Func)(Points, Count, 0);
+	return 3*sizeof(size_t);
+}
+
+size_t RunMaxNormFloat64(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	*((double *) Output) = ((MaxNormFloat64Func) Func)(Data->Float64 + Shift, Count);
+	return sizeof(double);
+}
+
+size_t RunFindNormFloat64(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	const double *Points = Data->Float64 + Shift;
+	double Threshold = 1.0;
+	size_t i = 0;
+	
+	if (!Fresh) {
+		((size_t *) Output)[0] = ((FindNormFloat64Func) Func)(Points, Count, INFINITY);
+		return sizeof(size_t);
+	}
+	
+	if (Count > 0) {
+		i = Count - 1 - Count/4;
+		Threshold = Points[2*i]*Points[2*i] + Points[2*i + 1]*Points[2*i + 1];
+		if (isnan(Threshold))
+			Threshold = 1.0;
+	}
+	
+	((size_t *) Output)[0] = ((FindNormFloat64Func) Func)(Points, Count, Threshold);
+	((size_t *) Output)[1] = ((FindNormFloat64Func) Func)(Points, Count, INFINITY);
+	((size_t *) Output)[2] = ((FindNormFloat64Func) Func)(Points, Count, 0.0);
+	return 3*sizeof(size_t);
+}
+
+size_t RunWindowFloat64(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	((WindowFloat64Func) Func)((double *) Output, Data->Float64 + Shift, Data->Window, Count);
+	return 2*Count*sizeof(double);
+}
+
+size_t RunWindowFloat32(KernelFunc Func, const KernelData *Data, size_t Count, size_t Shift, void *Output, int Fresh) {
+	((WindowFloat32Func) Func)((float *) Output, Data->Float64 + Shift, Data->Window, Count);
+	return 2*Count*sizeof(float);
+}
+
+const KernelFamily KernelFamilies[] = {
+	{"SwapInt32", RunSwapInt32, (KernelFunc) SwapInt32Portable, SIMD_KERNEL(SwapInt32SSE2), SIMD_KERNEL(SwapInt32AVX2)},
+	{"SwapFloat64", RunSwapFloat64, (KernelFunc) SwapFloat64Portable, SIMD_KERNEL(SwapFloat64SSE2), SIMD_KERNEL(SwapFloat64AVX2)},
+	{"OrMaskInt32", RunOrMaskInt32, (KernelFunc) OrMaskInt32Portable, SIMD_KERNEL(OrMaskInt32SSE2), SIMD_KERNEL(OrMaskInt32AVX2)},
+	{"OrMaskFloat64", RunOrMaskFloat64, (KernelFunc) OrMaskFloat64Portable, SIMD_KERNEL(OrMaskFloat64SSE2), SIMD_KERNEL(OrMaskFloat64AVX2)},
+	{"AccumulateInt32", RunAccumulateInt32, (KernelFunc) AccumulateInt32Portable, SIMD_KERNEL(AccumulateInt32SSE2), SIMD_KERNEL(AccumulateInt32AVX2)},
+	{"AccumulateInt32Int64", RunAccumulateInt32Int64, (KernelFunc) AccumulateInt32Int64Portable, SIMD_KERNEL(AccumulateInt32Int64SSE2), SIMD_KERNEL(AccumulateInt32Int64AVX2)},
+	{"MaxNormInt32", RunMaxNormInt32, (KernelFunc) MaxNormInt32Portable, NULL, SIMD_KERNEL(MaxNormInt32AVX2)},
+	{"FindNormInt32", RunFindNormInt32, (KernelFunc) FindNormInt32Portable, NULL, SIMD_KERNEL(FindNormInt32AVX2)},
+	{"MaxNormFloat64", RunMaxNormFloat64, (KernelFunc) MaxNormFloat64Portable, NULL, SIMD_KERNEL(MaxNormFloat64AVX2)},
+	{"FindNormFloat64", RunFindNormFloat64, (KernelFunc) FindNormFloat64Portable, NULL, SIMD_KERNEL(FindNormFloat64AVX2)},
+	{"WindowFloat64", RunWindowFloat64, (KernelFunc) WindowFloat64Portable, SIMD_KERNEL(WindowFloat64SSE2), SIMD_KERNEL(WindowFloat64AVX2)},
+	{"WindowFloat32", RunWindowFloat32, (KernelFunc) WindowFloat32Portable, NULL, SIMD_KERNEL(WindowFloat32AVX2)}
+};
+
+#define KERNEL_FAMILY_COUNT	(sizeof(KernelFamilies)/sizeof(KernelFamily))
+
+/** Fills Count points (and the margin for the shifts) of the kernel input data; with Specials set, the data include the extreme integers
+    and the floating point values the vectorized kernels must leave to the portable code (zeros, subnormal, huge and infinite values, NaNs) **/
+void FillKernelData(KernelData *Data, size_t Count, int Specials) {
+	const int32_t SpecialInt32[] = {INT32_MIN, INT32_MAX, 0, -1, 1, INT32_MIN + 1};
+	const double SpecialFloat64[] = {0.0, -0.0, NAN, INFINITY, -INFINITY, 1.0e-300, -1.0e300, DBL_MIN/4.0, DBL_MAX, 1.0e-160, 3.0e153};
+	size_t i = 0;
+	
+	for (i = 0; i < 2*(Count + KERNEL_MAX_SHIFT); i++) {
+		Data->Int32[i] = (int32_t) (CheckRandom() >> 40) - 8388608;	/** 24-bit samples as from the digitizer **/
+		Data->Float64[i] = (CheckRandomDouble() - 0.5)*ldexp(1.0, (int) (CheckRandom() % 48));
+		
+		if (Specials && (CheckRandom() % 8 == 0)) {
+			Data->Int32[i] = SpecialInt32[CheckRandom() % (sizeof(SpecialInt32)/sizeof(int32_t))];
+			Data->Float64[i] = SpecialFloat64[CheckRandom() % (sizeof(SpecialFloat64)/sizeof(double))];
+		}
+		
+		Data->Float32[i] = (float) Data->Float64[i];
+		Data->Window[i] = CheckRandomDouble();
+		Data->Sum[i] = (CheckRandomDouble() - 0.5)*1.0e12;
+		Data->Sum64[i] = (int64_t) (CheckRandom() >> 4) - (INT64_C(1) << 59);
+	}
+}
+
+typedef struct {
+	const KernelFamily *Family;
+	KernelFunc Func;
+	const KernelData *Data;
+	void *Output;
+} KernelBenchArg;
+
+void KernelBenchRun(void *Arg) {
+	KernelBenchArg *Bench = (KernelBenchArg *) Arg;
+	
+	Bench->Family->Run(Bench->Func, Bench->Data, KERNEL_BENCH_COUNT, 0, Bench->Output, 0);
+}
+
+/** Compares the vectorized kernels with the portable ones bit by bit for all small counts and shifts and for a long run,
+    measures them with --bench (in ns per point) **/
+void CheckKernels(void) {
+	KernelData Data;
+	KernelBenchArg BenchArg;
+	KernelFunc Variants[2];
+	const char *VariantNames[2] = {"SSE2", "AVX2"};
+	const KernelFamily *Family = NULL;
+	unsigned char *Expected = NULL;
+	unsigned char *Result = NULL;
+	size_t ExpectedSize = 0;
+	size_t ResultSize = 0;
+	size_t Length = 0;
+	size_t Count = 0;
+	size_t Shift = 0;
+	size_t MismatchCount = 0;
+	size_t MismatchShift = 0;
+	size_t Mismatches = 0;
+	size_t f = 0;
+	size_t v = 0;
+	int Identical = 0;
+	double PortableTime = 0.0;
+	double Time = 0.0;
+	
+	printf("Vectorized kernels (SSE2 %s, AVX2 %s)\n", (HasSSE2())?("available"):("not available"), (HasAVX2())?("available"):("not available"));
+	
+	Length = 2*(KERNEL_BENCH_COUNT + KERNEL_MAX_SHIFT);
+	Data.Int32 = (int32_t *) malloc(Length*sizeof(int32_t));
+	Data.Float64 = (double *) malloc(Length*sizeof(double));
+	Data.Float32 = (float *) malloc(Length*sizeof(float));
+	Data.Window = (double *) malloc(Length*sizeof(double));
+	Data.Sum = (double *) malloc(Length*sizeof(double));
+	Data.Sum64 = (int64_t *) malloc(Length*sizeof(int64_t));
+	Expected = (unsigned char *) malloc(Length*sizeof(double));
+	Result = (unsigned char *) malloc(Length*sizeof(double));
+	if ((Data.Int32 == NULL) || (Data.Float64 == NULL) || (Data.Float32 == NULL) || (Data.Window == NULL) || (Data.Sum == NULL) || (Data.Sum64 == NULL) ||
+		(Expected == NULL) || (Result == NULL)) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	FillKernelData(&Data, KERNEL_BENCH_COUNT, 1);
+	
+	for (f = 0; f < KERNEL_FAMILY_COUNT; f++) {
+		Family = &(KernelFamilies[f]);
+		Variants[0] = (HasSSE2())?(Family->SSE2):(NULL);
+		Variants[1] = (HasAVX2())?(Family->AVX2):(NULL);
+		
+		for (v = 0; v < 2; v++) {
+			if (Variants[v] == NULL)
+				continue;
+			
+			Identical = 1;
+			for (Count = 0; Identical && (Count <= KERNEL_MAX_COUNT + 1); Count++) {
+				for (Shift = 0; Identical && (Shift <= KERNEL_MAX_SHIFT); Shift++) {
+					/** the last round is the long run **/
+					MismatchCount = (Count <= KERNEL_MAX_COUNT)?(Count):(KERNEL_BENCH_COUNT);
+					MismatchShift = Shift;
+					
+					ExpectedSize = Family->Run(Family->Portable, &Data, MismatchCount, Shift, Expected, 1);
+					ResultSize = Family->Run(Variants[v], &Data, MismatchCount, Shift, Result, 1);
+					
+					if ((ExpectedSize != ResultSize) || (memcmp(Expected, Result, ExpectedSize) != 0))
+						Identical = 0;
+				}
+			}
+			
+			if (Identical)
+				Check(1, "%-21s %s identical to the portable kernel", Family->Name, VariantNames[v]);
+			else
+				Check(0, "%-21s %s differs from the portable kernel (%lu points shifted by %lu)", Family->Name, VariantNames[v],
+					(unsigned long) MismatchCount, (unsigned long) MismatchShift);
+		}
+	}
+	
+	/** the amplitudes must be bit for bit those of hypot, including the special values **/
+	AmplitudeFloat64((double *) Result, Data.Float64, KERNEL_BENCH_COUNT);
+	for (Mismatches = 0, Count = 0; Count < KERNEL_BENCH_COUNT; Count++) {
+		((double *) Expected)[0] = hypot(Data.Float64[2*Count], Data.Float64[2*Count + 1]);
+		if (memcmp(Expected, ((double *) Result) + Count, sizeof(double)) != 0)
+			Mismatches++;
+	}
+	Check(Mismatches == 0, "%-21s identical to hypot (%lu mismatches)", "AmplitudeFloat64", (unsigned long) Mismatches);
+	
+	AmplitudeFloat32((float *) Result, Data.Float32, KERNEL_BENCH_COUNT);
+	for (Mismatches = 0, Count = 0; Count < KERNEL_BENCH_COUNT; Count++) {
+		((float *) Expected)[0] = (float) hypot((double) Data.Float32[2*Count], (double) Data.Float32[2*Count + 1]);
+		if (memcmp(Expected, ((float *) Result) + Count, sizeof(float)) != 0)
+			Mismatches++;
+	}
+	Check(Mismatches == 0, "%-21s identical to hypot (%lu mismatches)", "AmplitudeFloat32", (unsigned long) Mismatches);
+	
+	if (Bench) {
+		/** the benchmark data are the usual ones, without the values handled by the portable code **/
+		FillKernelData(&Data, KERNEL_BENCH_COUNT, 0);
+		
+		printf("  %-21s %12s %20s %20s\n", "ns/point", "portable", "SSE2", "AVX2");
+		for (f = 0; f < KERNEL_FAMILY_COUNT; f++) {
+			Family = &(KernelFamilies[f]);
+			Variants[0] = (HasSSE2())?(Family->SSE2):(NULL);
+			Variants[1] = (HasAVX2())?(Family->AVX2):(NULL);
+			
+			BenchArg.Family = Family;
+			BenchArg.Data = &Data;
+			BenchArg.Output = Result;
+			Family->Run(Family->Portable, &Data, KERNEL_BENCH_COUNT, 0, Result, 1);
+			
+			BenchArg.Func = Family->Portable;
+			PortableTime = MeasureTime(KernelBenchRun, &BenchArg);
+			printf("  %-21s %12.3f", Family->Name, 1.0e9*PortableTime/KERNEL_BENCH_COUNT);
+			
+			for (v = 0; v < 2; v++) {
+				if (Variants[v] == NULL) {
+					printf(" %20s", "-");
+					continue;
+				}
+				
+				BenchArg.Func = Variants[v];
+				Time = MeasureTime(KernelBenchRun, &BenchArg);
+				printf(" %11.3f (x%5.2f)", 1.0e9*Time/KERNEL_BENCH_COUNT, PortableTime/Time);
+			}
+			printf("\n");
+		}
+	}
+	
+	free(Data.Int32);
+	free(Data.Float64);
+	free(Data.Float32);
+	free(Data.Window);
+	free(Data.Sum);
+	free(Data.Sum64);
+	free(Expected);
+	free(Result);
+}
+
+
+/** The echo peak by its definition: the first point of the largest amplitude in the order Centre, Centre - 1, Centre + 1, Centre - 2, ... (Centre = Count/2),
+    all the amplitudes evaluated by hypot; returns the amplitude, 0.0 if no peak is found **/
+double ReferenceEchoPeakInt32(const int32_t *Data, size_t Count, size_t *Peak) {
+	double Amp = 0.0;
+	double PeakAmp = 0.0;
+	size_t Order = 0;
+	size_t i = 0;
+	
+	for (Order = 0; Order < 2*Count + 1; Order++) {
+		if (Order % 2 == 0)
+			i = Count/2 + Order/2;
+		else
+		if ((Order + 1)/2 <= Count/2)
+			i = Count/2 - (Order + 1)/2;
+		else
+			continue;
+		
+		if (i >= Count)
+			continue;
+		
+		Amp = hypot(Data[2*i], Data[2*i + 1]);
+		if (Amp > PeakAmp) {
+			PeakAmp = Amp;
+			*Peak = i;
+		}
+	}
+	
+	return PeakAmp;
+}
+
+double ReferenceEchoPeakFloat64(const double *Data, size_t Count, size_t *Peak) {
+	double Amp = 0.0;
+	double PeakAmp = 0.0;
+	size_t Order = 0;
+	size_t i = 0;
+	
+	for (Order = 0; Order < 2*Count + 1; Order++) {
+		if (Order % 2 == 0)
+			i = Count/2 + Order/2;
+		else
+		if ((Order + 1)/2 <= Count/2)
+			i = Count/2 - (Order + 1)/2;
+		else
+			continue;
+		
+		if (i >= Count)
+			continue;
+		
+		Amp = hypot(Data[2*i], Data[2*i + 1]);
+		if (Amp > PeakAmp) {
+			PeakAmp = Amp;
+			*Peak = i;
+		}
+	}
+	
+	return PeakAmp;
+}
+
+typedef struct {
+	const int32_t *Int32;
+	const double *Float64;
+	size_t Count;
+	double Amp;
+} EchoPeakBenchArg;
+
+void EchoPeakBenchInt32(void *Arg) {
+	EchoPeakBenchArg *Bench = (EchoPeakBenchArg *) Arg;
+	size_t Peak = 0;
+	
+	Bench->Amp += FindEchoPeakInt32(Bench->Int32, Bench->Count, &Peak);
+}
+
+void EchoPeakBenchReferenceInt32(void *Arg) {
+	EchoPeakBenchArg *Bench = (EchoPeakBenchArg *) Arg;
+	size_t Peak = 0;
+	
+	Bench->Amp += ReferenceEchoPeakInt32(Bench->Int32, Bench->Count, &Peak);
+}
+
+void EchoPeakBenchFloat64(void *Arg) {
+	EchoPeakBenchArg *Bench = (EchoPeakBenchArg *) Arg;
+	size_t Peak = 0;
+	
+	Bench->Amp += FindEchoPeakFloat64(Bench->Float64, Bench->Count, &Peak);
+}
+
+void EchoPeakBenchReferenceFloat64(void *Arg) {
+	EchoPeakBenchArg *Bench = (EchoPeakBenchArg *) Arg;
+	size_t Peak = 0;
+	
+	Bench->Amp += ReferenceEchoPeakFloat64(Bench->Float64, Bench->Count, &Peak);
+}
+
+/** Measures the echo peak search and the definition on a long echo **/
+void BenchEchoPeakSearch(void) {
+	EchoPeakBenchArg BenchArg;
+	int32_t *Int32 = NULL;
+	double *Float64 = NULL;
+	double Envelope = 0.0;
+	double Time = 0.0;
+	double ReferenceTime = 0.0;
+	size_t i = 0;
+	
+	Int32 = (int32_t *) malloc(2*KERNEL_BENCH_COUNT*sizeof(int32_t));
+	Float64 = (double *) malloc(2*KERNEL_BENCH_COUNT*sizeof(double));
+	if ((Int32 == NULL) || (Float64 == NULL)) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	for (i = 0; i < KERNEL_BENCH_COUNT; i++) {
+		Envelope = 8388607.0*exp(-pow((((double) i) - 0.5*KERNEL_BENCH_COUNT)/(0.2*KERNEL_BENCH_COUNT), 2.0));
+		Int32[2*i] = (int32_t) lround(Envelope*cos(0.1*((double) i))) + (int32_t) (CheckRandom() % 17) - 8;
+		Int32[2*i + 1] = (int32_t) lround(Envelope*sin(0.1*((double) i))) + (int32_t) (CheckRandom() % 17) - 8;
+		Float64[2*i] = (double) Int32[2*i];
+		Float64[2*i + 1] = (double) Int32[2*i + 1];
+	}
+	
+	BenchArg.Int32 = Int32;
+	BenchArg.Float64 = Float64;
+	BenchArg.Count = KERNEL_BENCH_COUNT;
+	BenchArg.Amp = 0.0;
+	
+	Time = MeasureTime(EchoPeakBenchInt32, &BenchArg);
+	ReferenceTime = MeasureTime(EchoPeakBenchReferenceInt32, &BenchArg);
+	printf("  FindEchoPeakInt32     %.3f ns/point, hypot of every point %.3f ns/point (x%.2f)\n",
+		1.0e9*Time/KERNEL_BENCH_COUNT, 1.0e9*ReferenceTime/KERNEL_BENCH_COUNT, ReferenceTime/Time);
+	
+	Time = MeasureTime(EchoPeakBenchFloat64, &BenchArg);
+	ReferenceTime = MeasureTime(EchoPeakBenchReferenceFloat64, &BenchArg);
+	printf("  FindEchoPeakFloat64   %.3f ns/point, hypot of every point %.3f ns/point (x%.2f)\n",
+		1.0e9*Time/KERNEL_BENCH_COUNT, 1.0e9*ReferenceTime/KERNEL_BENCH_COUNT, ReferenceTime/Time);
+	
+	free(Int32);
+	free(Float64);
+}
+
+/** Compares the echo peak search (the norm-based selection of the candidates) with the definition on random chunks with many ties
+    and with amplitudes differing in the last bits, the floating point data being finite as in the datafiles **/
+void CheckEchoPeakSearch(void) {
+	const int32_t Ties[][2] = {{3, 4}, {4, 3}, {-5, 0}, {0, 5}, {-3, -4}};
+	int32_t Int32[2*KERNEL_MAX_COUNT];
+	double Float64[2*KERNEL_MAX_COUNT];
+	size_t Count = 0;
+	size_t Round = 0;
+	size_t Peak = 0;
+	size_t ReferencePeak = 0;
+	size_t i = 0;
+	size_t Scale = 0;
+	size_t Int32Mismatches = 0;
+	size_t Float64Mismatches = 0;
+	double Amp = 0.0;
+	double ReferenceAmp = 0.0;
+	
+	printf("Echo peak search\n");
+	
+	for (Round = 0; Round < 1000; Round++) {
+		for (Count = 1; Count <= KERNEL_MAX_COUNT; Count++) {
+			Scale = 1 + CheckRandom() % 30;
+			
+			for (i = 0; i < 2*Count; i++) {
+				switch (CheckRandom() % 4) {
+					case 0:	/** ties of the exact amplitudes **/
+						Int32[i] = (int32_t) (Ties[(i/2) % 5][i % 2] << Scale);
+						break;
+					case 1:	/** amplitudes equal up to the last bits **/
+						Int32[i] = (int32_t) ((i % 2 == 0)?(INT32_MAX - (int32_t) (CheckRandom() % 4)):(CheckRandom() % 4));
+						break;
+					default:
+						Int32[i] = (int32_t) (CheckRandom() >> 33) - (INT32_C(1) << 30);
+				}
+				
+				Float64[i] = ldexp((double) Int32[i], (int) (CheckRandom() % 2048) - 1100);
+			}
+			
+			Peak = 0;
+			ReferencePeak = 0;
+			Amp = FindEchoPeakInt32(Int32, Count, &Peak);
+			ReferenceAmp = ReferenceEchoPeakInt32(Int32, Count, &ReferencePeak);
+			if ((Amp != ReferenceAmp) || ((Amp > 0.0) && (Peak != ReferencePeak)))
+				Int32Mismatches++;
+			
+			/** the same scale for the whole chunk sometimes, the amplitudes then being comparable **/
+			if (Round % 2 == 0)
+				for (i = 0; i < 2*Count; i++)
+					Float64[i] = ldexp((double) Int32[i], (int) Scale - 15);
+			
+			Peak = 0;
+			ReferencePeak = 0;
+			Amp = FindEchoPeakFloat64(Float64, Count, &Peak);
+			ReferenceAmp = ReferenceEchoPeakFloat64(Float64, Count, &ReferencePeak);
+			if ((Amp != ReferenceAmp) || ((Amp > 0.0) && (Peak != ReferencePeak)))
+				Float64Mismatches++;
+		}
+	}
+	
+	Check(Int32Mismatches == 0, "FindEchoPeakInt32 agrees with the definition (%lu mismatches)", (unsigned long) Int32Mismatches);
+	Check(Float64Mismatches == 0, "FindEchoPeakFloat64 agrees with the definition (%lu mismatches)", (unsigned long) Float64Mismatches);
+	
+	if (Bench)
+		BenchEchoPeakSearch();
+}
@@ -0,0 +1,726 @@
+/*
+ * NMRFilip CHECK - the NMR data processing software - checks and benchmarks of the datafile loading
+ * Copyright (C) 2026 NMRFilip contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "nmrfilipcheck.h"
+
+
+/** Datafile loading compared by CheckLoader **/
+typedef struct {
+	const char *Name;
+	unsigned char LoadMode;
+	size_t ReadBlockSize;
+	unsigned int ReadQueueDepth;
+} LoaderVariant;
+
+const LoaderVariant LoaderVariants[] = {
+	{"read by 64 KiB", RAW_LOAD_READ, 65536, 0},
+	{"read by 1 MiB", RAW_LOAD_READ, 1048576, 0},
+	{"read by 1 MiB, 4 blocks ahead", RAW_LOAD_READ, 1048576, 4},
+	{"read by 8 MiB, 4 blocks ahead", RAW_LOAD_READ, 8388608, 4},
+#ifndef __WIN32__
+	{"mapped", RAW_LOAD_MMAP, 1048576, 4},
+#endif
+};
+
+#define LOADER_VARIANT_COUNT	(sizeof(LoaderVariants)/sizeof(LoaderVariant))
+
+
+/** The raw data of all the steps one after another **/
+unsigned char *SaveRawData(NMRData *NMRDataStruct, size_t *Size) {
+	unsigned char *Data = NULL;
+	size_t StepSize = 0;
+	size_t k = 0;
+	
+	*Size = 0;
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++)
+		*Size += 2*TDDIndexRange(NMRDataStruct, k)*((TDDIsFloat64(NMRDataStruct, k))?(sizeof(double)):(sizeof(int32_t)));
+	
+	Data = (unsigned char *) malloc(*Size + 1);
+	if (Data == NULL) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	*Size = 0;
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		if (TDDIsFloat64(NMRDataStruct, k)) {
+			StepSize = 2*TDDIndexRange(NMRDataStruct, k)*sizeof(double);
+			memcpy(Data + *Size, &TDDRealFloat64(NMRDataStruct, k, 0), StepSize);
+		} else {
+			StepSize = 2*TDDIndexRange(NMRDataStruct, k)*sizeof(int32_t);
+			memcpy(Data + *Size, &TDDRealInt32(NMRDataStruct, k, 0), StepSize);
+		}
+		*Size += StepSize;
+	}
+	
+	return Data;
+}
+
+/** Loads the datafile by each of the LoaderVariants, the raw data of all the steps must be identical; the timing includes the conversion of all the steps **/
+void CheckLoader(NMRData *NMRDataStruct, const char *Name) {
+	unsigned char *Reference = NULL;
+	unsigned char *Data = NULL;
+	size_t ReferenceSize = 0;
+	size_t Size = 0;
+	size_t SavedBlockSize = 0;
+	size_t i = 0;
+	unsigned int SavedQueueDepth = 0;
+	unsigned int Mismatches = 0;
+	unsigned char SavedMode = 0;
+	double Time = 0.0;
+	
+	SavedMode = NMRDataStruct->LoadMode;
+	SavedBlockSize = NMRDataStruct->ReadBlockSize;
+	SavedQueueDepth = NMRDataStruct->ReadQueueDepth;
+	
+	if (CheckNMRData(NMRDataStruct, CHECK_RawData, ALL_STEPS) != DATA_OK) {
+		Check(0, "%s: the datafile cannot be loaded", Name);
+		return;
+	}
+	
+	Reference = SaveRawData(NMRDataStruct, &ReferenceSize);
+	
+	for (i = 0; i < LOADER_VARIANT_COUNT; i++) {
+		NMRDataStruct->LoadMode = LoaderVariants[i].LoadMode;
+		NMRDataStruct->ReadBlockSize = LoaderVariants[i].ReadBlockSize;
+		NMRDataStruct->ReadQueueDepth = LoaderVariants[i].ReadQueueDepth;
+		
+		if (RunStage(NMRDataStruct, CHECK_StepSet, CHECK_RawData) != DATA_OK) {
+			Mismatches++;
+			continue;
+		}
+		
+		Data = SaveRawData(NMRDataStruct, &Size);
+		if ((Size != ReferenceSize) || (memcmp(Data, Reference, Size) != 0))
+			Mismatches++;
+		free(Data);
+		
+		if (Bench) {
+			Time = MeasureStage(NMRDataStruct, CHECK_StepSet, CHECK_RawData);
+			printf("  datafile %-30s %.3f ms, %.0f MiB/s, %.1f MiB resident\n", LoaderVariants[i].Name, 1.0e3*Time, ((double) NMRDataStruct->DataSize)*4.0/1048576.0/Time, 
+				((double) ResidentBytes(NMRDataStruct->DataSpace, NMRDataStruct->DataSize*sizeof(int32_t)))/1048576.0);
+		}
+	}
+	
+	Check(Mismatches == 0, "%s: raw data loaded identically by all the %u loaders (%s byte order, %lu mismatches)", Name, (unsigned int) LOADER_VARIANT_COUNT, 
+		((NMRDataStruct->ByteOrder != 0) != HostIsBigEndian())?("converted"):("host"), (unsigned long) Mismatches);
+	
+	free(Reference);
+	
+	NMRDataStruct->LoadMode = SavedMode;
+	NMRDataStruct->ReadBlockSize = SavedBlockSize;
+	NMRDataStruct->ReadQueueDepth = SavedQueueDepth;
+	RunStage(NMRDataStruct, CHECK_StepSet, CHECK_RawData);
+}
+
+/** Number of the datafile lines read so far **/
+size_t CountLoadedLines(NMRData *NMRDataStruct) {
+	size_t Count = 0;
+	size_t i = 0;
+	
+	if (NMRDataStruct->DataLoaded == NULL)
+		return 0;
+	
+	for (i = 0; i < StepNoRange(NMRDataStruct); i++)
+		if (NMRDataStruct->DataLoaded[i])
+			Count++;
+	
+	return Count;
+}
+
+/** The step set must not read the datafile, the steps read one by one (from the last one) must be identical to the steps read all at once **/
+void CheckLazyLoading(NMRData *NMRDataStruct, const char *Name) {
+	unsigned char *Reference = NULL;
+	unsigned char *Data = NULL;
+	size_t ReferenceSize = 0;
+	size_t Size = 0;
+	size_t StepSize = 0;
+	size_t ByteLine = 0;
+	size_t k = 0;
+	unsigned long Mismatches = 0;
+	unsigned char SavedMode = 0;
+	
+	SavedMode = NMRDataStruct->LoadMode;
+	NMRDataStruct->LoadMode = RAW_LOAD_READ;
+	
+	if (RunStage(NMRDataStruct, CHECK_StepSet, CHECK_RawData) != DATA_OK) {
+		Check(0, "%s: the datafile cannot be loaded", Name);
+		NMRDataStruct->LoadMode = SavedMode;
+		return;
+	}
+	
+	Reference = SaveRawData(NMRDataStruct, &ReferenceSize);
+	StepSize = (StepNoRange(NMRDataStruct) > 0)?(ReferenceSize/StepNoRange(NMRDataStruct)):(0);
+	
+	RunStage(NMRDataStruct, CHECK_StepSet, CHECK_StepSet);
+	
+	/** The data space is kept, so the data read at once are cleared **/
+	if (NMRDataStruct->DataSpace != NULL)
+		memset(NMRDataStruct->DataSpace, 0, NMRDataStruct->DataSize*sizeof(int32_t));
+	
+	ByteLine = NMRDataStruct->PointLine*((NMRDataStruct->DTypA == RAW_TYPE_FLOAT64)?(2*sizeof(double)):(2*sizeof(int32_t)));
+	Check((StepNoRange(NMRDataStruct) == NMRDataStruct->DataSize*4/ByteLine) && (CountLoadedLines(NMRDataStruct) == 0), 
+		"%s: the step set of %lu steps is created without reading the datafile (%lu lines read)", Name, (unsigned long) StepNoRange(NMRDataStruct), (unsigned long) CountLoadedLines(NMRDataStruct));
+	
+	for (k = StepNoRange(NMRDataStruct); k > 0; k--) {
+		if (CheckNMRData(NMRDataStruct, CHECK_RawData, k - 1) != DATA_OK) {
+			Mismatches++;
+			continue;
+		}
+		
+		if (CountLoadedLines(NMRDataStruct) != StepNoRange(NMRDataStruct) - k + 1)
+			Mismatches++;
+		
+		if (TDDIsFloat64(NMRDataStruct, k - 1))
+			Data = (unsigned char *) &TDDRealFloat64(NMRDataStruct, k - 1, 0);
+		else
+			Data = (unsigned char *) &TDDRealInt32(NMRDataStruct, k - 1, 0);
+		
+		if (memcmp(Data, Reference + (k - 1)*StepSize, StepSize) != 0)
+			Mismatches++;
+	}
+	
+	Data = SaveRawData(NMRDataStruct, &Size);
+	if ((Size != ReferenceSize) || (memcmp(Data, Reference, Size) != 0))
+		Mismatches++;
+	free(Data);
+	
+	Check(Mismatches == 0, "%s: the steps read on demand one by one identical to the steps read at once (%lu mismatches)", Name, Mismatches);
+	
+	free(Reference);
+	
+	NMRDataStruct->LoadMode = SavedMode;
+	RunStage(NMRDataStruct, CHECK_StepSet, CHECK_RawData);
+}
+
+/** Loads the same echo train written as int32 and as float64, the chunk sets, the chunk averages, the echo peaks and the DFT output must be identical **/
+void CheckRawDataTypes(const EchoTrain *Train, const char *Name) {
+	NMRData Int32Data;
+	NMRData Float64Data;
+	EchoTrain Float64Train;
+	size_t i = 0;
+	size_t k = 0;
+	unsigned long ChunkMismatches = 0;
+	unsigned long AvgMismatches = 0;
+	unsigned long PeakMismatches = 0;
+	unsigned long DFTMismatches = 0;
+	
+	Float64Train = *Train;
+	Float64Train.DTypA = RAW_TYPE_FLOAT64;
+	
+	printf("Dataset %s, int32 and float64\n", Name);
+	
+	if (OpenEchoTrain(&Int32Data, "int32", Train) != 0) {
+		Check(0, "%s: the int32 dataset cannot be written", Name);
+		return;
+	}
+	
+	if (OpenEchoTrain(&Float64Data, "float64", &Float64Train) != 0) {
+		Check(0, "%s: the float64 dataset cannot be written", Name);
+		CloseEchoTrain(&Int32Data);
+		return;
+	}
+	
+	if ((CheckNMRData(&Int32Data, CHECK_EchoPeaksEnvelope, ALL_STEPS) != DATA_OK) || (CheckNMRData(&Int32Data, CHECK_DFTResult, ALL_STEPS) != DATA_OK) || 
+		(CheckNMRData(&Float64Data, CHECK_EchoPeaksEnvelope, ALL_STEPS) != DATA_OK) || (CheckNMRData(&Float64Data, CHECK_DFTResult, ALL_STEPS) != DATA_OK)) {
+		Check(0, "%s: the data cannot be processed", Name);
+		CloseEchoTrain(&Float64Data);
+		CloseEchoTrain(&Int32Data);
+		return;
+	}
+	
+	Check(TDDIsFloat64(&Float64Data, 0) && !TDDIsFloat64(&Int32Data, 0), "%s: the float64 dataset is loaded as float64", Name);
+	
+	if ((StepNoRange(&Int32Data) != StepNoRange(&Float64Data)) || (ChunkNoRange(&Int32Data) != ChunkNoRange(&Float64Data))) {
+		Check(0, "%s: the float64 dataset has %lu steps of %lu chunks instead of %lu of %lu", Name, 
+			(unsigned long) StepNoRange(&Float64Data), (unsigned long) ChunkNoRange(&Float64Data), (unsigned long) StepNoRange(&Int32Data), (unsigned long) ChunkNoRange(&Int32Data));
+		CloseEchoTrain(&Float64Data);
+		CloseEchoTrain(&Int32Data);
+		return;
+	}
+	
+	for (i = 0; i < ChunkNoRange(&Int32Data); i++)
+		if ((ChunkDataStart(&Int32Data, i) != ChunkDataStart(&Float64Data, i)) || (ChunkIndexRange(&Int32Data, i) != ChunkIndexRange(&Float64Data, i)))
+			ChunkMismatches++;
+	
+	for (k = 0; k < StepNoRange(&Int32Data); k++) {
+		if ((ChunkAvgIndexRange(&Int32Data, k) != ChunkAvgIndexRange(&Float64Data, k)) || 
+			(memcmp(&ChunkAvgReal(&Int32Data, k, 0), &ChunkAvgReal(&Float64Data, k, 0), 2*ChunkAvgIndexRange(&Int32Data, k)*sizeof(double)) != 0))
+			AvgMismatches++;
+		
+		if ((EchoPeaksEnvelopeIndexRange(&Int32Data, k) != EchoPeaksEnvelopeIndexRange(&Float64Data, k)) || 
+			(memcmp(EchoPeaksEnvelopeDataStart(&Int32Data, k), EchoPeaksEnvelopeDataStart(&Float64Data, k), 2*EchoPeaksEnvelopeIndexRange(&Int32Data, k)*sizeof(double)) != 0))
+			PeakMismatches++;
+		
+		if ((DFTIndexRange(&Int32Data, k) != DFTIndexRange(&Float64Data, k)) || 
+			(memcmp(&DFTReal(&Int32Data, k, 0), &DFTReal(&Float64Data, k, 0), 2*DFTIndexRange(&Int32Data, k)*sizeof(NMRReal)) != 0))
+			DFTMismatches++;
+	}
+	
+	Check(ChunkMismatches == 0, "%s: float64 chunk set identical to int32 (%lu mismatches)", Name, ChunkMismatches);
+	Check(AvgMismatches == 0, "%s: float64 chunk averages identical to int32 (%lu steps differ)", Name, AvgMismatches);
+	Check(PeakMismatches == 0, "%s: float64 echo peaks identical to int32 (%lu steps differ)", Name, PeakMismatches);
+	Check(DFTMismatches == 0, "%s: float64 DFT output identical to int32 (%lu steps differ)", Name, DFTMismatches);
+	
+	CloseEchoTrain(&Float64Data);
+	CloseEchoTrain(&Int32Data);
+}
+
+/** Loads the echo train written as int32 and as float64 in both byte orders by all the loaders, the raw data of both byte orders must be identical. 
+    The mapping in the converted byte order must convert just the pages of the step in use. **/
+void CheckByteOrders(const EchoTrain *Train, const char *Name) {
+	NMRData NMRDataStruct;
+	EchoTrain Variant;
+	unsigned char *Reference = NULL;
+	unsigned char *Data = NULL;
+	size_t ReferenceSize = 0;
+	size_t Size = 0;
+	size_t PageSize = 0;
+	size_t ByteLine = 0;
+	size_t Pages = 0;
+	size_t i = 0;
+	unsigned int DTypA = 0;
+	unsigned int BigEndian = 0;
+	
+	Variant = *Train;
+	PageSize = RawMapPageSize();
+	
+	for (DTypA = RAW_TYPE_INT32; DTypA <= RAW_TYPE_FLOAT64; DTypA += RAW_TYPE_FLOAT64 - RAW_TYPE_INT32) {
+		Variant.DTypA = DTypA;
+		
+		for (BigEndian = 0; BigEndian < 2; BigEndian++) {
+			Variant.BigEndian = BigEndian;
+			
+			printf("Dataset %s, %s, %s endian\n", Name, (DTypA == RAW_TYPE_FLOAT64)?("float64"):("int32"), (BigEndian)?("big"):("little"));
+			
+			if (OpenEchoTrain(&NMRDataStruct, "byteorder", &Variant) != 0) {
+				Check(0, "%s: the dataset cannot be written", Name);
+				continue;
+			}
+			
+			CheckLoader(&NMRDataStruct, Name);
+			
+			if (CheckNMRData(&NMRDataStruct, CHECK_RawData, ALL_STEPS) == DATA_OK) {
+				if (Reference == NULL)
+					Reference = SaveRawData(&NMRDataStruct, &ReferenceSize);
+				else {
+					Data = SaveRawData(&NMRDataStruct, &Size);
+					Check((Size == ReferenceSize) && (memcmp(Data, Reference, Size) == 0), "%s: raw data of both byte orders identical", Name);
+					free(Data);
+				}
+			} else
+				Check(0, "%s: the datafile cannot be loaded", Name);
+			
+			/** Just the pages of the middle step get converted in the mapping **/
+			NMRDataStruct.LoadMode = RAW_LOAD_MMAP;
+			if ((RunStage(&NMRDataStruct, CHECK_StepSet, CHECK_StepSet) == DATA_OK) && (NMRDataStruct.DataMapDecoded != NULL) && (StepNoRange(&NMRDataStruct) > 0)) {
+				ByteLine = NMRDataStruct.DataMapLength/StepNoRange(&NMRDataStruct);
+				i = StepNoRange(&NMRDataStruct)/2;
+				
+				if (CheckNMRData(&NMRDataStruct, CHECK_RawData, i) == DATA_OK) {
+					for (Pages = 0, i = 0; i <= (NMRDataStruct.DataMapLength + PageSize - 1)/PageSize; i++)
+						if (NMRDataStruct.DataMapDecoded[i])
+							Pages++;
+					
+					i = StepNoRange(&NMRDataStruct)/2;
+					Check(Pages == ((i + 1)*ByteLine + PageSize - 1)/PageSize - (i*ByteLine)/PageSize, 
+						"%s: the mapping converts just the %lu pages of the %lu B step in use (%lu converted)", Name, 
+						(unsigned long) (((i + 1)*ByteLine + PageSize - 1)/PageSize - (i*ByteLine)/PageSize), (unsigned long) ByteLine, (unsigned long) Pages);
+				} else
+					Check(0, "%s: the mapped step cannot be loaded", Name);
+			}
+			
+			CloseEchoTrain(&NMRDataStruct);
+		}
+		
+		free(Reference);
+		Reference = NULL;
+	}
+}
+
+/** Reads the whole file, NULL if it cannot be read **/
+unsigned char *ReadWholeFile(const char *Path, size_t *Size) {
+	FILE *input = NULL;
+	unsigned char *Data = NULL;
+	long Length = 0;
+	
+	*Size = 0;
+	input = fopen(Path, "rb");
+	if (input == NULL)
+		return NULL;
+	
+	if ((fseek(input, 0, SEEK_END) != 0) || ((Length = ftell(input)) < 0) || (fseek(input, 0, SEEK_SET) != 0)) {
+		fclose(input);
+		return NULL;
+	}
+	
+	Data = (unsigned char *) malloc(Length + 1);
+	if ((Data == NULL) || (fread(Data, 1, Length, input) != (size_t) Length)) {
+		free(Data);
+		fclose(input);
+		return NULL;
+	}
+	
+	fclose(input);
+	*Size = Length;
+	
+	return Data;
+}
+
+/** Writes ("wb") or appends ("ab") Size bytes to the file **/
+int WriteWholeFile(const char *Path, const unsigned char *Data, size_t Size, const char *Mode) {
+	FILE *output = NULL;
+	
+	output = fopen(Path, Mode);
+	if (output == NULL)
+		return -1;
+	
+	if (fwrite(Data, 1, Size, output) != Size) {
+		fclose(output);
+		return -1;
+	}
+	
+	return (fclose(output) == 0)?(0):(-1);
+}
+
+/** Processes the dataset incrementally reloaded in the Mode, the results must be identical to the ones of the datafile opened anew **/
+void CompareIncrementalReload(NMRData *NMRDataStruct, const char *Dir, unsigned char Mode, const char *Name, const char *What) {
+	NMRData Fresh;
+	ProcResults Results;
+	size_t OldStepCount = 0;
+	long Val = 0;
+	int RetVal = 0;
+	
+	OldStepCount = StepNoRange(NMRDataStruct);
+	
+	RetVal = ReloadNMRDataIncremental(NMRDataStruct);
+	if ((RetVal != DATA_OK) || (CheckNMRData(NMRDataStruct, CHECK_EchoPeaksEnvelope, ALL_STEPS) != DATA_OK) || (CheckNMRData(NMRDataStruct, CHECK_DFTResult, ALL_STEPS) != DATA_OK)) {
+		Check(0, "%s: the data cannot be reloaded and processed after appending %s", Name, What);
+		return;
+	}
+	
+	Check((NMRDataStruct->ChunkMask != NULL) && (NMRDataStruct->ChunkMaskSteps == StepNoRange(NMRDataStruct)) && (StepNoRange(NMRDataStruct) > OldStepCount), 
+		"%s: %s OR-ed into the kept mask (%lu steps of %lu)", Name, What, (unsigned long) NMRDataStruct->ChunkMaskSteps, (unsigned long) StepNoRange(NMRDataStruct));
+	
+	if (OpenDataset(&Fresh, Dir) != 0) {
+		Check(0, "%s: the datafile cannot be opened anew", Name);
+		return;
+	}
+	
+	/** The reloaded dataset keeps the chunk window, the default of the longer chunks would differ **/
+	Fresh.LoadMode = Mode;
+	Val = NMRDataStruct->ChunkStart;
+	SetProcParam(&Fresh, PROC_PARAM_ChunkStart, PARAM_LONG, &Val, NULL);
+	Val = NMRDataStruct->ChunkEnd;
+	SetProcParam(&Fresh, PROC_PARAM_ChunkEnd, PARAM_LONG, &Val, NULL);
+	
+	if ((CheckNMRData(&Fresh, CHECK_EchoPeaksEnvelope, ALL_STEPS) == DATA_OK) && (CheckNMRData(&Fresh, CHECK_DFTResult, ALL_STEPS) == DATA_OK) && 
+		(StepNoRange(&Fresh) == StepNoRange(NMRDataStruct))) {
+		SaveProcResults(&Fresh, &Results);
+		Check(CompareProcResults(NMRDataStruct, &Results) == 0.0, "%s: reloaded after appending %s identical to the datafile opened anew", Name, What);
+		FreeProcResults(&Results);
+	} else
+		Check(0, "%s: the datafile opened anew cannot be processed", Name);
+	
+	CloseDataset(&Fresh);
+}
+
+/** Appends to the datafile the second half of the steps, which keep the chunk set, and then a step of a shifted echo train, which changes it. 
+    The incrementally reloaded data must be identical to the datafile opened anew, by reading and by mapping. **/
+void CheckIncrementalReload(const EchoTrain *Train, const char *Name) {
+	const unsigned char Modes[] = {
+		RAW_LOAD_READ, 
+#ifndef __WIN32__
+		RAW_LOAD_MMAP, 
+#endif
+	};
+	NMRData NMRDataStruct;
+	EchoTrain Shifted;
+	char *Dir = NULL;
+	char *ShiftedDir = NULL;
+	char *Path = NULL;
+	unsigned char *Data = NULL;
+	unsigned char *ShiftedData = NULL;
+	size_t Size = 0;
+	size_t ShiftedSize = 0;
+	size_t ByteLine = 0;
+	size_t Half = 0;
+	size_t m = 0;
+	
+	printf("Dataset %s, appended steps\n", Name);
+	
+	Shifted = *Train;
+	Shifted.Offset = Train->Offset + Train->Length + Train->Period/8;
+	
+	Dir = WriteEchoTrain("append", Train);
+	ShiftedDir = WriteEchoTrain("appendshifted", &Shifted);
+	if ((Dir == NULL) || (ShiftedDir == NULL)) {
+		Check(0, "%s: the datasets cannot be written", Name);
+		if (Dir != NULL)
+			RemoveEchoTrain(Dir);
+		if (ShiftedDir != NULL)
+			RemoveEchoTrain(ShiftedDir);
+		free(Dir);
+		free(ShiftedDir);
+		return;
+	}
+	
+	Path = CombinePath(ShiftedDir, "ser");
+	ShiftedData = ReadWholeFile(Path, &ShiftedSize);
+	free(Path);
+	RemoveEchoTrain(ShiftedDir);
+	free(ShiftedDir);
+	
+	Path = CombinePath(Dir, "ser");
+	Data = ReadWholeFile(Path, &Size);
+	
+	if ((Data == NULL) || (ShiftedData == NULL) || (Train->Steps < 2)) {
+		Check(0, "%s: the datafiles cannot be read", Name);
+		free(Data);
+		free(ShiftedData);
+		free(Path);
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return;
+	}
+	
+	ByteLine = Size/Train->Steps;
+	Half = Train->Steps/2;
+	
+	for (m = 0; m < sizeof(Modes)/sizeof(Modes[0]); m++) {
+		if ((WriteWholeFile(Path, Data, Half*ByteLine, "wb") != 0) || (OpenDataset(&NMRDataStruct, Dir) != 0)) {
+			Check(0, "%s: the first half of the steps cannot be written", Name);
+			continue;
+		}
+		
+		NMRDataStruct.LoadMode = Modes[m];
+		if ((CheckNMRData(&NMRDataStruct, CHECK_EchoPeaksEnvelope, ALL_STEPS) != DATA_OK) || (CheckNMRData(&NMRDataStruct, CHECK_DFTResult, ALL_STEPS) != DATA_OK)) {
+			Check(0, "%s: the first half of the steps cannot be processed", Name);
+			CloseDataset(&NMRDataStruct);
+			continue;
+		}
+		
+		if (WriteWholeFile(Path, Data + Half*ByteLine, Size - Half*ByteLine, "ab") == 0)
+			CompareIncrementalReload(&NMRDataStruct, Dir, Modes[m], Name, (Modes[m] == RAW_LOAD_MMAP)?("the steps of the same chunk set, mapped"):("the steps of the same chunk set, read"));
+		else
+			Check(0, "%s: the steps cannot be appended", Name);
+		
+		if (WriteWholeFile(Path, ShiftedData, ByteLine, "ab") == 0)
+			CompareIncrementalReload(&NMRDataStruct, Dir, Modes[m], Name, (Modes[m] == RAW_LOAD_MMAP)?("a shifted step, mapped"):("a shifted step, read"));
+		else
+			Check(0, "%s: the shifted step cannot be appended", Name);
+		
+		CloseDataset(&NMRDataStruct);
+	}
+	
+	free(Data);
+	free(ShiftedData);
+	free(Path);
+	RemoveEchoTrain(Dir);
+	free(Dir);
+}
+
+/** Modification time of the file in seconds, 0 if it cannot be found out **/
+time_t GetFileMTime(const char *Path) {
+	struct stat FileStat;
+	
+	if (stat(Path, &FileStat) != 0)
+		return 0;
+	
+	return FileStat.st_mtime;
+}
+
+int SetFileMTime(const char *Path, time_t Time) {
+	struct utimbuf Times;
+	
+	Times.actime = Time;
+	Times.modtime = Time;
+	
+	return utime(Path, &Times);
+}
+
+/** Opens the dataset in Dir, ignores the IgnoredStep (none if negative) and restores it from the cache; returns the result of LoadNMRDataCache and the flags of the valid data **/
+int LoadCachedDataset(const char *Dir, long IgnoredStep, unsigned long *Flags) {
+	NMRData NMRDataStruct;
+	long Val = STEP_IGNORE;
+	int RetVal = 0;
+	
+	*Flags = 0;
+	if (OpenDataset(&NMRDataStruct, Dir) != 0)
+		return -1;
+	
+	if ((IgnoredStep >= 0) && (SetProcParam(&NMRDataStruct, PROC_PARAM_SetStepFlag, PARAM_LONG, &Val, &IgnoredStep) != DATA_OK)) {
+		CloseDataset(&NMRDataStruct);
+		return -1;
+	}
+	
+	RetVal = LoadNMRDataCache(&NMRDataStruct);
+	*Flags = NMRDataStruct.Flags;
+	CloseDataset(&NMRDataStruct);
+	
+	return RetVal;
+}
+
+/** The dataset restored from the cache must be identical to the processed one, the raw data must be read just for averaging the restored chunk set anew. 
+    The cache must not be written again unless the processed data change, and it must be ignored after a change of the datafile, of the step layout or when damaged. **/
+void CheckCache(const EchoTrain *Train, const char *Name) {
+	const time_t OldTime = 1000000000;	/** the cache gets this modification time to find out whether it is written again **/
+	NMRData NMRDataStruct;
+	NMRData Cached;
+	ProcResults Results;
+	char *Dir = NULL;
+	char *SerPath = NULL;
+	char *CachePath = NULL;
+	unsigned char *Cache = NULL;
+	unsigned char *Damaged = NULL;
+	unsigned char *Ser = NULL;
+	size_t CacheSize = 0;
+	size_t SerSize = 0;
+	time_t SerTime = 0;
+	uint64_t Count = 0;
+	unsigned long Flags = 0;
+	long Val = 0;
+	int RetVal = 0;
+	
+	printf("Dataset %s, processed data cache\n", Name);
+	
+	Dir = WriteEchoTrain("cache", Train);
+	if ((Dir == NULL) || (OpenDataset(&NMRDataStruct, Dir) != 0)) {
+		Check(0, "%s: the dataset cannot be written", Name);
+		if (Dir != NULL)
+			RemoveEchoTrain(Dir);
+		free(Dir);
+		return;
+	}
+	
+	SerPath = CombinePath(Dir, "ser");
+	CachePath = CombinePath(Dir, "ser" NMRDATA_CACHE_SUFFIX);
+	
+	if ((CheckNMRData(&NMRDataStruct, CHECK_EchoPeaksEnvelope, ALL_STEPS) != DATA_OK) || (CheckNMRData(&NMRDataStruct, CHECK_DFTResult, ALL_STEPS) != DATA_OK) || 
+		(SaveNMRDataCache(&NMRDataStruct) != DATA_OK) || ((Cache = ReadWholeFile(CachePath, &CacheSize)) == NULL) || (CacheSize <= sizeof(NMRDataCacheHeader))) {
+		Check(0, "%s: the processed data cannot be cached", Name);
+		free(Cache);
+		CloseDataset(&NMRDataStruct);
+		free(SerPath);
+		free(CachePath);
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return;
+	}
+	
+	/** Round trip **/
+	if (OpenDataset(&Cached, Dir) == 0) {
+		RetVal = LoadNMRDataCache(&Cached);
+		Check((RetVal == DATA_OK) && (Cached.Flags & Flag(CHECK_ChunkSet)) && (Cached.Flags & Flag(CHECK_ChunkAvg)) && (CountLoadedLines(&Cached) == 0), 
+			"%s: chunk set and chunk averages restored without reading the datafile", Name);
+		
+		if ((CheckNMRData(&Cached, CHECK_DFTResult, ALL_STEPS) == DATA_OK) && (CheckNMRData(&Cached, CHECK_EchoPeaksEnvelope, ALL_STEPS) == DATA_OK)) {
+			SaveProcResults(&NMRDataStruct, &Results);
+			Check(CompareProcResults(&Cached, &Results) == 0.0, "%s: chunk set, chunk averages and DFT restored identical to the processed ones", Name);
+			FreeProcResults(&Results);
+		} else
+			Check(0, "%s: the restored dataset cannot be processed", Name);
+		
+		SetFileMTime(CachePath, OldTime);
+		Check((SaveNMRDataCache(&Cached) == DATA_OK) && (GetFileMTime(CachePath) == OldTime), "%s: unchanged processed data not written again", Name);
+		
+		/** The restored chunk set averaged anew reads the steps on their first use **/
+		Val = 1;
+		SetProcParam(&NMRDataStruct, PROC_PARAM_FirstChunk, PARAM_LONG, &Val, NULL);
+		SetProcParam(&Cached, PROC_PARAM_FirstChunk, PARAM_LONG, &Val, NULL);
+		if ((CheckNMRData(&NMRDataStruct, CHECK_DFTResult, ALL_STEPS) == DATA_OK) && (CheckNMRData(&Cached, CHECK_DFTResult, ALL_STEPS) == DATA_OK)) {
+			SaveProcResults(&NMRDataStruct, &Results);
+			Check(CompareProcResults(&Cached, &Results) == 0.0, "%s: restored chunk set averaged over another chunk range identical to the processed one", Name);
+			FreeProcResults(&Results);
+		} else
+			Check(0, "%s: the restored dataset cannot be averaged over another chunk range", Name);
+		
+		Check((SaveNMRDataCache(&Cached) == DATA_OK) && (GetFileMTime(CachePath) != OldTime), "%s: processed data of another chunk range written", Name);
+		CloseDataset(&Cached);
+		
+		RetVal = LoadCachedDataset(Dir, -1, &Flags);
+		Check((RetVal == DATA_OK) && (Flags & Flag(CHECK_ChunkSet)) && !(Flags & Flag(CHECK_ChunkAvg)), "%s: chunk averages of another chunk range not restored", Name);
+	} else
+		Check(0, "%s: the dataset cannot be opened anew", Name);
+	
+	/** Changed step layout **/
+	WriteWholeFile(CachePath, Cache, CacheSize, "wb");
+	RetVal = LoadCachedDataset(Dir, 0, &Flags);
+	Check((RetVal == DATA_OLD) && !(Flags & Flag(CHECK_ChunkSet)), "%s: cache rejected after ignoring a step", Name);
+	
+	/** Damaged cache **/
+	WriteWholeFile(CachePath, Cache, CacheSize - 1, "wb");
+	RetVal = LoadCachedDataset(Dir, -1, &Flags);
+	Check((RetVal == DATA_OLD) && !(Flags & Flag(CHECK_ChunkSet)), "%s: truncated cache rejected", Name);
+	
+	Damaged = (unsigned char *) malloc(CacheSize);
+	if (Damaged != NULL) {
+		memcpy(Damaged, Cache, CacheSize);
+		Damaged[sizeof(NMRDataCacheHeader) + (CacheSize - sizeof(NMRDataCacheHeader))/2] ^= 0x10;
+		WriteWholeFile(CachePath, Damaged, CacheSize, "wb");
+		RetVal = LoadCachedDataset(Dir, -1, &Flags);
+		Check((RetVal == DATA_OLD) && !(Flags & Flag(CHECK_ChunkSet)), "%s: corrupt cache data rejected", Name);
+		
+		memcpy(Damaged, Cache, CacheSize);
+		Count = UINT64_MAX/2;
+		memcpy(Damaged + offsetof(NMRDataCacheHeader, ChunkCount), &Count, sizeof(Count));
+		WriteWholeFile(CachePath, Damaged, CacheSize, "wb");
+		RetVal = LoadCachedDataset(Dir, -1, &Flags);
+		Check((RetVal == DATA_OLD) && !(Flags & Flag(CHECK_ChunkSet)), "%s: corrupt cache header rejected", Name);
+		
+		free(Damaged);
+	} else
+		Check(0, "%s: the cache cannot be copied", Name);
+	
+	WriteWholeFile(CachePath, Cache, CacheSize, "wb");
+	RetVal = LoadCachedDataset(Dir, -1, &Flags);
+	Check((RetVal == DATA_OK) && (Flags & Flag(CHECK_ChunkAvg)), "%s: intact cache restored again", Name);
+	
+	/** Changed datafile, the modification time or the content **/
+	SerTime = GetFileMTime(SerPath);
+	SetFileMTime(SerPath, SerTime + 1);
+	RetVal = LoadCachedDataset(Dir, -1, &Flags);
+	Check((RetVal == DATA_OLD) && !(Flags & Flag(CHECK_ChunkSet)), "%s: cache rejected after the datafile modification time changed", Name);
+	
+	Ser = ReadWholeFile(SerPath, &SerSize);
+	if ((Ser != NULL) && (SerSize > 0)) {
+		Ser[0] ^= 0x01;
+		WriteWholeFile(SerPath, Ser, SerSize, "wb");
+		SetFileMTime(SerPath, SerTime);
+		RetVal = LoadCachedDataset(Dir, -1, &Flags);
+		Check((RetVal == DATA_OLD) && !(Flags & Flag(CHECK_ChunkSet)), "%s: cache rejected after the datafile content changed", Name);
+		
+		Ser[0] ^= 0x01;
+		WriteWholeFile(SerPath, Ser, SerSize, "wb");
+	} else
+		Check(0, "%s: the datafile cannot be read", Name);
+	
+	SetFileMTime(SerPath, SerTime);
+	RetVal = LoadCachedDataset(Dir, -1, &Flags);
+	Check((RetVal == DATA_OK) && (Flags & Flag(CHECK_ChunkAvg)), "%s: cache restored again with the datafile restored", Name);
+	
+	free(Ser);
+	free(Cache);
+	CloseDataset(&NMRDataStruct);
+	free(SerPath);
+	free(CachePath);
+	RemoveEchoTrain(Dir);
+	free(Dir);
+}
@@ -0,0 +1,560 @@
+/*
+ * NMRFilip CHECK - the NMR data processing software - checks and benchmarks of the chunk processing
+ * Copyright (C) 2026 NMRFilip contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "nmrfilipcheck.h"
+
+
+#define CHUNK_CHECK_MIN	16	/** the chunk set is checked on echo trains from this many chunks... **/
+#define CHUNK_CHECK_MAX	4096	/** ...up to this many, 4 times more each time **/
+#define CHUNK_CHECK_JITTER	8	/** the echoes of the jittered trains are shifted by up to 1, 2, 4, ... this many points either way **/
+#define CHUNK_SUMS_CHECK_RANGES	16	/** the cumulative chunk sums are checked on this many FirstChunk .. LastChunk ranges **/
+
+
+/** The chunk average of the step by the scalar sums of the chunks converted one point at a time, Reference holds 2*ChunkAvgIndexRange values **/
+void ReferenceChunkAvg(NMRData *NMRDataStruct, size_t StepNo, double *Reference) {
+	size_t Counter = 0;
+	size_t i = 0;
+	size_t j = 0;
+	
+	for (j = 0; j < 2*ChunkAvgIndexRange(NMRDataStruct, StepNo); j++)
+		Reference[j] = 0.0;
+	
+	for (i = NMRDataStruct->FirstChunk; (i <= NMRDataStruct->LastChunk) && (i < ChunkNoRange(NMRDataStruct)); i++) {
+		if ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) > TDDIndexRange(NMRDataStruct, StepNo))
+			continue;
+		
+		Counter++;
+		for (j = 0; j < ChunkIndexRange(NMRDataStruct, i); j++) {
+			if (TDDIsFloat64(NMRDataStruct, StepNo)) {
+				Reference[2*j] += ChunkRealFloat64(NMRDataStruct, StepNo, i, j);
+				Reference[2*j + 1] += ChunkImagFloat64(NMRDataStruct, StepNo, i, j);
+			} else {
+				Reference[2*j] += (double) ChunkRealInt32(NMRDataStruct, StepNo, i, j);
+				Reference[2*j + 1] += (double) ChunkImagInt32(NMRDataStruct, StepNo, i, j);
+			}
+		}
+	}
+	
+	if (Counter > 0)
+		for (j = 0; j < 2*ChunkAvgIndexRange(NMRDataStruct, StepNo); j++)
+			Reference[j] /= (double) Counter;
+}
+
+typedef struct {
+	NMRData *NMRDataStruct;
+	double *Reference;
+} ChunkAvgBenchArg;
+
+void ChunkAvgBench(void *Arg) {
+	ChunkAvgBenchArg *Bench = (ChunkAvgBenchArg *) Arg;
+	
+	MarkNMRDataOld(Bench->NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+	CheckNMRData(Bench->NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+}
+
+/** The scalar sums and hypot of every point **/
+void ChunkAvgBenchReference(void *Arg) {
+	ChunkAvgBenchArg *Bench = (ChunkAvgBenchArg *) Arg;
+	size_t j = 0;
+	size_t k = 0;
+	
+	for (k = 0; k < StepNoRange(Bench->NMRDataStruct); k++) {
+		ReferenceChunkAvg(Bench->NMRDataStruct, k, Bench->Reference);
+		for (j = 0; j < ChunkAvgIndexRange(Bench->NMRDataStruct, k); j++)
+			Bench->Reference[2*j] = hypot(Bench->Reference[2*j], Bench->Reference[2*j + 1]);
+	}
+}
+
+/** Compares the chunk averages (summed in double or cumulatively in integers) with the scalar sums (ReferenceChunkAvg) 
+    and their amplitudes with hypot, both must be identical **/
+void CheckChunkAvg(NMRData *NMRDataStruct, const char *Name) {
+	ChunkAvgBenchArg BenchArg;
+	double *Reference = NULL;
+	size_t Mismatches = 0;
+	size_t AmpMismatches = 0;
+	size_t j = 0;
+	size_t k = 0;
+	double Amp = 0.0;
+	double Time = 0.0;
+	double ReferenceTime = 0.0;
+	unsigned char Cumulative = 0;
+	
+	for (Cumulative = 0; Cumulative < 2; Cumulative++) {
+		NMRDataStruct->CumulativeChunkSums = Cumulative;
+		MarkNMRDataOld(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+		
+		if ((CheckNMRData(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS) != DATA_OK) || (StepNoRange(NMRDataStruct) == 0)) {
+			Check(0, "%s: chunk averages cannot be computed", Name);
+			NMRDataStruct->CumulativeChunkSums = 0;
+			return;
+		}
+		
+		/** all the steps have the same chunk average length **/
+		Reference = (double *) realloc(Reference, (2*ChunkAvgIndexRange(NMRDataStruct, 0) + 1)*sizeof(double));
+		if (Reference == NULL) {
+			fprintf(stderr, "Cannot allocate memory.\n");
+			exit(2);
+		}
+		
+		Mismatches = 0;
+		AmpMismatches = 0;
+		for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+			if ((ChunkAvgIndexRange(NMRDataStruct, k) == 0) || (StepFlag(NMRDataStruct, k) & STEP_BLANK))
+				continue;
+			
+			ReferenceChunkAvg(NMRDataStruct, k, Reference);
+			
+			for (j = 0; j < ChunkAvgIndexRange(NMRDataStruct, k); j++) {
+				if ((ChunkAvgReal(NMRDataStruct, k, j) != Reference[2*j]) || (ChunkAvgImag(NMRDataStruct, k, j) != Reference[2*j + 1]))
+					Mismatches++;
+				
+				Amp = hypot(ChunkAvgReal(NMRDataStruct, k, j), ChunkAvgImag(NMRDataStruct, k, j));
+				if (memcmp(&Amp, &(ChunkAvgAmp(NMRDataStruct, k, j)), sizeof(double)) != 0)
+					AmpMismatches++;
+			}
+		}
+		
+		Check(Mismatches == 0, "%s: chunk averages (%s) identical to the scalar sums (%lu mismatches)", Name,
+			(Cumulative)?("cumulative integer sums"):("double sums"), (unsigned long) Mismatches);
+		Check(AmpMismatches == 0, "%s: chunk average amplitudes (%s) identical to hypot (%lu mismatches)", Name,
+			(Cumulative)?("cumulative integer sums"):("double sums"), (unsigned long) AmpMismatches);
+	}
+	
+	NMRDataStruct->CumulativeChunkSums = 0;
+	
+	if (Bench) {
+		BenchArg.NMRDataStruct = NMRDataStruct;
+		BenchArg.Reference = Reference;
+		
+		Time = MeasureTime(ChunkAvgBench, &BenchArg);
+		ReferenceTime = MeasureTime(ChunkAvgBenchReference, &BenchArg);
+		printf("  GetChunkAvg           %.3f ms, scalar sums and hypot %.3f ms (x%.2f)\n", 1.0e3*Time, 1.0e3*ReferenceTime, ReferenceTime/Time);
+	}
+	
+	free(Reference);
+}
+
+/** Compares the chunk averages of random FirstChunk .. LastChunk ranges summed directly with those taken from the cumulative chunk sums **/
+void CheckChunkSums(NMRData *NMRDataStruct, const char *Name) {
+	double *Direct = NULL;
+	size_t Length = 0;
+	size_t Offset = 0;
+	size_t Mismatches = 0;
+	size_t Missing = 0;
+	size_t Range = 0;
+	size_t k = 0;
+	long First[CHUNK_SUMS_CHECK_RANGES];
+	long Last[CHUNK_SUMS_CHECK_RANGES];
+	long FirstChunk = 0;
+	long LastChunk = 0;
+	long Val = 0;
+	
+	if ((CheckNMRData(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS) != DATA_OK) || (ChunkNoRange(NMRDataStruct) == 0) || (StepNoRange(NMRDataStruct) == 0)) {
+		Check(0, "%s: chunk averages cannot be computed", Name);
+		return;
+	}
+	
+	FirstChunk = NMRDataStruct->FirstChunk;
+	LastChunk = NMRDataStruct->LastChunk;
+	
+	/** all the chunks, the first and the last one alone, then random ranges **/
+	First[0] = 0;
+	Last[0] = ChunkNoRange(NMRDataStruct) - 1;
+	First[1] = 0;
+	Last[1] = 0;
+	First[2] = ChunkNoRange(NMRDataStruct) - 1;
+	Last[2] = ChunkNoRange(NMRDataStruct) - 1;
+	for (Range = 3; Range < CHUNK_SUMS_CHECK_RANGES; Range++) {
+		First[Range] = CheckRandom() % ChunkNoRange(NMRDataStruct);
+		Last[Range] = First[Range] + CheckRandom() % (ChunkNoRange(NMRDataStruct) - First[Range]);
+	}
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++)
+		Length += 2*ChunkAvgIndexRange(NMRDataStruct, k);
+	
+	Direct = (double *) malloc((CHUNK_SUMS_CHECK_RANGES*Length + 1)*sizeof(double));
+	if (Direct == NULL) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	/** the direct sums first, then the cumulative sums kept over all the ranges **/
+	for (NMRDataStruct->CumulativeChunkSums = 0; NMRDataStruct->CumulativeChunkSums < 2; NMRDataStruct->CumulativeChunkSums++) {
+		for (Range = 0; Range < CHUNK_SUMS_CHECK_RANGES; Range++) {
+			/** LastChunk cannot be set below FirstChunk, so the range is opened up first **/
+			Val = ChunkNoRange(NMRDataStruct) - 1;
+			SetProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &Val, NULL);
+			SetProcParam(NMRDataStruct, PROC_PARAM_FirstChunk, PARAM_LONG, &(First[Range]), NULL);
+			SetProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &(Last[Range]), NULL);
+			
+			if (((long) NMRDataStruct->FirstChunk != First[Range]) || ((long) NMRDataStruct->LastChunk != Last[Range]) || 
+				(CheckNMRData(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS) != DATA_OK)) {
+				Check(0, "%s: chunk averages of chunks %ld .. %ld cannot be computed", Name, First[Range], Last[Range]);
+				Mismatches++;
+				continue;
+			}
+			
+			Offset = Range*Length;
+			for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+				if (NMRDataStruct->CumulativeChunkSums == 0) 
+					memcpy(Direct + Offset, &ChunkAvgReal(NMRDataStruct, k, 0), 2*ChunkAvgIndexRange(NMRDataStruct, k)*sizeof(double));
+				else {
+					if (memcmp(Direct + Offset, &ChunkAvgReal(NMRDataStruct, k, 0), 2*ChunkAvgIndexRange(NMRDataStruct, k)*sizeof(double)) != 0)
+						Mismatches++;
+					
+					if ((NMRDataStruct->Steps[k].ChunkSums == NULL) && (!TDDIsFloat64(NMRDataStruct, k)) && 
+						(ChunkAvgIndexRange(NMRDataStruct, k) > 0) && (!(StepFlag(NMRDataStruct, k) & STEP_BLANK)))
+						Missing++;
+				}
+				
+				Offset += 2*ChunkAvgIndexRange(NMRDataStruct, k);
+			}
+		}
+	}
+	
+	Check(Mismatches == 0, "%s: chunk averages from the cumulative sums identical to the direct sums for %d chunk ranges (%lu mismatches)", Name, 
+		CHUNK_SUMS_CHECK_RANGES, (unsigned long) Mismatches);
+	Check(Missing == 0, "%s: cumulative chunk sums kept across the chunk ranges (%lu steps without them)", Name, (unsigned long) Missing);
+	
+	NMRDataStruct->CumulativeChunkSums = 0;
+	Val = ChunkNoRange(NMRDataStruct) - 1;
+	SetProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &Val, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_FirstChunk, PARAM_LONG, &FirstChunk, NULL);
+	SetProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &LastChunk, NULL);
+	CheckNMRData(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+	
+	free(Direct);
+}
+
+/** Compacts the raw data to the chunks, the chunks, the processing results and the raw data loaded again must be identical to the complete raw data **/
+void CheckCompactRawData(NMRData *NMRDataStruct, const char *Name) {
+	ProcResults Results;
+	unsigned char *Raw = NULL;
+	size_t *RawOffset = NULL;
+	size_t Size = 0;
+	size_t ChunkPoints = 0;
+	size_t Mismatches = 0;
+	size_t i = 0;
+	size_t k = 0;
+	unsigned char CompactRawData = NMRDataStruct->CompactRawData;
+	
+	if ((CheckNMRData(NMRDataStruct, CHECK_RawData, ALL_STEPS) != DATA_OK) || (CheckNMRData(NMRDataStruct, CHECK_DFTResult, ALL_STEPS) != DATA_OK)) {
+		Check(0, "%s: the data cannot be processed", Name);
+		return;
+	}
+	
+	SaveProcResults(NMRDataStruct, &Results);
+	
+	RawOffset = (size_t *) malloc((StepNoRange(NMRDataStruct) + 1)*sizeof(size_t));
+	if (RawOffset == NULL) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		RawOffset[k] = Size;
+		Size += 2*TDDIndexRange(NMRDataStruct, k)*((TDDIsFloat64(NMRDataStruct, k))?(sizeof(double)):(sizeof(int32_t)));
+	}
+	RawOffset[k] = Size;
+	
+	Raw = (unsigned char *) malloc(Size + 1);
+	if (Raw == NULL) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		if (TDDIsFloat64(NMRDataStruct, k))
+			memcpy(Raw + RawOffset[k], NMRDataStruct->Steps[k].RawDataFloat64, RawOffset[k + 1] - RawOffset[k]);
+		else
+			memcpy(Raw + RawOffset[k], NMRDataStruct->Steps[k].RawData, RawOffset[k + 1] - RawOffset[k]);
+	}
+	
+	for (i = 0; i < ChunkNoRange(NMRDataStruct); i++)
+		ChunkPoints += ChunkIndexRange(NMRDataStruct, i);
+	
+	NMRDataStruct->CompactRawData = 1;
+	if (RunStage(NMRDataStruct, CHECK_ChunkSet, CHECK_DFTResult) != DATA_OK) {
+		Check(0, "%s: the compacted data cannot be processed", Name);
+	} else {
+		/** nothing is compacted when the chunks cover all the data **/
+		if (ChunkPoints < TDDIndexRange(NMRDataStruct, 0))
+			Check(NMRDataStruct->ChunkSpace != NULL, "%s: raw data compacted to the chunks", Name);
+		
+		for (k = 0; k < StepNoRange(NMRDataStruct); k++) 
+			for (i = 0; i < ChunkNoRange(NMRDataStruct); i++) {
+				if ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) > TDDIndexRange(NMRDataStruct, k))
+					continue;
+				
+				if (TDDIsFloat64(NMRDataStruct, k)) {
+					if (memcmp(&ChunkRealFloat64(NMRDataStruct, k, i, 0), Raw + RawOffset[k] + ChunkDataStart(NMRDataStruct, i)*sizeof(double), 
+						2*ChunkIndexRange(NMRDataStruct, i)*sizeof(double)) != 0)
+						Mismatches++;
+				} else {
+					if (memcmp(&ChunkRealInt32(NMRDataStruct, k, i, 0), Raw + RawOffset[k] + ChunkDataStart(NMRDataStruct, i)*sizeof(int32_t), 
+						2*ChunkIndexRange(NMRDataStruct, i)*sizeof(int32_t)) != 0)
+						Mismatches++;
+				}
+			}
+		
+		Check(Mismatches == 0, "%s: compacted chunks identical to the complete raw data (%lu mismatches)", Name, (unsigned long) Mismatches);
+		Check(CompareProcResults(NMRDataStruct, &Results) == 0.0, "%s: chunk averages and DFT of the compacted data identical", Name);
+		
+		/** the complete data are loaded again on demand **/
+		Mismatches = 0;
+		if (CheckNMRData(NMRDataStruct, CHECK_RawData, ALL_STEPS) != DATA_OK) {
+			Check(0, "%s: the compacted raw data cannot be loaded again", Name);
+		} else {
+			for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+				if (TDDIsFloat64(NMRDataStruct, k)) {
+					if (memcmp(NMRDataStruct->Steps[k].RawDataFloat64, Raw + RawOffset[k], RawOffset[k + 1] - RawOffset[k]) != 0)
+						Mismatches++;
+				} else {
+					if (memcmp(NMRDataStruct->Steps[k].RawData, Raw + RawOffset[k], RawOffset[k + 1] - RawOffset[k]) != 0)
+						Mismatches++;
+				}
+			}
+			
+			Check((NMRDataStruct->ChunkSpace == NULL) && (Mismatches == 0), "%s: raw data loaded again after compacting identical (%lu steps differ)", 
+				Name, (unsigned long) Mismatches);
+		}
+	}
+	
+	NMRDataStruct->CompactRawData = CompactRawData;
+	RunStage(NMRDataStruct, CHECK_ChunkSet, CHECK_DFTResult);
+	
+	FreeProcResults(&Results);
+	free(RawOffset);
+	free(Raw);
+}
+
+/** Compares the echo peaks envelope with the peaks found by the definition **/
+void CheckEchoPeaks(NMRData *NMRDataStruct, const char *Name) {
+	size_t Mismatches = 0;
+	size_t IndexMin = 0;
+	size_t IndexMax = 0;
+	size_t Peak = 0;
+	size_t i = 0;
+	size_t k = 0;
+	double Amp = 0.0;
+	
+	if (CheckNMRData(NMRDataStruct, CHECK_EchoPeaksEnvelope, ALL_STEPS) != DATA_OK) {
+		Check(0, "%s: echo peaks envelope cannot be computed", Name);
+		return;
+	}
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		for (i = 0; i < EchoPeaksEnvelopeIndexRange(NMRDataStruct, k); i++) {
+			IndexMin = NMRDataStruct->ChunkStart;
+			IndexMax = (NMRDataStruct->ChunkEnd < ChunkIndexRange(NMRDataStruct, i))?(NMRDataStruct->ChunkEnd + 1):(ChunkIndexRange(NMRDataStruct, i));
+			
+			Amp = 0.0;
+			if (IndexMax > IndexMin) {
+				if (TDDIsFloat64(NMRDataStruct, k))
+					Amp = ReferenceEchoPeakFloat64(&ChunkRealFloat64(NMRDataStruct, k, i, IndexMin), IndexMax - IndexMin, &Peak);
+				else
+					Amp = ReferenceEchoPeakInt32(&ChunkRealInt32(NMRDataStruct, k, i, IndexMin), IndexMax - IndexMin, &Peak);
+			}
+			
+			if (Amp != EchoPeaksEnvelopeAmp(NMRDataStruct, k, i))
+				Mismatches++;
+			else
+			if ((Amp > 0.0) && (ChunkTime(NMRDataStruct, k, i, IndexMin + Peak) != EchoPeaksEnvelopeTime(NMRDataStruct, k, i)))
+				Mismatches++;
+		}
+	}
+	
+	Check(Mismatches == 0, "%s: echo peaks identical to the peaks found by the definition (%lu mismatches)", Name, (unsigned long) Mismatches);
+}
+
+/** Obtains the chunk set, the chunk averages and the DFT with 1 to the number of processors online (at least 2) threads, 
+    the chunk sets and the chunk averages must be identical, the DFT output (FFTW may choose other plans for more threads) within DFT_TOLERANCE **/
+void CheckThreads(NMRData *NMRDataStruct, const char *Name) {
+	ProcResults Reference;
+	unsigned int SavedThreads = 0;
+	unsigned int Processors = 0;
+	unsigned int Threads = 0;
+	int RetVal = DATA_OK;
+	double Deviation = 0.0;
+	double MaxDeviation = 0.0;
+	double Time = 0.0;
+	double SingleTime = 0.0;
+	
+	SavedThreads = NMRDataStruct->ProcThreads;
+	NMRDataStruct->ProcThreads = 0;
+	Processors = ChooseMax(GetProcThreadCount(NMRDataStruct), 2);
+	
+	NMRDataStruct->ProcThreads = 1;
+	if (RunStage(NMRDataStruct, CHECK_ChunkSet, CHECK_DFTResult) != DATA_OK) {
+		Check(0, "%s: the data cannot be processed by a single thread", Name);
+		NMRDataStruct->ProcThreads = SavedThreads;
+		return;
+	}
+	
+	SaveProcResults(NMRDataStruct, &Reference);
+	
+	if (Bench) {
+		SingleTime = MeasureStage(NMRDataStruct, CHECK_ChunkSet, CHECK_DFTResult);
+		printf("  chunk set, chunk averages and DFT, threads  1  %.3f ms\n", 1.0e3*SingleTime);
+	}
+	
+	for (Threads = 2; Threads <= Processors; Threads = ((Threads < Processors) && (2*Threads > Processors))?(Processors):(2*Threads)) {
+		NMRDataStruct->ProcThreads = Threads;
+		RetVal = RunStage(NMRDataStruct, CHECK_ChunkSet, CHECK_DFTResult);
+		
+		Deviation = (RetVal == DATA_OK)?(CompareProcResults(NMRDataStruct, &Reference)):(INFINITY);
+		if (Deviation > MaxDeviation)
+			MaxDeviation = Deviation;
+		
+		if (Bench && (RetVal == DATA_OK)) {
+			Time = MeasureStage(NMRDataStruct, CHECK_ChunkSet, CHECK_DFTResult);
+			printf("  chunk set, chunk averages and DFT, threads %2u  %.3f ms (x%.2f)\n", Threads, 1.0e3*Time, SingleTime/Time);
+		}
+	}
+	
+	Check(MaxDeviation <= DFT_TOLERANCE, "%s: results of 2 to %u threads identical to a single thread (maximum DFT deviation %.2e)", Name, Processors, MaxDeviation);
+	
+	FreeProcResults(&Reference);
+	NMRDataStruct->ProcThreads = SavedThreads;
+}
+
+/** Finds the chunks of synthetic echo trains of CHUNK_CHECK_MIN to CHUNK_CHECK_MAX echoes, the chunk set must be the generated one. 
+    The chunk set of the jittered trains must be the one found by searching through all the chunk pairs. **/
+void CheckChunkDetection(void) {
+	NMRData NMRDataStruct;
+	EchoTrain Train = {0, 4, 40, 96, 64, 0, 0, 0.0625};
+	size_t Chunks = 0;
+	size_t Mismatches = 0;
+	size_t i = 0;
+	double Time = 0.0;
+	double SearchTime = 0.0;
+	
+	printf("Chunk set of echo trains\n");
+	
+	for (Chunks = CHUNK_CHECK_MIN; Chunks <= CHUNK_CHECK_MAX; Chunks *= 4) {
+		Train.Chunks = Chunks;
+		Train.TD = 2*(Train.Offset + (Chunks + 1)*Train.Period);
+		
+		if (OpenEchoTrain(&NMRDataStruct, "chunks", &Train) != 0) {
+			Check(0, "the synthetic echo train of %lu chunks cannot be written", (unsigned long) Chunks);
+			continue;
+		}
+		
+		Mismatches = 0;
+		if (CheckNMRData(&NMRDataStruct, CHECK_ChunkSet, ALL_STEPS) != DATA_OK)
+			Mismatches = Chunks;
+		else {
+			if (ChunkNoRange(&NMRDataStruct) != Chunks)
+				Mismatches = Chunks;
+			
+			for (i = 0; (i < Chunks) && (Mismatches < Chunks); i++)
+				if ((ChunkDataStart(&NMRDataStruct, i) != 2*(Train.Offset + i*Train.Period)) || (ChunkIndexRange(&NMRDataStruct, i) != Train.Length))
+					Mismatches++;
+			
+			if (Bench) {
+				Time = MeasureStage(&NMRDataStruct, CHECK_ChunkSet, CHECK_ChunkSet);
+				printf("  GetChunkSet of %4lu chunks  %.3f ms, %.3f us/chunk\n", (unsigned long) Chunks, 1.0e3*Time, 1.0e6*Time/((double) Chunks));
+			}
+		}
+		
+		Check(Mismatches == 0, "chunk set of an echo train of %lu chunks is the generated one (%lu mismatches)", (unsigned long) Chunks, (unsigned long) Mismatches);
+		
+		CloseEchoTrain(&NMRDataStruct);
+	}
+	
+	for (Chunks = CHUNK_CHECK_MIN; Chunks <= CHUNK_CHECK_MAX; Chunks *= 4) {
+		Train.Chunks = Chunks;
+		Train.TD = 2*(Train.Offset + (Chunks + 1)*Train.Period);
+		
+		for (Train.Jitter = 1; Train.Jitter <= CHUNK_CHECK_JITTER; Train.Jitter *= 2) {
+			if (OpenEchoTrain(&NMRDataStruct, "chunks", &Train) != 0) {
+				Check(0, "the synthetic echo train of %lu chunks cannot be written", (unsigned long) Chunks);
+				continue;
+			}
+			
+			Check(CompareChunkSearch(&NMRDataStruct, &Time, &SearchTime), "chunk set of an echo train of %lu chunks jittered by %lu points is the one of the complete search", 
+				(unsigned long) Chunks, (unsigned long) Train.Jitter);
+			
+			if (Bench)
+				printf("  GetChunkSet of %4lu chunks jittered by %2lu points  %.3f ms, %.3f ms searching through all the chunk pairs\n", 
+					(unsigned long) Chunks, (unsigned long) Train.Jitter, 1.0e3*Time, 1.0e3*SearchTime);
+			
+			CloseEchoTrain(&NMRDataStruct);
+		}
+		
+		Train.Jitter = 0;
+	}
+}
+
+/** The chunk set of the dataset must be the one found by searching through all the chunk pairs **/
+void CheckChunkSearch(NMRData *NMRDataStruct, const char *Name) {
+	double Time = 0.0;
+	double SearchTime = 0.0;
+	
+	Check(CompareChunkSearch(NMRDataStruct, &Time, &SearchTime), "%s: chunk set identical to the one of the complete search", Name);
+	
+	if (Bench)
+		printf("  GetChunkSet  %.3f ms, %.3f ms searching through all the chunk pairs\n", 1.0e3*Time, 1.0e3*SearchTime);
+}
+
+/** Finds the chunk set of the echo train once by searching through all the chunk pairs and once by confirming the estimated period, returns 1 if they are identical. 
+    The times are measured in the benchmark only. **/
+int CompareChunkSearch(NMRData *NMRDataStruct, double *EstimateTime, double *SearchTime) {
+	SignalWindow *Reference = NULL;
+	size_t ReferenceCount = 0;
+	size_t i = 0;
+	int Identical = 1;
+	
+	*EstimateTime = 0.0;
+	*SearchTime = 0.0;
+	
+	ChunkPeriodEstimate = 0;
+	if (Bench)
+		*SearchTime = MeasureStage(NMRDataStruct, CHECK_StepSet, CHECK_ChunkSet);
+	else
+		RunStage(NMRDataStruct, CHECK_StepSet, CHECK_ChunkSet);
+	ChunkPeriodEstimate = 1;
+	
+	ReferenceCount = ChunkNoRange(NMRDataStruct);
+	Reference = (SignalWindow *) malloc((ReferenceCount + 1)*sizeof(SignalWindow));
+	if (Reference == NULL) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	if (ReferenceCount > 0)
+		memcpy(Reference, NMRDataStruct->ChunkSet, ReferenceCount*sizeof(SignalWindow));
+	
+	if (Bench)
+		*EstimateTime = MeasureStage(NMRDataStruct, CHECK_StepSet, CHECK_ChunkSet);
+	else
+		RunStage(NMRDataStruct, CHECK_StepSet, CHECK_ChunkSet);
+	
+	if (ChunkNoRange(NMRDataStruct) != ReferenceCount)
+		Identical = 0;
+	
+	for (i = 0; (i < ReferenceCount) && Identical; i++)
+		if ((ChunkDataStart(NMRDataStruct, i) != Reference[i].start) || (ChunkIndexRange(NMRDataStruct, i) != Reference[i].length))
+			Identical = 0;
+	
+	free(Reference);
+	
+	return Identical;
+}
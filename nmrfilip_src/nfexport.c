@@ -149,6 +149,14 @@ int ProcParamsToText(NMRData *NMRDataStruct, FILE *foutput, char **soutput, size
 		if (RVal == DATA_OK)
 			WriteAcqusStyleParamValueWEC(NMRDataStruct, foutput, "%RemoveOffset", &ProcParam, PARAM_LONG, &RetValW);
 
+		RetVal |= RVal = GetProcParam(NMRDataStruct, PROC_PARAM_Apodization, PARAM_LONG, &ProcParam, &Step);
+		if (RVal == DATA_OK)
+			WriteAcqusStyleParamValueWEC(NMRDataStruct, foutput, "%Apodization", &ProcParam, PARAM_LONG, &RetValW);
+
+		RetVal |= RVal = GetProcParam(NMRDataStruct, PROC_PARAM_ApodizationParam, PARAM_LONG, &ProcParam, &Step);
+		if (RVal == DATA_OK)
+			WriteAcqusStyleParamValueWEC(NMRDataStruct, foutput, "%ApodizationParam", &ProcParam, PARAM_LONG, &RetValW);
+
 		RetVal |= RVal = GetProcParam(NMRDataStruct, PROC_PARAM_Filter, PARAM_LONG, &ProcParam, &Step);
 		if (RVal == DATA_OK)
 			WriteAcqusStyleParamValueWEC(NMRDataStruct, foutput, "%FilterHz", &ProcParam, PARAM_LONG, &RetValW);
@@ -244,7 +252,7 @@ int TDDToText(NMRData *NMRDataStruct, FILE *foutput, char **soutput, size_t *sle
 	char *title = "Time domain data";
 	const size_t titlelen = 2+strlen(title)+2;
 	const size_t headlen = 4 + 7+20+3+21+1+strlen(AssocUnits(NMRDataStruct))+2 + 22;
-	const size_t rowlen = 22+2*11+4;
+	const size_t rowlen = 22+2*(((NMRDataStruct->StepCount > 0) && TDDIsFloat64(NMRDataStruct, 0))?(23):(11))+4;
 	const size_t buflen = StepNoRange(NMRDataStruct)*(TDDIndexRange(NMRDataStruct, 0)*rowlen + headlen) + titlelen + 1;
 	size_t i = 0, j = 0;
 	int ferr = 0, serr = 0, written = 0;
@@ -259,14 +267,26 @@ int TDDToText(NMRData *NMRDataStruct, FILE *foutput, char **soutput, size_t *sle
 				((i > 0)?("\n\n"):("")), (uint64_t) i, StepAssocValue(NMRDataStruct, i), AssocUnits(NMRDataStruct));
 			ferr = ferr || (written < 0);
 			
-			for (j = 0; (j < TDDIndexRange(NMRDataStruct, i)) && !ferr; j++) {
-				written = fprintf(foutput, "%" PRIu64 "\t%" PRIu64 "\t%.15g\t%" PRIi32 "\t%" PRIi32 "\t%lu\n", 
-					(uint64_t) i, (uint64_t) j, 
-					TDDTime(NMRDataStruct, i, j), 
-					TDDReal(NMRDataStruct, i, j), 
-					TDDImag(NMRDataStruct, i, j), 
-					StepFlag(NMRDataStruct, i));
-				ferr = ferr || (written < 0);
+			if (TDDIsFloat64(NMRDataStruct, i)) {
+				for (j = 0; (j < TDDIndexRange(NMRDataStruct, i)) && !ferr; j++) {
+					written = fprintf(foutput, "%" PRIu64 "\t%" PRIu64 "\t%.15g\t%.15g\t%.15g\t%lu\n", 
+						(uint64_t) i, (uint64_t) j, 
+						TDDTime(NMRDataStruct, i, j), 
+						TDDRealFloat64(NMRDataStruct, i, j), 
+						TDDImagFloat64(NMRDataStruct, i, j), 
+						StepFlag(NMRDataStruct, i));
+					ferr = ferr || (written < 0);
+				}
+			} else {
+				for (j = 0; (j < TDDIndexRange(NMRDataStruct, i)) && !ferr; j++) {
+					written = fprintf(foutput, "%" PRIu64 "\t%" PRIu64 "\t%.15g\t%" PRIi32 "\t%" PRIi32 "\t%lu\n", 
+						(uint64_t) i, (uint64_t) j, 
+						TDDTime(NMRDataStruct, i, j), 
+						TDDRealInt32(NMRDataStruct, i, j), 
+						TDDImagInt32(NMRDataStruct, i, j), 
+						StepFlag(NMRDataStruct, i));
+					ferr = ferr || (written < 0);
+				}
 			}
 		}
 		
@@ -285,12 +305,22 @@ int TDDToText(NMRData *NMRDataStruct, FILE *foutput, char **soutput, size_t *sle
 				((i > 0)?("\n\n"):("")), (uint64_t) i, StepAssocValue(NMRDataStruct, i), AssocUnits(NMRDataStruct));
 			serr = serr || ((written < 0) || (((size_t) written) > headlen));
 			
-			for (j = 0; (j < TDDIndexRange(NMRDataStruct, i)) && !serr; j++) {
-				s += written = snprintf(s, rowlen + 1, "%.15g\t%" PRIi32 "\t%" PRIi32 "\n", 
-					TDDTime(NMRDataStruct, i, j), 
-					TDDReal(NMRDataStruct, i, j), 
-					TDDImag(NMRDataStruct, i, j));
-				serr = serr || ((written < 0) || (((size_t) written) > rowlen));
+			if (TDDIsFloat64(NMRDataStruct, i)) {
+				for (j = 0; (j < TDDIndexRange(NMRDataStruct, i)) && !serr; j++) {
+					s += written = snprintf(s, rowlen + 1, "%.15g\t%.15g\t%.15g\n", 
+						TDDTime(NMRDataStruct, i, j), 
+						TDDRealFloat64(NMRDataStruct, i, j), 
+						TDDImagFloat64(NMRDataStruct, i, j));
+					serr = serr || ((written < 0) || (((size_t) written) > rowlen));
+				}
+			} else {
+				for (j = 0; (j < TDDIndexRange(NMRDataStruct, i)) && !serr; j++) {
+					s += written = snprintf(s, rowlen + 1, "%.15g\t%" PRIi32 "\t%" PRIi32 "\n", 
+						TDDTime(NMRDataStruct, i, j), 
+						TDDRealInt32(NMRDataStruct, i, j), 
+						TDDImagInt32(NMRDataStruct, i, j));
+					serr = serr || ((written < 0) || (((size_t) written) > rowlen));
+				}
 			}
 		}
 		
@@ -149,6 +149,8 @@ int LoadTextFile(NMRData *NMRDataStruct, char **TextData, size_t *TextLength, ch
 		return (DATA_VOID | INVALID_PARAMETER);
 	}
 	
+	DropParamIndex(NMRDataStruct, *TextData);
+	
 	TextFD = fopen(TextFileName, "rb");
 	if (TextFD == NULL) {
 		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Opening text file");
@@ -242,6 +244,9 @@ int LoadTextFile(NMRData *NMRDataStruct, char **TextData, size_t *TextLength, ch
 
 	(*TextData)[ByteSize] = '\0';
 	
+	/** The memory might have been used by a text indexed before **/
+	DropParamIndex(NMRDataStruct, *TextData);
+	
 	
 	if (fclose(TextFD) != 0) {
 		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Closing text file");
@@ -265,6 +270,8 @@ int FreeText(NMRData *NMRDataStruct, char **TextData, size_t *TextLength) {
 		return (DATA_VOID | INVALID_PARAMETER);
 	}
 	
+	DropParamIndex(NMRDataStruct, *TextData);
+	
 	free(*TextData);
 	*TextData = NULL;
 	*TextLength = 0;
@@ -399,8 +406,188 @@ int WriteAcqusStyleParamSet(NMRData *NMRDataStruct, FILE *output, char *ParamNam
 }
 
 
+void InitParamIndex(ParamIndex *Index) {
+	
+	Index->Text = NULL;
+	Index->TextLength = 0;
+	Index->Entries = NULL;
+	Index->EntryCount = 0;
+	Index->Buckets = NULL;
+	Index->BucketCount = 0;
+}
+
+
+int FreeParamIndex(ParamIndex *Index) {
+	
+	if (Index == NULL)
+		return INVALID_PARAMETER;
+	
+	free(Index->Entries);
+	free(Index->Buckets);
+	InitParamIndex(Index);
+	
+	return DATA_EMPTY;
+}
+
+
+/** FNV-1a hash of the parameter name **/
+size_t HashParamName(const char *Name, size_t Length) {
+	uint32_t Hash = 2166136261u;
+	size_t i = 0;
+	
+	for (i = 0; i < Length; i++) {
+		Hash ^= (unsigned char) Name[i];
+		Hash *= 16777619u;
+	}
+	
+	return (size_t) Hash;
+}
+
+
+/** Indexes the "##NAME=" lines of the text in a single pass, the entries with the same NAME are kept in the order of the text **/
+int BuildParamIndex(NMRData *NMRDataStruct, ParamIndex *Index, char *TextData, size_t TextLength) {
+	ParamIndexEntry *AuxPointer = NULL;
+	size_t BufferLength = 0;
+	size_t Bucket = 0;
+	size_t i = 0;
+	char *ptr1 = NULL;
+	size_t length = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((Index == NULL) || (TextData == NULL))
+		return INVALID_PARAMETER;
+	
+	FreeParamIndex(Index);
+	
+	ptr1 = TextData;
+	if (strncmp(ptr1, "\xEF\xBB\xBF", 3) == 0)
+		ptr1 += 3;	/** skip UTF-8 BOM if present **/
+	
+	/** Collect the entries **/
+	for (; *ptr1 != '\0'; ptr1 += strcspn(ptr1, "\r\n")) {
+		ptr1 += strspn(ptr1, " \t\v\f\r\n");
+		if ((ptr1[0] != '#') || (ptr1[1] != '#'))
+			continue;
+		
+		length = strcspn(ptr1 + 2, "=\r\n");
+		if (ptr1[2 + length] != '=')
+			continue;
+		
+		if (Index->EntryCount == BufferLength) {
+			BufferLength = (BufferLength == 0)?(256):(2*BufferLength);
+			
+			AuxPointer = Index->Entries;
+			Index->Entries = (ParamIndexEntry *) realloc(Index->Entries, BufferLength*sizeof(ParamIndexEntry));
+			
+			if (Index->Entries == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating parameter index memory space");
+				Index->Entries = AuxPointer;
+				AuxPointer = NULL;
+				FreeParamIndex(Index);
+				return (MEM_ALLOC_ERROR | DATA_EMPTY);
+			}
+		}
+		
+		Index->Entries[Index->EntryCount].NameStart = (ptr1 + 2) - TextData;
+		Index->Entries[Index->EntryCount].NameLength = length;
+		Index->Entries[Index->EntryCount].Next = PARAM_INDEX_NONE;
+		Index->EntryCount++;
+	}
+	
+	/** Hash the entries, at most 2 entries per bucket on average **/
+	for (Index->BucketCount = 16; Index->BucketCount < Index->EntryCount; Index->BucketCount *= 2)
+		;
+	Index->BucketCount *= 2;
+	
+	Index->Buckets = (size_t *) malloc(Index->BucketCount*sizeof(size_t));
+	if (Index->Buckets == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating parameter index memory space");
+		FreeParamIndex(Index);
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	}
+	
+	for (i = 0; i < Index->BucketCount; i++)
+		Index->Buckets[i] = PARAM_INDEX_NONE;
+	
+	/** Inserting at the bucket head in the reverse order keeps the order of the text within the bucket **/
+	for (i = Index->EntryCount; i > 0; i--) {
+		Bucket = HashParamName(TextData + Index->Entries[i - 1].NameStart, Index->Entries[i - 1].NameLength) & (Index->BucketCount - 1);
+		Index->Entries[i - 1].Next = Index->Buckets[Bucket];
+		Index->Buckets[Bucket] = i - 1;
+	}
+	
+	Index->Text = TextData;
+	Index->TextLength = TextLength;
+	
+	return DATA_OK;
+}
+
+
+/** Returns the index of the given text (AcqusData of NMRDataStruct or other one), building it if not available yet **/
+ParamIndex *GetParamIndex(NMRData *NMRDataStruct, char *TextData, size_t TextLength) {
+	ParamIndex *Index = NULL;
+	
+	if ((NMRDataStruct == NULL) || (TextData == NULL))
+		return NULL;
+	
+	if (TextData == NMRDataStruct->AcqusData)
+		Index = &(NMRDataStruct->AcqusIndex);
+	else
+		Index = &(NMRDataStruct->TextIndex);
+	
+	if ((Index->Text != TextData) || (Index->TextLength != TextLength))
+		if (BuildParamIndex(NMRDataStruct, Index, TextData, TextLength) != DATA_OK)
+			return NULL;
+	
+	return Index;
+}
+
+
+/** Invalidates the index of the given text, has to be called whenever the text is changed or freed **/
+void DropParamIndex(NMRData *NMRDataStruct, char *TextData) {
+	
+	if ((NMRDataStruct == NULL) || (TextData == NULL))
+		return;
+	
+	if (NMRDataStruct->AcqusIndex.Text == TextData)
+		FreeParamIndex(&(NMRDataStruct->AcqusIndex));
+	
+	if (NMRDataStruct->TextIndex.Text == TextData)
+		FreeParamIndex(&(NMRDataStruct->TextIndex));
+}
+
+
+/** Finds the first "##ParamName=" line whose value starts with ValuePrefix and returns the pointer behind the prefix, NULL if not found **/
+char *FindParamValue(ParamIndex *Index, char *ParamName, char *ValuePrefix) {
+	size_t i = 0;
+	size_t length = 0;
+	char *Value = NULL;
+	
+	if ((Index == NULL) || (Index->Text == NULL) || (Index->Buckets == NULL) || (ParamName == NULL) || (ValuePrefix == NULL))
+		return NULL;
+	
+	length = strlen(ParamName);
+	
+	for (i = Index->Buckets[HashParamName(ParamName, length) & (Index->BucketCount - 1)]; i != PARAM_INDEX_NONE; i = Index->Entries[i].Next) {
+		if ((Index->Entries[i].NameLength != length) || (strncmp(Index->Text + Index->Entries[i].NameStart, ParamName, length) != 0))
+			continue;
+		
+		Value = Index->Text + Index->Entries[i].NameStart + length + 1;
+		if (strncmp(Value, ValuePrefix, strlen(ValuePrefix)) == 0)
+			return Value + strlen(ValuePrefix);
+	}
+	
+	return NULL;
+}
+
+
 int GetAcqusStyleParamValue(NMRData *NMRDataStruct, char *AcqusData, size_t AcqusLength, char *ParamName, void *ParamValue, unsigned int type) {
-	char buf1[256];
+	ParamIndex *Index = NULL;
 	char *ptr1 = NULL;
 	char *ptr2 = NULL;
 	char *AuxPointer = NULL;
@@ -421,25 +608,11 @@ int GetAcqusStyleParamValue(NMRData *NMRDataStruct, char *AcqusData, size_t Acqu
 	if ((ParamName == NULL) || (ParamValue == NULL))
 		return INVALID_PARAMETER;
 
-	*buf1 = '\0';
-	strcat(buf1, "##");
-	strncat(buf1, ParamName, 128);
-	strcat(buf1, "= ");
-
-	ptr1 = AcqusData;
-	if (strncmp(ptr1, "\xEF\xBB\xBF", 3) == 0)
-		ptr1 += 3;	/** skip UTF-8 BOM if present **/
+	if ((Index = GetParamIndex(NMRDataStruct, AcqusData, AcqusLength)) == NULL)
+		return (DATA_OLD | MEM_ALLOC_ERROR);
 	
-	for (length = strlen(buf1); *ptr1 != '\0'; ptr1 += strcspn(ptr1, "\r\n")) {
-		ptr1 += strspn(ptr1, " \t\v\f\r\n");
-		if (strncmp(ptr1, buf1, length) == 0) 
-			break;
-	}
-
-	if (*ptr1 == '\0')
+	if ((ptr1 = FindParamValue(Index, ParamName, " ")) == NULL)
 		return (DATA_OLD | DATA_EMPTY);
-
-	ptr1 += length;
 	
 	switch (type) {
 		case PARAM_LONG:
@@ -500,8 +673,7 @@ int GetAcqusStyleParamSet(NMRData *NMRDataStruct, char *AcqusData, size_t AcqusL
 	void *AuxParamPointer = NULL;
 	char *StartPointer = NULL;
 	double AuxDouble = 0.0;
-	size_t length = 0;
-	char buf1[256];
+	ParamIndex *Index = NULL;
 	char *ptr1 = NULL;
 	char *ptr2 = NULL;
 	
@@ -518,27 +690,12 @@ int GetAcqusStyleParamSet(NMRData *NMRDataStruct, char *AcqusData, size_t AcqusL
 	if ((ParamName == NULL) || (ParamSet == NULL) || (ParamSetLength == NULL))
 		return INVALID_PARAMETER;
 	
-	*buf1 = 0;
+	if ((Index = GetParamIndex(NMRDataStruct, AcqusData, AcqusLength)) == NULL)
+		return (DATA_OLD | MEM_ALLOC_ERROR);
 	
-	strcat(buf1, "##");
-	strncat(buf1, ParamName, 128);
-	strcat(buf1, "= (0..");
-	
-	ptr1 = AcqusData;
-	if (strncmp(ptr1, "\xEF\xBB\xBF", 3) == 0)
-		ptr1 += 3;	/** skip UTF-8 BOM if present **/
-	
-	for (length = strlen(buf1); *ptr1 != '\0'; ptr1 += strcspn(ptr1, "\r\n")) {
-		ptr1 += strspn(ptr1, " \t\v\f\r\n");
-		if (strncmp(ptr1, buf1, length) == 0) 
-			break;
-	}
-
-	if (*ptr1 == '\0') 
+	if ((ptr1 = FindParamValue(Index, ParamName, " (0..")) == NULL)
 		return (DATA_OLD | DATA_EMPTY);
 	
-	ptr1 += strlen(buf1);
-	
 	errno = 0;
 	ParamCount = strtol(ptr1, &ptr2, 0);
 	if (errno || (ptr1 == ptr2)) {
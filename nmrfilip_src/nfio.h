@@ -38,6 +38,13 @@ int LoadTextFile(NMRData *NMRDataStruct, char **TextData, size_t *TextLength, ch
 int FreeText(NMRData *NMRDataStruct, char **TextData, size_t *TextLength);
 int WriteAcqusStyleParamValue(NMRData *NMRDataStruct, FILE *output, char *ParamName, void *ParamValue, unsigned int type);
 int WriteAcqusStyleParamSet(NMRData *NMRDataStruct, FILE *output, char *ParamName, void *ParamSet, size_t ParamSetLength, unsigned int type);
+void InitParamIndex(ParamIndex *Index);
+int FreeParamIndex(ParamIndex *Index);
+size_t HashParamName(const char *Name, size_t Length);
+int BuildParamIndex(NMRData *NMRDataStruct, ParamIndex *Index, char *TextData, size_t TextLength);
+ParamIndex *GetParamIndex(NMRData *NMRDataStruct, char *TextData, size_t TextLength);
+void DropParamIndex(NMRData *NMRDataStruct, char *TextData);
+char *FindParamValue(ParamIndex *Index, char *ParamName, char *ValuePrefix);
 int GetAcqusStyleParamValue(NMRData *NMRDataStruct, char *AcqusData, size_t AcqusLength, char *ParamName, void *ParamValue, unsigned int type);
 int GetAcqusStyleParamSet(NMRData *NMRDataStruct, char *AcqusData, size_t AcqusLength, char *ParamName, void **ParamSet, size_t *ParamSetLength, unsigned int type);
 int GetAcqusParamValue(NMRData *NMRDataStruct, char *ParamName, void *ParamValue, unsigned int type);
@@ -18,6 +18,10 @@
  * 
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE	/** mremap **/
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -25,6 +29,16 @@
 #include <errno.h>
 #include <limits.h>
 #include <inttypes.h>
+#ifndef __WIN32__
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if THREADS
+#include <pthread.h>
+#endif
 #include "fftw3.h"
 
 #include "nmrfilip.h"
@@ -32,6 +46,14 @@
 #include "nfio.h"
 #include "nfload.h"
 #include "nfproc.h"
+#include "nfsimd.h"
+
+
+/** Size of a complex point of raw data in the datafile in bytes **/
+#define RawPointSize(NMRDataPtr)	(((NMRDataPtr)->DTypA == RAW_TYPE_FLOAT64)?(16):(8))
+
+/** Size of a single datafile read request in bytes, a multiple of 1024 **/
+#define RawReadBlockSize(NMRDataPtr)	(((NMRDataPtr)->ReadBlockSize < 1024)?((size_t) 1024):((NMRDataPtr)->ReadBlockSize & ~((size_t) 1023)))
 
 
 typedef struct {
@@ -378,6 +400,14 @@ int GetAcquParams(NMRData *NMRDataStruct, long StepNo, unsigned long Components)
 		else
 			NMRDataStruct->DTypA = 0;
 		
+		/** lines of double precision data are aligned to 1024 B as well, i.e. to 128 values instead of 256 **/
+		if ((NMRDataStruct->DTypA == RAW_TYPE_FLOAT64) && ((NMRDataStruct->TimeDomain) > 0)) {
+			NMRDataStruct->PointLine = ((NMRDataStruct->TimeDomain)&(~((int)0x7f)));
+			if (((NMRDataStruct->TimeDomain)&(0x7f)) != 0x00)
+				NMRDataStruct->PointLine += 0x80;
+			NMRDataStruct->PointLine >>= 1;
+		}
+		
 		
 		/** load parameters related to the digital filter used during the acquisition (should the loading fail, the defaults are reasonable) **/
 		GetAcqusParamValue(NMRDataStruct, "$DIGMOD", &(NMRDataStruct->AcquInfo.DigMod), PARAM_LONG);
@@ -831,30 +861,18 @@ int FreeAcquInfo(NMRData *NMRDataStruct) {
 }
 
 
-int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
+/** Prepares the datafile for loading: allocates the data space of the datafile size (or maps the datafile). 
+    Nothing is read here, the steps are read and converted to the host byte order by GetRawData on their first use. **/
+int LoadRawData(NMRData *NMRDataStruct) {
 	const int DFOK = (DATA_OK | FILE_LOADED_OK);
 	int RetVal = DFOK;
 
 	FILE *ser = NULL;
 	
-	unsigned char ByteLineBuffer[1024];
-	char *FileIOBufffer = NULL;
-	
-	unsigned int ByteLine = 0;
 	long ByteSize = 0;
+	size_t ByteLine = 0;
 	
 	int32_t *AuxPointer = NULL;
-	long i, j;
-	
-	register uint32_t RealB0 = 0;
-	register uint32_t RealB1 = 0;
-	register uint32_t RealB2 = 0;
-	register uint32_t RealB3 = 0;
-	
-	register uint32_t ImagB0 = 0;
-	register uint32_t ImagB1 = 0;
-	register uint32_t ImagB2 = 0;
-	register uint32_t ImagB3 = 0;
 	
 	if (NMRDataStruct == NULL)
 		return NMR_DATA_STRUCT_VOID;
@@ -873,11 +891,24 @@ int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		return (INVALID_PARAMETER | DATA_OLD);
 	}
 	
-	if (NMRDataStruct->DTypA != 0) {
+	if ((NMRDataStruct->DTypA != RAW_TYPE_INT32) && (NMRDataStruct->DTypA != RAW_TYPE_FLOAT64)) {
 		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Unsupported data format", "Opening datafile");
 		return (INVALID_PARAMETER | DATA_OLD);
 	}
 	
+	/** Map the file if requested, read it the usual way if the mapping is not available **/
+	if (NMRDataStruct->LoadMode == RAW_LOAD_MMAP) {
+		RetVal = MapRawData(NMRDataStruct);
+		if ((RetVal != DFOK) || (NMRDataStruct->DataMap != NULL))
+			return RetVal;
+	}
+	
+	/** The data space is reallocated below, so it must not point to a mapping **/
+	if (NMRDataStruct->DataMap != NULL)
+		UnmapRawData(NMRDataStruct);
+	
+	ByteLine = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct);
+	
 	/** Open the file **/
 	ser = fopen(NMRDataStruct->SerName, "rb");
 	if (ser == NULL) {
@@ -885,21 +916,7 @@ int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		return (FILE_OPEN_ERROR | DATA_OLD);
 	}
 
-	ByteLine = NMRDataStruct->PointLine * 8;
-
-	
-	/** Buffer two times longer than one step should speed up the reading **/
-	FileIOBufffer = malloc(2*ByteLine);
-	if (FileIOBufffer == NULL) 
-		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating datafile I/O buffer");
-	else
-		if (setvbuf(ser, FileIOBufffer, _IOFBF, 2*ByteLine) != 0) {
-			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Setting datafile I/O buffer");
-			RetVal |= (FILE_IO_ERROR | DATA_OLD);
-		}
-	
-	
-	if ((RetVal == DFOK) && fseek(ser, 0, SEEK_END)) {
+	if (fseek(ser, 0, SEEK_END)) {
 		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Determining datafile size");
 		RetVal |= (FILE_IO_ERROR | DATA_OLD);
 	}
@@ -909,18 +926,24 @@ int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		RetVal |= (FILE_IO_ERROR | DATA_OLD);
 	}
 	
-	if ((RetVal == DFOK) && fseek(ser, 0, SEEK_SET)) {
-		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Seeking datafile start");
-		RetVal |= (FILE_IO_ERROR | DATA_OLD);
-	}
-	
 	/** Is it non-empty? Is it alligned to 1024 B? **/
 	if ((RetVal == DFOK) && ((ByteSize <= 0) || ((ByteSize % 1024) != 0))) {
 		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Wrong datafile size", "Checking datafile size");
 		RetVal |= (FILE_WRONG_SIZE | DATA_OLD);
 	}
 	
-	/** Memory space allocation **/
+	/** No line has been read yet, the file might have changed since the last load; the spare entry avoids zero-size allocation **/
+	if (RetVal == DFOK) {
+		free(NMRDataStruct->DataLoaded);
+		NMRDataStruct->DataLoaded = (unsigned char *) calloc(ByteSize / ByteLine + 1, sizeof(unsigned char));
+		
+		if (NMRDataStruct->DataLoaded == NULL) {
+			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating datafile line flags");
+			RetVal |= (MEM_ALLOC_ERROR | DATA_EMPTY);
+		}
+	}
+	
+	/** Memory space allocation, the pages of the lines never read are not even touched **/
 	if ((RetVal == DFOK) && ((NMRDataStruct->DataSize != ((size_t) ByteSize/4)) || (NMRDataStruct->DataSpace == NULL))) {
 		AuxPointer = NMRDataStruct->DataSpace;
 		NMRDataStruct->DataSpace = (int32_t *) realloc(NMRDataStruct->DataSpace, ByteSize/4*sizeof(int32_t));
@@ -935,55 +958,345 @@ int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		}
 	}
 	
-	/** Read the data to memory **/
-	if (RetVal == DFOK) {
-		if (NMRDataStruct->ByteOrder) {
-			/** Big endian **/
-			for (i = 0; i < ByteSize/1024; i++) {
-				if (fread(ByteLineBuffer, 1, 1024, ser) != 1024) {
-					NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Reading datafile");
-					RetVal |= (FILE_IO_ERROR | DATA_INVALID);
-					break;
-				}
-				
-				for (j = 0; j < 128; j++) {
-					RealB0 = ByteLineBuffer[j*8+0];
-					RealB1 = ByteLineBuffer[j*8+1];
-					RealB2 = ByteLineBuffer[j*8+2];
-					RealB3 = ByteLineBuffer[j*8+3];
-				
-					ImagB0 = ByteLineBuffer[j*8+4];
-					ImagB1 = ByteLineBuffer[j*8+5];
-					ImagB2 = ByteLineBuffer[j*8+6];
-					ImagB3 = ByteLineBuffer[j*8+7];
-				
-					(NMRDataStruct->DataSpace)[256*i+2*j+0] = (int32_t) ((RealB0 << 24) | (RealB1 << 16) | (RealB2 << 8) | (RealB3 << 0));
-					(NMRDataStruct->DataSpace)[256*i+2*j+1] = (int32_t) ((ImagB0 << 24) | (ImagB1 << 16) | (ImagB2 << 8) | (ImagB3 << 0));
-				}
+	/** Close the file **/
+	if (fclose(ser) != 0) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Closing datafile");
+		RetVal |= FILE_NOT_CLOSED;
+	}
+	
+	return RetVal;
+}
+
+
+/** Reads the lines (steps) First to End - 1 of the datafile into DataSpace unless they have been read already, the consecutive lines not read yet are read together. 
+    Nothing is done if the datafile is mapped. **/
+int ReadRawDataLines(NMRData *NMRDataStruct, size_t First, size_t End) {
+	FILE *ser = NULL;
+	size_t ByteLine = 0;
+	size_t i = 0;
+	size_t j = 0;
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->DataLoaded == NULL) || (NMRDataStruct->DataSpace == NULL) || (NMRDataStruct->PointLine == 0))
+		return DATA_OK;
+	
+	ByteLine = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct);
+	
+	if ((First > End) || (End*ByteLine > NMRDataStruct->DataSize*4))
+		return INVALID_PARAMETER;
+	
+	for (i = First; (i < End) && (RetVal == DATA_OK); i = j) {
+		if (NMRDataStruct->DataLoaded[i]) {
+			j = i + 1;
+			continue;
+		}
+		
+		for (j = i + 1; (j < End) && (!NMRDataStruct->DataLoaded[j]); j++) 
+			;
+		
+		/** Open the file for the first line missing **/
+		if (ser == NULL) {
+			ser = fopen(NMRDataStruct->SerName, "rb");
+			if (ser == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Opening datafile");
+				return (FILE_OPEN_ERROR | DATA_INVALID);
 			}
-		} else {
-			/** Little endian **/
-			for (i = 0; i < ByteSize/1024; i++) {
-				if (fread(ByteLineBuffer, 1, 1024, ser) != 1024) {
-					NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Reading datafile");
-					RetVal |= (FILE_IO_ERROR | DATA_INVALID);
-					break;
-				}
-				
-				for (j = 0; j < 128; j++) {
-					RealB0 = ByteLineBuffer[j*8+0];
-					RealB1 = ByteLineBuffer[j*8+1];
-					RealB2 = ByteLineBuffer[j*8+2];
-					RealB3 = ByteLineBuffer[j*8+3];
-				
-					ImagB0 = ByteLineBuffer[j*8+4];
-					ImagB1 = ByteLineBuffer[j*8+5];
-					ImagB2 = ByteLineBuffer[j*8+6];
-					ImagB3 = ByteLineBuffer[j*8+7];
-				
-					(NMRDataStruct->DataSpace)[256*i+2*j+0] = (int32_t) ((RealB0 << 0) | (RealB1 << 8) | (RealB2 << 16) | (RealB3 << 24));
-					(NMRDataStruct->DataSpace)[256*i+2*j+1] = (int32_t) ((ImagB0 << 0) | (ImagB1 << 8) | (ImagB2 << 16) | (ImagB3 << 24));
-				}
+			
+			/** The lines are read in large blocks straight to the data space, a stream buffer would only add copying **/
+			if (setvbuf(ser, NULL, _IONBF, 0) != 0) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Setting datafile I/O buffer");
+				RetVal |= (FILE_IO_ERROR | DATA_INVALID);
+				break;
+			}
+		}
+		
+		if (fseek(ser, (long) (i*ByteLine), SEEK_SET)) {
+			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Seeking datafile line");
+			RetVal |= (FILE_IO_ERROR | DATA_INVALID);
+			break;
+		}
+		
+		/** The lines are alligned to 1024 B **/
+		RetVal |= ReadRawDataBlocks(NMRDataStruct, ser, i*ByteLine/1024, j*ByteLine/1024);
+		if (RetVal == DATA_OK)
+			memset(NMRDataStruct->DataLoaded + i, 1, j - i);
+	}
+	
+	/** Close the file **/
+	if ((ser != NULL) && (fclose(ser) != 0)) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Closing datafile");
+		RetVal |= FILE_NOT_CLOSED;
+	}
+	
+	return RetVal;
+}
+
+
+/** Reads the 1024 B blocks FirstBlock to EndBlock - 1 of the opened datafile into DataSpace and converts them to the host byte order in place. 
+    The file position must correspond to FirstBlock. If the conversion is necessary, the reading is carried out by a separate thread ahead of the conversion. **/
+int ReadRawDataBlocks(NMRData *NMRDataStruct, FILE *ser, size_t FirstBlock, size_t EndBlock) {
+	unsigned char *Dest = NULL;
+	size_t Length = 0;
+	size_t BlockSize = 0;
+	size_t Count = 0;
+	size_t Pos = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((ser == NULL) || (NMRDataStruct->DataSpace == NULL) || (EndBlock*256 > NMRDataStruct->DataSize) || (FirstBlock > EndBlock))
+		return (INVALID_PARAMETER | DATA_INVALID);
+	
+	Dest = (unsigned char *) (NMRDataStruct->DataSpace + 256*FirstBlock);
+	Length = (EndBlock - FirstBlock)*1024;
+	BlockSize = RawReadBlockSize(NMRDataStruct);
+	
+#if THREADS
+	if ((NMRDataStruct->ReadQueueDepth > 0) && (Length > BlockSize) && ((NMRDataStruct->ByteOrder != 0) != HostIsBigEndian())) 
+		if (ReadRawDataPipelined(NMRDataStruct, ser, Dest, Length) != INVALID_PARAMETER)	/** otherwise the thread could not be started **/
+			return DATA_OK;
+#endif
+	
+	for (Pos = 0; Pos < Length; Pos += Count) {
+		Count = ((Length - Pos) < BlockSize)?(Length - Pos):(BlockSize);
+		
+		if (fread(Dest + Pos, 1, Count, ser) != Count) {
+			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Reading datafile");
+			return (FILE_IO_ERROR | DATA_INVALID);
+		}
+		
+		DecodeRawDataBytes(NMRDataStruct, Dest + Pos, Count);
+	}
+	
+	return DATA_OK;
+}
+
+
+/** Converts Count bytes (multiple of 1024) of the datafile content at Data to the host byte order in place **/
+void DecodeRawDataBytes(NMRData *NMRDataStruct, unsigned char *Data, size_t Count) {
+	
+	if (NMRDataStruct->DTypA == RAW_TYPE_FLOAT64)
+		DecodeFloat64((double *) Data, Data, Count / 8, NMRDataStruct->ByteOrder);
+	else
+		DecodeInt32((int32_t *) Data, Data, Count / 4, NMRDataStruct->ByteOrder);
+}
+
+
+#if THREADS
+/** State shared by the read-ahead thread and the converting thread. The window of DataSpace between Decoded and Read serves as the queue of blocks read but not yet converted. **/
+typedef struct {
+	FILE *ser;
+	unsigned char *Dest;
+	size_t Length;
+	size_t BlockSize;
+	size_t QueueLength;	/** in bytes **/
+	size_t Read;	/** bytes read so far **/
+	size_t Decoded;	/** bytes converted so far **/
+	int Failed;
+	int ErrorNumber;
+	pthread_mutex_t Lock;
+	pthread_cond_t BlockRead;
+	pthread_cond_t BlockDecoded;
+} ReadAheadQueue;
+
+
+/** Body of the read-ahead thread **/
+void *ReadAheadThread(void *Arg) {
+	ReadAheadQueue *Queue = (ReadAheadQueue *) Arg;
+	size_t Pos = 0;
+	size_t Count = 0;
+	
+	while (1) {
+		pthread_mutex_lock(&(Queue->Lock));
+		while ((Queue->Read - Queue->Decoded) >= Queue->QueueLength) 
+			pthread_cond_wait(&(Queue->BlockDecoded), &(Queue->Lock));
+		Pos = Queue->Read;
+		pthread_mutex_unlock(&(Queue->Lock));
+		
+		if (Pos >= Queue->Length)
+			break;
+		
+		Count = ((Queue->Length - Pos) < Queue->BlockSize)?(Queue->Length - Pos):(Queue->BlockSize);
+		
+		if (fread(Queue->Dest + Pos, 1, Count, Queue->ser) != Count) {
+			pthread_mutex_lock(&(Queue->Lock));
+			Queue->Failed = 1;
+			Queue->ErrorNumber = errno;
+			pthread_cond_signal(&(Queue->BlockRead));
+			pthread_mutex_unlock(&(Queue->Lock));
+			break;
+		}
+		
+		pthread_mutex_lock(&(Queue->Lock));
+		Queue->Read += Count;
+		pthread_cond_signal(&(Queue->BlockRead));
+		pthread_mutex_unlock(&(Queue->Lock));
+	}
+	
+	return NULL;
+}
+
+
+/** Reads Length bytes from the datafile to Dest by the read-ahead thread while converting the blocks already read. 
+    Returns INVALID_PARAMETER without reading anything if the thread cannot be started. **/
+int ReadRawDataPipelined(NMRData *NMRDataStruct, FILE *ser, unsigned char *Dest, size_t Length) {
+	ReadAheadQueue Queue;
+	pthread_t Thread;
+	size_t Available = 0;
+	
+	Queue.ser = ser;
+	Queue.Dest = Dest;
+	Queue.Length = Length;
+	Queue.BlockSize = RawReadBlockSize(NMRDataStruct);
+	Queue.QueueLength = Queue.BlockSize * NMRDataStruct->ReadQueueDepth;
+	Queue.Read = 0;
+	Queue.Decoded = 0;
+	Queue.Failed = 0;
+	Queue.ErrorNumber = 0;
+	
+	if (pthread_mutex_init(&(Queue.Lock), NULL) != 0)
+		return INVALID_PARAMETER;
+	
+	if (pthread_cond_init(&(Queue.BlockRead), NULL) != 0) {
+		pthread_mutex_destroy(&(Queue.Lock));
+		return INVALID_PARAMETER;
+	}
+	
+	if (pthread_cond_init(&(Queue.BlockDecoded), NULL) != 0) {
+		pthread_cond_destroy(&(Queue.BlockRead));
+		pthread_mutex_destroy(&(Queue.Lock));
+		return INVALID_PARAMETER;
+	}
+	
+	if (pthread_create(&Thread, NULL, ReadAheadThread, &Queue) != 0) {
+		pthread_cond_destroy(&(Queue.BlockDecoded));
+		pthread_cond_destroy(&(Queue.BlockRead));
+		pthread_mutex_destroy(&(Queue.Lock));
+		return INVALID_PARAMETER;
+	}
+	
+	/** Convert the blocks as soon as they are read **/
+	while (Queue.Decoded < Length) {
+		pthread_mutex_lock(&(Queue.Lock));
+		while ((Queue.Read == Queue.Decoded) && (!Queue.Failed)) 
+			pthread_cond_wait(&(Queue.BlockRead), &(Queue.Lock));
+		Available = Queue.Read;
+		pthread_mutex_unlock(&(Queue.Lock));
+		
+		if (Available == Queue.Decoded)	/** reading failed **/
+			break;
+		
+		DecodeRawDataBytes(NMRDataStruct, Dest + Queue.Decoded, Available - Queue.Decoded);
+		
+		pthread_mutex_lock(&(Queue.Lock));
+		Queue.Decoded = Available;
+		pthread_cond_signal(&(Queue.BlockDecoded));
+		pthread_mutex_unlock(&(Queue.Lock));
+	}
+	
+	pthread_join(Thread, NULL);
+	
+	pthread_cond_destroy(&(Queue.BlockDecoded));
+	pthread_cond_destroy(&(Queue.BlockRead));
+	pthread_mutex_destroy(&(Queue.Lock));
+	
+	if (Queue.Failed) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, Queue.ErrorNumber, "Reading datafile");
+		return (FILE_IO_ERROR | DATA_INVALID);
+	}
+	
+	return DATA_OK;
+}
+#endif
+
+
+/** Extends the data space (mapping) by the data appended to the datafile since the last load, the lines read before are kept untouched. 
+    The appended lines are read by GetRawData on their first use. 
+    Returns FILE_WRONG_SIZE if the datafile is not alligned or has shrunk, the caller should load it from scratch then. **/
+int AppendRawData(NMRData *NMRDataStruct) {
+	const int DFOK = (DATA_OK | FILE_LOADED_OK);
+	int RetVal = DFOK;
+
+	FILE *ser = NULL;
+	
+	long ByteSize = 0;
+	size_t OldByteSize = 0;
+	size_t ByteLine = 0;
+	size_t OldLineCount = 0;
+	size_t LineCount = 0;
+	
+	int32_t *AuxPointer = NULL;
+	unsigned char *AuxLoaded = NULL;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((NMRDataStruct->SerName == NULL) || (NMRDataStruct->PointLine == 0) || (NMRDataStruct->DataSpace == NULL))
+		return (INVALID_PARAMETER | DATA_OLD);
+	
+	if (NMRDataStruct->DataMap != NULL)
+		return RemapRawData(NMRDataStruct);
+	
+	if (NMRDataStruct->DataLoaded == NULL)
+		return (INVALID_PARAMETER | DATA_OLD);
+	
+	OldByteSize = NMRDataStruct->DataSize*4;
+	ByteLine = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct);
+	
+	/** Open the file **/
+	ser = fopen(NMRDataStruct->SerName, "rb");
+	if (ser == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Opening datafile");
+		return (FILE_OPEN_ERROR | DATA_OLD);
+	}
+	
+	if (fseek(ser, 0, SEEK_END)) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Determining datafile size");
+		RetVal |= (FILE_IO_ERROR | DATA_OLD);
+	}
+	
+	if ((RetVal == DFOK) && ((ByteSize = ftell(ser)) == -1)) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Determining datafile size");
+		RetVal |= (FILE_IO_ERROR | DATA_OLD);
+	}
+	
+	if ((RetVal == DFOK) && (((size_t) ByteSize < OldByteSize) || ((ByteSize % 1024) != 0))) 
+		RetVal |= (FILE_WRONG_SIZE | DATA_OLD);
+	
+	if ((RetVal == DFOK) && ((size_t) ByteSize > OldByteSize)) {
+		OldLineCount = OldByteSize / ByteLine;
+		LineCount = ByteSize / ByteLine;
+		
+		/** The flags of the appended lines (and of the formerly incomplete last line) are cleared, the flags of the lines read before are preserved **/
+		AuxLoaded = NMRDataStruct->DataLoaded;
+		NMRDataStruct->DataLoaded = (unsigned char *) realloc(NMRDataStruct->DataLoaded, (LineCount + 1)*sizeof(unsigned char));
+		
+		if (NMRDataStruct->DataLoaded == NULL) {
+			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating datafile line flags");
+			NMRDataStruct->DataLoaded = AuxLoaded;	/** still valid for the original data space **/
+			AuxLoaded = NULL;
+			RetVal |= (MEM_ALLOC_ERROR | DATA_OLD);
+		} else 
+			memset(NMRDataStruct->DataLoaded + OldLineCount, 0, LineCount + 1 - OldLineCount);
+		
+		/** Memory space reallocation, the data loaded before are preserved **/
+		if (RetVal == DFOK) {
+			AuxPointer = NMRDataStruct->DataSpace;
+			NMRDataStruct->DataSpace = (int32_t *) realloc(NMRDataStruct->DataSpace, ByteSize/4*sizeof(int32_t));
+			NMRDataStruct->DataSize = ByteSize/4;
+			
+			if (NMRDataStruct->DataSpace == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating data memory space");
+				free(AuxPointer);
+				AuxPointer = NULL;
+				NMRDataStruct->DataSize = 0;
+				RetVal |= (MEM_ALLOC_ERROR | DATA_EMPTY);
 			}
 		}
 	}
@@ -991,11 +1304,7 @@ int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 	/** Close the file **/
 	if (fclose(ser) != 0) {
 		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Closing datafile");
-		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Datafile still opened, file I/O buffer not freed.", "Closing datafile");
 		RetVal |= FILE_NOT_CLOSED;
-	} else {
-		free(FileIOBufffer);
-		FileIOBufffer = NULL;
 	}
 	
 	return RetVal;
@@ -1007,17 +1316,569 @@ int FreeRawData(NMRData *NMRDataStruct) {
 	if (NMRDataStruct == NULL)
 		return NMR_DATA_STRUCT_VOID;
 	
+	if (NMRDataStruct->DataMap != NULL)
+		return UnmapRawData(NMRDataStruct);
+	
 	free(NMRDataStruct->DataSpace);
 	NMRDataStruct->DataSpace = NULL;
 	NMRDataStruct->DataSize = 0;
+	
+	free(NMRDataStruct->DataLoaded);
+	NMRDataStruct->DataLoaded = NULL;
 
 	return DATA_EMPTY;
 }
 
 
+/** Maps the datafile into memory. 
+    If the byte order of the datafile matches the host, DataSpace points straight to the (read-only) mapping. 
+    Otherwise the mapping is private and writable and the pages holding particular lines are converted in place by DecodeRawDataLine on their first use, 
+    so that just the pages in use get copied. 
+    If the mapping itself fails, DataMap is left NULL and DATA_OK is returned, so that the caller can read the file instead. **/
+int MapRawData(NMRData *NMRDataStruct) {
+	const int DFOK = (DATA_OK | FILE_LOADED_OK);
+	int RetVal = DFOK;
+	
+#ifndef __WIN32__
+	int Convert = 0;
+	
+	int ser = -1;
+	struct stat SerStat;
+	void *Map = MAP_FAILED;
+	size_t ByteSize = 0;
+	size_t PageSize = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
 
-int AllocStepSet(NMRData *NMRDataStruct, size_t StepCount) {
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((NMRDataStruct->SerName == NULL) || (NMRDataStruct->PointLine == 0)) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Invalid data parameters supplied", "Mapping datafile");
+		return (INVALID_PARAMETER | DATA_OLD);
+	}
+	
+	Convert = ((NMRDataStruct->ByteOrder != 0) != HostIsBigEndian());
+	PageSize = RawMapPageSize();
+	
+	/** Release the previous data, the file might have changed **/
+	FreeRawData(NMRDataStruct);
+	
+	/** Open the file **/
+	ser = open(NMRDataStruct->SerName, O_RDONLY);
+	if (ser == -1) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Opening datafile");
+		return (FILE_OPEN_ERROR | DATA_OLD);
+	}
+	
+	if (fstat(ser, &SerStat) != 0) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Determining datafile size");
+		RetVal |= (FILE_IO_ERROR | DATA_OLD);
+	}
+	
+	/** Is it non-empty? Is it alligned to 1024 B? **/
+	if ((RetVal == DFOK) && ((SerStat.st_size <= 0) || ((SerStat.st_size % 1024) != 0))) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Wrong datafile size", "Checking datafile size");
+		RetVal |= (FILE_WRONG_SIZE | DATA_OLD);
+	}
+	
+	if (RetVal == DFOK) {
+		ByteSize = (size_t) SerStat.st_size;
+		
+		if (Convert)
+			Map = mmap(NULL, ByteSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, ser, 0);
+		else
+			Map = mmap(NULL, ByteSize, PROT_READ, MAP_PRIVATE, ser, 0);
+	}
+	
+	if (Map != MAP_FAILED) {
+		if (Convert) {
+			/** The pages are converted on their first use, the spare entry avoids zero-size allocation **/
+			NMRDataStruct->DataMapDecoded = (unsigned char *) calloc((ByteSize + PageSize - 1) / PageSize + 1, sizeof(unsigned char));
+			if (NMRDataStruct->DataMapDecoded == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating datafile mapping flags");
+				munmap(Map, ByteSize);
+				Map = MAP_FAILED;
+				RetVal |= (MEM_ALLOC_ERROR | DATA_EMPTY);
+			}
+		}
+	}
+	
+	if (Map != MAP_FAILED) {
+		NMRDataStruct->DataMap = Map;
+		NMRDataStruct->DataMapLength = ByteSize;
+		NMRDataStruct->DataSpace = (int32_t *) Map;
+		NMRDataStruct->DataSize = ByteSize / 4;
+	}
+	
+	/** Close the file, the mapping remains valid **/
+	if (close(ser) != 0) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Closing datafile");
+		RetVal |= FILE_NOT_CLOSED;
+	}
+#endif
+	
+	return RetVal;
+}
+
+
+int UnmapRawData(NMRData *NMRDataStruct) {
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+#ifndef __WIN32__
+	if (NMRDataStruct->DataMap != NULL)
+		munmap(NMRDataStruct->DataMap, NMRDataStruct->DataMapLength);
+#endif
+	
+	NMRDataStruct->DataMap = NULL;
+	NMRDataStruct->DataMapLength = 0;
+	
+	free(NMRDataStruct->DataMapDecoded);
+	NMRDataStruct->DataMapDecoded = NULL;
+	
+	NMRDataStruct->DataSpace = NULL;
+	NMRDataStruct->DataSize = 0;
+
+	return DATA_EMPTY;
+}
+
+
+/** Extends the mapping of the datafile to the data appended since it was mapped. 
+    The read-only mapping is just resized on Linux. The converted mapping is always mapped anew, as its pages converted in place are private copies, 
+    which would hide the data appended to the formerly last page, the pages converted before are converted again then. **/
+int RemapRawData(NMRData *NMRDataStruct) {
+	const int DFOK = (DATA_OK | FILE_LOADED_OK);
+	int RetVal = DFOK;
+	
+#ifndef __WIN32__
+	int ser = -1;
+	struct stat SerStat;
+	void *Map = MAP_FAILED;
+	size_t ByteSize = 0;
+	size_t PageSize = 0;
+	size_t OldPageCount = 0;
+	size_t PageCount = 0;
+	size_t i = 0;
+	int Resized = 0;
+	unsigned char *AuxPointer = NULL;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((NMRDataStruct->SerName == NULL) || (NMRDataStruct->PointLine == 0) || (NMRDataStruct->DataMap == NULL))
+		return (INVALID_PARAMETER | DATA_OLD);
+	
+	PageSize = RawMapPageSize();
+	
+	/** Open the file **/
+	ser = open(NMRDataStruct->SerName, O_RDONLY);
+	if (ser == -1) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Opening datafile");
+		return (FILE_OPEN_ERROR | DATA_OLD);
+	}
+	
+	if (fstat(ser, &SerStat) != 0) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Determining datafile size");
+		RetVal |= (FILE_IO_ERROR | DATA_OLD);
+	}
+	
+	if ((RetVal == DFOK) && (((size_t) SerStat.st_size < NMRDataStruct->DataMapLength) || ((SerStat.st_size % 1024) != 0))) 
+		RetVal |= (FILE_WRONG_SIZE | DATA_OLD);
+	
+	if ((RetVal == DFOK) && ((size_t) SerStat.st_size > NMRDataStruct->DataMapLength)) {
+		ByteSize = (size_t) SerStat.st_size;
+		OldPageCount = (NMRDataStruct->DataMapLength + PageSize - 1) / PageSize;
+		PageCount = (ByteSize + PageSize - 1) / PageSize;
+		
+#ifdef __linux__
+		if (NMRDataStruct->DataMapDecoded == NULL) {
+			Map = mremap(NMRDataStruct->DataMap, NMRDataStruct->DataMapLength, ByteSize, MREMAP_MAYMOVE);
+			Resized = 1;
+		}
+#endif
+		
+		if (!Resized) {
+			if (NMRDataStruct->DataMapDecoded != NULL)
+				Map = mmap(NULL, ByteSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, ser, 0);
+			else
+				Map = mmap(NULL, ByteSize, PROT_READ, MAP_PRIVATE, ser, 0);
+			
+			if (Map != MAP_FAILED)
+				munmap(NMRDataStruct->DataMap, NMRDataStruct->DataMapLength);
+		}
+		
+		if (Map == MAP_FAILED) {
+			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Remapping datafile");
+			RetVal |= (FILE_IO_ERROR | DATA_OLD);	/** the original mapping is still valid **/
+		} else {
+			NMRDataStruct->DataMap = Map;
+			NMRDataStruct->DataMapLength = ByteSize;
+			NMRDataStruct->DataSpace = (int32_t *) Map;
+			NMRDataStruct->DataSize = ByteSize / 4;
+			
+			if (NMRDataStruct->DataMapDecoded != NULL) {
+				AuxPointer = NMRDataStruct->DataMapDecoded;
+				NMRDataStruct->DataMapDecoded = (unsigned char *) realloc(NMRDataStruct->DataMapDecoded, (PageCount + 1)*sizeof(unsigned char));
+				
+				if (NMRDataStruct->DataMapDecoded == NULL) {
+					NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating datafile mapping flags");
+					NMRDataStruct->DataMapDecoded = AuxPointer;
+					AuxPointer = NULL;
+					UnmapRawData(NMRDataStruct);
+					RetVal |= (MEM_ALLOC_ERROR | DATA_EMPTY);
+				} else {
+					for (i = OldPageCount; i <= PageCount; i++)
+						NMRDataStruct->DataMapDecoded[i] = 0;
+					
+					/** The new mapping holds the original file content, the pages in use are converted again **/
+					for (i = 0; i < OldPageCount; i++) {
+						if (NMRDataStruct->DataMapDecoded[i]) {
+							NMRDataStruct->DataMapDecoded[i] = 0;
+							DecodeRawDataPage(NMRDataStruct, i);
+						}
+					}
+				}
+			}
+		}
+	}
+	
+	/** Close the file, the mapping remains valid **/
+	if (close(ser) != 0) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Closing datafile");
+		RetVal |= FILE_NOT_CLOSED;
+	}
+#endif
+	
+	return RetVal;
+}
+
+
+/** Unit of the conversion of the mapped datafile in bytes - the page, so that the conversion copies no page which is not in use. A multiple of 1024. **/
+size_t RawMapPageSize(void) {
+#ifndef __WIN32__
+	long PageSize = sysconf(_SC_PAGESIZE);
+	
+	if ((PageSize >= 1024) && ((PageSize % 1024) == 0))
+		return (size_t) PageSize;
+#endif
+	
+	return 1024;
+}
+
+
+/** Converts one page (RawMapPageSize) of the mapped datafile to the host byte order unless it has been done already **/
+int DecodeRawDataPage(NMRData *NMRDataStruct, size_t PageNo) {
+	size_t PageSize = 0;
+	size_t Start = 0;
+	size_t Count = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->DataMapDecoded == NULL) || (NMRDataStruct->DataSpace == NULL))
+		return DATA_OK;
+	
+	PageSize = RawMapPageSize();
+	Start = PageNo*PageSize;
+	
+	if (Start >= NMRDataStruct->DataMapLength)
+		return INVALID_PARAMETER;
+	
+	if (NMRDataStruct->DataMapDecoded[PageNo])
+		return DATA_OK;
+	
+	/** The last page might be mapped just partially, the mapping length is a multiple of 1024 B **/
+	Count = ((NMRDataStruct->DataMapLength - Start) < PageSize)?(NMRDataStruct->DataMapLength - Start):(PageSize);
+	DecodeRawDataBytes(NMRDataStruct, ((unsigned char *) NMRDataStruct->DataSpace) + Start, Count);
+	
+	NMRDataStruct->DataMapDecoded[PageNo] = 1;
+	
+	return DATA_OK;
+}
+
+
+/** Converts the pages of the mapped datafile holding one line (PointLine complex points) to the host byte order unless it has been done already **/
+int DecodeRawDataLine(NMRData *NMRDataStruct, size_t LineNo) {
+	size_t ByteLine = 0;
+	size_t PageSize = 0;
 	size_t i = 0;
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->DataMapDecoded == NULL) || (NMRDataStruct->DataSpace == NULL) || (NMRDataStruct->PointLine == 0))
+		return DATA_OK;
+	
+	ByteLine = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct);
+	PageSize = RawMapPageSize();
+	
+	/** An incomplete line at the end of the datafile might be still growing, so it does not make a step yet **/
+	if (((LineNo + 1)*ByteLine) > NMRDataStruct->DataMapLength)
+		return INVALID_PARAMETER;
+	
+	for (i = LineNo*ByteLine/PageSize; i*PageSize < (LineNo + 1)*ByteLine; i++) 
+		if ((RetVal = DecodeRawDataPage(NMRDataStruct, i)) != DATA_OK)
+			return RetVal;
+	
+	return DATA_OK;
+}
+
+
+
+/** Makes the raw data of the requested step (or all steps) available and checks if the step is empty or not **/
+int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
+	size_t i = 0;
+	size_t j = 0;
+	int32_t OrVal = 0;
+	size_t Start = 0;
+	size_t Range = 0;
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0)) 
+		return DATA_OK;
+	
+	if (StepNo < 0) {
+		Start = 0;
+		Range = StepNoRange(NMRDataStruct);
+	} else 
+	if ((unsigned long) StepNo < StepNoRange(NMRDataStruct)) {
+		Start = StepNo;
+		Range = StepNo + 1;
+	} else 
+		return INVALID_PARAMETER;
+	
+	/** Just the chunks are kept, the complete data have to be loaded again **/
+	if ((NMRDataStruct->ChunkSpace != NULL) && ((RetVal = ExpandRawData(NMRDataStruct)) != DATA_OK))
+		return RetVal;
+	
+	/** Read the steps not read from the datafile yet **/
+	RetVal = ReadRawDataLines(NMRDataStruct, Start, Range);
+	if (RetVal == INVALID_PARAMETER)
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Step out of the datafile range", "Reading raw data");
+	
+	if (RetVal != DATA_OK)
+		return (RetVal | DATA_INVALID);
+	
+	for (i = Start; i < Range; i++) {
+		if (NMRDataStruct->Steps[i].Flags & Flag(CHECK_RawData))
+			continue;	/** This step is already done **/
+		
+		if ((RetVal = DecodeRawDataLine(NMRDataStruct, i)) != DATA_OK) {
+			NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Step out of the datafile range", "Converting raw data");
+			return (RetVal | DATA_INVALID);
+		}
+		
+		/** Check if the step is empty or not **/
+		if (TDDIsFloat64(NMRDataStruct, i)) {
+			for (j = 0, OrVal = 0; (j < NMRDataStruct->Steps[i].RawDataLength) && (!OrVal); j++) 
+				OrVal = (TDDRealFloat64(NMRDataStruct, i, j) != 0.0) || (TDDImagFloat64(NMRDataStruct, i, j) != 0.0);
+		} else {
+			for (j = 0, OrVal = 0; (j < NMRDataStruct->Steps[i].RawDataLength) && (!OrVal); j++) 
+				OrVal |= TDDRealInt32(NMRDataStruct, i, j) | TDDImagInt32(NMRDataStruct, i, j);
+		}
+		
+		if (OrVal == 0)
+			NMRDataStruct->Steps[i].StepFlag |= STEP_BLANK;
+		else
+			NMRDataStruct->Steps[i].StepFlag &= ~STEP_BLANK;
+	}
+	
+	return DATA_OK;
+}
+
+
+/** Packs the chunks of all steps together and releases the complete raw data, which are loaded again by GetRawData when needed. 
+    Requires the raw data of all steps and the chunk set, the raw data are marked unavailable afterwards without invalidating the data depending on them. 
+    Nothing is done unless requested by CompactRawData or if the chunks would not take less memory than the complete data. **/
+int CompactRawData(NMRData *NMRDataStruct) {
+	size_t i = 0;
+	size_t k = 0;
+	size_t ElementSize = 0;	/** size of the real or imaginary part of a point in bytes **/
+	size_t StepLength = 0;	/** packed chunks of a single step in 2x ElementSize (Re, Im) units **/
+	size_t Offset = 0;
+	unsigned char *Source = NULL;
+	unsigned char *Dest = NULL;
+	int32_t *AuxPointer = NULL;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if (	(!NMRDataStruct->CompactRawData) || (NMRDataStruct->ChunkSpace != NULL) || (NMRDataStruct->DataSpace == NULL) || 
+		(NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0) || (NMRDataStruct->ChunkSet == NULL) || (NMRDataStruct->ChunkCount == 0) )
+		return DATA_OK;
+	
+	ElementSize = RawPointSize(NMRDataStruct) / 2;
+	
+	for (i = 0; i < ChunkNoRange(NMRDataStruct); i++) {
+		if ((ChunkDataStart(NMRDataStruct, i) < 0) || ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) > NMRDataStruct->TimeDomain/2))
+			return DATA_OK;
+		
+		StepLength += ChunkIndexRange(NMRDataStruct, i);
+	}
+	
+	/** All steps must be already converted to the host byte order **/
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) 
+		if (!(NMRDataStruct->Steps[k].Flags & Flag(CHECK_RawData)) || (NMRDataStruct->Steps[k].RawDataType != NMRDataStruct->DTypA))
+			return DATA_OK;
+	
+	if ((StepLength == 0) || (StepLength*2*ElementSize*NMRDataStruct->StepCount >= NMRDataStruct->DataSize*sizeof(int32_t)))
+		return DATA_OK;
+	
+	AuxPointer = (int32_t *) malloc(StepLength*2*ElementSize*NMRDataStruct->StepCount);
+	if (AuxPointer == NULL)	/** the complete data are kept then **/
+		return DATA_OK;
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		Source = (NMRDataStruct->DTypA == RAW_TYPE_FLOAT64)?((unsigned char *) NMRDataStruct->Steps[k].RawDataFloat64):((unsigned char *) NMRDataStruct->Steps[k].RawData);
+		Dest = ((unsigned char *) AuxPointer) + k*StepLength*2*ElementSize;
+		
+		for (i = 0, Offset = 0; i < ChunkNoRange(NMRDataStruct); i++) {
+			memcpy(Dest + Offset*ElementSize, Source + ChunkDataStart(NMRDataStruct, i)*ElementSize, ChunkIndexRange(NMRDataStruct, i)*2*ElementSize);
+			Offset += 2*ChunkIndexRange(NMRDataStruct, i);
+		}
+	}
+	
+	FreeRawData(NMRDataStruct);
+	
+	NMRDataStruct->ChunkSpace = AuxPointer;
+	NMRDataStruct->ChunkSpaceSize = StepLength*2*ElementSize*NMRDataStruct->StepCount/sizeof(int32_t);
+	
+	for (i = 0, Offset = 0; i < ChunkNoRange(NMRDataStruct); i++) {
+		NMRDataStruct->ChunkSet[i].offset = Offset;
+		Offset += 2*ChunkIndexRange(NMRDataStruct, i);
+	}
+	
+	/** The steps keep their original length, just the data outside the chunks are not available **/
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		Dest = ((unsigned char *) AuxPointer) + k*StepLength*2*ElementSize;
+		if (NMRDataStruct->DTypA == RAW_TYPE_FLOAT64)
+			NMRDataStruct->Steps[k].RawDataFloat64 = (double *) Dest;
+		else
+			NMRDataStruct->Steps[k].RawData = (int32_t *) Dest;
+		
+		NMRDataStruct->Steps[k].Flags &= ~Flag(CHECK_RawData);
+	}
+	
+	NMRDataStruct->Flags &= ~Flag(CHECK_RawData);
+	
+	return DATA_OK;
+}
+
+
+/** Loads the complete raw data again after CompactRawData, the steps get converted and checked for being empty by GetRawData then **/
+int ExpandRawData(NMRData *NMRDataStruct) {
+	int RetVal = DATA_OK;
+	size_t LineWords = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if (NMRDataStruct->ChunkSpace == NULL)
+		return DATA_OK;
+	
+	/** The compacted data stay in use if the loading fails **/
+	if ((RetVal = LoadRawData(NMRDataStruct)) != (DATA_OK | FILE_LOADED_OK))
+		return (RetVal | DATA_OLD);
+	
+	LineWords = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct) / 4;
+	if ((NMRDataStruct->DataSpace == NULL) || (NMRDataStruct->DataSize < NMRDataStruct->StepCount*LineWords)) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "The datafile has been truncated", "Loading raw data again");
+		MarkNMRDataOld(NMRDataStruct, CHECK_StepSet, ALL_STEPS);
+		return (FILE_WRONG_SIZE | DATA_OLD);
+	}
+	
+	return AssignStepSet(NMRDataStruct);
+}
+
+
+int FreeCompactRawData(NMRData *NMRDataStruct) {
+	size_t i = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	free(NMRDataStruct->ChunkSpace);
+	NMRDataStruct->ChunkSpace = NULL;
+	NMRDataStruct->ChunkSpaceSize = 0;
+	
+	if (NMRDataStruct->ChunkSet != NULL)
+		for (i = 0; i < ChunkNoRange(NMRDataStruct); i++)
+			NMRDataStruct->ChunkSet[i].offset = ChunkDataStart(NMRDataStruct, i);
+	
+	return DATA_EMPTY;
+}
+
+
+/** Initializes the steps from First on, which were just (re)allocated **/
+int InitStepSet(NMRData *NMRDataStruct, size_t First) {
+	size_t i = 0;
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if (NMRDataStruct->Steps == NULL)
+		return DATA_EMPTY;
+	
+	for (i = First; i < NMRDataStruct->StepCount; i++) {
+		NMRDataStruct->Steps[i].Flags = NMRDataStruct->Flags & (Flag(CHECK_AcquParams) | Flag(CHECK_StepSet));
+		NMRDataStruct->Steps[i].StepFlag = STEP_OK;
+		NMRDataStruct->Steps[i].AssocValue = 0.0;
+		NMRDataStruct->Steps[i].Freq = 0.0;
+		NMRDataStruct->Steps[i].RawDataType = RAW_TYPE_INT32;
+		NMRDataStruct->Steps[i].RawData = NULL;
+		NMRDataStruct->Steps[i].RawDataFloat64 = NULL;
+		NMRDataStruct->Steps[i].RawDataLength = 0;
+		NMRDataStruct->Steps[i].ChunkAvgData = NULL;
+		NMRDataStruct->Steps[i].ChunkAvgAmp = NULL;
+		NMRDataStruct->Steps[i].ChunkAvgLength = 0;
+		NMRDataStruct->Steps[i].ChunkSums = NULL;
+		NMRDataStruct->Steps[i].ChunkSumLength = 0;
+		NMRDataStruct->Steps[i].EchoPeaksEnvelope = NULL;
+		NMRDataStruct->Steps[i].EchoPeaksEnvelopeLength = 0;
+		NMRDataStruct->Steps[i].DFTInputFirst[0] = 0.0;
+		NMRDataStruct->Steps[i].DFTInputFirst[1] = 0.0;
+		NMRDataStruct->Steps[i].DFTOutput = NULL;
+		NMRDataStruct->Steps[i].DFTOutAmp = NULL;
+		NMRDataStruct->Steps[i].DFTLength = 0;
+		NMRDataStruct->Steps[i].PhaseCorrFlag = 0;
+		NMRDataStruct->Steps[i].PhaseCorr0 = 0;
+		NMRDataStruct->Steps[i].PhaseCorr1 = 0;
+		NMRDataStruct->Steps[i].PhaseCorr1Ref = -1;
+		NMRDataStruct->Steps[i].DFTPhaseCorrOutput = NULL;
+		NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp = NULL;
+		NMRDataStruct->Steps[i].ChunkAvgAmpMax = 0.0;
+		NMRDataStruct->Steps[i].ChunkAvgAmpInt = 0.0;
+		NMRDataStruct->Steps[i].DFTAmpMax = 0.0;
+		NMRDataStruct->Steps[i].DFTAmpMaxPoint = 0;
+		NMRDataStruct->Steps[i].DFTAmpMean = 0.0;
+		NMRDataStruct->Steps[i].DFTPhaseCorrRealMax = 0.0;
+		NMRDataStruct->Steps[i].DFTPhaseCorrRealMaxPoint = 0;
+		NMRDataStruct->Steps[i].DFTPhaseCorrRealMean = 0.0;
+		NMRDataStruct->Steps[i].DFTPhaseCorrAmpMax = 0.0;
+		NMRDataStruct->Steps[i].DFTPhaseCorrAmpMaxPoint = 0;
+		NMRDataStruct->Steps[i].DFTPhaseCorrAmpMean = 0.0;
+	}
+	
+	return DATA_OK;
+}
+
+int AllocStepSet(NMRData *NMRDataStruct, size_t StepCount) {
 
 	if (NMRDataStruct == NULL)
 		return NMR_DATA_STRUCT_VOID;
@@ -1040,40 +1901,7 @@ int AllocStepSet(NMRData *NMRDataStruct, size_t StepCount) {
 			NMRDataStruct->StepCount = StepCount;
 			
 			/** Initialize the newly allocated steps **/
-			for (i = 0; i < NMRDataStruct->StepCount; i++) {
-				NMRDataStruct->Steps[i].Flags = NMRDataStruct->Flags & (Flag(CHECK_AcquParams) | Flag(CHECK_RawData));
-				NMRDataStruct->Steps[i].StepFlag = STEP_OK;
-				NMRDataStruct->Steps[i].AssocValue = 0.0;
-				NMRDataStruct->Steps[i].Freq = 0.0;
-				NMRDataStruct->Steps[i].RawData = NULL;
-				NMRDataStruct->Steps[i].RawDataLength = 0;
-				NMRDataStruct->Steps[i].ChunkAvgData = NULL;
-				NMRDataStruct->Steps[i].ChunkAvgAmp = NULL;
-				NMRDataStruct->Steps[i].ChunkAvgLength = 0;
-				NMRDataStruct->Steps[i].EchoPeaksEnvelope = NULL;
-				NMRDataStruct->Steps[i].EchoPeaksEnvelopeLength = 0;
-				NMRDataStruct->Steps[i].DFTInput = NULL;
-				NMRDataStruct->Steps[i].DFTOutput = NULL;
-				NMRDataStruct->Steps[i].DFTOutAmp = NULL;
-				NMRDataStruct->Steps[i].DFTLength = 0;
-				NMRDataStruct->Steps[i].PhaseCorrFlag = 0;
-				NMRDataStruct->Steps[i].PhaseCorr0 = 0;
-				NMRDataStruct->Steps[i].PhaseCorr1 = 0;
-				NMRDataStruct->Steps[i].PhaseCorr1Ref = -1;
-				NMRDataStruct->Steps[i].DFTPhaseCorrOutput = NULL;
-				NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp = NULL;
-				NMRDataStruct->Steps[i].ChunkAvgAmpMax = 0.0;
-				NMRDataStruct->Steps[i].ChunkAvgAmpInt = 0.0;
-				NMRDataStruct->Steps[i].DFTAmpMax = 0.0;
-				NMRDataStruct->Steps[i].DFTAmpMaxPoint = 0;
-				NMRDataStruct->Steps[i].DFTAmpMean = 0.0;
-				NMRDataStruct->Steps[i].DFTPhaseCorrRealMax = 0.0;
-				NMRDataStruct->Steps[i].DFTPhaseCorrRealMaxPoint = 0;
-				NMRDataStruct->Steps[i].DFTPhaseCorrRealMean = 0.0;
-				NMRDataStruct->Steps[i].DFTPhaseCorrAmpMax = 0.0;
-				NMRDataStruct->Steps[i].DFTPhaseCorrAmpMaxPoint = 0;
-				NMRDataStruct->Steps[i].DFTPhaseCorrAmpMean = 0.0;
-			}
+			InitStepSet(NMRDataStruct, 0);
 		}
 	}
 
@@ -1081,13 +1909,8 @@ int AllocStepSet(NMRData *NMRDataStruct, size_t StepCount) {
 }
 
 int GetStepSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
-	size_t i = 0;
-	size_t j = 0;
-	int32_t OrVal = 0;
+	size_t LineWords = 0;
 	size_t AuxStepCount = 0;
-	double AssocValue = 0.0;
-	double AssocStep = 0.0;
-	double AssocCoef = 1.0;
 	int RetVal = DATA_OK;
 	
 	size_t PointLine = 0;
@@ -1107,8 +1930,13 @@ int GetStepSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		return (DATA_OLD | INVALID_PARAMETER);
 	}
 	
+	/** Load (map) the datafile **/
+	if ((RetVal = LoadRawData(NMRDataStruct)) != (DATA_OK | FILE_LOADED_OK))
+		return RetVal;
+	
 	/** Find out the number of steps **/
-	AuxStepCount = NMRDataStruct->DataSize / 2 / PointLine;
+	LineWords = PointLine * RawPointSize(NMRDataStruct) / 4;
+	AuxStepCount = NMRDataStruct->DataSize / LineWords;
 	if ((NMRDataStruct->DataSpace == NULL) || (NMRDataStruct->DataSize == 0)) 
 		AuxStepCount = 0;
 	
@@ -1116,21 +1944,85 @@ int GetStepSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 	if ((RetVal = AllocStepSet(NMRDataStruct, AuxStepCount)) != DATA_OK)
 		return RetVal;
 	
-	/** Set the pointers to starts of individual step records and set the flags if necessary **/
-	for (i = 0; i < NMRDataStruct->StepCount; i++) {
-		NMRDataStruct->Steps[i].RawData = NMRDataStruct->DataSpace + 2*i*PointLine;
-		NMRDataStruct->Steps[i].RawDataLength = TimeDomain / 2;
+	return AssignStepSet(NMRDataStruct);
+}
+
+
+/** Extends the step set by the steps appended to the datafile by AppendRawData, the steps existing before are kept including their processed data. 
+    The DFT data space common for all steps is extended by AllocDFTResult once the new steps get transformed. **/
+int AppendStepSet(NMRData *NMRDataStruct) {
+	size_t LineWords = 0;
+	size_t AuxStepCount = 0;
+	size_t OldStepCount = 0;
+	StepStruct *AuxPointer = NULL;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((NMRDataStruct->PointLine == 0) || (NMRDataStruct->DataSpace == NULL) || (NMRDataStruct->Steps == NULL))
+		return (DATA_OLD | INVALID_PARAMETER);
+	
+	LineWords = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct) / 4;
+	AuxStepCount = NMRDataStruct->DataSize / LineWords;
+	OldStepCount = NMRDataStruct->StepCount;
+	
+	if (AuxStepCount < OldStepCount) 
+		return (DATA_OLD | INVALID_PARAMETER);
+	
+	if (AuxStepCount > OldStepCount) {
+		AuxPointer = NMRDataStruct->Steps;
+		NMRDataStruct->Steps = (StepStruct *) realloc(NMRDataStruct->Steps, AuxStepCount*sizeof(StepStruct));
+		
+		if (NMRDataStruct->Steps == NULL) {
+			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating step set memory space");
+			NMRDataStruct->Steps = AuxPointer;	/** keep the original steps, they are freed by FreeStepSet **/
+			AuxPointer = NULL;
+			return (MEM_ALLOC_ERROR | DATA_OLD);
+		}
+		
+		NMRDataStruct->StepCount = AuxStepCount;
+		InitStepSet(NMRDataStruct, OldStepCount);
 	}
 	
-	/** Check if the step is empty or not **/
+	/** The data space might have moved **/
+	return AssignStepSet(NMRDataStruct);
+}
+
+
+/** Sets the pointers to starts of individual step records and assigns the associated values to the steps **/
+int AssignStepSet(NMRData *NMRDataStruct) {
+	size_t i = 0;
+	size_t LineWords = 0;
+	double AssocValue = 0.0;
+	double AssocStep = 0.0;
+	double AssocCoef = 1.0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	/** The steps get the complete raw data **/
+	FreeCompactRawData(NMRDataStruct);
+	
+	if ((NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0))
+		return DATA_OK;
+	
+	LineWords = NMRDataStruct->PointLine * RawPointSize(NMRDataStruct) / 4;
+	
+	/** Set the pointers to starts of individual step records **/
 	for (i = 0; i < NMRDataStruct->StepCount; i++) {
-		for (j = 0, OrVal = 0; (j < NMRDataStruct->Steps[i].RawDataLength) && (!OrVal); j++) 
-			OrVal |= NMRDataStruct->Steps[i].RawData[2*j + 0] | NMRDataStruct->Steps[i].RawData[2*j + 1];
-		
-		if (OrVal == 0)
-			NMRDataStruct->Steps[i].StepFlag |= STEP_BLANK;
-		else
-			NMRDataStruct->Steps[i].StepFlag &= ~STEP_BLANK;
+		if (NMRDataStruct->DTypA == RAW_TYPE_FLOAT64) {
+			NMRDataStruct->Steps[i].RawDataType = RAW_TYPE_FLOAT64;
+			NMRDataStruct->Steps[i].RawData = NULL;
+			NMRDataStruct->Steps[i].RawDataFloat64 = (double *) (NMRDataStruct->DataSpace + i*LineWords);
+		} else {
+			NMRDataStruct->Steps[i].RawDataType = RAW_TYPE_INT32;
+			NMRDataStruct->Steps[i].RawData = NMRDataStruct->DataSpace + i*LineWords;
+			NMRDataStruct->Steps[i].RawDataFloat64 = NULL;
+		}
+		NMRDataStruct->Steps[i].RawDataLength = NMRDataStruct->TimeDomain / 2;
 	}
 	
 	
@@ -1175,6 +2067,7 @@ int FreeStepSet(NMRData *NMRDataStruct) {
 		for (i = 0; i < NMRDataStruct->StepCount; i++) {
 			free(NMRDataStruct->Steps[i].ChunkAvgData);
 			free(NMRDataStruct->Steps[i].ChunkAvgAmp);
+			free(NMRDataStruct->Steps[i].ChunkSums);
 			free(NMRDataStruct->Steps[i].EchoPeaksEnvelope);
 		}
 		
@@ -21,16 +21,39 @@
 #ifndef __nfload_h__
 #define __nfload_h__
 
+#include <stdio.h>
+
 #include "nmrfilipcmn.h"
 
 int GetAcquParams(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
 int InitAcquInfo(NMRData *NMRDataStruct);
 int GetAcquInfo(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
 int FreeAcquInfo(NMRData *NMRDataStruct);
+int LoadRawData(NMRData *NMRDataStruct);
 int GetRawData(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
+int ReadRawDataLines(NMRData *NMRDataStruct, size_t First, size_t End);
+int ReadRawDataBlocks(NMRData *NMRDataStruct, FILE *ser, size_t FirstBlock, size_t EndBlock);
+void DecodeRawDataBytes(NMRData *NMRDataStruct, unsigned char *Data, size_t Count);
+#if THREADS
+void *ReadAheadThread(void *Arg);
+int ReadRawDataPipelined(NMRData *NMRDataStruct, FILE *ser, unsigned char *Dest, size_t Length);
+#endif
+int AppendRawData(NMRData *NMRDataStruct);
 int FreeRawData(NMRData *NMRDataStruct);
+int MapRawData(NMRData *NMRDataStruct);
+int RemapRawData(NMRData *NMRDataStruct);
+int UnmapRawData(NMRData *NMRDataStruct);
+size_t RawMapPageSize(void);
+int DecodeRawDataPage(NMRData *NMRDataStruct, size_t PageNo);
+int DecodeRawDataLine(NMRData *NMRDataStruct, size_t LineNo);
+int CompactRawData(NMRData *NMRDataStruct);
+int ExpandRawData(NMRData *NMRDataStruct);
+int FreeCompactRawData(NMRData *NMRDataStruct);
+int InitStepSet(NMRData *NMRDataStruct, size_t First);
 int AllocStepSet(NMRData *NMRDataStruct, size_t StepCount);
 int GetStepSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
+int AppendStepSet(NMRData *NMRDataStruct);
+int AssignStepSet(NMRData *NMRDataStruct);
 int FreeStepSet(NMRData *NMRDataStruct);
 
 #endif
\ No newline at end of file
@@ -25,49 +25,60 @@
 #include <errno.h>
 #include <limits.h>
 #include <inttypes.h>
+#if THREADS
+#include <pthread.h>
+#endif
+#if THREADS || FFTW_THREADS
+#include <unistd.h>
+#endif
+#ifndef __WIN32__
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 #include "fftw3.h"
 
 #include "nmrfilip.h"
 
 #include "nfio.h"
+#include "nfload.h"
 #include "nfproc.h"
 #include "nfexport.h"
+#include "nfsimd.h"
 
 
-typedef struct {
-	intptr_t Offset;
-	size_t Length;	/** in 2x long (Re, Im) (8 B) **/
-	size_t DataLength;
-	size_t Count;
-	intptr_t Start;
-	size_t FalseNegative;
-	size_t FalsePositive;
-} SignalPattern;
+/** The plans and auxiliary DFT data are kept by each dataset (DFTCacheData), so that the datasets can be processed by separate threads. 
+    Just the FFTW planner and the wisdom are shared by the whole process, they are accessed under the DFT planner lock. **/
+#if FFTW_THREADS
+int DFTThreadsReady = 0;	/** 1 once fftw_init_threads succeeded, -1 if it failed **/
+#endif
+#if THREADS
+pthread_mutex_t DFTPlannerMutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/** File the FFTW wisdom is stored to on exit, NULL if not used **/
+char *DFTWisdomFile = NULL;
+
+/** 0 to search through all the chunk pairs for the chunk pattern instead of confirming the estimated period, for comparison **/
+unsigned char ChunkPeriodEstimate = 1;
+
 
 /** Single ChunkSet is common for all steps; used as array of offsets with respect to step beginning **/
 int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 	size_t MaxLength = 0;
-	unsigned char AddPattern = 0;
-	size_t i = 0, j = 0, k = 0;
-	intptr_t m = 0;
+	size_t i = 0, j = 0;
 	size_t AuxChunkCount = 0;
 	int32_t AuxLong = 0;
 	int32_t *OrPad = NULL;
+	size_t *NonZero = NULL;
 	SignalWindow *AuxPointer = NULL;
 
-	SignalPattern Pattern = {0, 0, 0, 1, 0, 0, 0};
-	size_t BufferLength = 0;
-	SignalPattern* Patterns = NULL;
-	size_t ValidPatterns = 0;
-	SignalPattern* AuxPointer2 = NULL;
-	intptr_t Start = 0;
-	intptr_t End = 0;
-
-	size_t MinLength = SIZE_MAX;
-	size_t MaxCount = 0;
-	size_t MaxCount2 = 0;
-	size_t MinFalseNegative = SIZE_MAX;
-	size_t MinFalsePositive = SIZE_MAX;
+	SignalPattern Pattern = {0, 0, 0, 1, 0, 0, 0, PATTERN_INDEX_NONE};
+	size_t Period = 0;
+	int RetVal = DATA_OK;
+	
+	unsigned char MaskChanged = 0;
 	
 	if (NMRDataStruct == NULL)
 		return NMR_DATA_STRUCT_VOID;
@@ -76,6 +87,7 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		return ERROR_REPORT_VOID;
 	
 	if ((NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0)) {
+		FreeChunkMask(NMRDataStruct);
 		free(NMRDataStruct->ChunkSet);
 		NMRDataStruct->ChunkSet = NULL;
 		NMRDataStruct->ChunkCount = 0;
@@ -88,6 +100,8 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 			MaxLength = TDDIndexRange(NMRDataStruct, i);
 
 	if (MaxLength == 0) {
+		FreeChunkMask(NMRDataStruct);
+		FreeChunkSums(NMRDataStruct, ALL_STEPS);
 		free(NMRDataStruct->ChunkSet);
 		NMRDataStruct->ChunkSet = NULL;
 		NMRDataStruct->ChunkCount = 0;
@@ -101,21 +115,46 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating auxiliary memory space during the creation of chunk set");
 		return (MEM_ALLOC_ERROR | DATA_OLD);
 	}
-		
-	/** zero-ing OrPad **/
-	for (i = 0; i < MaxLength; i++) 
-		OrPad[i] = 0;
 	
-	/** OR-ing all steps into OrPad **/
-	for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
-		if (!(StepFlag(NMRDataStruct, i) & STEP_IGNORE))
-			/* for (j = 0; j < TDDIndexRange(NMRDataStruct, i); j++) { */
-			for (j = NMRDataStruct->SkipPoints; j < TDDIndexRange(NMRDataStruct, i); j++) {	/** skip the digital filter artifacts **/
-				OrPad[j] |= TDDReal(NMRDataStruct, i, j);
-				OrPad[j] |= TDDImag(NMRDataStruct, i, j);
-			}
+	/** Just the steps appended since the chunk set was found are OR-ed into the mask kept, the chunk set stays as it is unless they add a non-zero point **/
+	if ((NMRDataStruct->ChunkMask != NULL) && (NMRDataStruct->ChunkMaskLength == MaxLength) && (NMRDataStruct->ChunkMaskSteps <= StepNoRange(NMRDataStruct))) {
+		OrStepsIntoMask(NMRDataStruct, NMRDataStruct->ChunkMaskSteps, OrPad, MaxLength);
+		
+		for (j = 0; j < MaxLength; j++) {
+			if ((NMRDataStruct->ChunkMask[j] == 0) && (OrPad[j] != 0))
+				MaskChanged = 1;
+			NMRDataStruct->ChunkMask[j] |= OrPad[j];
+		}
+		
+		NMRDataStruct->ChunkMaskSteps = StepNoRange(NMRDataStruct);
+		
+		if ((!MaskChanged) && (NMRDataStruct->ChunkSet != NULL)) {
+			free(OrPad);
+			OrPad = NULL;
+			
+			CompactRawData(NMRDataStruct);
+			
+			return DATA_OK;
+		}
+		
+		memcpy(OrPad, NMRDataStruct->ChunkMask, MaxLength*sizeof(int32_t));
+	} else {
+		/** OR-ing all steps into OrPad **/
+		OrStepsIntoMask(NMRDataStruct, 0, OrPad, MaxLength);
+		
+		/** Kept for the steps appended later **/
+		FreeChunkMask(NMRDataStruct);
+		NMRDataStruct->ChunkMask = (int32_t *) malloc(MaxLength*sizeof(int32_t));
+		if (NMRDataStruct->ChunkMask != NULL) {
+			memcpy(NMRDataStruct->ChunkMask, OrPad, MaxLength*sizeof(int32_t));
+			NMRDataStruct->ChunkMaskLength = MaxLength;
+			NMRDataStruct->ChunkMaskSteps = StepNoRange(NMRDataStruct);
+		}
 	}
 	
+	/** The chunk set is found anew **/
+	FreeChunkSums(NMRDataStruct, ALL_STEPS);
+	
 	/** Counting non-zero chunks in OrPad **/
 	for (j = 0; j < MaxLength; j++) {
 		/** "rising edge" detection **/
@@ -148,6 +187,7 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		/** "rising edge" detection **/
 		if ((AuxLong == 0) && (OrPad[j] !=0)) {
 			ChunkDataStart(NMRDataStruct, i) = 2*((intptr_t) j);
+			NMRDataStruct->ChunkSet[i].offset = ChunkDataStart(NMRDataStruct, i);
 			ChunkIndexRange(NMRDataStruct, i) = 1;
 			i++;
 		} else
@@ -158,18 +198,314 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		AuxLong = OrPad[j];
 	}
 	
+	/** A regular echo train needs no search, the chunks found are exactly the ones the search would end up with **/
+	if (ChunkSetIsPeriodic(NMRDataStruct)) {
+		free(OrPad);
+		OrPad = NULL;
+		
+		CompactRawData(NMRDataStruct);
+		
+		return DATA_OK;
+	}
+	
+	/** Number of non-zero points preceding each point for scoring the patterns **/
+	NonZero = (size_t *) malloc((MaxLength + 1)*sizeof(size_t));
+	if (NonZero == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating auxiliary memory space during the creation of chunk set");
+		free(OrPad);
+		OrPad = NULL;
+		return (MEM_ALLOC_ERROR | DATA_OLD);
+	}
+	
+	for (j = 0, NonZero[0] = 0; j < MaxLength; j++)
+		NonZero[j + 1] = NonZero[j] + (OrPad[j] != 0);
+	
+	free(OrPad);
+	OrPad = NULL;
+	
+
+	/** The period estimated from the run lengths needs just to be confirmed by the patterns of the chunks up to CHUNK_PERIOD_CONFIRM_DISTANCE apart, 
+	    all the chunk pairs are searched through if they point elsewhere **/
+	Period = (ChunkPeriodEstimate)?(EstimateChunkPeriod(NMRDataStruct)):(0);
+	
+	RetVal = SearchSignalPattern(NMRDataStruct, NonZero, MaxLength, (Period > 0)?(CHUNK_PERIOD_CONFIRM_DISTANCE):(SIZE_MAX), &Pattern);
+	if ((Period > 0) && ((RetVal != DATA_OK) || (Pattern.Length != Period)))
+		RetVal = SearchSignalPattern(NMRDataStruct, NonZero, MaxLength, SIZE_MAX, &Pattern);
+	
+	free(NonZero);
+	NonZero = NULL;
+	
+	if (RetVal == DATA_OK) {
+		AuxChunkCount = Pattern.Count;
+		
+		if ((AuxChunkCount != (NMRDataStruct->ChunkCount)) || ((NMRDataStruct->ChunkSet) == NULL)) {
+			AuxPointer = NMRDataStruct->ChunkSet;
+			NMRDataStruct->ChunkSet = (SignalWindow *) realloc(NMRDataStruct->ChunkSet, AuxChunkCount*sizeof(SignalWindow));
+			
+			if (NMRDataStruct->ChunkSet == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk set memory space");
+				free(AuxPointer);
+				AuxPointer = NULL;
+				NMRDataStruct->ChunkCount = 0;
+				return (MEM_ALLOC_ERROR | DATA_EMPTY);
+			}
+			
+			NMRDataStruct->ChunkCount = AuxChunkCount;
+		}
+		
+		/** Recreate chunk set **/
+		for (i = 0, j = Pattern.Start; i < Pattern.Count; i++, j += Pattern.Length) {
+			ChunkDataStart(NMRDataStruct, i) = 2*((intptr_t) j);
+			NMRDataStruct->ChunkSet[i].offset = ChunkDataStart(NMRDataStruct, i);
+			ChunkIndexRange(NMRDataStruct, i) = Pattern.DataLength;
+		}
+		
+	} else
+	if (RetVal == DATA_EMPTY) {
+		NMRDataStruct->ChunkCount = 0;
+		free(NMRDataStruct->ChunkSet);
+		NMRDataStruct->ChunkSet = NULL;
+	} else
+		return RetVal;
+	
+	/** Just the chunks are needed from now on **/
+	CompactRawData(NMRDataStruct);
+
+	return DATA_OK;
+}
+
+int FreeChunkSet(NMRData *NMRDataStruct) {
+
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	FreeChunkSums(NMRDataStruct, ALL_STEPS);
+	FreeChunkMask(NMRDataStruct);
+	
+	free(NMRDataStruct->ChunkSet);
+	NMRDataStruct->ChunkSet = NULL;
+	NMRDataStruct->ChunkCount = 0;
+
+	return DATA_EMPTY;
+}
+
+int FreeChunkMask(NMRData *NMRDataStruct) {
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	free(NMRDataStruct->ChunkMask);
+	NMRDataStruct->ChunkMask = NULL;
+	NMRDataStruct->ChunkMaskLength = 0;
+	NMRDataStruct->ChunkMaskSteps = 0;
+	
+	return DATA_EMPTY;
+}
+
+/** ORs the steps FirstStep to EndStep - 1 (except the ignored ones) into Mask, the digital filter artifacts are skipped **/
+void OrStepRangeIntoMask(NMRData *NMRDataStruct, size_t FirstStep, size_t EndStep, int32_t *Mask) {
+	size_t i = 0;
+	size_t Skip = NMRDataStruct->SkipPoints;
+	
+	for (i = FirstStep; i < EndStep; i++) {
+		if ((StepFlag(NMRDataStruct, i) & STEP_IGNORE) || (TDDIndexRange(NMRDataStruct, i) <= Skip))
+			continue;
+		
+		if (TDDIsFloat64(NMRDataStruct, i)) 
+			OrMaskFloat64(Mask + Skip, NMRDataStruct->Steps[i].RawDataFloat64 + 2*Skip, TDDIndexRange(NMRDataStruct, i) - Skip);
+		else
+			OrMaskInt32(Mask + Skip, NMRDataStruct->Steps[i].RawData + 2*Skip, TDDIndexRange(NMRDataStruct, i) - Skip);
+	}
+}
+
+/** Returns the number of threads to process the steps with **/
+unsigned int GetProcThreadCount(NMRData *NMRDataStruct) {
+#if (THREADS || FFTW_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+	long Processors = 0;
+#endif
+	
+	if (NMRDataStruct->ProcThreads > 0)
+		return NMRDataStruct->ProcThreads;
+	
+#if (THREADS || FFTW_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+	Processors = sysconf(_SC_NPROCESSORS_ONLN);
+	if (Processors > 1)
+		return (unsigned int) Processors;
+#endif
+	
+	return 1;
+}
+
+#if THREADS
+/** Block of steps reduced by a single thread into its own mask **/
+typedef struct {
+	NMRData *NMRDataStruct;
+	size_t FirstStep;
+	size_t EndStep;
+	int32_t *Mask;
+	pthread_t Thread;
+	int Started;
+} OrMaskTask;
+
+void *OrMaskThread(void *Arg) {
+	OrMaskTask *Task = (OrMaskTask *) Arg;
+	
+	OrStepRangeIntoMask(Task->NMRDataStruct, Task->FirstStep, Task->EndStep, Task->Mask);
+	
+	return NULL;
+}
+#endif
+
+/** ORs the steps from FirstStep on into Mask of MaxLength points. Large step sets are split into blocks reduced by separate threads into private masks, which are merged at the end. **/
+void OrStepsIntoMask(NMRData *NMRDataStruct, size_t FirstStep, int32_t *Mask, size_t MaxLength) {
+	size_t StepCount = 0;
+#if THREADS
+	size_t i = 0;
+	size_t j = 0;
+	size_t ThreadCount = 0;
+	OrMaskTask *Tasks = NULL;
+#endif
+	
+	memset(Mask, 0, MaxLength*sizeof(int32_t));
+	
+	if (FirstStep >= StepNoRange(NMRDataStruct))
+		return;
+	
+	StepCount = StepNoRange(NMRDataStruct) - FirstStep;
+	
+#if THREADS
+	ThreadCount = GetProcThreadCount(NMRDataStruct);
+	if (ThreadCount > StepCount)
+		ThreadCount = StepCount;
+	if (ThreadCount > (StepCount*MaxLength)/PARALLEL_MIN_POINTS)	/** not worth it for small data **/
+		ThreadCount = (StepCount*MaxLength)/PARALLEL_MIN_POINTS;
+	
+	if (ThreadCount > 1)
+		Tasks = (OrMaskTask *) calloc(ThreadCount, sizeof(OrMaskTask));
+	
+	if (Tasks != NULL) {
+		for (i = 0; i < ThreadCount; i++) {
+			Tasks[i].NMRDataStruct = NMRDataStruct;
+			Tasks[i].FirstStep = FirstStep + i*StepCount/ThreadCount;
+			Tasks[i].EndStep = FirstStep + (i + 1)*StepCount/ThreadCount;
+			Tasks[i].Mask = (i == 0)?(Mask):((int32_t *) calloc(MaxLength, sizeof(int32_t)));
+			Tasks[i].Started = (i > 0) && (Tasks[i].Mask != NULL) && (pthread_create(&(Tasks[i].Thread), NULL, OrMaskThread, &(Tasks[i])) == 0);
+		}
+		
+		/** The first block and the blocks whose thread could not be started are reduced by this thread **/
+		for (i = 0; i < ThreadCount; i++) 
+			if (!Tasks[i].Started)
+				OrStepRangeIntoMask(NMRDataStruct, Tasks[i].FirstStep, Tasks[i].EndStep, Mask);
+		
+		for (i = 1; i < ThreadCount; i++) {
+			if (Tasks[i].Started) {
+				pthread_join(Tasks[i].Thread, NULL);
+				for (j = 0; j < MaxLength; j++) 
+					Mask[j] |= Tasks[i].Mask[j];
+			}
+			free(Tasks[i].Mask);
+		}
+		
+		free(Tasks);
+		return;
+	}
+#endif
+	
+	OrStepRangeIntoMask(NMRDataStruct, FirstStep, StepNoRange(NMRDataStruct), Mask);
+}
+
+int CompareSize(const void *Val1, const void *Val2) {
+	if ((*((const size_t *) Val1)) < (*((const size_t *) Val2)))
+		return -1;
+	
+	if ((*((const size_t *) Val1)) > (*((const size_t *) Val2)))
+		return 1;
+	
+	return 0;
+}
+
+/** Estimates the period of the chunks from the run lengths of the OR-ed steps: the median distance of the starts of adjacent chunks (a chunk and the gap after it) 
+    tells the number of periods between them, the period is the distance of the first and the last chunk divided by the number of periods in between. 
+    Returns 0 if there are less than 3 chunks. **/
+size_t EstimateChunkPeriod(NMRData *NMRDataStruct) {
+	size_t *Distances = NULL;
+	size_t Count = 0;
+	size_t Median = 0;
+	size_t Periods = 0;
+	size_t Span = 0;
+	size_t i = 0;
+	
+	if ((NMRDataStruct->ChunkSet == NULL) || (NMRDataStruct->ChunkCount < 3))
+		return 0;
+	
+	Count = NMRDataStruct->ChunkCount - 1;
+	Distances = (size_t *) malloc(Count*sizeof(size_t));
+	if (Distances == NULL)
+		return 0;	/** all the chunk pairs get searched through instead **/
+	
+	for (i = 0; i < Count; i++)
+		Distances[i] = (size_t) (ChunkDataStart(NMRDataStruct, i + 1)/2 - ChunkDataStart(NMRDataStruct, i)/2);
+	
+	qsort(Distances, Count, sizeof(size_t), CompareSize);
+	Median = Distances[Count/2];
+	
+	free(Distances);
+	Distances = NULL;
+	
+	/** Missing echoes count as well **/
+	for (i = 0; i < Count; i++)
+		Periods += ((size_t) (ChunkDataStart(NMRDataStruct, i + 1)/2 - ChunkDataStart(NMRDataStruct, i)/2) + Median/2)/Median;
+	
+	if (Periods == 0)
+		return 0;
+	
+	Span = (size_t) (ChunkDataStart(NMRDataStruct, Count)/2 - ChunkDataStart(NMRDataStruct, 0)/2);
+	
+	return (Span + Periods/2)/Periods;
+}
+
+/** Finds the pattern of the chunks the most of the chunk pairs up to MaxDistance chunks apart agree on, the one with the least false negative and then false positive points of them. 
+    Returns DATA_EMPTY if there is none. **/
+int SearchSignalPattern(NMRData *NMRDataStruct, const size_t *NonZero, size_t MaxLength, size_t MaxDistance, SignalPattern *Result) {
+	unsigned char Reindex = 0;
+	size_t i = 0, j = 0, k = 0;
+	size_t Distances = 0;
+	size_t Pairs = 0;
+	
+	SignalPattern Pattern = {0, 0, 0, 1, 0, 0, 0, PATTERN_INDEX_NONE};
+	size_t BufferLength = 0;
+	size_t *Buckets = NULL;
+	size_t BucketCount = 0;
+	SignalPattern* Patterns = NULL;
+	size_t ValidPatterns = 0;
+	SignalPattern* AuxPointer2 = NULL;
+	intptr_t Start = 0;
 
+	size_t MinLength = SIZE_MAX;
+	size_t MaxCount = 0;
+	size_t MaxCount2 = 0;
+	size_t MinFalseNegative = SIZE_MAX;
+	size_t MinFalsePositive = SIZE_MAX;
+	
+	if ((NMRDataStruct->ChunkSet == NULL) || (NMRDataStruct->ChunkCount == 0))
+		return DATA_EMPTY;
+	
+	Distances = (MaxDistance < NMRDataStruct->ChunkCount - 1)?(MaxDistance):(NMRDataStruct->ChunkCount - 1);
+	
 	/** Construct a set of concievable patterns **/
 	MinLength = SIZE_MAX;
 	MaxCount = 2;
-	for (i = 0; i < NMRDataStruct->ChunkCount; i++) {	/** extra extent **/
-
+	for (i = 0; i <= Distances; i++) {	/** extra extent **/
+		Pairs = (i < Distances)?(NMRDataStruct->ChunkCount - i - 1):(0);
+		
 		/** Any pattern found from now on will be longer than the shortest pattern from the last cycle **/
 		/** Try to avoid the need to allocate more memory: check the patterns of Length <= the shortest pattern from the last cycle and keep only the ones with the highest Count **/
-		if (i == (NMRDataStruct->ChunkCount - 1))		/** no more patterns are going to be found in the last iteration, so keep only the patterns with the highest Count for further processing **/
+		if (i == Distances)		/** no more patterns are going to be found in the last iteration, so keep only the patterns with the highest Count for further processing **/
 			MinLength = SIZE_MAX;
 		
-		if (((BufferLength - ValidPatterns) < (2*(NMRDataStruct->ChunkCount - i - 1))) || (i == (NMRDataStruct->ChunkCount - 1))) {
+		Reindex = 0;
+		
+		if (((BufferLength - ValidPatterns) < (2*Pairs)) || (i == Distances)) {
 			for (MaxCount2 = 0, k = 0; k < ValidPatterns; k++) 
 				if ((Patterns[k].Length <= MinLength) && (Patterns[k].Count > MaxCount2))
 					MaxCount2 = Patterns[k].Count;
@@ -178,10 +514,11 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 				if ((Patterns[k].Length > MinLength) || (Patterns[k].Count == MaxCount2)) 	/** keep the pattern **/
 					Patterns[j++] = Patterns[k];
 			ValidPatterns = j;
+			Reindex = 1;
 		}
 		
 		/** (re)allocate a buffer if necessary **/
-		if (((BufferLength - ValidPatterns) < (2*(NMRDataStruct->ChunkCount - i - 1))) || (Patterns == NULL)) {
+		if (((BufferLength - ValidPatterns) < (2*Pairs)) || (Patterns == NULL)) {
 			if (Patterns == NULL)
 				BufferLength = 4 * NMRDataStruct->ChunkCount;	/** rough initial guess **/
 			else
@@ -194,8 +531,22 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk pattern array memory space");
 				free(AuxPointer2);
 				AuxPointer2 = NULL;
-				free(OrPad);
-				OrPad = NULL;
+				free(Buckets);
+				Buckets = NULL;
+				return (MEM_ALLOC_ERROR | DATA_INVALID);
+			}
+			
+			/** At most 1 pattern per bucket on average **/
+			for (BucketCount = 16; BucketCount < BufferLength; BucketCount *= 2)
+				;
+			
+			free(Buckets);
+			Buckets = (size_t *) malloc(BucketCount*sizeof(size_t));
+			
+			if (Buckets == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk pattern index memory space");
+				free(Patterns);
+				Patterns = NULL;
 				return (MEM_ALLOC_ERROR | DATA_INVALID);
 			}
 			
@@ -210,11 +561,16 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 				Patterns[ValidPatterns].FalsePositive = 0;
 				ValidPatterns++;
 			}
+			
+			Reindex = 1;
 		}
 		
+		if (Reindex)
+			IndexSignalPatterns(Patterns, ValidPatterns, Buckets, BucketCount);
+		
 		MinLength = SIZE_MAX;
 		
-		for (j = 0; j < (NMRDataStruct->ChunkCount - i - 1); j++) {	/** chunk **/
+		for (j = 0; j < Pairs; j++) {	/** chunk **/
 			/** starts **/
 			Start = ChunkDataStart(NMRDataStruct, j)/2;
 			Pattern.Length = ChunkDataStart(NMRDataStruct, j + i + 1)/2 - ChunkDataStart(NMRDataStruct, j)/2;
@@ -225,28 +581,10 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 			if (Pattern.Length < MinLength)
 				MinLength = Pattern.Length;
 			
-			for (k = 0, AddPattern = 1; (k < ValidPatterns) && AddPattern; k++) {	/** backward search for a better efficiency **/
-				
-				if ((Patterns[ValidPatterns - 1 - k].Offset == Pattern.Offset) && 
-					(Patterns[ValidPatterns - 1 - k].Length == Pattern.Length) && 
-					(Patterns[ValidPatterns - 1 - k].DataLength == Pattern.DataLength)) {
-						
-					/** Count the repeated pattern occurrence instead of producing duplicities **/
-					AddPattern = 0;
-					Patterns[ValidPatterns - 1 - k].Count++;
-					/** keep track of maximal Count so far **/
-					if (Patterns[ValidPatterns - 1 - k].Count > MaxCount)
-						MaxCount = Patterns[ValidPatterns - 1 - k].Count;
-				}
-			}
-			
-			if (AddPattern) {
-				Patterns[ValidPatterns] = Pattern;
-				ValidPatterns++;
-			}
+			AddSignalPattern(Patterns, &ValidPatterns, Buckets, BucketCount, &Pattern, &MaxCount);
 		}
 		
-		for (j = 0; j < (NMRDataStruct->ChunkCount - i - 1); j++) {	/** chunk **/
+		for (j = 0; j < Pairs; j++) {	/** chunk **/
 			/** ends **/
 			Pattern.Length = (ChunkDataStart(NMRDataStruct, j + i + 1)/2 + ChunkIndexRange(NMRDataStruct, j + i + 1)) - (ChunkDataStart(NMRDataStruct, j)/2 + ChunkIndexRange(NMRDataStruct, j));
 			Pattern.DataLength = ChunkDataStart(NMRDataStruct, j + i + 1)/2 + ChunkIndexRange(NMRDataStruct, j + i + 1) - ChunkDataStart(NMRDataStruct, j + 1)/2;
@@ -257,25 +595,7 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 			if (Pattern.Length < MinLength)
 				MinLength = Pattern.Length;
 
-			for (k = 0, AddPattern = 1; (k < ValidPatterns) && AddPattern; k++) {	/** backward search for a better efficiency **/
-				
-				if ((Patterns[ValidPatterns - 1 - k].Offset == Pattern.Offset) && 
-					(Patterns[ValidPatterns - 1 - k].Length == Pattern.Length) && 
-					(Patterns[ValidPatterns - 1 - k].DataLength == Pattern.DataLength)) {
-						
-					/** Count the repeated pattern occurrence instead of producing duplicities **/
-					AddPattern = 0;
-					Patterns[ValidPatterns - 1 - k].Count++;
-					/** keep track of maximal Count so far **/
-					if (Patterns[ValidPatterns - 1 - k].Count > MaxCount)
-						MaxCount = Patterns[ValidPatterns - 1 - k].Count;
-				}
-			}
-			
-			if (AddPattern) {
-				Patterns[ValidPatterns] = Pattern;
-				ValidPatterns++;
-			}
+			AddSignalPattern(Patterns, &ValidPatterns, Buckets, BucketCount, &Pattern, &MaxCount);
 		}
 		
 		/** Any pattern found in further cycles will be longer than the shortest pattern from this cycle **/
@@ -284,11 +604,14 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 				(ChunkDataStart(NMRDataStruct, NMRDataStruct->ChunkCount - 1)/2 - ChunkDataStart(NMRDataStruct, 0)/2)/MinLength + 
 				((ChunkDataStart(NMRDataStruct, NMRDataStruct->ChunkCount - 1)/2 + ChunkIndexRange(NMRDataStruct, NMRDataStruct->ChunkCount - 1)) - (ChunkDataStart(NMRDataStruct, 0)/2 + ChunkIndexRange(NMRDataStruct, 0)))/MinLength
 			)
-		) && (i < (NMRDataStruct->ChunkCount - 1)))
-			i = NMRDataStruct->ChunkCount - 2;	/** Jump to the last iteration **/
+		) && (i < Distances))
+			i = Distances - 1;	/** Jump to the last iteration **/
 
 	}
 	
+	free(Buckets);
+	Buckets = NULL;
+	
 	/** Classify the most common patterns **/
 	for (k = 0; k < ValidPatterns; k++) {
 		
@@ -303,35 +626,9 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 		if (Patterns[k].Count > (MaxLength - Patterns[k].Start + Patterns[k].Length - Patterns[k].DataLength)/Patterns[k].Length)
 			Patterns[k].Count = (MaxLength - Patterns[k].Start + Patterns[k].Length - Patterns[k].DataLength)/Patterns[k].Length;
 		
-		if ((Patterns[k].Count > 0) && (Patterns[k].DataLength > 0))	/** probably unnecessary check **/
-			End = Patterns[k].Start + (Patterns[k].Count - 1) * Patterns[k].Length + Patterns[k].DataLength - 1;
-		else 
-			End = Patterns[k].Start;
-		
-		for (m = 0; ((size_t) m) < MaxLength; m++) {
-			
-			if ((m < Patterns[k].Start) && (OrPad[m] != 0)) {
-				Patterns[k].FalseNegative++;
-			}
-			
-			if ((m >= Patterns[k].Start) && (m <= End)) {
-				if ((((m - Patterns[k].Offset) % Patterns[k].Length) < Patterns[k].DataLength) && (OrPad[m] == 0))
-					Patterns[k].FalsePositive++;
-				
-				if ((((m - Patterns[k].Offset) % Patterns[k].Length) >= Patterns[k].DataLength) && (OrPad[m] != 0))
-					Patterns[k].FalseNegative++;
-			}
-			
-			if ((m > End) && (OrPad[m] != 0)) {
-				Patterns[k].FalseNegative++;
-			}
-		}
-		
+		ScoreSignalPattern(&(Patterns[k]), NonZero, MaxLength);
 	}
 	
-	free(OrPad);
-	OrPad = NULL;
-	
 	/** Check the false negative match ratios and keep only the patterns with the lowest one **/
 	for (k = 0; k < ValidPatterns; k++) 
 		if (Patterns[k].FalseNegative < MinFalseNegative)
@@ -352,64 +649,144 @@ int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
 			Patterns[j++] = Patterns[k];
 	ValidPatterns = j;
 	
-	if (ValidPatterns > 0) {
-		/** If there are two or more of them, pick the first one, probably with shorter Length and DataLength. **/
-		AuxChunkCount = Patterns[0].Count;
-		
-		if ((AuxChunkCount != (NMRDataStruct->ChunkCount)) || ((NMRDataStruct->ChunkSet) == NULL)) {
-			AuxPointer = NMRDataStruct->ChunkSet;
-			NMRDataStruct->ChunkSet = (SignalWindow *) realloc(NMRDataStruct->ChunkSet, AuxChunkCount*sizeof(SignalWindow));
-			
-			if (NMRDataStruct->ChunkSet == NULL) {
-				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk set memory space");
-				free(AuxPointer);
-				AuxPointer = NULL;
-				NMRDataStruct->ChunkCount = 0;
-				free(Patterns);
-				Patterns = NULL;
-				return (MEM_ALLOC_ERROR | DATA_EMPTY);
-			}
-			
-			NMRDataStruct->ChunkCount = AuxChunkCount;
-		}
-		
-		/** Recreate chunk set **/
-		for (i = 0, j = Patterns[0].Start; i < Patterns[0].Count; i++, j += Patterns[0].Length) {
-			ChunkDataStart(NMRDataStruct, i) = 2*((intptr_t) j);
-			ChunkIndexRange(NMRDataStruct, i) = Patterns[0].DataLength;
-		}
-		
-	} else {
-		NMRDataStruct->ChunkCount = 0;
-		free(NMRDataStruct->ChunkSet);
-		NMRDataStruct->ChunkSet = NULL;
+	if (ValidPatterns == 0) {
+		free(Patterns);
+		Patterns = NULL;
+		return DATA_EMPTY;
 	}
 	
+	/** If there are two or more of them, pick the first one, probably with shorter Length and DataLength. **/
+	*Result = Patterns[0];
+	
 	free(Patterns);
 	Patterns = NULL;
-
+	
 	return DATA_OK;
 }
 
-int FreeChunkSet(NMRData *NMRDataStruct) {
-
-	if (NMRDataStruct == NULL)
-		return NMR_DATA_STRUCT_VOID;
+/** Checks if the chunks have the same length and follow each other with the same period (based on the run lengths of the OR-ed steps). 
+    If so, the pattern search in GetChunkSet would keep them as they are: the pattern of the period and the chunk length has no false negative nor false positive points, 
+    so it is the one selected, and any other one without them consists of the same chunks. **/
+int ChunkSetIsPeriodic(NMRData *NMRDataStruct) {
+	size_t i = 0;
+	intptr_t Period = 0;
 	
-	free(NMRDataStruct->ChunkSet);
-	NMRDataStruct->ChunkSet = NULL;
-	NMRDataStruct->ChunkCount = 0;
-
-	return DATA_EMPTY;
+	if ((NMRDataStruct == NULL) || (NMRDataStruct->ChunkSet == NULL) || (NMRDataStruct->ChunkCount < 2))
+		return 0;
+	
+	Period = ChunkDataStart(NMRDataStruct, 1) - ChunkDataStart(NMRDataStruct, 0);
+	
+	for (i = 1; i < ChunkNoRange(NMRDataStruct); i++) 
+		if (((ChunkDataStart(NMRDataStruct, i) - ChunkDataStart(NMRDataStruct, i - 1)) != Period) || (ChunkIndexRange(NMRDataStruct, i) != ChunkIndexRange(NMRDataStruct, 0)))
+			return 0;
+	
+	return 1;
 }
 
+size_t HashSignalPattern(const SignalPattern *Pattern) {
+	uint64_t Hash = (uint64_t) Pattern->Offset;
+	
+	Hash = Hash*0x9E3779B97F4A7C15ull + (uint64_t) Pattern->Length;
+	Hash = Hash*0x9E3779B97F4A7C15ull + (uint64_t) Pattern->DataLength;
+	
+	return (size_t) (Hash ^ (Hash >> 29));
+}
 
-
-int GetEchoPeaksEnvelope(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
-	double Amp = 0.0;
-	unsigned long UpperEstimate = 0;
+/** Rebuilds the index of the patterns, BucketCount must be a power of 2 **/
+void IndexSignalPatterns(SignalPattern *Patterns, size_t PatternCount, size_t *Buckets, size_t BucketCount) {
+	size_t i = 0;
+	size_t Bucket = 0;
+	
+	for (i = 0; i < BucketCount; i++)
+		Buckets[i] = PATTERN_INDEX_NONE;
+	
+	for (i = 0; i < PatternCount; i++) {
+		Bucket = HashSignalPattern(&(Patterns[i])) & (BucketCount - 1);
+		Patterns[i].Next = Buckets[Bucket];
+		Buckets[Bucket] = i;
+	}
+}
+
+/** Counts another occurrence of the pattern, or appends it to the indexed patterns if it was not found yet. There must be space for one more pattern. **/
+void AddSignalPattern(SignalPattern *Patterns, size_t *PatternCount, size_t *Buckets, size_t BucketCount, const SignalPattern *Pattern, size_t *MaxCount) {
+	size_t i = 0;
+	size_t Bucket = 0;
+	
+	Bucket = HashSignalPattern(Pattern) & (BucketCount - 1);
+	
+	for (i = Buckets[Bucket]; i != PATTERN_INDEX_NONE; i = Patterns[i].Next) {
+		if ((Patterns[i].Offset == Pattern->Offset) && (Patterns[i].Length == Pattern->Length) && (Patterns[i].DataLength == Pattern->DataLength)) {
+			/** Count the repeated pattern occurrence instead of producing duplicities **/
+			Patterns[i].Count++;
+			/** keep track of maximal Count so far **/
+			if (Patterns[i].Count > *MaxCount)
+				*MaxCount = Patterns[i].Count;
+			return;
+		}
+	}
+	
+	Patterns[*PatternCount] = *Pattern;
+	Patterns[*PatternCount].Next = Buckets[Bucket];
+	Buckets[Bucket] = *PatternCount;
+	(*PatternCount)++;
+}
+
+/** Counts the false negative and false positive points of the pattern (with Start and Count already set) period by period. 
+    NonZero[m] is the number of non-zero points of the OR-ed steps preceding the point m, for m up to MaxLength. **/
+void ScoreSignalPattern(SignalPattern *Pattern, const size_t *NonZero, size_t MaxLength) {
+	intptr_t End = 0;
+	size_t Limit = 0;	/** end of the pattern, exclusive **/
+	size_t Pos = 0;
+	size_t DataEnd = 0;
+	size_t GapEnd = 0;
+	
+	if ((Pattern->Count > 0) && (Pattern->DataLength > 0))	/** probably unnecessary check **/
+		End = Pattern->Start + (Pattern->Count - 1) * Pattern->Length + Pattern->DataLength - 1;
+	else 
+		End = Pattern->Start;
+	
+	Pattern->FalseNegative = 0;
+	Pattern->FalsePositive = 0;
+	
+	Pos = ((size_t) Pattern->Start < MaxLength)?((size_t) Pattern->Start):(MaxLength);
+	Limit = ((size_t) End < MaxLength)?((size_t) End + 1):(MaxLength);
+	if (Limit < Pos)
+		Limit = Pos;
+	
+	/** Everything outside the pattern **/
+	Pattern->FalseNegative += NonZero[Pos] + (NonZero[MaxLength] - NonZero[Limit]);
+	
+	/** Gaps (and data) of the particular periods **/
+	for (; Pos < Limit; Pos += Pattern->Length) {
+		DataEnd = ((Pos + Pattern->DataLength) < Limit)?(Pos + Pattern->DataLength):(Limit);
+		GapEnd = ((Pos + Pattern->Length) < Limit)?(Pos + Pattern->Length):(Limit);
+		
+		Pattern->FalsePositive += (DataEnd - Pos) - (NonZero[DataEnd] - NonZero[Pos]);
+		Pattern->FalseNegative += NonZero[GapEnd] - NonZero[DataEnd];
+	}
+}
+
+
+
+/** The chunk set restored from the processed data cache is valid without the raw data, so the step is read just when its chunks are used **/
+int GetChunkRawData(NMRData *NMRDataStruct, size_t StepNo) {
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->ChunkSpace != NULL) || (NMRDataStruct->Steps[StepNo].Flags & Flag(CHECK_RawData)))
+		return DATA_OK;
+	
+	if ((RetVal = GetRawData(NMRDataStruct, StepNo, Flag(CHECK_RawData))) != DATA_OK)
+		return RetVal;
+	
+	return MarkNMRDataValid(NMRDataStruct, CHECK_RawData, StepNo);
+}
+
+int GetEchoPeaksEnvelope(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
+	double Amp = 0.0;
 	size_t i = 0;
-	size_t j = 0;
 	size_t k = 0;
 	size_t Index = 0;
 	size_t IndexMin = 0;
@@ -470,6 +847,9 @@ int GetEchoPeaksEnvelope(NMRData *NMRDataStruct, long StepNo, unsigned long Comp
 			EchoPeaksEnvelopeIndexRange(NMRDataStruct, k) = ChunkNoRange(NMRDataStruct);
 		}
 		
+		if ((RetVal = GetChunkRawData(NMRDataStruct, k)) != DATA_OK)
+			return RetVal;
+		
 		for (i = 0; i < EchoPeaksEnvelopeIndexRange(NMRDataStruct, k); i++) {
 			EchoPeaksEnvelopeTime(NMRDataStruct, k, i) = 0.0;
 			EchoPeaksEnvelopeAmp(NMRDataStruct, k, i) = 0.0;
@@ -479,170 +859,1213 @@ int GetEchoPeaksEnvelope(NMRData *NMRDataStruct, long StepNo, unsigned long Comp
 			IndexMax = (NMRDataStruct->ChunkEnd < ChunkIndexRange(NMRDataStruct, i))?(NMRDataStruct->ChunkEnd + 1):(ChunkIndexRange(NMRDataStruct, i));
 			IndexRange = (IndexMax > IndexMin)?(IndexMax - IndexMin):(0);
 			
-			/** maximum of echo amplitude is supposed to be near the centre of chunk - start at the centre and proceed alternately towards both ends -> cca 2-times faster execution for complete spectrum measurement **/
-			for (j = 0, Index = IndexMin + IndexRange/2; j < IndexRange; j++) {
-				if (j%2)
-					Index -= j;
+			/** maximum of echo amplitude is supposed to be near the centre of chunk - the first point of the largest amplitude in the order from the centre alternately towards both ends is taken **/
+			if (IndexRange > 0) {
+				if (TDDIsFloat64(NMRDataStruct, k)) 
+					Amp = FindEchoPeakFloat64(&ChunkRealFloat64(NMRDataStruct, k, i, IndexMin), IndexRange, &Index);
 				else 
-					Index += j;
+					Amp = FindEchoPeakInt32(&ChunkRealInt32(NMRDataStruct, k, i, IndexMin), IndexRange, &Index);
 				
-				/** computes estimate first for faster execution **/
-				UpperEstimate = (unsigned long) labs(ChunkReal(NMRDataStruct, k, i, Index)) + (unsigned long) labs(ChunkImag(NMRDataStruct, k, i, Index));
+				if (Amp > 0.0) {
+					EchoPeaksEnvelopeTime(NMRDataStruct, k, i) = ChunkTime(NMRDataStruct, k, i, IndexMin + Index);	/** time [us] **/
+					EchoPeaksEnvelopeAmp(NMRDataStruct, k, i) = Amp;
+				}
+			}
+		}
+		
+	}
+	
+	return DATA_OK;
+}
+
+/** Finds the echo peak among Count points (Re, Im) - the first point of the largest amplitude in the order Centre, Centre - 1, Centre + 1, Centre - 2, ... (Centre = Count/2); 
+    the norms select the candidates, hypot is evaluated just for the points whose amplitude may be the largest one; returns the amplitude, 0.0 if no peak is found **/
+double FindEchoPeakInt32(const int32_t *Data, size_t Count, size_t *Peak) {
+	uint64_t MaxNorm = 0;
+	uint64_t Threshold = 0;
+	double Amp = 0.0;
+	double PeakAmp = 0.0;
+	size_t PeakOrder = 0;
+	size_t Order = 0;
+	size_t i = 0;
+	
+	MaxNorm = MaxNormInt32(Data, Count);
+	if (MaxNorm == 0)
+		return 0.0;
+	
+	/** the norms are exact, the amplitudes of the points below the threshold are smaller for sure **/
+	Threshold = MaxNorm - (MaxNorm >> ECHO_PEAK_NORM_SHIFT);
+	
+	for (i = FindNormInt32(Data, Count, Threshold); i < Count; i += 1 + FindNormInt32(Data + 2*(i + 1), Count - (i + 1), Threshold)) {
+		Amp = hypot(Data[2*i], Data[2*i + 1]);
+		Order = (i >= Count/2)?(2*(i - Count/2)):(2*(Count/2 - i) - 1);
+		
+		if ((Amp > PeakAmp) || ((Amp == PeakAmp) && (Order < PeakOrder))) {
+			PeakAmp = Amp;
+			PeakOrder = Order;
+			*Peak = i;
+		}
+	}
+	
+	return PeakAmp;
+}
+
+double FindEchoPeakFloat64(const double *Data, size_t Count, size_t *Peak) {
+	double MaxNorm = 0.0;
+	double Threshold = 0.0;
+	double Amp = 0.0;
+	double PeakAmp = 0.0;
+	size_t PeakOrder = 0;
+	size_t Order = 0;
+	size_t i = 0;
+	
+	MaxNorm = MaxNormFloat64(Data, Count);
+	
+	/** all the points except NaN are candidates if the norms may overflow or underflow **/
+	if ((MaxNorm >= AMPLITUDE_NORM_MIN) && (MaxNorm <= AMPLITUDE_NORM_MAX))
+		Threshold = MaxNorm*(1.0 - ldexp(1.0, -ECHO_PEAK_NORM_SHIFT));
+	
+	for (i = FindNormFloat64(Data, Count, Threshold); i < Count; i += 1 + FindNormFloat64(Data + 2*(i + 1), Count - (i + 1), Threshold)) {
+		Amp = hypot(Data[2*i], Data[2*i + 1]);
+		Order = (i >= Count/2)?(2*(i - Count/2)):(2*(Count/2 - i) - 1);
+		
+		if ((Amp > PeakAmp) || ((Amp == PeakAmp) && (Order < PeakOrder))) {
+			PeakAmp = Amp;
+			PeakOrder = Order;
+			*Peak = i;
+		}
+	}
+	
+	return PeakAmp;
+}
+
+
+
+int GetChunkAvg(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
+	size_t MaxChunkLength = 0;
+	size_t Counter = 0;
+	size_t i = 0;
+	size_t j = 0;
+	size_t k = 0;
+	double *AuxPointerDouble = NULL;
+	const int64_t *SumFirst = NULL;
+	const int64_t *SumEnd = NULL;
+	long Val = 0;
+	size_t Start = 0;
+	size_t Range = 0;
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+
+	if (StepNo < 0) {
+		Start = 0;
+		Range = StepNoRange(NMRDataStruct);
+	} else 
+	if ((unsigned long) StepNo < StepNoRange(NMRDataStruct)) {
+		Start = StepNo;
+		Range = StepNo + 1;
+	} else 
+		return INVALID_PARAMETER;
+	
+	if ((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_FirstChunk, PARAM_LONG, &Val, NULL)) != DATA_OK) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Processing parameter 'FirstChunk' check failed", "Chunk average calculation");
+		return RetVal;
+	}
+	
+	if ((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &Val, NULL)) != DATA_OK) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Processing parameter 'LastChunk' check failed", "Chunk average calculation");
+		return RetVal;
+	}
+
+	/** Determines MaxChunkLength (actually, all chunks should have the same length anyway) **/
+	for (i = NMRDataStruct->FirstChunk; (i <= NMRDataStruct->LastChunk) && (i < ChunkNoRange(NMRDataStruct)); i++) 
+		if (ChunkIndexRange(NMRDataStruct, i) > MaxChunkLength)
+			MaxChunkLength = ChunkIndexRange(NMRDataStruct, i);
+	
+	if (MaxChunkLength == 0) {
+		/** Deleting old data **/
+		for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
+			free(ChunkAvgDataStart(NMRDataStruct, i));
+			ChunkAvgDataStart(NMRDataStruct, i) = NULL;
+			free(ChunkAvgDataAmpStart(NMRDataStruct, i));
+			ChunkAvgDataAmpStart(NMRDataStruct, i) = NULL;
+			ChunkAvgIndexRange(NMRDataStruct, i) = 0;
+		}
+
+		return DATA_OK;
+	}
+
+	for (k = Start; k < Range; k++) {
+		if (NMRDataStruct->Steps[k].Flags & Flag(CHECK_ChunkAvg))
+			continue;	/** This step is already done **/
+		
+		if ((MaxChunkLength != ChunkAvgIndexRange(NMRDataStruct, k)) || (ChunkAvgDataStart(NMRDataStruct, k) == NULL) || (ChunkAvgDataAmpStart(NMRDataStruct, k) == NULL)) {
+			AuxPointerDouble = ChunkAvgDataStart(NMRDataStruct, k);
+			ChunkAvgDataStart(NMRDataStruct, k) = (double *) realloc(ChunkAvgDataStart(NMRDataStruct, k), 2*MaxChunkLength*sizeof(double));
+	
+			if (ChunkAvgDataStart(NMRDataStruct, k) == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk average data memory space");
+				free(AuxPointerDouble);
+				AuxPointerDouble = NULL;
+				ChunkAvgIndexRange(NMRDataStruct, k) = 0;
+				return (MEM_ALLOC_ERROR | DATA_INVALID);
+			}
+	
+			AuxPointerDouble = ChunkAvgDataAmpStart(NMRDataStruct, k);
+			ChunkAvgDataAmpStart(NMRDataStruct, k) = (double *) realloc(ChunkAvgDataAmpStart(NMRDataStruct, k), MaxChunkLength*sizeof(double));
+
+			if (ChunkAvgDataAmpStart(NMRDataStruct, k) == NULL) {
+				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk average data memory space");
+				free(AuxPointerDouble);
+				AuxPointerDouble = NULL;
+				ChunkAvgIndexRange(NMRDataStruct, k) = 0;
+				return (MEM_ALLOC_ERROR | DATA_INVALID);
+			}
+			
+			ChunkAvgIndexRange(NMRDataStruct, k) = MaxChunkLength;
+		}
+			
+		for (j = 0; j < MaxChunkLength; j++) {
+			ChunkAvgReal(NMRDataStruct, k, j) = 0.0;
+			ChunkAvgImag(NMRDataStruct, k, j) = 0.0;
+		}
+
+		if ((!(StepFlag(NMRDataStruct, k) & STEP_BLANK)) && ((RetVal = GetChunkRawData(NMRDataStruct, k)) != DATA_OK))
+			return RetVal;
+		
+		if ((!(StepFlag(NMRDataStruct, k) & STEP_BLANK)) && (!TDDIsFloat64(NMRDataStruct, k)) && NMRDataStruct->CumulativeChunkSums) {
+			if ((RetVal = GetChunkSums(NMRDataStruct, k)) != DATA_OK)
+				return RetVal;
+			
+			Counter = 0;
+			for (i = NMRDataStruct->FirstChunk; (i <= NMRDataStruct->LastChunk) && (i < ChunkNoRange(NMRDataStruct)); i++) 
+				if ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) <= TDDIndexRange(NMRDataStruct, k))
+					Counter++;
+			
+			/** The difference of two rows is the exact sum of the chunks FirstChunk .. i-1 **/
+			SumFirst = ChunkSumRow(NMRDataStruct, k, NMRDataStruct->FirstChunk);
+			SumEnd = ChunkSumRow(NMRDataStruct, k, i);
+			for (j = 0; j < MaxChunkLength; j++) {
+				ChunkAvgReal(NMRDataStruct, k, j) = (double) (SumEnd[2*j + 0] - SumFirst[2*j + 0]);
+				ChunkAvgImag(NMRDataStruct, k, j) = (double) (SumEnd[2*j + 1] - SumFirst[2*j + 1]);
+			}
+		} else 
+		if (!(StepFlag(NMRDataStruct, k) & STEP_BLANK)) {
+			/** The sums are not kept once CumulativeChunkSums gets disabled **/
+			if (NMRDataStruct->Steps[k].ChunkSums != NULL)
+				FreeChunkSums(NMRDataStruct, k);
+			
+			Counter = 0;
+			for (i = NMRDataStruct->FirstChunk; (i <= NMRDataStruct->LastChunk) && (i < ChunkNoRange(NMRDataStruct)); i++) {
+				if ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) <= TDDIndexRange(NMRDataStruct, k)) {	/** It shouldn't be really necessary to test this **/
+					Counter++;
 				
-				if (UpperEstimate > (unsigned long) EchoPeaksEnvelopeAmp(NMRDataStruct, k, i)) {
-					/** may take some time **/
-					Amp = hypot(ChunkReal(NMRDataStruct, k, i, Index), ChunkImag(NMRDataStruct, k, i, Index));
-					
-					if (Amp > EchoPeaksEnvelopeAmp(NMRDataStruct, k, i)) {
-						EchoPeaksEnvelopeTime(NMRDataStruct, k, i) = ChunkTime(NMRDataStruct, k, i, Index);	/** time [us] **/
-						EchoPeaksEnvelopeAmp(NMRDataStruct, k, i) = Amp;
-					}
+					if (TDDIsFloat64(NMRDataStruct, k)) {
+						for (j = 0; j < ChunkIndexRange(NMRDataStruct, i); j++) {
+							ChunkAvgReal(NMRDataStruct, k, j) += ChunkRealFloat64(NMRDataStruct, k, i, j);
+							ChunkAvgImag(NMRDataStruct, k, j) += ChunkImagFloat64(NMRDataStruct, k, i, j);
+						}
+					} else 
+						AccumulateInt32(ChunkAvgDataStart(NMRDataStruct, k), &ChunkRealInt32(NMRDataStruct, k, i, 0), 2*ChunkIndexRange(NMRDataStruct, i));
 				}
 			}
 		}
+
+		if (!(StepFlag(NMRDataStruct, k) & STEP_BLANK)) {
+			if (Counter > 0)
+				for (j = 0; j < ChunkAvgIndexRange(NMRDataStruct, k); j++) {
+					ChunkAvgReal(NMRDataStruct, k, j) /= (double) Counter;
+					ChunkAvgImag(NMRDataStruct, k, j) /= (double) Counter;
+				}
+			
+			AmplitudeFloat64(ChunkAvgDataAmpStart(NMRDataStruct, k), ChunkAvgDataStart(NMRDataStruct, k), ChunkAvgIndexRange(NMRDataStruct, k));
+			
+		} else {
+			for (j = 0; j < MaxChunkLength; j++) 
+				ChunkAvgAmp(NMRDataStruct, k, j) = 0.0;
+		}
+		
+	}
+	
+	return DATA_OK;
+}
+
+int GetChunkSums(NMRData *NMRDataStruct, size_t StepNo) {
+	size_t MaxChunkLength = 0;
+	size_t i = 0;
+	size_t j = 0;
+	int64_t *Row = NULL;
+	int64_t *NextRow = NULL;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((NMRDataStruct->Steps == NULL) || (StepNo >= StepNoRange(NMRDataStruct)) || TDDIsFloat64(NMRDataStruct, StepNo))
+		return INVALID_PARAMETER;
+	
+	if ((NMRDataStruct->Steps[StepNo].ChunkSums != NULL) && (NMRDataStruct->Steps[StepNo].ChunkSumLength > 0))
+		return DATA_OK;	/** The sums are still valid **/
+	
+	for (i = 0; i < ChunkNoRange(NMRDataStruct); i++) 
+		if (ChunkIndexRange(NMRDataStruct, i) > MaxChunkLength)
+			MaxChunkLength = ChunkIndexRange(NMRDataStruct, i);
+	
+	free(NMRDataStruct->Steps[StepNo].ChunkSums);
+	NMRDataStruct->Steps[StepNo].ChunkSums = NULL;
+	NMRDataStruct->Steps[StepNo].ChunkSumLength = 0;
+	
+	if (MaxChunkLength == 0)
+		return INVALID_PARAMETER;
+	
+	if ((ChunkNoRange(NMRDataStruct) + 1) > SIZE_MAX/(2*MaxChunkLength*sizeof(int64_t))) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Chunk sums would exceed the address space", "Chunk average calculation");
+		return (MEM_ALLOC_ERROR | DATA_INVALID);
+	}
+	
+	NMRDataStruct->Steps[StepNo].ChunkSums = (int64_t *) malloc((ChunkNoRange(NMRDataStruct) + 1)*2*MaxChunkLength*sizeof(int64_t));
+	if (NMRDataStruct->Steps[StepNo].ChunkSums == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk sum memory space");
+		return (MEM_ALLOC_ERROR | DATA_INVALID);
+	}
+	
+	NMRDataStruct->Steps[StepNo].ChunkSumLength = MaxChunkLength;
+	
+	Row = ChunkSumRow(NMRDataStruct, StepNo, 0);
+	for (j = 0; j < 2*MaxChunkLength; j++) 
+		Row[j] = 0;
+	
+	/** Chunks not fitting into the step contribute nothing, just like in the direct summation **/
+	for (i = 0; i < ChunkNoRange(NMRDataStruct); i++) {
+		Row = ChunkSumRow(NMRDataStruct, StepNo, i);
+		NextRow = ChunkSumRow(NMRDataStruct, StepNo, i + 1);
+		
+		memcpy(NextRow, Row, 2*MaxChunkLength*sizeof(int64_t));
+		
+		if ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) <= TDDIndexRange(NMRDataStruct, StepNo)) 
+			AccumulateInt32Int64(NextRow, &ChunkRealInt32(NMRDataStruct, StepNo, i, 0), 2*ChunkIndexRange(NMRDataStruct, i));
+	}
+	
+	return DATA_OK;
+}
+
+void FreeChunkSums(NMRData *NMRDataStruct, long StepNo) {
+	size_t i = 0;
+	
+	if ((NMRDataStruct == NULL) || (NMRDataStruct->Steps == NULL))
+		return;
+	
+	for (i = 0; i < NMRDataStruct->StepCount; i++) {
+		if ((StepNo >= 0) && ((size_t) StepNo < NMRDataStruct->StepCount) && (i != (size_t) StepNo))
+			continue;
+		
+		free(NMRDataStruct->Steps[i].ChunkSums);
+		NMRDataStruct->Steps[i].ChunkSums = NULL;
+		NMRDataStruct->Steps[i].ChunkSumLength = 0;
+	}
+}
+
+
+
+/** Returns the FFTW planner flags corresponding to the DFTPlanner rigor **/
+unsigned int GetDFTPlannerFlags(NMRData *NMRDataStruct) {
+	
+	switch (NMRDataStruct->DFTPlanner) {
+		case DFT_PLANNER_MEASURE:
+			return FFTW_MEASURE;
+		case DFT_PLANNER_PATIENT:
+			return FFTW_PATIENT;
+		default:
+			return FFTW_ESTIMATE;
+	}
+}
+
+/** Returns the cached plan of Count forward transforms of Length points stored one after another, a new plan is created (and the least recently used one destroyed) if no suitable one is cached; 
+    Interleaved output places the point q of the transform r at r + Count*q instead of r*Length + q; 
+    the plan is in-place if Input == Output (the interleaved output requires distinct arrays); 
+    the planning may overwrite both Input and Output, the plan is to be executed by fftw_execute_dft (fftwf_execute_dft with SINGLE_PRECISION) **/
+DFT_FFTW(plan) GetDFTPlan(NMRData *NMRDataStruct, int Length, int Count, unsigned char Interleaved, NMRReal *Input, NMRReal *Output) {
+	DFTCacheData *Cache = NULL;
+	DFTPlanCacheEntry *Plans = NULL;
+	size_t i = 0;
+	size_t Oldest = 0;
+	unsigned int Flags = 0;
+	int InputAlignment = 0;
+	int OutputAlignment = 0;
+	int Threads = 1;
+	unsigned char InPlace = 0;
+	
+	if ((Cache = GetDFTCache(NMRDataStruct)) == NULL)
+		return NULL;
+	
+	Plans = Cache->Plans;
+	Flags = GetDFTPlannerFlags(NMRDataStruct) | FFTW_DESTROY_INPUT;
+	InPlace = (Input == Output);
+	InputAlignment = DFT_FFTW(alignment_of)(Input);
+	OutputAlignment = DFT_FFTW(alignment_of)(Output);
+	Threads = GetDFTThreadCount(NMRDataStruct, Length, Count);
+	
+	for (i = 0; i < DFT_PLAN_CACHE_SIZE; i++) {
+		if ((Plans[i].Plan != NULL) && (Plans[i].Length == Length) && (Plans[i].Count == Count) && (Plans[i].Interleaved == Interleaved) && (Plans[i].InPlace == InPlace) && 
+			(Plans[i].InputAlignment == InputAlignment) && (Plans[i].OutputAlignment == OutputAlignment) && 
+			(Plans[i].Flags == Flags) && (Plans[i].Threads == Threads)) {
+			Plans[i].LastUse = ++(Cache->PlanClock);
+			return Plans[i].Plan;
+		}
+		
+		if ((Plans[Oldest].Plan != NULL) && ((Plans[i].Plan == NULL) || (Plans[i].LastUse < Plans[Oldest].LastUse)))
+			Oldest = i;
+	}
+	
+	LockDFTPlanner();
+	
+	if (Plans[Oldest].Plan != NULL) {
+		DFT_FFTW(destroy_plan)(Plans[Oldest].Plan);
+		Plans[Oldest].Plan = NULL;
+	}
+	
+#if FFTW_THREADS
+	if (DFTThreadsReady > 0)
+		DFT_FFTW(plan_with_nthreads)(Threads);
+#endif
+	
+	Plans[Oldest].Plan = DFT_FFTW(plan_many_dft)(1, &Length, Count, 
+								(DFT_FFTW(complex) *) Input, NULL, 1, Length, 
+								(DFT_FFTW(complex) *) Output, NULL, (Interleaved)?(Count):(1), (Interleaved)?(1):(Length), 
+								FFTW_FORWARD, Flags);
+	
+	UnlockDFTPlanner();
+	
+	if (Plans[Oldest].Plan == NULL)
+		return NULL;
+	
+	Plans[Oldest].Length = Length;
+	Plans[Oldest].Count = Count;
+	Plans[Oldest].Interleaved = Interleaved;
+	Plans[Oldest].InPlace = InPlace;
+	Plans[Oldest].InputAlignment = InputAlignment;
+	Plans[Oldest].OutputAlignment = OutputAlignment;
+	Plans[Oldest].Flags = Flags;
+	Plans[Oldest].Threads = Threads;
+	Plans[Oldest].LastUse = ++(Cache->PlanClock);
+	
+	return Plans[Oldest].Plan;
+}
+
+/** Returns the number of threads to execute the DFT plan of Count transforms of Length points with, always 1 without FFTW_THREADS **/
+int GetDFTThreadCount(NMRData *NMRDataStruct, int Length, int Count) {
+#if FFTW_THREADS
+	size_t Threads = 0;
+	size_t MaxThreads = 0;
+	
+	LockDFTPlanner();
+	if (DFTThreadsReady == 0)
+		DFTThreadsReady = (DFT_FFTW(init_threads)())?(1):(-1);
+	UnlockDFTPlanner();
+	
+	if (DFTThreadsReady < 0)
+		return 1;
+	
+	Threads = GetProcThreadCount(NMRDataStruct);
+	MaxThreads = (((size_t) Length)*((size_t) Count))/DFT_PARALLEL_MIN_POINTS;	/** small transforms do not pay off the thread synchronization **/
+	
+	if (Threads > MaxThreads)
+		Threads = MaxThreads;
+	
+	if (Threads > INT_MAX)
+		Threads = INT_MAX;
+	
+	return (Threads > 1)?((int) Threads):(1);
+#else
+	return 1;
+#endif
+}
+
+/** The FFTW planner (creating and destroying the plans, the wisdom) is shared by the whole process and it is not thread-safe, 
+    so it is used by a single thread at a time. The plan execution needs no locking. **/
+void LockDFTPlanner(void) {
+#if THREADS
+	pthread_mutex_lock(&DFTPlannerMutex);
+#endif
+}
+
+void UnlockDFTPlanner(void) {
+#if THREADS
+	pthread_mutex_unlock(&DFTPlannerMutex);
+#endif
+}
+
+/** Returns the DFT plans and auxiliary data of the dataset, allocated on the first use; NULL on failure (reported) **/
+DFTCacheData *GetDFTCache(NMRData *NMRDataStruct) {
+	DFTCacheData *Cache = NULL;
+	
+	if (NMRDataStruct->DFTCache != NULL)
+		return (DFTCacheData *) NMRDataStruct->DFTCache;
+	
+	/** No plans, all the arrays empty **/
+	Cache = (DFTCacheData *) calloc(1, sizeof(DFTCacheData));
+	if (Cache == NULL) {
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating DFT plan cache");
+		return NULL;
+	}
+	
+	NMRDataStruct->DFTCache = Cache;
+	
+	return Cache;
+}
+
+void FreeDFTCache(NMRData *NMRDataStruct) {
+	DFTCacheData *Cache = NULL;
+	size_t i = 0;
+	
+	if ((NMRDataStruct == NULL) || (NMRDataStruct->DFTCache == NULL))
+		return;
+	
+	Cache = (DFTCacheData *) NMRDataStruct->DFTCache;
+	
+	LockDFTPlanner();
+	for (i = 0; i < DFT_PLAN_CACHE_SIZE; i++) {
+		if (Cache->Plans[i].Plan != NULL) 
+			DFT_FFTW(destroy_plan)(Cache->Plans[i].Plan);
+		Cache->Plans[i].Plan = NULL;
+	}
+	UnlockDFTPlanner();
+	
+	free(Cache->Twiddles);
+	DFT_FFTW(free)(Cache->Scratch);
+	free(Cache->Window.Coefs);
+	free(Cache->DownconvertFilter);
+	
+	free(Cache);
+	NMRDataStruct->DFTCache = NULL;
+}
+
+/** Returns 1 if the DFT data (output and amplitude) of all steps exceed the DFTMemoryBudget and are to be kept in the scratch file, 
+    always 0 where the memory mapping is not available **/
+unsigned char GetDFTSpill(NMRData *NMRDataStruct) {
+#ifndef __WIN32__
+	if (NMRDataStruct->DFTMemoryBudget == 0)
+		return 0;
+	
+	return ((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*3*sizeof(NMRReal) > (NMRDataStruct->DFTMemoryBudget)*DFT_MEMORY_BUDGET_UNIT);
+#else
+	return 0;
+#endif
+}
+
+/** Returns the number of steps transformed together by the batched plan - as many as fit the DFTMemoryBudget, at least one **/
+size_t GetDFTBatchSteps(NMRData *NMRDataStruct) {
+	size_t Steps = 0;
+	
+	if ((NMRDataStruct->DFTMemoryBudget == 0) || (NMRDataStruct->DFTLength == 0))
+		return StepNoRange(NMRDataStruct);
+	
+	Steps = ((NMRDataStruct->DFTMemoryBudget)*DFT_MEMORY_BUDGET_UNIT) / ((NMRDataStruct->DFTLength)*3*sizeof(NMRReal));
+	
+	if (Steps > StepNoRange(NMRDataStruct))
+		Steps = StepNoRange(NMRDataStruct);
+	
+	return (Steps > 0)?(Steps):(1);
+}
+
+/** Allocates Size bytes of DFT data space (aligned for FFTW if Aligned), or maps them from a new unlinked scratch file if Spilled; 
+    the mapping is preceded by a page holding the length of the whole mapping; NULL is returned (with errno set) on failure. 
+    The scratch file space is reserved in advance, a sparse file would get the process killed by SIGBUS once the file system fills up. **/
+void *AllocDFTSpace(size_t Size, unsigned char Aligned, unsigned char Spilled) {
+#ifndef __WIN32__
+	const char *Dir = NULL;
+	char *Name = NULL;
+	int scratch = -1;
+	int AuxErrno = 0;
+	size_t Page = 0;
+	void *Map = MAP_FAILED;
+	
+	if (Spilled) {
+		Page = (size_t) sysconf(_SC_PAGESIZE);
+		
+		Dir = getenv("TMPDIR");
+		if ((Dir == NULL) || (*Dir == '\0'))
+			Dir = DFT_SCRATCH_DIR;
+		
+		Name = (char *) malloc(strlen(Dir) + strlen(DFT_SCRATCH_NAME) + 2);
+		if (Name == NULL)
+			return NULL;
+		
+		sprintf(Name, "%s/%s", Dir, DFT_SCRATCH_NAME);
+		scratch = mkstemp(Name);
+		if (scratch == -1) {
+			free(Name);
+			return NULL;
+		}
+		
+		/** The file disappears once the mapping is released **/
+		unlink(Name);
+		free(Name);
+		
+		AuxErrno = posix_fallocate(scratch, 0, (off_t) (Size + Page));
+		if (AuxErrno == 0) {
+			Map = mmap(NULL, Size + Page, PROT_READ | PROT_WRITE, MAP_SHARED, scratch, 0);
+			AuxErrno = errno;
+		}
+		
+		close(scratch);
+		
+		if (Map == MAP_FAILED) {
+			errno = AuxErrno;
+			return NULL;
+		}
+		
+		*((size_t *) Map) = Size + Page;
+		return ((unsigned char *) Map) + Page;
+	}
+#endif
+	
+	if (Aligned)
+		return DFT_FFTW(malloc)(Size);
+	
+	return malloc(Size);
+}
+
+/** Releases the space obtained from AllocDFTSpace with the same Aligned and Spilled **/
+void FreeDFTSpace(void *Space, unsigned char Aligned, unsigned char Spilled) {
+#ifndef __WIN32__
+	unsigned char *Map = NULL;
+	
+	if (Spilled) {
+		if (Space != NULL) {
+			Map = ((unsigned char *) Space) - sysconf(_SC_PAGESIZE);
+			munmap(Map, *((size_t *) Map));
+		}
+		return;
+	}
+#endif
+	
+	if (Aligned)
+		DFT_FFTW(free)(Space);
+	else
+		free(Space);
+}
+
+/** Drops the pages of the given part of a scratch file mapping from memory, the data are written to the file and read back on the next access **/
+void ReleaseDFTSpace(void *Start, size_t Size) {
+#ifndef __WIN32__
+	uintptr_t First = 0;
+	uintptr_t Page = 0;
+	
+	Page = (uintptr_t) sysconf(_SC_PAGESIZE);
+	First = ((uintptr_t) Start) & ~(Page - 1);
+	
+	/** Discarding the neighbouring data at the page boundaries is harmless, they are kept in the file as well **/
+	madvise((void *) First, ((uintptr_t) Start) + Size - First, MADV_DONTNEED);
+#endif
+}
+
+/** Makes sure that the DFT data space common for all steps corresponds to the current DFTLength and StepCount. 
+    If just steps have been appended, the DFT data of the former steps are kept, otherwise the DFT results of all steps are marked old. **/
+int AllocDFTResult(NMRData *NMRDataStruct) {
+	NMRReal *aux_out = NULL;
+	NMRReal *aux_amp = NULL;
+	size_t i = 0;
+	size_t OldStepCount = 0;
+	unsigned char Spilled = 0;
+	int AuxErrno = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->Steps == NULL) || (NMRDataStruct->StepCount == 0))
+		return DATA_OK;
+	
+	Spilled = GetDFTSpill(NMRDataStruct) && !(NMRDataStruct->DFTSpillFailed);
+	
+	if ((NMRDataStruct->DFTLength == DFTIndexRange(NMRDataStruct, 0)) && (NMRDataStruct->DFTLength == DFTIndexRange(NMRDataStruct, StepNoRange(NMRDataStruct) - 1)) && 
+		(NMRDataStruct->DFTSpilled == Spilled))
+		return DATA_OK;
+	
+	if ((NMRDataStruct->Steps->DFTOutput != NULL) && (NMRDataStruct->DFTLength == DFTIndexRange(NMRDataStruct, 0))) {
+		for (OldStepCount = 0; (OldStepCount < StepNoRange(NMRDataStruct)) && (DFTIndexRange(NMRDataStruct, OldStepCount) == NMRDataStruct->DFTLength); OldStepCount++)
+			;
+	}
+
+	aux_out = (NMRReal *) AllocDFTSpace((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*2*sizeof(NMRReal), 1, Spilled);
+	aux_amp = (NMRReal *) AllocDFTSpace((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*sizeof(NMRReal), 0, Spilled);
+	
+	/** The scratch file cannot be created (e.g. the file system is full), the DFT data are kept in memory then **/
+	if (Spilled && ((aux_out == NULL) || (aux_amp == NULL))) {
+		AuxErrno = errno;
+		FreeDFTSpace(aux_out, 1, Spilled);
+		FreeDFTSpace(aux_amp, 0, Spilled);
+		
+		NMRDataStruct->ErrorReport(NMRDataStruct, AuxErrno, "Reserving DFT data scratch file space (keeping the data in memory)");
+		NMRDataStruct->DFTSpillFailed = 1;
+		Spilled = 0;
+		
+		aux_out = (NMRReal *) AllocDFTSpace((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*2*sizeof(NMRReal), 1, Spilled);
+		aux_amp = (NMRReal *) AllocDFTSpace((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*sizeof(NMRReal), 0, Spilled);
+	}
+	
+	if ( (aux_out == NULL) || (aux_amp == NULL) ) {
+		FreeDFTSpace(aux_out, 1, Spilled);
+		FreeDFTSpace(aux_amp, 0, Spilled);
+
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating DFT data memory space");
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	}
+	
+	if (OldStepCount > 0) {
+		memcpy(aux_out, NMRDataStruct->Steps->DFTOutput, (NMRDataStruct->DFTLength)*OldStepCount*2*sizeof(NMRReal));
+		memcpy(aux_amp, NMRDataStruct->Steps->DFTOutAmp, (NMRDataStruct->DFTLength)*OldStepCount*sizeof(NMRReal));
+		
+		/** The phase corrected data spaces are not extended, they get allocated again **/
+		MarkNMRDataOld(NMRDataStruct, CHECK_DFTPhaseCorrPrep_MemReIm, ALL_STEPS);
+		MarkNMRDataOld(NMRDataStruct, CHECK_DFTPhaseCorrPrep_MemAmp, ALL_STEPS);
+	} else
+		MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
+	
+	FreeDFTResult(NMRDataStruct);
+	NMRDataStruct->DFTSpilled = Spilled;
+	
+	for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
+		DFTIndexRange(NMRDataStruct, i) = NMRDataStruct->DFTLength;
+		NMRDataStruct->Steps[i].DFTOutput = aux_out + 2*i*(NMRDataStruct->DFTLength);
+		NMRDataStruct->Steps[i].DFTPhaseCorrOutput = aux_out + 2*i*(NMRDataStruct->DFTLength);
+		NMRDataStruct->Steps[i].DFTOutAmp = aux_amp + i*(NMRDataStruct->DFTLength);
+		NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp = aux_amp + i*(NMRDataStruct->DFTLength);
+	}
+	
+	return DATA_OK;
+}
+
+/** Returns the apodization window value at the point Index of the processed part of the chunk average of Length points (without the first point scaling) **/
+double GetDFTWindowPoint(NMRData *NMRDataStruct, size_t Index, size_t Length) {
+	double Param = 0.0;
+	double Time = 0.0;
+	double Pos = 0.0;
+	
+	Param = 1.0e-3*NMRDataStruct->ApodizationParam;
+	Time = (NMRDataStruct->SWMh > 0.0)?(((double) Index)/(1.0e6*NMRDataStruct->SWMh)):(0.0);	/** s **/
+	Pos = (Length > 1)?(((double) Index)/((double) (Length - 1))):(0.5);
+	
+	switch (NMRDataStruct->Apodization) {
+		case APODIZATION_Exponential:
+			return exp(-M_PI*Param*Time);
+		
+		case APODIZATION_Gaussian:
+			return exp(-(M_PI*Param*Time)*(M_PI*Param*Time)/(4.0*M_LN2));
+		
+		case APODIZATION_SineBell:
+			return (Length > 1)?(sin(M_PI/180.0*(Param + (180.0 - Param)*Pos))):(1.0);
+		
+		case APODIZATION_Kaiser:
+			if (fabs(Param) > DFT_KAISER_MAX_SHAPE)
+				Param = DFT_KAISER_MAX_SHAPE;
+			return BesselI0(Param*sqrt(ChooseMax(0.0, 1.0 - (2.0*Pos - 1.0)*(2.0*Pos - 1.0))))/BesselI0(Param);
+		
+		default:
+			return 1.0;
+	}
+}
+
+/** Makes sure that the apodization window corresponds to the processed length of Length points and the current parameters, 
+    the first point scaling is included in the window **/
+int GetDFTWindow(NMRData *NMRDataStruct, size_t Length) {
+	DFTCacheData *Cache = NULL;
+	double *AuxPointer = NULL;
+	size_t n = 0;
+	
+	if ((Cache = GetDFTCache(NMRDataStruct)) == NULL)
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	
+	if ((Cache->Window.Coefs != NULL) && (Cache->Window.Length == Length) && (Cache->Window.Apodization == NMRDataStruct->Apodization) && 
+		(Cache->Window.ApodizationParam == NMRDataStruct->ApodizationParam) && (Cache->Window.SWMh == NMRDataStruct->SWMh) && 
+		(Cache->Window.ScaleFirstTDPoint == NMRDataStruct->ScaleFirstTDPoint))
+		return DATA_OK;
+	
+	AuxPointer = Cache->Window.Coefs;
+	Cache->Window.Coefs = (double *) realloc(Cache->Window.Coefs, ((Length > 0)?(Length):(1))*sizeof(double));
+	if (Cache->Window.Coefs == NULL) {
+		free(AuxPointer);
+		Cache->Window.Length = 0;
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating apodization window");
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	}
+	
+	for (n = 0; n < Length; n++) 
+		Cache->Window.Coefs[n] = GetDFTWindowPoint(NMRDataStruct, n, Length);
+	
+	if (NMRDataStruct->ScaleFirstTDPoint && (Length > 0))
+		Cache->Window.Coefs[0] *= 0.5;
+	
+	Cache->Window.Length = Length;
+	Cache->Window.Apodization = NMRDataStruct->Apodization;
+	Cache->Window.ApodizationParam = NMRDataStruct->ApodizationParam;
+	Cache->Window.SWMh = NMRDataStruct->SWMh;
+	Cache->Window.ScaleFirstTDPoint = NMRDataStruct->ScaleFirstTDPoint;
+	
+	return DATA_OK;
+}
+
+/** Fills the DFT output space of the given step (or all steps) with the processed part of the chunk average multiplied by the window (GetDFTWindow), 
+    converted to NMRReal and zero-padded to DFTLength in a single pass, to be transformed in place **/
+void PrepareDFTInput(NMRData *NMRDataStruct, long StepNo) {
+	DFTCacheData *Cache = NULL;
+	size_t i = 0;
+	size_t Start = 0;
+	size_t Range = 0;
+	
+	Cache = (DFTCacheData *) NMRDataStruct->DFTCache;
+	
+	if ((StepNo >= 0) && ((size_t) StepNo < StepNoRange(NMRDataStruct))) {
+		Start = StepNo;
+		Range = StepNo + 1;
+	} else {
+		Start = 0;
+		Range = StepNoRange(NMRDataStruct);
+	}
+	
+	for (i = Start; i < Range; i++) 
+		WindowReal(NMRDataStruct->Steps[i].DFTOutput, ChunkAvgProcStart(NMRDataStruct, i), Cache->Window.Coefs, ChunkAvgProcIndexRange(NMRDataStruct, i), DFTIndexRange(NMRDataStruct, i));
+	
+	SetDFTInputFirst(NMRDataStruct, StepNo);
+}
+
+/** Keeps the first point of the DFT input (windowed) of the given step (or all steps) needed by the offset removal **/
+void SetDFTInputFirst(NMRData *NMRDataStruct, long StepNo) {
+	size_t i = 0;
+	size_t Start = 0;
+	size_t Range = 0;
+	double Window = 1.0;
+	
+	if ((StepNo >= 0) && ((size_t) StepNo < StepNoRange(NMRDataStruct))) {
+		Start = StepNo;
+		Range = StepNo + 1;
+	} else {
+		Start = 0;
+		Range = StepNoRange(NMRDataStruct);
+	}
+	
+	if (NMRDataStruct->Apodization != APODIZATION_None)
+		Window = GetDFTWindowPoint(NMRDataStruct, 0, NMRDataStruct->ChunkEnd + 1 - NMRDataStruct->ChunkStart);
+	
+	for (i = Start; i < Range; i++) {
+		if (ChunkAvgProcIndexRange(NMRDataStruct, i) > 0) {
+			NMRDataStruct->Steps[i].DFTInputFirst[0] = Window*ChunkAvgProcReal(NMRDataStruct, i, 0);
+			NMRDataStruct->Steps[i].DFTInputFirst[1] = Window*ChunkAvgProcImag(NMRDataStruct, i, 0);
+		} else {
+			NMRDataStruct->Steps[i].DFTInputFirst[0] = 0.0;
+			NMRDataStruct->Steps[i].DFTInputFirst[1] = 0.0;
+		}
+		
+		if (NMRDataStruct->ScaleFirstTDPoint) {
+			NMRDataStruct->Steps[i].DFTInputFirst[0] *= 0.5;
+			NMRDataStruct->Steps[i].DFTInputFirst[1] *= 0.5;
+		}
+	}
+}
+
+/** Returns the length of the sub-transforms of the input-pruned DFT of DataLength points, 0 if the full-length transform is to be used. 
+    The sub-transform length is the smallest divisor of DFTLength not shorter than the data. **/
+size_t GetPrunedDFTLength(NMRData *NMRDataStruct, size_t DataLength) {
+	size_t SubLength = 0;
+	
+	if (DataLength == 0)
+		return 0;
+	
+	for (SubLength = DataLength; SubLength <= NMRDataStruct->DFTLength / DFT_PRUNE_MIN_RATIO; SubLength++) 
+		if (NMRDataStruct->DFTLength % SubLength == 0)
+			return SubLength;
+	
+	return 0;
+}
+
+/** Makes sure that the twiddle factors correspond to the current DFTLength **/
+int GetDFTTwiddles(NMRData *NMRDataStruct) {
+	DFTCacheData *Cache = NULL;
+	double *AuxPointer = NULL;
+	size_t k = 0;
+	
+	if ((Cache = GetDFTCache(NMRDataStruct)) == NULL)
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	
+	if ((Cache->Twiddles != NULL) && (Cache->TwiddleLength == NMRDataStruct->DFTLength))
+		return DATA_OK;
+	
+	AuxPointer = Cache->Twiddles;
+	Cache->Twiddles = (double *) realloc(Cache->Twiddles, (NMRDataStruct->DFTLength)*2*sizeof(double));
+	if (Cache->Twiddles == NULL) {
+		free(AuxPointer);
+		Cache->TwiddleLength = 0;
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating DFT twiddle factors");
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	}
+	
+	Cache->TwiddleLength = NMRDataStruct->DFTLength;
+	for (k = 0; k < Cache->TwiddleLength; k++) {
+		Cache->Twiddles[2*k + 0] = cos(2.0*M_PI*((double) k)/((double) Cache->TwiddleLength));
+		Cache->Twiddles[2*k + 1] = -sin(2.0*M_PI*((double) k)/((double) Cache->TwiddleLength));
+	}
+	
+	return DATA_OK;
+}
+
+/** Reverses the order of Count complex points in place **/
+void ReverseDFTPoints(NMRReal *Data, size_t Count) {
+	NMRReal *Low = NULL;
+	NMRReal *High = NULL;
+	NMRReal Re = 0.0;
+	NMRReal Im = 0.0;
+	
+	if (Count < 2)
+		return;
+	
+	for (Low = Data, High = Data + 2*(Count - 1); Low < High; Low += 2, High -= 2) {
+		Re = Low[0];
+		Im = Low[1];
+		Low[0] = High[0];
+		Low[1] = High[1];
+		High[0] = Re;
+		High[1] = Im;
+	}
+}
+
+/** Reorders the transform of Length points into the ascending order of frequency (see DFTIndexToRawIndexNoFilter) - 
+    rotates it by Length/2 + 1 points in place by three reversals, each point being moved twice in sequential passes **/
+void ShiftDFTOutput(NMRReal *Data, size_t Length) {
+	size_t Shift = 0;
+	
+	if (Length < 2)
+		return;
+	
+	Shift = (Length/2 + 1) % Length;
+	
+	ReverseDFTPoints(Data, Shift);
+	ReverseDFTPoints(Data + 2*Shift, Length - Shift);
+	ReverseDFTPoints(Data, Length);
+}
+
+/** Makes sure that the scratch space holds at least Length complex points **/
+int GetDFTScratch(NMRData *NMRDataStruct, size_t Length) {
+	DFTCacheData *Cache = NULL;
+	
+	if ((Cache = GetDFTCache(NMRDataStruct)) == NULL)
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	
+	if ((Cache->Scratch != NULL) && (Cache->ScratchLength >= Length))
+		return DATA_OK;
+	
+	/** FFTW provides no reallocation, the contents need not to be kept anyway **/
+	DFT_FFTW(free)(Cache->Scratch);
+	Cache->Scratch = (NMRReal *) DFT_FFTW(malloc)(Length*2*sizeof(NMRReal));
+	if (Cache->Scratch == NULL) {
+		Cache->ScratchLength = 0;
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating DFT scratch space");
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	}
+	
+	Cache->ScratchLength = Length;
+	
+	return DATA_OK;
+}
+
+/** Input-pruned DFT of a single step with DFTLength = Count*SubLength and the data not longer than SubLength: 
+    the output point r + Count*q is the point q of the length-SubLength DFT of the data multiplied by exp(-2*pi*i*n*r/DFTLength), 
+    so the scratch space holds Count such rows (the first one being the data themselves) transformed by a single plan with interleaved output. 
+    Compared to the full-length transform of the zero-padded data, the butterflies of log2(DFTLength/SubLength) stages are saved. 
+    The output differs from the full-length transform by a few units in the last place of the largest output point (below 1e-15 relative to it). **/
+int GetPrunedDFTResult(NMRData *NMRDataStruct, size_t StepNo, size_t SubLength) {
+	DFT_FFTW(plan) DFTPlan;
+	DFTCacheData *Cache = NULL;
+	size_t Count = 0;
+	size_t DataLength = 0;
+	size_t n = 0;
+	size_t r = 0;
+	size_t k = 0;
+	double *Data = NULL;
+	NMRReal *Row = NULL;
+	double Re = 0.0;
+	double Im = 0.0;
+	int RetVal = DATA_OK;
+	
+	Count = NMRDataStruct->DFTLength / SubLength;
+	DataLength = ChunkAvgProcIndexRange(NMRDataStruct, StepNo);
+	Data = ChunkAvgProcStart(NMRDataStruct, StepNo);
+	
+	if ((RetVal = GetDFTTwiddles(NMRDataStruct)) != DATA_OK)
+		return RetVal;
+	
+	if ((RetVal = GetDFTScratch(NMRDataStruct, NMRDataStruct->DFTLength)) != DATA_OK)
+		return RetVal;
+	
+	Cache = (DFTCacheData *) NMRDataStruct->DFTCache;
+	
+	/** The planning may overwrite the arrays, so the plan is obtained first **/
+	DFTPlan = GetDFTPlan(NMRDataStruct, (int) SubLength, (int) Count, 1, Cache->Scratch, NMRDataStruct->Steps[StepNo].DFTOutput);
+	if (DFTPlan == NULL) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Creating the DFT plan failed", "Carrying out Fourier transform");
+		return DATA_INVALID;
+	}
+	
+	for (r = 0; r < Count; r++) {
+		Row = Cache->Scratch + 2*r*SubLength;
+		
+		/** n*r < DataLength*Count <= DFTLength, no reduction of the twiddle index is needed **/
+		for (n = 0, k = 0; n < DataLength; n++, k += r) {
+			Re = Cache->Window.Coefs[n]*Data[2*n + 0];
+			Im = Cache->Window.Coefs[n]*Data[2*n + 1];
+			Row[2*n + 0] = (NMRReal) (Re*Cache->Twiddles[2*k + 0] - Im*Cache->Twiddles[2*k + 1]);
+			Row[2*n + 1] = (NMRReal) (Re*Cache->Twiddles[2*k + 1] + Im*Cache->Twiddles[2*k + 0]);
+		}
+		
+		/** zero-padding **/
+		memset(Row + 2*DataLength, 0, (SubLength - DataLength)*2*sizeof(NMRReal));
+	}
+	
+	DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) Cache->Scratch, (DFT_FFTW(complex) *) (NMRDataStruct->Steps[StepNo].DFTOutput));
+	
+	ShiftDFTOutput(NMRDataStruct->Steps[StepNo].DFTOutput, DFTIndexRange(NMRDataStruct, StepNo));
+	
+	SetDFTInputFirst(NMRDataStruct, StepNo);
+	
+	AmplitudeReal(NMRDataStruct->Steps[StepNo].DFTOutAmp, NMRDataStruct->Steps[StepNo].DFTOutput, DFTIndexRange(NMRDataStruct, StepNo));
+	
+	return DATA_OK;
+}
+
+/** Returns the length of the decimated transform of the downconversion, 0 if the full-length transform is to be used. 
+    The decimated length is the smallest divisor of DFTLength covering the filtered band DFT_DOWNCONVERT_OVERSAMPLING times. **/
+size_t GetDownconvertedDFTLength(NMRData *NMRDataStruct) {
+	size_t SubLength = 0;
+	size_t MinLength = 0;
+	long Offset = 0;
+	long First = 0;
+	long Last = 0;
+	long Center = 0;
+	long Half = 0;
+	
+	if ((NMRDataStruct->DFTLength == 0) || (NMRDataStruct->filter + NMRDataStruct->filter2 == 0) || 
+		(NMRDataStruct->filter + NMRDataStruct->filter2 >= NMRDataStruct->DFTLength))
+		return 0;
+	
+	/** The filtered band in bins relative to the zero frequency **/
+	Offset = (long) (NMRDataStruct->DFTLength - NMRDataStruct->DFTLength/2 - 1);
+	First = (long) NMRDataStruct->filter - Offset;
+	Last = (long) (NMRDataStruct->DFTLength - NMRDataStruct->filter2 - 1) - Offset;
+	Center = (First + Last)/2;
+	Half = ChooseMax(Center - First, Last - Center);
+	
+	MinLength = DFT_DOWNCONVERT_OVERSAMPLING*(2*((size_t) Half) + 1);
+	
+	for (SubLength = MinLength; SubLength <= NMRDataStruct->DFTLength / DFT_DOWNCONVERT_MIN_RATIO; SubLength++) 
+		if (NMRDataStruct->DFTLength % SubLength == 0)
+			return SubLength;
+	
+	return 0;
+}
+
+/** Modified Bessel function of the first kind of order zero, by its power series **/
+double BesselI0(double x) {
+	double Sum = 1.0;
+	double Term = 1.0;
+	double k = 0.0;
+	
+	for (k = 1.0; Term > 1.0e-17*Sum; k += 1.0) {
+		Term *= (0.5*x/k)*(0.5*x/k);
+		Sum += Term;
+	}
+	
+	return Sum;
+}
+
+/** Makes sure that the low-pass filter of the downconversion corresponds to the given decimation ratio and half-length: 
+    a Kaiser-windowed sinc cut off at 1/(2*Ratio) of the sampling rate with DFT_DOWNCONVERT_ATTENUATION, normalized to unit gain at zero frequency **/
+int GetDownconvertFilter(NMRData *NMRDataStruct, size_t Ratio, size_t HalfLength) {
+	DFTCacheData *Cache = NULL;
+	double *AuxPointer = NULL;
+	double Beta = 0.0;
+	double Cutoff = 0.0;
+	double Arg = 0.0;
+	double Sum = 0.0;
+	size_t j = 0;
+	
+	if ((Cache = GetDFTCache(NMRDataStruct)) == NULL)
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	
+	if ((Cache->DownconvertFilter != NULL) && (Cache->DownconvertRatio == Ratio) && (Cache->DownconvertHalfLength == HalfLength))
+		return DATA_OK;
+	
+	AuxPointer = Cache->DownconvertFilter;
+	Cache->DownconvertFilter = (double *) realloc(Cache->DownconvertFilter, (HalfLength + 1)*sizeof(double));
+	if (Cache->DownconvertFilter == NULL) {
+		free(AuxPointer);
+		Cache->DownconvertRatio = 0;
+		Cache->DownconvertHalfLength = 0;
+		NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating downconversion filter");
+		return (MEM_ALLOC_ERROR | DATA_EMPTY);
+	}
+	
+	Beta = 0.1102*(DFT_DOWNCONVERT_ATTENUATION - 8.7);
+	Cutoff = 0.5/((double) Ratio);
+	
+	for (j = 0; j <= HalfLength; j++) {
+		Arg = ((double) j)/((double) HalfLength);
+		Cache->DownconvertFilter[j] = BesselI0(Beta*sqrt(1.0 - Arg*Arg));
+		if (j > 0)
+			Cache->DownconvertFilter[j] *= sin(2.0*M_PI*Cutoff*((double) j))/(M_PI*((double) j));
+		else
+			Cache->DownconvertFilter[j] *= 2.0*Cutoff;
 		
+		Sum += (j > 0)?(2.0*Cache->DownconvertFilter[j]):(Cache->DownconvertFilter[j]);
 	}
 	
+	for (j = 0; j <= HalfLength; j++) 
+		Cache->DownconvertFilter[j] /= Sum;
+	
+	Cache->DownconvertRatio = Ratio;
+	Cache->DownconvertHalfLength = HalfLength;
+	
 	return DATA_OK;
 }
 
-
-
-int GetChunkAvg(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
-	size_t MaxChunkLength = 0;
-	size_t Counter = 0;
-	size_t i = 0;
-	size_t j = 0;
+/** Band-limited DFT of a single step with DFTLength = Ratio*SubLength: the data are shifted by the center of the filtered band to zero frequency, 
+    low-pass filtered and decimated by Ratio, then the points q of the length-SubLength DFT of the decimated data (wrapped to SubLength) 
+    multiplied by Ratio are the output points Center + q within the filtered band, written in the ascending order of frequency right away. 
+    The output outside the filtered band is zero. 
+    The filtering takes about 2*HalfLength/Ratio (below 20) multiply-adds per data point, the transform is Ratio times shorter. 
+    The filtered band differs from the full-length transform by less than 1e-6 relative to the largest output point. **/
+int GetDownconvertedDFTResult(NMRData *NMRDataStruct, size_t StepNo, size_t SubLength) {
+	DFT_FFTW(plan) DFTPlan;
+	DFTCacheData *Cache = NULL;
+	size_t Ratio = 0;
+	size_t DataLength = 0;
+	size_t HalfLength = 0;
+	size_t Step = 0;
+	size_t n = 0;
 	size_t k = 0;
-	double *AuxPointerDouble = NULL;
-	long Val = 0;
-	size_t Start = 0;
-	size_t Range = 0;
+	size_t j = 0;
+	long Offset = 0;
+	long First = 0;
+	long Last = 0;
+	long Center = 0;
+	long Half = 0;
+	long m = 0;
+	long t = 0;
+	long Low = 0;
+	long High = 0;
+	long q = 0;
+	double Transition = 0.0;
+	double *Data = NULL;
+	NMRReal *Mixed = NULL;
+	NMRReal *Output = NULL;
+	double Re = 0.0;
+	double Im = 0.0;
 	int RetVal = DATA_OK;
 	
-	if (NMRDataStruct == NULL)
-		return NMR_DATA_STRUCT_VOID;
-
-	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
-		return ERROR_REPORT_VOID;
-
-	if (StepNo < 0) {
-		Start = 0;
-		Range = StepNoRange(NMRDataStruct);
-	} else 
-	if ((unsigned long) StepNo < StepNoRange(NMRDataStruct)) {
-		Start = StepNo;
-		Range = StepNo + 1;
-	} else 
-		return INVALID_PARAMETER;
+	Ratio = NMRDataStruct->DFTLength / SubLength;
+	DataLength = ChunkAvgProcIndexRange(NMRDataStruct, StepNo);
+	Data = ChunkAvgProcStart(NMRDataStruct, StepNo);
+	Output = NMRDataStruct->Steps[StepNo].DFTOutput;
 	
-	if ((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_FirstChunk, PARAM_LONG, &Val, NULL)) != DATA_OK) {
-		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Processing parameter 'FirstChunk' check failed", "Chunk average calculation");
+	Offset = (long) (NMRDataStruct->DFTLength - NMRDataStruct->DFTLength/2 - 1);
+	First = (long) NMRDataStruct->filter - Offset;
+	Last = (long) (NMRDataStruct->DFTLength - NMRDataStruct->filter2 - 1) - Offset;
+	Center = (First + Last)/2;
+	Half = ChooseMax(Center - First, Last - Center);
+	
+	/** The aliases of the band from beyond 1/Ratio - Half/DFTLength are suppressed, the Kaiser filter length follows from the transition width **/
+	Transition = 1.0/((double) Ratio) - 2.0*((double) Half)/((double) NMRDataStruct->DFTLength);
+	HalfLength = (size_t) ceil((DFT_DOWNCONVERT_ATTENUATION - 8.0)/(2.285*2.0*M_PI*Transition)/2.0);
+	
+	if ((RetVal = GetDFTTwiddles(NMRDataStruct)) != DATA_OK)
 		return RetVal;
-	}
 	
-	if ((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_LastChunk, PARAM_LONG, &Val, NULL)) != DATA_OK) {
-		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Processing parameter 'LastChunk' check failed", "Chunk average calculation");
+	if ((RetVal = GetDownconvertFilter(NMRDataStruct, Ratio, HalfLength)) != DATA_OK)
 		return RetVal;
-	}
-
-	/** Determines MaxChunkLength (actually, all chunks should have the same length anyway) **/
-	for (i = NMRDataStruct->FirstChunk; (i <= NMRDataStruct->LastChunk) && (i < ChunkNoRange(NMRDataStruct)); i++) 
-		if (ChunkIndexRange(NMRDataStruct, i) > MaxChunkLength)
-			MaxChunkLength = ChunkIndexRange(NMRDataStruct, i);
 	
-	if (MaxChunkLength == 0) {
-		/** Deleting old data **/
-		for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
-			free(ChunkAvgDataStart(NMRDataStruct, i));
-			ChunkAvgDataStart(NMRDataStruct, i) = NULL;
-			free(ChunkAvgDataAmpStart(NMRDataStruct, i));
-			ChunkAvgDataAmpStart(NMRDataStruct, i) = NULL;
-			ChunkAvgIndexRange(NMRDataStruct, i) = 0;
-		}
-
-		return DATA_OK;
+	if ((RetVal = GetDFTScratch(NMRDataStruct, SubLength + DataLength)) != DATA_OK)
+		return RetVal;
+	
+	Cache = (DFTCacheData *) NMRDataStruct->DFTCache;
+	
+	/** The planning may overwrite the array, so the plan is obtained first **/
+	DFTPlan = GetDFTPlan(NMRDataStruct, (int) SubLength, 1, 0, Cache->Scratch, Cache->Scratch);
+	if (DFTPlan == NULL) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Creating the DFT plan failed", "Carrying out Fourier transform");
+		return DATA_INVALID;
 	}
-
-	for (k = Start; k < Range; k++) {
-		if (NMRDataStruct->Steps[k].Flags & Flag(CHECK_ChunkAvg))
-			continue;	/** This step is already done **/
-		
-		if ((MaxChunkLength != ChunkAvgIndexRange(NMRDataStruct, k)) || (ChunkAvgDataStart(NMRDataStruct, k) == NULL) || (ChunkAvgDataAmpStart(NMRDataStruct, k) == NULL)) {
-			AuxPointerDouble = ChunkAvgDataStart(NMRDataStruct, k);
-			ChunkAvgDataStart(NMRDataStruct, k) = (double *) realloc(ChunkAvgDataStart(NMRDataStruct, k), 2*MaxChunkLength*sizeof(double));
 	
-			if (ChunkAvgDataStart(NMRDataStruct, k) == NULL) {
-				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk average data memory space");
-				free(AuxPointerDouble);
-				AuxPointerDouble = NULL;
-				ChunkAvgIndexRange(NMRDataStruct, k) = 0;
-				return (MEM_ALLOC_ERROR | DATA_INVALID);
-			}
+	/** Mixing by exp(-2*pi*i*n*Center/DFTLength) behind the decimated data **/
+	Mixed = Cache->Scratch + 2*SubLength;
+	Step = (size_t) (((Center % (long) NMRDataStruct->DFTLength) + (long) NMRDataStruct->DFTLength) % (long) NMRDataStruct->DFTLength);
+	for (n = 0, k = 0; n < DataLength; n++) {
+		Re = Cache->Window.Coefs[n]*Data[2*n + 0];
+		Im = Cache->Window.Coefs[n]*Data[2*n + 1];
+		Mixed[2*n + 0] = (NMRReal) (Re*Cache->Twiddles[2*k + 0] - Im*Cache->Twiddles[2*k + 1]);
+		Mixed[2*n + 1] = (NMRReal) (Re*Cache->Twiddles[2*k + 1] + Im*Cache->Twiddles[2*k + 0]);
+		
+		k += Step;
+		if (k >= NMRDataStruct->DFTLength)
+			k -= NMRDataStruct->DFTLength;
+	}
 	
-			AuxPointerDouble = ChunkAvgDataAmpStart(NMRDataStruct, k);
-			ChunkAvgDataAmpStart(NMRDataStruct, k) = (double *) realloc(ChunkAvgDataAmpStart(NMRDataStruct, k), MaxChunkLength*sizeof(double));
-
-			if (ChunkAvgDataAmpStart(NMRDataStruct, k) == NULL) {
-				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating chunk average data memory space");
-				free(AuxPointerDouble);
-				AuxPointerDouble = NULL;
-				ChunkAvgIndexRange(NMRDataStruct, k) = 0;
-				return (MEM_ALLOC_ERROR | DATA_INVALID);
-			}
-			
-			ChunkAvgIndexRange(NMRDataStruct, k) = MaxChunkLength;
-		}
-			
-		for (j = 0; j < MaxChunkLength; j++) {
-			ChunkAvgReal(NMRDataStruct, k, j) = 0.0;
-			ChunkAvgImag(NMRDataStruct, k, j) = 0.0;
-		}
-
-		if (!(StepFlag(NMRDataStruct, k) & STEP_BLANK)) {
-			Counter = 0;
-			for (i = NMRDataStruct->FirstChunk; (i <= NMRDataStruct->LastChunk) && (i < ChunkNoRange(NMRDataStruct)); i++) {
-				if ((ChunkDataStart(NMRDataStruct, i)/2 + ChunkIndexRange(NMRDataStruct, i)) <= TDDIndexRange(NMRDataStruct, k)) {	/** It shouldn't be really necessary to test this **/
-					Counter++;
-				
-					for (j = 0; j < ChunkIndexRange(NMRDataStruct, i); j++) {
-						ChunkAvgReal(NMRDataStruct, k, j) += (double) ChunkReal(NMRDataStruct, k, i, j);
-						ChunkAvgImag(NMRDataStruct, k, j) += (double) ChunkImag(NMRDataStruct, k, i, j);
-					}
-				}
-			}
-
-			if (Counter > 0)
-				for (j = 0; j < ChunkAvgIndexRange(NMRDataStruct, k); j++) {
-					ChunkAvgReal(NMRDataStruct, k, j) /= (double) Counter;
-					ChunkAvgImag(NMRDataStruct, k, j) /= (double) Counter;
-				}
-			
-			for (j = 0; j < ChunkAvgIndexRange(NMRDataStruct, k); j++) 
-				ChunkAvgAmp(NMRDataStruct, k, j) = hypot(ChunkAvgReal(NMRDataStruct, k, j), ChunkAvgImag(NMRDataStruct, k, j));
-			
-		} else {
-			for (j = 0; j < MaxChunkLength; j++) 
-				ChunkAvgAmp(NMRDataStruct, k, j) = 0.0;
+	/** Filtering and decimation, the filtered data reach HalfLength points beyond the data on both sides **/
+	memset(Cache->Scratch, 0, SubLength*2*sizeof(NMRReal));
+	for (m = -((long) (HalfLength / Ratio)); m <= ((long) (DataLength + HalfLength) - 1) / (long) Ratio; m++) {
+		t = m*((long) Ratio);
+		Low = ChooseMax(0, t - (long) HalfLength);
+		High = ((t + (long) HalfLength) < (long) DataLength)?(t + (long) HalfLength):((long) DataLength - 1);
+		
+		Re = 0.0;
+		Im = 0.0;
+		for (n = (size_t) Low; (long) n <= High; n++) {
+			j = (size_t) labs(t - (long) n);
+			Re += Cache->DownconvertFilter[j]*Mixed[2*n + 0];
+			Im += Cache->DownconvertFilter[j]*Mixed[2*n + 1];
 		}
 		
+		/** Wrapping the decimated data to SubLength samples the spectrum at the SubLength points exactly **/
+		q = ((m % (long) SubLength) + (long) SubLength) % (long) SubLength;
+		Cache->Scratch[2*q + 0] += (NMRReal) Re;
+		Cache->Scratch[2*q + 1] += (NMRReal) Im;
 	}
 	
+	DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) Cache->Scratch, (DFT_FFTW(complex) *) Cache->Scratch);
+	
+	memset(Output, 0, DFTIndexRange(NMRDataStruct, StepNo)*2*sizeof(NMRReal));
+	for (j = NMRDataStruct->filter; j < NMRDataStruct->DFTLength - NMRDataStruct->filter2; j++) {
+		q = (long) j - Offset - Center;
+		q = ((q % (long) SubLength) + (long) SubLength) % (long) SubLength;
+		Output[2*j + 0] = (NMRReal) Ratio*Cache->Scratch[2*q + 0];
+		Output[2*j + 1] = (NMRReal) Ratio*Cache->Scratch[2*q + 1];
+	}
+	
+	SetDFTInputFirst(NMRDataStruct, StepNo);
+	
+	AmplitudeReal(NMRDataStruct->Steps[StepNo].DFTOutAmp, NMRDataStruct->Steps[StepNo].DFTOutput, DFTIndexRange(NMRDataStruct, StepNo));
+	
 	return DATA_OK;
 }
 
-
-
+/** Transforms the steps whose DFT result is old - all steps together by the batched plan if there is no up to date step, one by one otherwise. 
+    Heavily zero-padded data are transformed one by one by the input-pruned DFT, just the narrow filtered band one by one by the downconversion if enabled. **/
 int GetDFTResult(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
-	double *aux_in = NULL;
-	double *aux_out = NULL;
-	double *aux_amp = NULL;
-	fftw_plan DFTPlan;
+	DFT_FFTW(plan) DFTPlan;
 	size_t i = 0;
-	size_t j = 0;
+	size_t Start = 0;
+	size_t Range = 0;
+	size_t OldCount = 0;
+	size_t SubLength = 0;
+	size_t DownLength = 0;
+	size_t First = 0;
+	size_t Count = 0;
+	size_t BatchSteps = 0;
 	long Val = 0;
 	int RetVal = DATA_OK;
-	int FFTlength = 0;
 	
 	if (NMRDataStruct == NULL)
 		return NMR_DATA_STRUCT_VOID;
@@ -671,64 +2094,124 @@ int GetDFTResult(NMRData *NMRDataStruct, long StepNo, unsigned long Components)
 		return DATA_OK;
 	}
 	
-	if (NMRDataStruct->DFTLength != DFTIndexRange(NMRDataStruct, 0)) {
-		FreeDFTResult(NMRDataStruct);
-
-		aux_in = (double *) fftw_malloc((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*2*sizeof(double));
-		aux_out = (double *) fftw_malloc((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*2*sizeof(double));
-		aux_amp = (double *) malloc((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*sizeof(double));
-		
-		if ( (aux_in == NULL) || (aux_out == NULL) || (aux_amp == NULL) ) {
-			fftw_free(aux_in);
-			fftw_free(aux_out);
-			free(aux_amp);
-
-			NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating DFT data memory space");
-			return (MEM_ALLOC_ERROR | DATA_EMPTY);
-		}
-		
-		for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
-			DFTIndexRange(NMRDataStruct, i) = NMRDataStruct->DFTLength;
-			NMRDataStruct->Steps[i].DFTInput = aux_in + 2*i*(NMRDataStruct->DFTLength);
-			NMRDataStruct->Steps[i].DFTOutput = aux_out + 2*i*(NMRDataStruct->DFTLength);
-			NMRDataStruct->Steps[i].DFTPhaseCorrOutput = aux_out + 2*i*(NMRDataStruct->DFTLength);
-			NMRDataStruct->Steps[i].DFTOutAmp = aux_amp + i*(NMRDataStruct->DFTLength);
-			NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp = aux_amp + i*(NMRDataStruct->DFTLength);
-		}
+	if ((RetVal = AllocDFTResult(NMRDataStruct)) != DATA_OK)
+		return RetVal;
+	
+	if ((RetVal = GetDFTWindow(NMRDataStruct, NMRDataStruct->ChunkEnd + 1 - NMRDataStruct->ChunkStart)) != DATA_OK)
+		return RetVal;
+	
+	/** The downconverted band follows the filter of the current DFTLength **/
+	if (NMRDataStruct->DFTDownconvert && ((RetVal = CheckProcParam(NMRDataStruct, PROC_PARAM_Filter, PARAM_LONG, &Val, NULL)) != DATA_OK)) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Processing parameter 'Filter' check failed", "Carrying out Fourier transform");
+		return RetVal;
 	}
 
-	FFTlength = NMRDataStruct->DFTLength;
+	if ((NMRDataStruct->DFTLength > INT_MAX) || (NMRDataStruct->StepCount > INT_MAX)) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "The DFT length or the step count is out of range", "Carrying out Fourier transform");
+		return (INVALID_PARAMETER | DATA_INVALID);
+	}
 	
-	DFTPlan = fftw_plan_many_dft(1, &FFTlength, NMRDataStruct->StepCount , 
-								(fftw_complex *) (NMRDataStruct->Steps->DFTInput), NULL, 1, NMRDataStruct->DFTLength, 
-								(fftw_complex *) (NMRDataStruct->Steps->DFTOutput), NULL, 1, NMRDataStruct->DFTLength, 
-								FFTW_FORWARD, FFTW_ESTIMATE | FFTW_DESTROY_INPUT);
+	if ((StepNo >= 0) && ((size_t) StepNo < StepNoRange(NMRDataStruct))) {
+		Start = StepNo;
+		Range = StepNo + 1;
+	} else {
+		Start = 0;
+		Range = StepNoRange(NMRDataStruct);
+	}
 	
-	/** Copying input data **/
-	for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
-		memcpy(NMRDataStruct->Steps[i].DFTInput, ChunkAvgProcStart(NMRDataStruct, i), ChunkAvgProcIndexRange(NMRDataStruct, i)*2*sizeof(double));
-		/** zero-padding **/
-		for (j = ChunkAvgProcIndexRange(NMRDataStruct, i); j < DFTIndexRange(NMRDataStruct, i); j++) {
-			NMRDataStruct->Steps[i].DFTInput[2*j + 0] = 0.0;
-			NMRDataStruct->Steps[i].DFTInput[2*j + 1] = 0.0;
+	for (i = Start; i < Range; i++) 
+		if (!(NMRDataStruct->Steps[i].Flags & Flag(CHECK_DFTResult)))
+			OldCount++;
+	
+	SubLength = GetPrunedDFTLength(NMRDataStruct, ChunkAvgProcIndexRange(NMRDataStruct, 0));
+	DownLength = (NMRDataStruct->DFTDownconvert)?(GetDownconvertedDFTLength(NMRDataStruct)):(0);
+	
+	if ((OldCount == StepNoRange(NMRDataStruct)) && (SubLength == 0) && (DownLength == 0)) {
+		/** The steps are transformed in batches fitting the DFTMemoryBudget (all at once if there is no budget) **/
+		BatchSteps = GetDFTBatchSteps(NMRDataStruct);
+		
+		for (First = 0; First < StepNoRange(NMRDataStruct); First += BatchSteps) {
+			Count = StepNoRange(NMRDataStruct) - First;
+			if (Count > BatchSteps)
+				Count = BatchSteps;
+			
+			/** The planning may overwrite the arrays, so the plan is obtained first **/
+			DFTPlan = GetDFTPlan(NMRDataStruct, (int) NMRDataStruct->DFTLength, (int) Count, 0, NMRDataStruct->Steps[First].DFTOutput, NMRDataStruct->Steps[First].DFTOutput);
+			if (DFTPlan == NULL) {
+				NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Creating the DFT plan failed", "Carrying out Fourier transform");
+				return DATA_INVALID;
+			}
+			
+			if (Count == StepNoRange(NMRDataStruct))
+				PrepareDFTInput(NMRDataStruct, ALL_STEPS);
+			else
+				for (i = First; i < First + Count; i++) 
+					PrepareDFTInput(NMRDataStruct, i);
+			
+			DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) (NMRDataStruct->Steps[First].DFTOutput), (DFT_FFTW(complex) *) (NMRDataStruct->Steps[First].DFTOutput));
+			
+			/** Reordering and computing amplitude **/
+			for (i = First; i < First + Count; i++) {
+				ShiftDFTOutput(NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i));
+				AmplitudeReal(NMRDataStruct->Steps[i].DFTOutAmp, NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i));
+			}
+			
+			/** The finished batch goes to the scratch file to make room for the next one **/
+			if (NMRDataStruct->DFTSpilled) {
+				ReleaseDFTSpace(NMRDataStruct->Steps[First].DFTOutput, (NMRDataStruct->DFTLength)*Count*2*sizeof(NMRReal));
+				ReleaseDFTSpace(NMRDataStruct->Steps[First].DFTOutAmp, (NMRDataStruct->DFTLength)*Count*sizeof(NMRReal));
+			}
 		}
+		
+		return DATA_OK;
 	}
 	
-	if (NMRDataStruct->ScaleFirstTDPoint) {
-		for (i = 0; i < StepNoRange(NMRDataStruct); i++) {
-			NMRDataStruct->Steps[i].DFTInput[0] *= 0.5;
-			NMRDataStruct->Steps[i].DFTInput[1] *= 0.5;
+	for (i = Start; i < Range; i++) {
+		if (NMRDataStruct->Steps[i].Flags & Flag(CHECK_DFTResult))
+			continue;
+		
+		if (DownLength > 0) {
+			if ((RetVal = GetDownconvertedDFTResult(NMRDataStruct, i, DownLength)) != DATA_OK)
+				return RetVal;
+			
+			if (NMRDataStruct->DFTSpilled) {
+				ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i)*2*sizeof(NMRReal));
+				ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutAmp, DFTIndexRange(NMRDataStruct, i)*sizeof(NMRReal));
+			}
+			continue;
+		}
+		
+		if ((SubLength > 0) && (ChunkAvgProcIndexRange(NMRDataStruct, i) <= SubLength)) {
+			if ((RetVal = GetPrunedDFTResult(NMRDataStruct, i, SubLength)) != DATA_OK)
+				return RetVal;
+			
+			if (NMRDataStruct->DFTSpilled) {
+				ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i)*2*sizeof(NMRReal));
+				ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutAmp, DFTIndexRange(NMRDataStruct, i)*sizeof(NMRReal));
+			}
+			continue;
+		}
+		
+		/** The single-transform plan is looked up for every step since its arrays must have the alignment the plan was created for **/
+		DFTPlan = GetDFTPlan(NMRDataStruct, (int) NMRDataStruct->DFTLength, 1, 0, NMRDataStruct->Steps[i].DFTOutput, NMRDataStruct->Steps[i].DFTOutput);
+		if (DFTPlan == NULL) {
+			NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Creating the DFT plan failed", "Carrying out Fourier transform");
+			return DATA_INVALID;
+		}
+		
+		PrepareDFTInput(NMRDataStruct, i);
+		
+		DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) (NMRDataStruct->Steps[i].DFTOutput), (DFT_FFTW(complex) *) (NMRDataStruct->Steps[i].DFTOutput));
+		
+		ShiftDFTOutput(NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i));
+		
+		AmplitudeReal(NMRDataStruct->Steps[i].DFTOutAmp, NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i));
+		
+		if (NMRDataStruct->DFTSpilled) {
+			ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i)*2*sizeof(NMRReal));
+			ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutAmp, DFTIndexRange(NMRDataStruct, i)*sizeof(NMRReal));
 		}
 	}
-
-	fftw_execute(DFTPlan);
-
-	fftw_destroy_plan(DFTPlan);
-
-	/** Computing amplitude **/
-	for (i = 0; i < StepNoRange(NMRDataStruct); i++) 
-		for (j = 0; j < DFTIndexRange(NMRDataStruct, i); j++) 
-			DFTAmp(NMRDataStruct, i, j) = hypot(DFTReal(NMRDataStruct, i, j), DFTImag(NMRDataStruct, i, j));
 	
 	return DATA_OK;
 }
@@ -741,21 +2224,19 @@ int FreeDFTResult(NMRData *NMRDataStruct) {
 		return NMR_DATA_STRUCT_VOID;
 	
 	if (NMRDataStruct->Steps != NULL) {
-		/** Free DFT in/out space **/
-		fftw_free(NMRDataStruct->Steps->DFTInput);
-		fftw_free(NMRDataStruct->Steps->DFTOutput);
-		free(NMRDataStruct->Steps->DFTOutAmp);
+		/** Free DFT space **/
+		FreeDFTSpace(NMRDataStruct->Steps->DFTOutput, 1, NMRDataStruct->DFTSpilled);
+		FreeDFTSpace(NMRDataStruct->Steps->DFTOutAmp, 0, NMRDataStruct->DFTSpilled);
 		
 		/** Free phase-corrected DFT output, if there is any (i.e. if its not just a pointer to the DFT out memory space) **/
 		if (NMRDataStruct->Steps->DFTPhaseCorrOutput != NMRDataStruct->Steps->DFTOutput)
-			fftw_free(NMRDataStruct->Steps->DFTPhaseCorrOutput);
+			FreeDFTSpace(NMRDataStruct->Steps->DFTPhaseCorrOutput, 1, NMRDataStruct->DFTSpilled);
 
 		/** Free phase- and offset-corrected DFT output amplitude, if there is any (i.e. if its not just a pointer to the DFT output amplitude memory space) **/
 		if (NMRDataStruct->Steps->DFTPhaseCorrOutAmp != NMRDataStruct->Steps->DFTOutAmp)
-			free(NMRDataStruct->Steps->DFTPhaseCorrOutAmp);
+			FreeDFTSpace(NMRDataStruct->Steps->DFTPhaseCorrOutAmp, 0, NMRDataStruct->DFTSpilled);
 		
 		for (i = 0; i < NMRDataStruct->StepCount; i++) {
-			NMRDataStruct->Steps[i].DFTInput = NULL;
 			NMRDataStruct->Steps[i].DFTOutput = NULL;
 			NMRDataStruct->Steps[i].DFTOutAmp = NULL;
 			NMRDataStruct->Steps[i].DFTLength = 0;
@@ -763,6 +2244,8 @@ int FreeDFTResult(NMRData *NMRDataStruct) {
 			NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp = NULL;
 		}
 	}
+	
+	NMRDataStruct->DFTSpilled = 0;
 
 	return DATA_EMPTY;
 }
@@ -770,7 +2253,7 @@ int FreeDFTResult(NMRData *NMRDataStruct) {
 
 
 int GetDFTPhaseCorrPrep(NMRData *NMRDataStruct, long StepNo, unsigned long Components) {
-	double *aux_phased = NULL;
+	NMRReal *aux_phased = NULL;
 	size_t i = 0;
 	size_t j = 0;
 	double ReCoef = 0.0;
@@ -911,7 +2394,7 @@ int GetDFTPhaseCorrPrep(NMRData *NMRDataStruct, long StepNo, unsigned long Compo
 		/** Allocate memory if necessary and not already available **/
 		if ((DoPhaseCorrection || NMRDataStruct->RemoveOffset) && (NMRDataStruct->Steps->DFTPhaseCorrOutput == NMRDataStruct->Steps->DFTOutput)) {
 			MarkNMRDataOld(NMRDataStruct, CHECK_DFTPhaseCorr_ReIm, ALL_STEPS);
-			aux_phased = (double *) fftw_malloc((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*2*sizeof(double));
+			aux_phased = (NMRReal *) AllocDFTSpace((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*2*sizeof(NMRReal), 1, NMRDataStruct->DFTSpilled);
 			
 			if (aux_phased == NULL) {
 				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating memory for phase corrected DFT data");
@@ -927,7 +2410,7 @@ int GetDFTPhaseCorrPrep(NMRData *NMRDataStruct, long StepNo, unsigned long Compo
 		/** Allocate memory if necessary and not already available **/
 		if (NMRDataStruct->RemoveOffset && (NMRDataStruct->Steps->DFTPhaseCorrOutAmp == NMRDataStruct->Steps->DFTOutAmp)) {
 			MarkNMRDataOld(NMRDataStruct, CHECK_DFTPhaseCorr_Amp, ALL_STEPS);
-			aux_phased = (double *) malloc((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*sizeof(double));
+			aux_phased = (NMRReal *) AllocDFTSpace((NMRDataStruct->DFTLength)*StepNoRange(NMRDataStruct)*sizeof(NMRReal), 0, NMRDataStruct->DFTSpilled);
 			
 			if (aux_phased == NULL) {
 				NMRDataStruct->ErrorReport(NMRDataStruct, errno, "Allocating memory for phase corrected DFT data");
@@ -984,7 +2467,7 @@ int GetDFTPhaseCorr(NMRData *NMRDataStruct, long StepNo, unsigned long Component
 				DoPhaseCorrection = 1;
 			
 			if ((!DoPhaseCorrection) && (NMRDataStruct->Steps->DFTPhaseCorrOutput != NMRDataStruct->Steps->DFTOutput)) 				
-				memcpy(NMRDataStruct->Steps[i].DFTPhaseCorrOutput, NMRDataStruct->Steps[i].DFTOutput, (NMRDataStruct->DFTLength)*2*sizeof(double));	/** Just copy the unphased data **/
+				memcpy(NMRDataStruct->Steps[i].DFTPhaseCorrOutput, NMRDataStruct->Steps[i].DFTOutput, (NMRDataStruct->DFTLength)*2*sizeof(NMRReal));	/** Just copy the unphased data **/
 			
 			if (DoPhaseCorrection) {
 				if (DFTPhaseCorr1Relative(NMRDataStruct, i) == 0) {
@@ -1010,8 +2493,8 @@ int GetDFTPhaseCorr(NMRData *NMRDataStruct, long StepNo, unsigned long Component
 				ReCoef = cos(M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, i))*(0.5 + 0.001*DFTPhaseCorr1Relative(NMRDataStruct, i)*(NMRDataStruct->SWMh));
 				ImCoef = sin(M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, i))*(0.5 + 0.001*DFTPhaseCorr1Relative(NMRDataStruct, i)*(NMRDataStruct->SWMh));
 				
-				ReOffset = ReCoef*NMRDataStruct->Steps[i].DFTInput[0] - ImCoef*NMRDataStruct->Steps[i].DFTInput[1];
-				ImOffset = ReCoef*NMRDataStruct->Steps[i].DFTInput[1] + ImCoef*NMRDataStruct->Steps[i].DFTInput[0];
+				ReOffset = ReCoef*NMRDataStruct->Steps[i].DFTInputFirst[0] - ImCoef*NMRDataStruct->Steps[i].DFTInputFirst[1];
+				ImOffset = ReCoef*NMRDataStruct->Steps[i].DFTInputFirst[1] + ImCoef*NMRDataStruct->Steps[i].DFTInputFirst[0];
 				
 				for (j = 0; j < DFTIndexRange(NMRDataStruct, i); j++) {
 					DFTPhaseCorrReal(NMRDataStruct, i, j) -= ReOffset;
@@ -1023,11 +2506,210 @@ int GetDFTPhaseCorr(NMRData *NMRDataStruct, long StepNo, unsigned long Component
 		/** Get the amplitude **/
 		if ((Components & Flag(CHECK_DFTPhaseCorr_Amp)) && !(NMRDataStruct->Steps[i].Flags & Flag(CHECK_DFTPhaseCorr_Amp))) {
 			if ((!(NMRDataStruct->RemoveOffset)) && (NMRDataStruct->Steps->DFTPhaseCorrOutAmp != NMRDataStruct->Steps->DFTOutAmp))
-				memcpy(NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp, NMRDataStruct->Steps[i].DFTOutAmp, (NMRDataStruct->DFTLength)*sizeof(double));	/** Just copy the uncorrected data **/
+				memcpy(NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp, NMRDataStruct->Steps[i].DFTOutAmp, (NMRDataStruct->DFTLength)*sizeof(NMRReal));	/** Just copy the uncorrected data **/
 
 			if (NMRDataStruct->RemoveOffset) 
-				for (j = 0; j < DFTIndexRange(NMRDataStruct, i); j++) 
-					DFTPhaseCorrAmp(NMRDataStruct, i, j) = hypot(DFTPhaseCorrReal(NMRDataStruct, i, j), DFTPhaseCorrImag(NMRDataStruct, i, j));
+				AmplitudeReal(NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp, NMRDataStruct->Steps[i].DFTPhaseCorrOutput, DFTIndexRange(NMRDataStruct, i));
+		}
+		
+		if (NMRDataStruct->DFTSpilled) {
+			ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutput, DFTIndexRange(NMRDataStruct, i)*2*sizeof(NMRReal));
+			ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTOutAmp, DFTIndexRange(NMRDataStruct, i)*sizeof(NMRReal));
+			ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTPhaseCorrOutput, DFTIndexRange(NMRDataStruct, i)*2*sizeof(NMRReal));
+			ReleaseDFTSpace(NMRDataStruct->Steps[i].DFTPhaseCorrOutAmp, DFTIndexRange(NMRDataStruct, i)*sizeof(NMRReal));
+		}
+	}
+	
+	return DATA_OK;
+}
+
+/** Returns the smallest length not shorter than MinLength having no prime factors other than 2, 3, 5 and 7 (0 if there is none in the size_t range) **/
+size_t GetDFTFriendlyLength(size_t MinLength) {
+	size_t Best = 0;
+	size_t p2 = 0;
+	size_t p3 = 0;
+	size_t p5 = 0;
+	size_t p7 = 0;
+	
+	if (MinLength <= 1)
+		return 1;
+	
+	for (p7 = 1; ; p7 *= 7) {
+		for (p5 = p7; ; p5 *= 5) {
+			for (p3 = p5; ; p3 *= 3) {
+				/** the smallest power-of-two multiple of p3 reaching MinLength **/
+				for (p2 = p3; p2 < MinLength; p2 *= 2) 
+					if (p2 > SIZE_MAX / 2) 
+						break;
+				
+				if ((p2 >= MinLength) && ((Best == 0) || (p2 < Best)))
+					Best = p2;
+				
+				if ((p3 >= MinLength) || (p3 > SIZE_MAX / 3))
+					break;
+			}
+			if ((p5 >= MinLength) || (p5 > SIZE_MAX / 5))
+				break;
+		}
+		if ((p7 >= MinLength) || (p7 > SIZE_MAX / 7))
+			break;
+	}
+	
+	return Best;
+}
+
+/** Returns the DFT length Length rounded up to the nearest size having no prime factors other than 2, 3, 5 and 7 
+    if it is longer by DFTLengthTolerance % at most and fits the long processing parameter, Length itself otherwise **/
+size_t GetRoundedDFTLength(NMRData *NMRDataStruct, size_t Length) {
+	size_t Friendly = 0;
+	
+	if ((NMRDataStruct->DFTLengthTolerance == 0) || (Length == 0))
+		return Length;
+	
+	Friendly = GetDFTFriendlyLength(Length);
+	if ((Friendly == 0) || (Friendly > LONG_MAX) || (((double) (Friendly - Length)) > 0.01*NMRDataStruct->DFTLengthTolerance*((double) Length)))
+		return Length;
+	
+	return Friendly;
+}
+
+/** Chirp-z (Bluestein) evaluation of the phase-corrected spectrum of a single step at Count frequencies evenly spaced from FreqStart to FreqEnd (in MHz, both included). 
+    With the data x of length N, f0 = (FreqStart - StepFreq)/SW and d the frequency step relative to SW, the point k of the output is 
+    X(k) = sum_n x(n) exp(-2*pi*i*(f0 + k*d)*n) = w(k) * sum_n (x(n) exp(-2*pi*i*f0*n) w(n)) / w(k - n), where w(m) = exp(-pi*i*d*m^2), 
+    i.e. a convolution done by two forward transforms and a backward one (as the conjugate of the forward transform of the conjugate) of a friendly length not shorter than N + Count - 1. 
+    The cost thus scales with N + Count instead of DFTLength; the points at the frequencies of the zero-padded DFT agree with it within the rounding errors. 
+    The phase correction and the offset removal are the same as in GetDFTPhaseCorr, Output receives Count pairs of the real and imaginary parts. **/
+int GetDFTZoomResult(NMRData *NMRDataStruct, size_t StepNo, double FreqStart, double FreqEnd, size_t Count, double *Output) {
+	DFT_FFTW(plan) DFTPlan;
+	DFTCacheData *Cache = NULL;
+	NMRReal *Chirped = NULL;
+	NMRReal *Kernel = NULL;
+	double *Data = NULL;
+	size_t DataLength = 0;
+	size_t Length = 0;
+	size_t n = 0;
+	size_t k = 0;
+	double Step = 0.0;
+	double Start = 0.0;
+	double Angle = 0.0;
+	double Re = 0.0;
+	double Im = 0.0;
+	double ReCoef = 0.0;
+	double ImCoef = 0.0;
+	double ReOffset = 0.0;
+	double ImOffset = 0.0;
+	double First[2] = {0.0, 0.0};
+	int RetVal = DATA_OK;
+	
+	DataLength = ChunkAvgProcIndexRange(NMRDataStruct, StepNo);
+	Data = ChunkAvgProcStart(NMRDataStruct, StepNo);
+	
+	if ((DataLength == 0) || (NMRDataStruct->SWMh <= 0.0)) {
+		memset(Output, 0, Count*2*sizeof(double));
+		return DATA_OK;
+	}
+	
+	Length = GetDFTFriendlyLength(DataLength + Count - 1);
+	if ((Length == 0) || (Length > INT_MAX) || (Length > SIZE_MAX / 2)) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "The number of points is out of range", "Evaluating zoomed spectrum");
+		return (INVALID_PARAMETER | DATA_INVALID);
+	}
+	
+	if ((RetVal = GetDFTWindow(NMRDataStruct, DataLength)) != DATA_OK)
+		return RetVal;
+	
+	/** Both arrays in the scratch space **/
+	if ((RetVal = GetDFTScratch(NMRDataStruct, 2*Length)) != DATA_OK)
+		return RetVal;
+	
+	Cache = (DFTCacheData *) NMRDataStruct->DFTCache;
+	
+	Chirped = Cache->Scratch;
+	Kernel = Cache->Scratch + 2*Length;
+	
+	Start = (FreqStart - StepFreq(NMRDataStruct, StepNo)) / NMRDataStruct->SWMh;
+	Step = (Count > 1)?((FreqEnd - FreqStart) / ((double) (Count - 1)) / NMRDataStruct->SWMh):(0.0);
+	
+	/** The planning may overwrite the arrays, so the plans are obtained (and cached) before filling them **/
+	if ((GetDFTPlan(NMRDataStruct, (int) Length, 1, 0, Chirped, Chirped) == NULL) || (GetDFTPlan(NMRDataStruct, (int) Length, 1, 0, Kernel, Kernel) == NULL)) {
+		NMRDataStruct->ErrorReportCustom(NMRDataStruct, "Creating the DFT plan failed", "Evaluating zoomed spectrum");
+		return DATA_INVALID;
+	}
+	
+	First[0] = Cache->Window.Coefs[0]*Data[0];
+	First[1] = Cache->Window.Coefs[0]*Data[1];
+	
+	/** x(n) exp(-2*pi*i*f0*n) w(n), the angles reduced to single turns to keep the precision, x(n) including the apodization **/
+	for (n = 0; n < DataLength; n++) {
+		Re = Cache->Window.Coefs[n]*Data[2*n + 0];
+		Im = Cache->Window.Coefs[n]*Data[2*n + 1];
+		
+		Angle = - 2*M_PI*(fmod(Start*n, 1.0) + fmod(0.5*Step*n*n, 1.0));
+		Chirped[2*n + 0] = (NMRReal) (Re*cos(Angle) - Im*sin(Angle));
+		Chirped[2*n + 1] = (NMRReal) (Re*sin(Angle) + Im*cos(Angle));
+	}
+	memset(Chirped + 2*DataLength, 0, (Length - DataLength)*2*sizeof(NMRReal));
+	
+	/** 1/w(m) for m from -(N - 1) to Count - 1, the negative indices wrapped around **/
+	memset(Kernel, 0, Length*2*sizeof(NMRReal));
+	for (k = 0; k < Count; k++) {
+		Angle = 2*M_PI*fmod(0.5*Step*k*k, 1.0);
+		Kernel[2*k + 0] = (NMRReal) cos(Angle);
+		Kernel[2*k + 1] = (NMRReal) sin(Angle);
+	}
+	for (n = 1; n < DataLength; n++) {
+		Angle = 2*M_PI*fmod(0.5*Step*n*n, 1.0);
+		Kernel[2*(Length - n) + 0] = (NMRReal) cos(Angle);
+		Kernel[2*(Length - n) + 1] = (NMRReal) sin(Angle);
+	}
+	
+	DFTPlan = GetDFTPlan(NMRDataStruct, (int) Length, 1, 0, Chirped, Chirped);
+	DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) Chirped, (DFT_FFTW(complex) *) Chirped);
+	DFTPlan = GetDFTPlan(NMRDataStruct, (int) Length, 1, 0, Kernel, Kernel);
+	DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) Kernel, (DFT_FFTW(complex) *) Kernel);
+	
+	/** Conjugated product of the transforms **/
+	for (n = 0; n < Length; n++) {
+		Re = (double) Chirped[2*n + 0]*Kernel[2*n + 0] - (double) Chirped[2*n + 1]*Kernel[2*n + 1];
+		Im = (double) Chirped[2*n + 0]*Kernel[2*n + 1] + (double) Chirped[2*n + 1]*Kernel[2*n + 0];
+		Chirped[2*n + 0] = (NMRReal) Re;
+		Chirped[2*n + 1] = (NMRReal) (- Im);
+	}
+	
+	DFTPlan = GetDFTPlan(NMRDataStruct, (int) Length, 1, 0, Chirped, Chirped);
+	DFT_FFTW(execute_dft)(DFTPlan, (DFT_FFTW(complex) *) Chirped, (DFT_FFTW(complex) *) Chirped);
+	
+	for (k = 0; k < Count; k++) {
+		/** conjugating back, normalizing and multiplying by w(k) **/
+		Re = Chirped[2*k + 0] / (double) Length;
+		Im = - Chirped[2*k + 1] / (double) Length;
+		
+		Angle = - 2*M_PI*fmod(0.5*Step*k*k, 1.0);
+		Output[2*k + 0] = Re*cos(Angle) - Im*sin(Angle);
+		Output[2*k + 1] = Re*sin(Angle) + Im*cos(Angle);
+	}
+	
+	/** Phase correction and offset removal **/
+	if ((DFTPhaseCorr0(NMRDataStruct, StepNo) != 0) || (DFTPhaseCorr1Relative(NMRDataStruct, StepNo) != 0)) {
+		for (k = 0; k < Count; k++) {
+			Angle = M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, StepNo) + 2*M_PI*0.001*DFTPhaseCorr1Relative(NMRDataStruct, StepNo)*(Start + k*Step)*(NMRDataStruct->SWMh);
+			Re = Output[2*k + 0];
+			Im = Output[2*k + 1];
+			Output[2*k + 0] = cos(Angle)*Re - sin(Angle)*Im;
+			Output[2*k + 1] = cos(Angle)*Im + sin(Angle)*Re;
+		}
+	}
+	
+	if (NMRDataStruct->RemoveOffset) {
+		ReCoef = cos(M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, StepNo))*(0.5 + 0.001*DFTPhaseCorr1Relative(NMRDataStruct, StepNo)*(NMRDataStruct->SWMh));
+		ImCoef = sin(M_PI/180.0*0.001*DFTPhaseCorr0(NMRDataStruct, StepNo))*(0.5 + 0.001*DFTPhaseCorr1Relative(NMRDataStruct, StepNo)*(NMRDataStruct->SWMh));
+		
+		ReOffset = ReCoef*First[0] - ImCoef*First[1];
+		ImOffset = ReCoef*First[1] + ImCoef*First[0];
+		
+		for (k = 0; k < Count; k++) {
+			Output[2*k + 0] -= ReOffset;
+			Output[2*k + 1] -= ImOffset;
 		}
 	}
 	
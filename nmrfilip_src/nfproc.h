@@ -22,15 +22,164 @@
 #define __nfproc_h__
 
 #include "nmrfilipcmn.h"
+#include "fftw3.h"
+
+/** Chunk pattern considered by GetChunkSet **/
+typedef struct {
+	intptr_t Offset;
+	size_t Length;	/** in 2x long (Re, Im) (8 B) **/
+	size_t DataLength;
+	size_t Count;
+	intptr_t Start;
+	size_t FalseNegative;
+	size_t FalsePositive;
+	size_t Next;	/** next pattern in the same bucket of the pattern index, PATTERN_INDEX_NONE if last **/
+} SignalPattern;
+
+#define PATTERN_INDEX_NONE	SIZE_MAX
+
+/** The FFTW interface matching the precision of the DFT data (NMRReal) **/
+#if SINGLE_PRECISION
+#define DFT_FFTW(name)	FFTW_MANGLE_FLOAT(name)
+#else
+#define DFT_FFTW(name)	FFTW_MANGLE_DOUBLE(name)
+#endif
+
+/** DFT plan kept for reuse, the plan may be executed on any arrays with the same alignment **/
+typedef struct {
+	DFT_FFTW(plan) Plan;	/** NULL if the entry is free **/
+	int Length;
+	int Count;
+	unsigned char Interleaved;	/** the output points of the transforms are interleaved rather than stored one after another **/
+	unsigned char InPlace;	/** the plan transforms the data in place (Input == Output) **/
+	int InputAlignment;
+	int OutputAlignment;
+	unsigned int Flags;	/** FFTW planner flags **/
+	int Threads;	/** number of threads the plan is executed with **/
+	unsigned long LastUse;
+} DFTPlanCacheEntry;
+
+#define DFT_PLAN_CACHE_SIZE	8
+
+/** Apodization window of the processed part of the chunk average (including the first point scaling) kept for the processed length and parameters it was computed for **/
+typedef struct {
+	double *Coefs;	/** Length window coefficients **/
+	size_t Length;
+	unsigned char Apodization;
+	long ApodizationParam;
+	double SWMh;
+	unsigned char ScaleFirstTDPoint;
+} DFTWindowCacheEntry;
+
+/** DFT plans and auxiliary data kept by each dataset (NMRData.DFTCache) between the transforms **/
+typedef struct {
+	/** DFT plans, created and destroyed under the DFT planner lock **/
+	DFTPlanCacheEntry Plans[DFT_PLAN_CACHE_SIZE];
+	unsigned long PlanClock;
+	
+	/** Twiddle factors exp(-2*pi*i*k/TwiddleLength) of the input-pruned DFT and the downconversion **/
+	double *Twiddles;
+	size_t TwiddleLength;
+	
+	/** Input of the input-pruned DFT of a single step, the other transforms are done in place **/
+	NMRReal *Scratch;
+	size_t ScratchLength;	/** in 2x NMRReal (Re, Im) **/
+	
+	/** Apodization window of the DFT input **/
+	DFTWindowCacheEntry Window;
+	
+	/** Half of the symmetric low-pass filter of the downconversion (DownconvertHalfLength + 1 taps), cut off at half of the decimated band **/
+	double *DownconvertFilter;
+	size_t DownconvertRatio;
+	size_t DownconvertHalfLength;
+} DFTCacheData;
+
+extern char *DFTWisdomFile;
+extern unsigned char ChunkPeriodEstimate;
+#if FFTW_THREADS
+extern int DFTThreadsReady;
+#endif
+
+#define DFT_LENGTH_MAX_TOLERANCE	100	/** in %, the largest DFTLengthTolerance accepted **/
+
+#define DFT_PRUNE_MIN_RATIO	16	/** the input-pruned DFT is used if the DFT length is at least this multiple of the sub-transform length **/
+
+#define DFT_KAISER_MAX_SHAPE	700.0	/** larger shape parameters of the Kaiser window are reduced to this one, I0 would overflow **/
+
+#define DFT_DOWNCONVERT_MIN_RATIO	8	/** the downconversion is used if the DFT length is at least this multiple of the decimated transform length **/
+#define DFT_DOWNCONVERT_OVERSAMPLING	2	/** minimal ratio of the decimated transform length to the width of the filtered band **/
+#define DFT_DOWNCONVERT_ATTENUATION	140.0	/** stopband attenuation of the decimation low-pass filter in dB, i.e. 1e-7 relative error of the filtered band **/
+
+#define DFT_MEMORY_BUDGET_UNIT	1048576	/** DFTMemoryBudget is given in MiB **/
+#define DFT_SCRATCH_DIR	"/var/tmp"	/** directory of the DFT scratch files unless TMPDIR is set (/tmp often resides in memory) **/
+#define DFT_SCRATCH_NAME	"nmrfilip-dft-XXXXXX"
+
+#define DFT_PARALLEL_MIN_POINTS	262144	/** minimal number of points (in all transforms) per thread worth running the DFT in parallel for **/
+
+#define ECHO_PEAK_NORM_SHIFT	40	/** points with the norm within 2^-40 of the maximal one are compared by their amplitude **/
+
+#define CHUNK_PERIOD_CONFIRM_DISTANCE	2	/** the estimated period of the chunks is confirmed by the patterns of the chunk pairs up to this many chunks apart **/
+
+#define PARALLEL_MIN_POINTS	4194304	/** minimal number of points (in all steps) per thread worth starting the threads for **/
 
 int GetChunkSet(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
 int FreeChunkSet(NMRData *NMRDataStruct);
+int FreeChunkMask(NMRData *NMRDataStruct);
+void OrStepRangeIntoMask(NMRData *NMRDataStruct, size_t FirstStep, size_t EndStep, int32_t *Mask);
+unsigned int GetProcThreadCount(NMRData *NMRDataStruct);
+#if THREADS
+void *OrMaskThread(void *Arg);
+#endif
+void OrStepsIntoMask(NMRData *NMRDataStruct, size_t FirstStep, int32_t *Mask, size_t MaxLength);
+int ChunkSetIsPeriodic(NMRData *NMRDataStruct);
+int CompareSize(const void *Val1, const void *Val2);
+size_t EstimateChunkPeriod(NMRData *NMRDataStruct);
+int SearchSignalPattern(NMRData *NMRDataStruct, const size_t *NonZero, size_t MaxLength, size_t MaxDistance, SignalPattern *Result);
+size_t HashSignalPattern(const SignalPattern *Pattern);
+void IndexSignalPatterns(SignalPattern *Patterns, size_t PatternCount, size_t *Buckets, size_t BucketCount);
+void AddSignalPattern(SignalPattern *Patterns, size_t *PatternCount, size_t *Buckets, size_t BucketCount, const SignalPattern *Pattern, size_t *MaxCount);
+void ScoreSignalPattern(SignalPattern *Pattern, const size_t *NonZero, size_t MaxLength);
+int GetChunkRawData(NMRData *NMRDataStruct, size_t StepNo);
 int GetEchoPeaksEnvelope(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
+double FindEchoPeakInt32(const int32_t *Data, size_t Count, size_t *Peak);
+double FindEchoPeakFloat64(const double *Data, size_t Count, size_t *Peak);
 int GetChunkAvg(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
+int GetChunkSums(NMRData *NMRDataStruct, size_t StepNo);
+void FreeChunkSums(NMRData *NMRDataStruct, long StepNo);
+unsigned int GetDFTPlannerFlags(NMRData *NMRDataStruct);
+DFT_FFTW(plan) GetDFTPlan(NMRData *NMRDataStruct, int Length, int Count, unsigned char Interleaved, NMRReal *Input, NMRReal *Output);
+int GetDFTThreadCount(NMRData *NMRDataStruct, int Length, int Count);
+void LockDFTPlanner(void);
+void UnlockDFTPlanner(void);
+DFTCacheData *GetDFTCache(NMRData *NMRDataStruct);
+void FreeDFTCache(NMRData *NMRDataStruct);
+unsigned char GetDFTSpill(NMRData *NMRDataStruct);
+size_t GetDFTBatchSteps(NMRData *NMRDataStruct);
+void *AllocDFTSpace(size_t Size, unsigned char Aligned, unsigned char Spilled);
+void FreeDFTSpace(void *Space, unsigned char Aligned, unsigned char Spilled);
+void ReleaseDFTSpace(void *Start, size_t Size);
+int AllocDFTResult(NMRData *NMRDataStruct);
+double GetDFTWindowPoint(NMRData *NMRDataStruct, size_t Index, size_t Length);
+int GetDFTWindow(NMRData *NMRDataStruct, size_t Length);
+void PrepareDFTInput(NMRData *NMRDataStruct, long StepNo);
+void SetDFTInputFirst(NMRData *NMRDataStruct, long StepNo);
+size_t GetPrunedDFTLength(NMRData *NMRDataStruct, size_t DataLength);
+int GetDFTTwiddles(NMRData *NMRDataStruct);
+void ReverseDFTPoints(NMRReal *Data, size_t Count);
+void ShiftDFTOutput(NMRReal *Data, size_t Length);
+int GetDFTScratch(NMRData *NMRDataStruct, size_t Length);
+int GetPrunedDFTResult(NMRData *NMRDataStruct, size_t StepNo, size_t SubLength);
+size_t GetDownconvertedDFTLength(NMRData *NMRDataStruct);
+double BesselI0(double x);
+int GetDownconvertFilter(NMRData *NMRDataStruct, size_t Ratio, size_t HalfLength);
+int GetDownconvertedDFTResult(NMRData *NMRDataStruct, size_t StepNo, size_t SubLength);
 int GetDFTResult(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
 int FreeDFTResult(NMRData *NMRDataStruct);
 int GetDFTPhaseCorrPrep(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
 int GetDFTPhaseCorr(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
+size_t GetDFTFriendlyLength(size_t MinLength);
+size_t GetRoundedDFTLength(NMRData *NMRDataStruct, size_t Length);
+int GetDFTZoomResult(NMRData *NMRDataStruct, size_t StepNo, double FreqStart, double FreqEnd, size_t Count, double *Output);
 int CompareDouble(const void * dVal1, const void * dVal2);
 int GetDFTEnvelope(NMRData *NMRDataStruct, long StepNo, unsigned long Components);
 int FreeDFTEnvelope(NMRData *NMRDataStruct);
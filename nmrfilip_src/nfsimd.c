@@ -0,0 +1,824 @@
+/* 
+ * NMRFilip LIB - the NMR data processing software - core library
+ * Copyright (C) 2026 NMRFilip contributors
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include "nmrfilip.h"
+
+#include "nfsimd.h"
+
+#if SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if THREADS
+#include <pthread.h>
+#endif
+
+
+/** The kernels used by the dispatching functions, the portable ones until InitSIMDDispatch selects the best supported ones **/
+typedef struct {
+	SwapInt32Func SwapInt32;
+	SwapFloat64Func SwapFloat64;
+	OrMaskInt32Func OrMaskInt32;
+	OrMaskFloat64Func OrMaskFloat64;
+	AccumulateInt32Func AccumulateInt32;
+	AccumulateInt32Int64Func AccumulateInt32Int64;
+	MaxNormInt32Func MaxNormInt32;
+	FindNormInt32Func FindNormInt32;
+	MaxNormFloat64Func MaxNormFloat64;
+	FindNormFloat64Func FindNormFloat64;
+	WindowFloat64Func WindowFloat64;
+	WindowFloat32Func WindowFloat32;
+} SIMDDispatchTable;
+
+static SIMDDispatchTable SIMDDispatch = {
+	SwapInt32Portable, SwapFloat64Portable, OrMaskInt32Portable, OrMaskFloat64Portable, 
+	AccumulateInt32Portable, AccumulateInt32Int64Portable, MaxNormInt32Portable, FindNormInt32Portable, 
+	MaxNormFloat64Portable, FindNormFloat64Portable, WindowFloat64Portable, WindowFloat32Portable
+};
+
+
+int HostIsBigEndian(void) {
+	const uint32_t ByteOrderProbe = 1;
+	
+	return (*((const unsigned char *) &ByteOrderProbe) == 0);
+}
+
+
+/** Byte order conversion of 32-bit words, Dest may be equal to Src **/
+
+void SwapInt32Portable(int32_t *Dest, const unsigned char *Src, size_t Count) {
+	size_t i = 0;
+	uint32_t Word = 0;
+	
+	for (i = 0; i < Count; i++) {
+		memcpy(&Word, Src + 4*i, sizeof(uint32_t));
+		Word = (Word >> 24) | ((Word >> 8) & 0x0000FF00ul) | ((Word << 8) & 0x00FF0000ul) | (Word << 24);
+		Dest[i] = (int32_t) Word;
+	}
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void SwapInt32SSE2(int32_t *Dest, const unsigned char *Src, size_t Count) {
+	size_t i = 0;
+	__m128i x;
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		x = _mm_loadu_si128((const __m128i *) (Src + 4*i));
+		/** swap bytes within 16-bit words, then swap the words **/
+		x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+		x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_si128((__m128i *) (Dest + i), x);
+	}
+	
+	SwapInt32Portable(Dest + i, Src + 4*i, Count - i);
+}
+
+__attribute__((target("avx2")))
+void SwapInt32AVX2(int32_t *Dest, const unsigned char *Src, size_t Count) {
+	size_t i = 0;
+	__m256i x;
+	const __m256i Mask = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	
+	for (i = 0; i + 8 <= Count; i += 8) {
+		x = _mm256_loadu_si256((const __m256i *) (Src + 4*i));
+		x = _mm256_shuffle_epi8(x, Mask);
+		_mm256_storeu_si256((__m256i *) (Dest + i), x);
+	}
+	
+	SwapInt32Portable(Dest + i, Src + 4*i, Count - i);
+}
+#endif
+
+
+/** Byte order conversion of 64-bit words, Dest may be equal to Src **/
+
+void SwapFloat64Portable(double *Dest, const unsigned char *Src, size_t Count) {
+	size_t i = 0;
+	uint64_t Word = 0;
+	
+	for (i = 0; i < Count; i++) {
+		memcpy(&Word, Src + 8*i, sizeof(uint64_t));
+		Word = 	((Word >> 56) & 0x00000000000000FFull) | ((Word >> 40) & 0x000000000000FF00ull) | 
+			((Word >> 24) & 0x0000000000FF0000ull) | ((Word >> 8) & 0x00000000FF000000ull) | 
+			((Word << 8) & 0x000000FF00000000ull) | ((Word << 24) & 0x0000FF0000000000ull) | 
+			((Word << 40) & 0x00FF000000000000ull) | ((Word << 56) & 0xFF00000000000000ull);
+		memcpy(Dest + i, &Word, sizeof(uint64_t));
+	}
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void SwapFloat64SSE2(double *Dest, const unsigned char *Src, size_t Count) {
+	size_t i = 0;
+	__m128i x;
+	
+	for (i = 0; i + 2 <= Count; i += 2) {
+		x = _mm_loadu_si128((const __m128i *) (Src + 8*i));
+		/** swap bytes within 16-bit words, then reverse the order of the words **/
+		x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+		x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+		x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+		_mm_storeu_si128((__m128i *) (Dest + i), x);
+	}
+	
+	SwapFloat64Portable(Dest + i, Src + 8*i, Count - i);
+}
+
+__attribute__((target("avx2")))
+void SwapFloat64AVX2(double *Dest, const unsigned char *Src, size_t Count) {
+	size_t i = 0;
+	__m256i x;
+	const __m256i Mask = _mm256_setr_epi8(
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 
+		7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		x = _mm256_loadu_si256((const __m256i *) (Src + 8*i));
+		x = _mm256_shuffle_epi8(x, Mask);
+		_mm256_storeu_si256((__m256i *) (Dest + i), x);
+	}
+	
+	SwapFloat64Portable(Dest + i, Src + 8*i, Count - i);
+}
+#endif
+
+
+SwapInt32Func SelectSwapInt32(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return SwapInt32AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return SwapInt32SSE2;
+#endif
+	
+	return SwapInt32Portable;
+}
+
+SwapFloat64Func SelectSwapFloat64(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return SwapFloat64AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return SwapFloat64SSE2;
+#endif
+	
+	return SwapFloat64Portable;
+}
+
+
+/** Converts Count 32-bit integers stored in the given byte order to the host byte order, Dest may be equal to Src **/
+void DecodeInt32(int32_t *Dest, const unsigned char *Src, size_t Count, int BigEndian) {
+	
+	if ((BigEndian != 0) == HostIsBigEndian()) {
+		if ((const unsigned char *) Dest != Src)
+			memmove(Dest, Src, Count*sizeof(int32_t));
+		return;
+	}
+	
+	SIMDDispatch.SwapInt32(Dest, Src, Count);
+}
+
+
+/** Converts Count 64-bit floating point numbers stored in the given byte order to the host byte order, Dest may be equal to Src **/
+void DecodeFloat64(double *Dest, const unsigned char *Src, size_t Count, int BigEndian) {
+	
+	if ((BigEndian != 0) == HostIsBigEndian()) {
+		if ((const unsigned char *) Dest != Src)
+			memmove(Dest, Src, Count*sizeof(double));
+		return;
+	}
+	
+	SIMDDispatch.SwapFloat64(Dest, Src, Count);
+}
+
+
+/** OR-ing of Count complex points (Re, Im) into the mask of non-zero points: Mask[i] |= Re | Im **/
+
+void OrMaskInt32Portable(int32_t *Mask, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		Mask[i] |= Data[2*i] | Data[2*i + 1];
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void OrMaskInt32SSE2(int32_t *Mask, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	__m128 a, b;
+	__m128i x;
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		a = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (Data + 2*i)));
+		b = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *) (Data + 2*i + 4)));
+		/** real parts OR-ed with imaginary parts **/
+		x = _mm_or_si128(_mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+		_mm_storeu_si128((__m128i *) (Mask + i), _mm_or_si128(_mm_loadu_si128((const __m128i *) (Mask + i)), x));
+	}
+	
+	OrMaskInt32Portable(Mask + i, Data + 2*i, Count - i);
+}
+
+__attribute__((target("avx2")))
+void OrMaskInt32AVX2(int32_t *Mask, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	__m256 a, b;
+	__m256i x;
+	
+	for (i = 0; i + 8 <= Count; i += 8) {
+		a = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (Data + 2*i)));
+		b = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *) (Data + 2*i + 8)));
+		/** the shuffles work within 128-bit lanes, the points 0, 1, 4, 5, 2, 3, 6, 7 get in order by the permutation **/
+		x = _mm256_or_si256(_mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), _mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))));
+		x = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *) (Mask + i), _mm256_or_si256(_mm256_loadu_si256((const __m256i *) (Mask + i)), x));
+	}
+	
+	OrMaskInt32Portable(Mask + i, Data + 2*i, Count - i);
+}
+#endif
+
+
+/** Marking of Count complex points (Re, Im) with a non-zero part in the mask: Mask[i] |= ((Re != 0.0) || (Im != 0.0)) **/
+
+void OrMaskFloat64Portable(int32_t *Mask, const double *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		Mask[i] |= ((Data[2*i] != 0.0) || (Data[2*i + 1] != 0.0));
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void OrMaskFloat64SSE2(int32_t *Mask, const double *Data, size_t Count) {
+	size_t i = 0;
+	const __m128d Zero = _mm_setzero_pd();
+	
+	/** the unordered comparison treats NaN as non-zero like the != operator **/
+	for (i = 0; i < Count; i++) 
+		Mask[i] |= (_mm_movemask_pd(_mm_cmpneq_pd(_mm_loadu_pd(Data + 2*i), Zero)) != 0);
+}
+
+__attribute__((target("avx2")))
+void OrMaskFloat64AVX2(int32_t *Mask, const double *Data, size_t Count) {
+	size_t i = 0;
+	int Bits = 0;
+	const __m256d Zero = _mm256_setzero_pd();
+	
+	for (i = 0; i + 2 <= Count; i += 2) {
+		Bits = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(Data + 2*i), Zero, _CMP_NEQ_UQ));
+		Mask[i] |= ((Bits & 0x3) != 0);
+		Mask[i + 1] |= ((Bits & 0xC) != 0);
+	}
+	
+	OrMaskFloat64Portable(Mask + i, Data + 2*i, Count - i);
+}
+#endif
+
+
+OrMaskInt32Func SelectOrMaskInt32(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return OrMaskInt32AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return OrMaskInt32SSE2;
+#endif
+	
+	return OrMaskInt32Portable;
+}
+
+OrMaskFloat64Func SelectOrMaskFloat64(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return OrMaskFloat64AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return OrMaskFloat64SSE2;
+#endif
+	
+	return OrMaskFloat64Portable;
+}
+
+
+void OrMaskInt32(int32_t *Mask, const int32_t *Data, size_t Count) {
+	SIMDDispatch.OrMaskInt32(Mask, Data, Count);
+}
+
+void OrMaskFloat64(int32_t *Mask, const double *Data, size_t Count) {
+	SIMDDispatch.OrMaskFloat64(Mask, Data, Count);
+}
+
+
+/** Widening accumulation of Count 32-bit integers: Sum[i] += (double) Data[i], the rounding is the same as with the scalar additions **/
+
+void AccumulateInt32Portable(double *Sum, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		Sum[i] += (double) Data[i];
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void AccumulateInt32SSE2(double *Sum, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i + 2 <= Count; i += 2) 
+		_mm_storeu_pd(Sum + i, _mm_add_pd(_mm_loadu_pd(Sum + i), _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *) (Data + i)))));
+	
+	AccumulateInt32Portable(Sum + i, Data + i, Count - i);
+}
+
+__attribute__((target("avx2")))
+void AccumulateInt32AVX2(double *Sum, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i + 4 <= Count; i += 4) 
+		_mm256_storeu_pd(Sum + i, _mm256_add_pd(_mm256_loadu_pd(Sum + i), _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *) (Data + i)))));
+	
+	AccumulateInt32Portable(Sum + i, Data + i, Count - i);
+}
+#endif
+
+
+/** Widening accumulation of Count 32-bit integers: Sum[i] += (int64_t) Data[i] **/
+
+void AccumulateInt32Int64Portable(int64_t *Sum, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		Sum[i] += Data[i];
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void AccumulateInt32Int64SSE2(int64_t *Sum, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	__m128i x, s;
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		x = _mm_loadu_si128((const __m128i *) (Data + i));
+		/** sign extension by interleaving with the sign words **/
+		s = _mm_srai_epi32(x, 31);
+		_mm_storeu_si128((__m128i *) (Sum + i), _mm_add_epi64(_mm_loadu_si128((const __m128i *) (Sum + i)), _mm_unpacklo_epi32(x, s)));
+		_mm_storeu_si128((__m128i *) (Sum + i + 2), _mm_add_epi64(_mm_loadu_si128((const __m128i *) (Sum + i + 2)), _mm_unpackhi_epi32(x, s)));
+	}
+	
+	AccumulateInt32Int64Portable(Sum + i, Data + i, Count - i);
+}
+
+__attribute__((target("avx2")))
+void AccumulateInt32Int64AVX2(int64_t *Sum, const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i + 4 <= Count; i += 4) 
+		_mm256_storeu_si256((__m256i *) (Sum + i), _mm256_add_epi64(_mm256_loadu_si256((const __m256i *) (Sum + i)), _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *) (Data + i)))));
+	
+	AccumulateInt32Int64Portable(Sum + i, Data + i, Count - i);
+}
+#endif
+
+
+/** Squared magnitude (norm) of Count complex points (Re, Im) - the maximum and the first point reaching a threshold; 
+    the integer norm is exact (at most 2^63), NaN points are skipped in the floating point case **/
+
+uint64_t MaxNormInt32Portable(const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	uint64_t Norm = 0;
+	uint64_t Max = 0;
+	
+	for (i = 0; i < Count; i++) {
+		Norm = (uint64_t) ((int64_t) Data[2*i]*Data[2*i]) + (uint64_t) ((int64_t) Data[2*i + 1]*Data[2*i + 1]);
+		if (Norm > Max)
+			Max = Norm;
+	}
+	
+	return Max;
+}
+
+size_t FindNormInt32Portable(const int32_t *Data, size_t Count, uint64_t Threshold) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		if ((uint64_t) ((int64_t) Data[2*i]*Data[2*i]) + (uint64_t) ((int64_t) Data[2*i + 1]*Data[2*i + 1]) >= Threshold)
+			break;
+	
+	return i;
+}
+
+double MaxNormFloat64Portable(const double *Data, size_t Count) {
+	size_t i = 0;
+	double Norm = 0.0;
+	double Max = 0.0;
+	
+	for (i = 0; i < Count; i++) {
+		Norm = Data[2*i]*Data[2*i] + Data[2*i + 1]*Data[2*i + 1];
+		if (Norm > Max)
+			Max = Norm;
+	}
+	
+	return Max;
+}
+
+size_t FindNormFloat64Portable(const double *Data, size_t Count, double Threshold) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		if (Data[2*i]*Data[2*i] + Data[2*i + 1]*Data[2*i + 1] >= Threshold)
+			break;
+	
+	return i;
+}
+
+#if SIMD_X86
+/** Norms of 4 points (Re, Im), biased by 2^63 so that the signed comparison orders them as unsigned **/
+__attribute__((target("avx2")))
+__m256i NormInt32AVX2(const int32_t *Data) {
+	const __m256i Bias = _mm256_set1_epi64x((long long) 0x8000000000000000ull);
+	__m256i x = _mm256_loadu_si256((const __m256i *) Data);
+	__m256i y = _mm256_srli_epi64(x, 32);
+	
+	return _mm256_xor_si256(_mm256_add_epi64(_mm256_mul_epi32(x, x), _mm256_mul_epi32(y, y)), Bias);
+}
+
+__attribute__((target("avx2")))
+uint64_t MaxNormInt32AVX2(const int32_t *Data, size_t Count) {
+	size_t i = 0;
+	uint64_t Lanes[4];
+	uint64_t Max = 0;
+	__m256i Norm;
+	__m256i MaxNorm = _mm256_set1_epi64x((long long) 0x8000000000000000ull);
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		Norm = NormInt32AVX2(Data + 2*i);
+		MaxNorm = _mm256_blendv_epi8(MaxNorm, Norm, _mm256_cmpgt_epi64(Norm, MaxNorm));
+	}
+	
+	_mm256_storeu_si256((__m256i *) Lanes, MaxNorm);
+	Max = MaxNormInt32Portable(Data + 2*i, Count - i);
+	for (i = 0; i < 4; i++) 
+		if ((Lanes[i] ^ 0x8000000000000000ull) > Max)
+			Max = Lanes[i] ^ 0x8000000000000000ull;
+	
+	return Max;
+}
+
+__attribute__((target("avx2")))
+size_t FindNormInt32AVX2(const int32_t *Data, size_t Count, uint64_t Threshold) {
+	size_t i = 0;
+	int Below = 0;
+	const __m256i Limit = _mm256_set1_epi64x((long long) (Threshold ^ 0x8000000000000000ull));
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		Below = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(Limit, NormInt32AVX2(Data + 2*i))));
+		if (Below != 0xF)
+			return i + __builtin_ctz(~Below);
+	}
+	
+	return i + FindNormInt32Portable(Data + 2*i, Count - i, Threshold);
+}
+
+/** Norms of 2 points (Re, Im), each in both of its lanes **/
+__attribute__((target("avx2")))
+__m256d NormFloat64AVX2(const double *Data) {
+	__m256d x = _mm256_loadu_pd(Data);
+	
+	x = _mm256_mul_pd(x, x);
+	return _mm256_hadd_pd(x, x);
+}
+
+__attribute__((target("avx2")))
+double MaxNormFloat64AVX2(const double *Data, size_t Count) {
+	size_t i = 0;
+	double Lanes[4];
+	double Max = 0.0;
+	__m256d MaxNorm = _mm256_setzero_pd();
+	
+	/** the maximum yields its second operand if either is NaN **/
+	for (i = 0; i + 2 <= Count; i += 2) 
+		MaxNorm = _mm256_max_pd(NormFloat64AVX2(Data + 2*i), MaxNorm);
+	
+	_mm256_storeu_pd(Lanes, MaxNorm);
+	Max = MaxNormFloat64Portable(Data + 2*i, Count - i);
+	for (i = 0; i < 4; i++) 
+		if (Lanes[i] > Max)
+			Max = Lanes[i];
+	
+	return Max;
+}
+
+__attribute__((target("avx2")))
+size_t FindNormFloat64AVX2(const double *Data, size_t Count, double Threshold) {
+	size_t i = 0;
+	int Above = 0;
+	const __m256d Limit = _mm256_set1_pd(Threshold);
+	
+	for (i = 0; i + 2 <= Count; i += 2) {
+		Above = _mm256_movemask_pd(_mm256_cmp_pd(NormFloat64AVX2(Data + 2*i), Limit, _CMP_GE_OQ));
+		if (Above & 0x3)
+			return i;
+		if (Above & 0xC)
+			return i + 1;
+	}
+	
+	return i + FindNormFloat64Portable(Data + 2*i, Count - i, Threshold);
+}
+#endif
+
+
+/** Amplitudes of Count complex points (Re, Im): Amp[i] = hypot(Re, Im); 
+    the square root of the norm would be cheaper and vectorizable, but it may differ from hypot in the last bit, 
+    the batch saves just the per-point access through the data macros **/
+
+void AmplitudeFloat64(double *Amp, const double *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		Amp[i] = hypot(Data[2*i], Data[2*i + 1]);
+}
+
+/** Amplitudes of Count single-precision complex points (Re, Im): Amp[i] = hypot(Re, Im) evaluated in double precision **/
+void AmplitudeFloat32(float *Amp, const float *Data, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		Amp[i] = (float) hypot(Data[2*i], Data[2*i + 1]);
+}
+
+
+/** Multiplication of Count complex points (Re, Im) by the real window: Dest[i] = Window[i]*(Re, Im), Dest must not overlap Data **/
+
+void WindowFloat64Portable(double *Dest, const double *Data, const double *Window, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) {
+		Dest[2*i] = Window[i]*Data[2*i];
+		Dest[2*i + 1] = Window[i]*Data[2*i + 1];
+	}
+}
+
+#if SIMD_X86
+__attribute__((target("sse2")))
+void WindowFloat64SSE2(double *Dest, const double *Data, const double *Window, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) 
+		_mm_storeu_pd(Dest + 2*i, _mm_mul_pd(_mm_load1_pd(Window + i), _mm_loadu_pd(Data + 2*i)));
+}
+
+__attribute__((target("avx2")))
+void WindowFloat64AVX2(double *Dest, const double *Data, const double *Window, size_t Count) {
+	size_t i = 0;
+	__m256d w;
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		w = _mm256_loadu_pd(Window + i);
+		/** each window value repeated for both parts of the point **/
+		_mm256_storeu_pd(Dest + 2*i, _mm256_mul_pd(_mm256_permute4x64_pd(w, _MM_SHUFFLE(1, 1, 0, 0)), _mm256_loadu_pd(Data + 2*i)));
+		_mm256_storeu_pd(Dest + 2*i + 4, _mm256_mul_pd(_mm256_permute4x64_pd(w, _MM_SHUFFLE(3, 3, 2, 2)), _mm256_loadu_pd(Data + 2*i + 4)));
+	}
+	
+	WindowFloat64Portable(Dest + 2*i, Data + 2*i, Window + i, Count - i);
+}
+#endif
+
+
+/** Multiplication of Count complex points (Re, Im) by the real window with the conversion to single precision: Dest[i] = Window[i]*(Re, Im) **/
+
+void WindowFloat32Portable(float *Dest, const double *Data, const double *Window, size_t Count) {
+	size_t i = 0;
+	
+	for (i = 0; i < Count; i++) {
+		Dest[2*i] = (float) (Window[i]*Data[2*i]);
+		Dest[2*i + 1] = (float) (Window[i]*Data[2*i + 1]);
+	}
+}
+
+#if SIMD_X86
+__attribute__((target("avx2")))
+void WindowFloat32AVX2(float *Dest, const double *Data, const double *Window, size_t Count) {
+	size_t i = 0;
+	__m256d w;
+	
+	for (i = 0; i + 4 <= Count; i += 4) {
+		w = _mm256_loadu_pd(Window + i);
+		_mm_storeu_ps(Dest + 2*i, _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_permute4x64_pd(w, _MM_SHUFFLE(1, 1, 0, 0)), _mm256_loadu_pd(Data + 2*i))));
+		_mm_storeu_ps(Dest + 2*i + 4, _mm256_cvtpd_ps(_mm256_mul_pd(_mm256_permute4x64_pd(w, _MM_SHUFFLE(3, 3, 2, 2)), _mm256_loadu_pd(Data + 2*i + 4))));
+	}
+	
+	WindowFloat32Portable(Dest + 2*i, Data + 2*i, Window + i, Count - i);
+}
+#endif
+
+
+AccumulateInt32Func SelectAccumulateInt32(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return AccumulateInt32AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return AccumulateInt32SSE2;
+#endif
+	
+	return AccumulateInt32Portable;
+}
+
+AccumulateInt32Int64Func SelectAccumulateInt32Int64(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return AccumulateInt32Int64AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return AccumulateInt32Int64SSE2;
+#endif
+	
+	return AccumulateInt32Int64Portable;
+}
+
+MaxNormInt32Func SelectMaxNormInt32(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return MaxNormInt32AVX2;
+#endif
+	
+	return MaxNormInt32Portable;
+}
+
+FindNormInt32Func SelectFindNormInt32(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return FindNormInt32AVX2;
+#endif
+	
+	return FindNormInt32Portable;
+}
+
+MaxNormFloat64Func SelectMaxNormFloat64(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return MaxNormFloat64AVX2;
+#endif
+	
+	return MaxNormFloat64Portable;
+}
+
+FindNormFloat64Func SelectFindNormFloat64(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return FindNormFloat64AVX2;
+#endif
+	
+	return FindNormFloat64Portable;
+}
+
+WindowFloat64Func SelectWindowFloat64(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return WindowFloat64AVX2;
+	
+	if (__builtin_cpu_supports("sse2"))
+		return WindowFloat64SSE2;
+#endif
+	
+	return WindowFloat64Portable;
+}
+
+WindowFloat32Func SelectWindowFloat32(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	
+	if (__builtin_cpu_supports("avx2"))
+		return WindowFloat32AVX2;
+#endif
+	
+	return WindowFloat32Portable;
+}
+
+
+static void SelectSIMDDispatch(void) {
+	
+	SIMDDispatch.SwapInt32 = SelectSwapInt32();
+	SIMDDispatch.SwapFloat64 = SelectSwapFloat64();
+	SIMDDispatch.OrMaskInt32 = SelectOrMaskInt32();
+	SIMDDispatch.OrMaskFloat64 = SelectOrMaskFloat64();
+	SIMDDispatch.AccumulateInt32 = SelectAccumulateInt32();
+	SIMDDispatch.AccumulateInt32Int64 = SelectAccumulateInt32Int64();
+	SIMDDispatch.MaxNormInt32 = SelectMaxNormInt32();
+	SIMDDispatch.FindNormInt32 = SelectFindNormInt32();
+	SIMDDispatch.MaxNormFloat64 = SelectMaxNormFloat64();
+	SIMDDispatch.FindNormFloat64 = SelectFindNormFloat64();
+	SIMDDispatch.WindowFloat64 = SelectWindowFloat64();
+	SIMDDispatch.WindowFloat32 = SelectWindowFloat32();
+}
+
+/** Selects all the kernels at once, called by InitNMRData before any processing threads can start; 
+    repeated and concurrent calls are harmless, the table is written only by the first one **/
+void InitSIMDDispatch(void) {
+#if THREADS
+	static pthread_once_t Once = PTHREAD_ONCE_INIT;
+	
+	pthread_once(&Once, SelectSIMDDispatch);
+#else
+	static int Selected = 0;
+	
+	if (!Selected) {
+		SelectSIMDDispatch();
+		Selected = 1;
+	}
+#endif
+}
+
+
+/** Dispatching to the kernels selected by InitSIMDDispatch **/
+
+void AccumulateInt32(double *Sum, const int32_t *Data, size_t Count) {
+	SIMDDispatch.AccumulateInt32(Sum, Data, Count);
+}
+
+void AccumulateInt32Int64(int64_t *Sum, const int32_t *Data, size_t Count) {
+	SIMDDispatch.AccumulateInt32Int64(Sum, Data, Count);
+}
+
+uint64_t MaxNormInt32(const int32_t *Data, size_t Count) {
+	return SIMDDispatch.MaxNormInt32(Data, Count);
+}
+
+size_t FindNormInt32(const int32_t *Data, size_t Count, uint64_t Threshold) {
+	return SIMDDispatch.FindNormInt32(Data, Count, Threshold);
+}
+
+double MaxNormFloat64(const double *Data, size_t Count) {
+	return SIMDDispatch.MaxNormFloat64(Data, Count);
+}
+
+size_t FindNormFloat64(const double *Data, size_t Count, double Threshold) {
+	return SIMDDispatch.FindNormFloat64(Data, Count, Threshold);
+}
+
+/** Copies Count complex points multiplied by the window and zero-pads the result up to Length points in a single pass **/
+void WindowFloat64(double *Dest, const double *Data, const double *Window, size_t Count, size_t Length) {
+	SIMDDispatch.WindowFloat64(Dest, Data, Window, Count);
+	
+	if (Length > Count)
+		memset(Dest + 2*Count, 0, 2*(Length - Count)*sizeof(double));
+}
+
+/** Copies Count complex points multiplied by the window converted to single precision and zero-pads the result up to Length points in a single pass **/
+void WindowFloat32(float *Dest, const double *Data, const double *Window, size_t Count, size_t Length) {
+	SIMDDispatch.WindowFloat32(Dest, Data, Window, Count);
+	
+	if (Length > Count)
+		memset(Dest + 2*Count, 0, 2*(Length - Count)*sizeof(float));
+}
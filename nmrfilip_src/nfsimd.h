@@ -0,0 +1,130 @@
+/* 
+ * NMRFilip LIB - the NMR data processing software - core library
+ * Copyright (C) 2026 NMRFilip contributors
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ * 
+ */
+
+#ifndef __nfsimd_h__
+#define __nfsimd_h__
+
+#include "nmrfilipcmn.h"
+
+#if SIMD && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+/** Vectorized kernels with runtime CPU dispatch, portable code is used where no suitable instruction set is available **/
+
+void InitSIMDDispatch(void);
+int HostIsBigEndian(void);
+void DecodeInt32(int32_t *Dest, const unsigned char *Src, size_t Count, int BigEndian);
+void DecodeFloat64(double *Dest, const unsigned char *Src, size_t Count, int BigEndian);
+void OrMaskInt32(int32_t *Mask, const int32_t *Data, size_t Count);
+void OrMaskFloat64(int32_t *Mask, const double *Data, size_t Count);
+void AccumulateInt32(double *Sum, const int32_t *Data, size_t Count);
+void AccumulateInt32Int64(int64_t *Sum, const int32_t *Data, size_t Count);
+uint64_t MaxNormInt32(const int32_t *Data, size_t Count);
+size_t FindNormInt32(const int32_t *Data, size_t Count, uint64_t Threshold);
+double MaxNormFloat64(const double *Data, size_t Count);
+size_t FindNormFloat64(const double *Data, size_t Count, double Threshold);
+void AmplitudeFloat64(double *Amp, const double *Data, size_t Count);
+void AmplitudeFloat32(float *Amp, const float *Data, size_t Count);
+void WindowFloat64(double *Dest, const double *Data, const double *Window, size_t Count, size_t Length);
+void WindowFloat32(float *Dest, const double *Data, const double *Window, size_t Count, size_t Length);
+
+/** Amplitude of the DFT data of NMRReal type **/
+#if SINGLE_PRECISION
+#define AmplitudeReal	AmplitudeFloat32
+#else
+#define AmplitudeReal	AmplitudeFloat64
+#endif
+
+/** Windowed copy of the chunk average to the DFT data of NMRReal type **/
+#if SINGLE_PRECISION
+#define WindowReal	WindowFloat32
+#else
+#define WindowReal	WindowFloat64
+#endif
+
+/** Kernels of the particular instruction sets (the SSE2 and AVX2 ones may be called only if the CPU supports them, see nmrfilipcheck) **/
+typedef void (*SwapInt32Func)(int32_t *, const unsigned char *, size_t);
+typedef void (*SwapFloat64Func)(double *, const unsigned char *, size_t);
+typedef void (*OrMaskInt32Func)(int32_t *, const int32_t *, size_t);
+typedef void (*OrMaskFloat64Func)(int32_t *, const double *, size_t);
+typedef void (*AccumulateInt32Func)(double *, const int32_t *, size_t);
+typedef void (*AccumulateInt32Int64Func)(int64_t *, const int32_t *, size_t);
+typedef uint64_t (*MaxNormInt32Func)(const int32_t *, size_t);
+typedef size_t (*FindNormInt32Func)(const int32_t *, size_t, uint64_t);
+typedef double (*MaxNormFloat64Func)(const double *, size_t);
+typedef size_t (*FindNormFloat64Func)(const double *, size_t, double);
+typedef void (*WindowFloat64Func)(double *, const double *, const double *, size_t);
+typedef void (*WindowFloat32Func)(float *, const double *, const double *, size_t);
+
+void SwapInt32Portable(int32_t *Dest, const unsigned char *Src, size_t Count);
+void SwapFloat64Portable(double *Dest, const unsigned char *Src, size_t Count);
+void OrMaskInt32Portable(int32_t *Mask, const int32_t *Data, size_t Count);
+void OrMaskFloat64Portable(int32_t *Mask, const double *Data, size_t Count);
+void AccumulateInt32Portable(double *Sum, const int32_t *Data, size_t Count);
+void AccumulateInt32Int64Portable(int64_t *Sum, const int32_t *Data, size_t Count);
+uint64_t MaxNormInt32Portable(const int32_t *Data, size_t Count);
+size_t FindNormInt32Portable(const int32_t *Data, size_t Count, uint64_t Threshold);
+double MaxNormFloat64Portable(const double *Data, size_t Count);
+size_t FindNormFloat64Portable(const double *Data, size_t Count, double Threshold);
+void WindowFloat64Portable(double *Dest, const double *Data, const double *Window, size_t Count);
+void WindowFloat32Portable(float *Dest, const double *Data, const double *Window, size_t Count);
+
+#if SIMD_X86
+void SwapInt32SSE2(int32_t *Dest, const unsigned char *Src, size_t Count);
+void SwapInt32AVX2(int32_t *Dest, const unsigned char *Src, size_t Count);
+void SwapFloat64SSE2(double *Dest, const unsigned char *Src, size_t Count);
+void SwapFloat64AVX2(double *Dest, const unsigned char *Src, size_t Count);
+void OrMaskInt32SSE2(int32_t *Mask, const int32_t *Data, size_t Count);
+void OrMaskInt32AVX2(int32_t *Mask, const int32_t *Data, size_t Count);
+void OrMaskFloat64SSE2(int32_t *Mask, const double *Data, size_t Count);
+void OrMaskFloat64AVX2(int32_t *Mask, const double *Data, size_t Count);
+void AccumulateInt32SSE2(double *Sum, const int32_t *Data, size_t Count);
+void AccumulateInt32AVX2(double *Sum, const int32_t *Data, size_t Count);
+void AccumulateInt32Int64SSE2(int64_t *Sum, const int32_t *Data, size_t Count);
+void AccumulateInt32Int64AVX2(int64_t *Sum, const int32_t *Data, size_t Count);
+uint64_t MaxNormInt32AVX2(const int32_t *Data, size_t Count);
+size_t FindNormInt32AVX2(const int32_t *Data, size_t Count, uint64_t Threshold);
+double MaxNormFloat64AVX2(const double *Data, size_t Count);
+size_t FindNormFloat64AVX2(const double *Data, size_t Count, double Threshold);
+void WindowFloat64SSE2(double *Dest, const double *Data, const double *Window, size_t Count);
+void WindowFloat64AVX2(double *Dest, const double *Data, const double *Window, size_t Count);
+void WindowFloat32AVX2(float *Dest, const double *Data, const double *Window, size_t Count);
+#endif
+
+SwapInt32Func SelectSwapInt32(void);
+SwapFloat64Func SelectSwapFloat64(void);
+OrMaskInt32Func SelectOrMaskInt32(void);
+OrMaskFloat64Func SelectOrMaskFloat64(void);
+AccumulateInt32Func SelectAccumulateInt32(void);
+AccumulateInt32Int64Func SelectAccumulateInt32Int64(void);
+MaxNormInt32Func SelectMaxNormInt32(void);
+FindNormInt32Func SelectFindNormInt32(void);
+MaxNormFloat64Func SelectMaxNormFloat64(void);
+FindNormFloat64Func SelectFindNormFloat64(void);
+WindowFloat64Func SelectWindowFloat64(void);
+WindowFloat32Func SelectWindowFloat32(void);
+
+#define AMPLITUDE_NORM_MIN	0x1p-900	/** the echo peak search compares norms (Re^2 + Im^2) within these bounds directly, hypot is used otherwise **/
+#define AMPLITUDE_NORM_MAX	0x1p+1000
+
+#endif
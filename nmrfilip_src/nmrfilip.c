@@ -33,6 +33,7 @@
 #include "nfload.h"
 #include "nfproc.h"
 #include "nfexport.h"
+#include "nfsimd.h"
 
 
 typedef int (*NMRProcFunc)(NMRData *, long, unsigned long);
@@ -59,9 +60,8 @@ const NMRDataRelation NMRDataRelations[22] = {
 		Flag(CHECK_Evaluation_DFTPhaseCorrReal) | Flag(CHECK_Evaluation_DFTPhaseCorrAmp) | 
 		Flag(CHECK_EchoPeaksEnvelope) | Flag(CHECK_AcquInfo)},
 	/** CHECK_RawData **/
-	{&GetRawData, 1, CHECK_AcquParams, Flag(CHECK_RawData), Flag(CHECK_RawData) | 
-		Flag(CHECK_StepSet) | Flag(CHECK_ChunkSet) | Flag(CHECK_ChunkAvg) | 
-		Flag(CHECK_DFTResult) | 
+	{&GetRawData, 0, CHECK_StepSet, Flag(CHECK_RawData), Flag(CHECK_RawData) | 
+		Flag(CHECK_ChunkSet) | Flag(CHECK_ChunkAvg) | Flag(CHECK_DFTResult) | 
 		Flag(CHECK_DFTPhaseCorrPrep) | Flag(CHECK_DFTPhaseCorrPrep_AutoCorr) | 
 		Flag(CHECK_DFTPhaseCorrPrep_MemReIm) | Flag(CHECK_DFTPhaseCorrPrep_MemAmp) | 
 		Flag(CHECK_DFTPhaseCorr) | Flag(CHECK_DFTPhaseCorr_ReIm) | Flag(CHECK_DFTPhaseCorr_Amp) | 
@@ -70,8 +70,9 @@ const NMRDataRelation NMRDataRelations[22] = {
 		Flag(CHECK_Evaluation_DFTPhaseCorrReal) | Flag(CHECK_Evaluation_DFTPhaseCorrAmp) | 
 		Flag(CHECK_EchoPeaksEnvelope) | Flag(CHECK_AcquInfo)},
 	/** CHECK_StepSet **/
-	{&GetStepSet, 1, CHECK_RawData, Flag(CHECK_StepSet), Flag(CHECK_StepSet) | 
-		Flag(CHECK_ChunkSet) | Flag(CHECK_ChunkAvg) | Flag(CHECK_DFTResult) | 
+	{&GetStepSet, 1, CHECK_AcquParams, Flag(CHECK_StepSet), Flag(CHECK_StepSet) | 
+		Flag(CHECK_RawData) | Flag(CHECK_ChunkSet) | Flag(CHECK_ChunkAvg) | 
+		Flag(CHECK_DFTResult) | 
 		Flag(CHECK_DFTPhaseCorrPrep) | Flag(CHECK_DFTPhaseCorrPrep_AutoCorr) | 
 		Flag(CHECK_DFTPhaseCorrPrep_MemReIm) | Flag(CHECK_DFTPhaseCorrPrep_MemAmp) | 
 		Flag(CHECK_DFTPhaseCorr) | Flag(CHECK_DFTPhaseCorr_ReIm) | Flag(CHECK_DFTPhaseCorr_Amp) | 
@@ -80,7 +81,7 @@ const NMRDataRelation NMRDataRelations[22] = {
 		Flag(CHECK_Evaluation_DFTPhaseCorrReal) | Flag(CHECK_Evaluation_DFTPhaseCorrAmp) | 
 		Flag(CHECK_EchoPeaksEnvelope) | Flag(CHECK_AcquInfo)},
 	/** CHECK_ChunkSet **/
-	{&GetChunkSet, 1, CHECK_StepSet, Flag(CHECK_ChunkSet), Flag(CHECK_ChunkSet) | 
+	{&GetChunkSet, 1, CHECK_RawData, Flag(CHECK_ChunkSet), Flag(CHECK_ChunkSet) | 
 		Flag(CHECK_ChunkAvg) | Flag(CHECK_DFTResult) | 
 		Flag(CHECK_DFTPhaseCorrPrep) | Flag(CHECK_DFTPhaseCorrPrep_AutoCorr) | 
 		Flag(CHECK_DFTPhaseCorrPrep_MemReIm) | Flag(CHECK_DFTPhaseCorrPrep_MemAmp) | 
@@ -99,7 +100,7 @@ const NMRDataRelation NMRDataRelations[22] = {
 		Flag(CHECK_Evaluation) | Flag(CHECK_Evaluation_ChunkAvgAmp) | Flag(CHECK_Evaluation_DFTAmp) | 
 		Flag(CHECK_Evaluation_DFTPhaseCorrReal) | Flag(CHECK_Evaluation_DFTPhaseCorrAmp)}, 
 	/** CHECK_DFTResult **/
-	{&GetDFTResult, 1, CHECK_ChunkAvg, Flag(CHECK_DFTResult), Flag(CHECK_DFTResult) | 
+	{&GetDFTResult, 0, CHECK_ChunkAvg, Flag(CHECK_DFTResult), Flag(CHECK_DFTResult) | 
 		Flag(CHECK_DFTPhaseCorrPrep) | Flag(CHECK_DFTPhaseCorrPrep_AutoCorr) | 
 		Flag(CHECK_DFTPhaseCorrPrep_MemReIm) | Flag(CHECK_DFTPhaseCorrPrep_MemAmp) | 
 		Flag(CHECK_DFTPhaseCorr) | Flag(CHECK_DFTPhaseCorr_ReIm) | Flag(CHECK_DFTPhaseCorr_Amp) | 
@@ -182,14 +183,38 @@ EXPORT int InitNMRData(NMRData *NMRDataStruct) {
 	if (NMRDataStruct == NULL)
 		return NMR_DATA_STRUCT_VOID;
 	
+	InitSIMDDispatch();
+	
 	NMRDataStruct->AcqusData = NULL;
 	NMRDataStruct->AcqusLength = 0;
+	InitParamIndex(&(NMRDataStruct->AcqusIndex));
+	InitParamIndex(&(NMRDataStruct->TextIndex));
 	
 	NMRDataStruct->SerName = NULL;
 	NMRDataStruct->ByteOrder = 0;
+	NMRDataStruct->DTypA = RAW_TYPE_INT32;
 	
 	NMRDataStruct->DataSpace = NULL;
 	NMRDataStruct->DataSize = 0;
+	NMRDataStruct->DataLoaded = NULL;
+	NMRDataStruct->LoadMode = RAW_LOAD_READ;
+	NMRDataStruct->CompactRawData = 0;
+	NMRDataStruct->CumulativeChunkSums = 0;
+	NMRDataStruct->ChunkSpace = NULL;
+	NMRDataStruct->ChunkSpaceSize = 0;
+	NMRDataStruct->DataMap = NULL;
+	NMRDataStruct->DataMapLength = 0;
+	NMRDataStruct->DataMapDecoded = NULL;
+	NMRDataStruct->ReadBlockSize = 1048576;
+	NMRDataStruct->ReadQueueDepth = 4;
+	NMRDataStruct->ProcThreads = 0;
+	NMRDataStruct->DFTPlanner = DFT_PLANNER_ESTIMATE;
+	NMRDataStruct->DFTMemoryBudget = 0;
+	NMRDataStruct->DFTSpilled = 0;
+	NMRDataStruct->DFTSpillFailed = 0;
+	NMRDataStruct->DFTDownconvert = 0;
+	NMRDataStruct->DFTLengthTolerance = 0;
+	NMRDataStruct->DFTCache = NULL;
 	NMRDataStruct->TimeDomain = 0;
 	NMRDataStruct->PointLine = 0;
 	
@@ -203,12 +228,15 @@ EXPORT int InitNMRData(NMRData *NMRDataStruct) {
 	NMRDataStruct->ChunkStart = 0;
 	NMRDataStruct->ChunkEnd = INT_MAX;
 	NMRDataStruct->DFTLength = 128;
+	NMRDataStruct->DFTLengthSet = 128;
 	NMRDataStruct->FilterHz = 2000000000;
 	NMRDataStruct->filter = 0;
 	NMRDataStruct->filter2 = 0;
 
 	NMRDataStruct->ScaleFirstTDPoint = 0;
 	NMRDataStruct->RemoveOffset = 0;
+	NMRDataStruct->Apodization = APODIZATION_None;
+	NMRDataStruct->ApodizationParam = 0;
 	
 	NMRDataStruct->Steps = NULL;
 	NMRDataStruct->StepCount = 0;
@@ -216,6 +244,9 @@ EXPORT int InitNMRData(NMRData *NMRDataStruct) {
 	
 	NMRDataStruct->ChunkSet = NULL;
 	NMRDataStruct->ChunkCount = 0;
+	NMRDataStruct->ChunkMask = NULL;
+	NMRDataStruct->ChunkMaskLength = 0;
+	NMRDataStruct->ChunkMaskSteps = 0;
 	
 	NMRDataStruct->DFTEnvelopeArray = NULL;
 	NMRDataStruct->DFTEnvelopeCount = 0;
@@ -254,6 +285,14 @@ int MarkNMRDataOld(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo
 	Changed |= NMRDataStruct->Flags & NMRDataRelations[NMRDataType].enables;
 	NMRDataStruct->Flags &= ~NMRDataRelations[NMRDataType].enables;
 	
+	if (NMRDataRelations[NMRDataType].enables & Flag(CHECK_ChunkSet)) {
+		FreeChunkSums(NMRDataStruct, StepNo);	/** The cumulative sums follow the chunk set, not the chunk average **/
+		
+		/** The OR mask remains valid if just a step not OR-ed into it yet (an appended one) is concerned **/
+		if ((StepNo < 0) || ((size_t) StepNo < NMRDataStruct->ChunkMaskSteps))
+			FreeChunkMask(NMRDataStruct);
+	}
+	
 	if (NMRDataStruct->Steps != NULL) {
 		if ((StepNo >= 0) && ((size_t) StepNo < NMRDataStruct->StepCount)) {
 			Changed |= NMRDataStruct->Steps[StepNo].Flags & NMRDataRelations[NMRDataType].enables;
@@ -272,6 +311,31 @@ int MarkNMRDataOld(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo
 	return DATA_OK;
 }
 
+/** Marks particular data valid without obtaining them, which is meant for data restored otherwise (e.g. from the processed data cache) **/
+int MarkNMRDataValid(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo) {
+	size_t i = 0;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if (NMRDataType > HighestNMRDataType) 
+		return INVALID_PARAMETER;
+	
+	if (NMRDataStruct->Steps != NULL) {
+		if ((StepNo >= 0) && ((size_t) StepNo < NMRDataStruct->StepCount)) {
+			NMRDataStruct->Steps[StepNo].Flags |= NMRDataRelations[NMRDataType].components;
+			return DATA_OK;
+		}
+		
+		for (i = 0; i < NMRDataStruct->StepCount; i++)
+			NMRDataStruct->Steps[i].Flags |= NMRDataRelations[NMRDataType].components;
+	}
+	
+	NMRDataStruct->Flags |= NMRDataRelations[NMRDataType].components;
+	
+	return DATA_OK;
+}
+
 /** Makes sure that requested data are available, taking care of all prerequisities **/
 EXPORT int CheckNMRData(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo) {
 	size_t i = 0;
@@ -295,13 +359,17 @@ EXPORT int CheckNMRData(NMRData *NMRDataStruct, unsigned int NMRDataType, long S
 	if (NMRDataRelations[NMRDataType].method == NULL)
 		return DATA_EMPTY;
 	
-	if ((StepNo < 0) || ((size_t) StepNo >= NMRDataStruct->StepCount) || (NMRDataRelations[NMRDataType].collective)/* || (NMRDataStruct->Steps == NULL)*/) 
+	if ((StepNo < 0) || (NMRDataRelations[NMRDataType].collective)) 
 		StepNo = ALL_STEPS;
 	
 	/** Prepare prerequisities **/
 	if (NMRDataRelations[NMRDataType].requires != NMRDataType)	/** avoid endless cycles in case of methods without actual prerequisities **/
 		if ((RetVal = CheckNMRData(NMRDataStruct, NMRDataRelations[NMRDataType].requires, StepNo)) != DATA_OK)
 			return RetVal;
+	
+	/** The step set might have been just created by the prerequisities, so check the step range afterwards **/
+	if ((StepNo != ALL_STEPS) && (((size_t) StepNo >= NMRDataStruct->StepCount) || (NMRDataStruct->Steps == NULL))) 
+		StepNo = ALL_STEPS;
 
 	/** Obtain the data **/
 	if ((RetVal = NMRDataRelations[NMRDataType].method(NMRDataStruct, StepNo, NMRDataRelations[NMRDataType].components)) != DATA_OK)
@@ -376,6 +444,77 @@ EXPORT int ReloadNMRData(NMRData *NMRDataStruct) {
 	return RetVal;
 }
 
+/** Loads just the data appended to the datafile since the last (re)load, which is meant for monitoring a running acquisition. 
+    The steps loaded before are kept together with their processed data and only the new steps are marked old, unless the chunk set changes. 
+    Falls back to ReloadNMRData() if the data have not been loaded yet or if the datafile has changed otherwise than by growing. 
+    The acquisition parameters are not reloaded. **/
+EXPORT int ReloadNMRDataIncremental(NMRData *NMRDataStruct) {
+	size_t i = 0;
+	size_t OldStepCount = 0;
+	size_t OldChunkCount = 0;
+	SignalWindow *OldChunkSet = NULL;
+	unsigned char ChunkSetChanged = 0;
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	/** Only the complete raw data can be extended **/
+	if (NMRDataStruct->ChunkSpace != NULL)
+		ExpandRawData(NMRDataStruct);
+	
+	if (!(NMRDataStruct->Flags & Flag(CHECK_StepSet)) || (NMRDataStruct->DataSpace == NULL) || (NMRDataStruct->Steps == NULL))
+		return ReloadNMRData(NMRDataStruct);
+	
+	OldStepCount = NMRDataStruct->StepCount;
+	
+	if ((AppendRawData(NMRDataStruct) != (DATA_OK | FILE_LOADED_OK)) || (AppendStepSet(NMRDataStruct) != DATA_OK)) 
+		return ReloadNMRData(NMRDataStruct);
+	
+	if (NMRDataStruct->StepCount == OldStepCount)
+		return DATA_OK;
+	
+	/** Mark only the new steps old, the collective data get marked old as well **/
+	for (i = OldStepCount; i < NMRDataStruct->StepCount; i++)
+		MarkNMRDataOld(NMRDataStruct, CHECK_RawData, i);
+	
+	/** The new steps might change the chunk set, which would invalidate the processed data of all steps **/
+	if ((NMRDataStruct->ChunkSet != NULL) && (NMRDataStruct->ChunkCount > 0)) {
+		OldChunkSet = (SignalWindow *) malloc(NMRDataStruct->ChunkCount*sizeof(SignalWindow));
+		if (OldChunkSet != NULL) {
+			memcpy(OldChunkSet, NMRDataStruct->ChunkSet, NMRDataStruct->ChunkCount*sizeof(SignalWindow));
+			OldChunkCount = NMRDataStruct->ChunkCount;
+		}
+	}
+	
+	RetVal = CheckNMRData(NMRDataStruct, CHECK_ChunkSet, ALL_STEPS);
+	
+	if ((RetVal != DATA_OK) || (OldChunkSet == NULL) || (NMRDataStruct->ChunkCount != OldChunkCount))
+		ChunkSetChanged = 1;
+	else {
+		for (i = 0; (i < OldChunkCount) && (!ChunkSetChanged); i++) 
+			if ((OldChunkSet[i].start != ChunkDataStart(NMRDataStruct, i)) || (OldChunkSet[i].length != ChunkIndexRange(NMRDataStruct, i)))
+				ChunkSetChanged = 1;
+	}
+	
+	free(OldChunkSet);
+	OldChunkSet = NULL;
+	
+	/** The new chunk set is kept, just the data depending on it are obtained again **/
+	if (RetVal != DATA_OK)
+		MarkNMRDataOld(NMRDataStruct, CHECK_ChunkSet, ALL_STEPS);
+	else
+	if (ChunkSetChanged) {
+		MarkNMRDataOld(NMRDataStruct, CHECK_ChunkAvg, ALL_STEPS);
+		MarkNMRDataOld(NMRDataStruct, CHECK_EchoPeaksEnvelope, ALL_STEPS);
+	}
+	
+	return RetVal;
+}
+
 EXPORT int FreeNMRData(NMRData *NMRDataStruct) {
 	int RetVal = 0;
 	
@@ -387,15 +526,95 @@ EXPORT int FreeNMRData(NMRData *NMRDataStruct) {
 	RetVal |= FreeChunkSet(NMRDataStruct);
 	RetVal |= FreeStepSet(NMRDataStruct);
 	RetVal |= FreeRawData(NMRDataStruct);
+	RetVal |= FreeCompactRawData(NMRDataStruct);
 	RetVal |= FreeText(NMRDataStruct, &(NMRDataStruct->AcqusData), &(NMRDataStruct->AcqusLength));
+	FreeParamIndex(&(NMRDataStruct->AcqusIndex));
+	FreeParamIndex(&(NMRDataStruct->TextIndex));
 	RetVal |= FreeAcquInfo(NMRDataStruct);
+	FreeDFTCache(NMRDataStruct);
 	
 	return RetVal;
 }
 
-/** Should be called on exit of program **/
+/** Should be called on exit of program once all the NMRData structures have been freed, stores the wisdom to the file given to LoadDFTWisdom **/
 EXPORT void CleanupOnExit() {
-	fftw_cleanup();
+	LockDFTPlanner();
+	
+	if (DFTWisdomFile != NULL) 
+		DFT_FFTW(export_wisdom_to_filename)(DFTWisdomFile);
+	
+	free(DFTWisdomFile);
+	DFTWisdomFile = NULL;
+	
+#if FFTW_THREADS
+	if (DFTThreadsReady > 0) {
+		DFT_FFTW(cleanup_threads)();
+		DFTThreadsReady = 0;
+		UnlockDFTPlanner();
+		return;
+	}
+#endif
+	
+	DFT_FFTW(cleanup)();
+	
+	UnlockDFTPlanner();
+}
+
+/** Imports the FFTW wisdom from WisdomFile (if it exists) and remembers the file name for storing the wisdom on exit, NULL forgets it **/
+EXPORT int LoadDFTWisdom(const char *WisdomFile) {
+	FILE *test = NULL;
+	int RetVal = DATA_OK;
+	
+	LockDFTPlanner();
+	
+	free(DFTWisdomFile);
+	DFTWisdomFile = NULL;
+	
+	if (WisdomFile != NULL) {
+		DFTWisdomFile = strdup(WisdomFile);
+		if (DFTWisdomFile == NULL)
+			RetVal = MEM_ALLOC_ERROR;
+	}
+	
+	if ((WisdomFile != NULL) && (RetVal == DATA_OK)) {
+		test = fopen(WisdomFile, "r");
+		if (test == NULL)
+			RetVal = DATA_EMPTY;	/** no wisdom gathered yet **/
+		else {
+			fclose(test);
+			
+			if (!DFT_FFTW(import_wisdom_from_filename)(WisdomFile))
+				RetVal = (FILE_IO_ERROR | DATA_INVALID);
+		}
+	}
+	
+	UnlockDFTPlanner();
+	
+	return RetVal;
+}
+
+/** Evaluates the phase-corrected spectrum of the step StepNo at Count frequencies evenly spaced from FreqStart to FreqEnd (in MHz, both included) 
+    at any density regardless of DFTLength, Output receives Count pairs of the real and imaginary parts **/
+EXPORT int GetDFTZoom(NMRData *NMRDataStruct, long StepNo, double FreqStart, double FreqEnd, size_t Count, double *Output) {
+	int RetVal = DATA_OK;
+	
+	if (NMRDataStruct == NULL)
+		return NMR_DATA_STRUCT_VOID;
+	
+	if ((NMRDataStruct->ErrorReport == NULL) || (NMRDataStruct->ErrorReportCustom == NULL))
+		return ERROR_REPORT_VOID;
+	
+	if ((Output == NULL) || (Count == 0) || (Count > SIZE_MAX / (2*sizeof(double))) || (StepNo < 0) || !isfinite(FreqStart) || !isfinite(FreqEnd))
+		return INVALID_PARAMETER;
+	
+	/** The chunk averages and the phase correction values **/
+	if ((RetVal = CheckNMRData(NMRDataStruct, CHECK_DFTPhaseCorrPrep, StepNo)) != DATA_OK)
+		return RetVal;
+	
+	if ((NMRDataStruct->Steps == NULL) || ((size_t) StepNo >= StepNoRange(NMRDataStruct)))
+		return INVALID_PARAMETER;
+	
+	return GetDFTZoomResult(NMRDataStruct, StepNo, FreqStart, FreqEnd, Count, Output);
 }
 
 
@@ -497,6 +716,30 @@ EXPORT int GetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 				Val = StepFlag(NMRDataStruct, *StepNo);
 			break;
 		
+		case PROC_PARAM_ProcThreads:
+			Val = NMRDataStruct->ProcThreads;
+			break;
+		
+		case PROC_PARAM_DFTMemoryBudget:
+			Val = (NMRDataStruct->DFTMemoryBudget > LONG_MAX)?(LONG_MAX):(NMRDataStruct->DFTMemoryBudget);
+			break;
+		
+		case PROC_PARAM_DFTDownconvert:
+			Val = NMRDataStruct->DFTDownconvert;
+			break;
+		
+		case PROC_PARAM_Apodization:
+			Val = NMRDataStruct->Apodization;
+			break;
+		
+		case PROC_PARAM_DFTLengthTolerance:
+			Val = NMRDataStruct->DFTLengthTolerance;
+			break;
+		
+		case PROC_PARAM_ApodizationParam:
+			Val = NMRDataStruct->ApodizationParam;
+			break;
+		
 		default:
 			return INVALID_PARAMETER;
 	}
@@ -518,6 +761,10 @@ EXPORT int GetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 				*((double *) ParamValue) = 1.0e-6*Val;	/** MHz **/
 				break;
 			
+			case PROC_PARAM_ApodizationParam:
+				*((double *) ParamValue) = 1.0e-3*Val;
+				break;
+			
 			default:
 				*((double *) ParamValue) = Val;
 				break;
@@ -547,7 +794,8 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 		return INVALID_PARAMETER;
 
 	
-	if (ParamType > PROC_PARAM_Filter) {
+	if ((ParamType > PROC_PARAM_Filter) && (ParamType != PROC_PARAM_ProcThreads) && (ParamType != PROC_PARAM_DFTMemoryBudget) && (ParamType != PROC_PARAM_DFTDownconvert) && 
+		(ParamType != PROC_PARAM_Apodization) && (ParamType != PROC_PARAM_ApodizationParam) && (ParamType != PROC_PARAM_DFTLengthTolerance)) {
 		if ((RetVal = CheckNMRData(NMRDataStruct, CHECK_StepSet, ALL_STEPS)) != DATA_OK) 
 			return RetVal;
 		
@@ -575,6 +823,7 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 			
 			case PROC_PARAM_PhaseCorr1ManualRefDataStart:
 			case PROC_PARAM_PhaseCorr1ManualRefProcStart:
+			case PROC_PARAM_ApodizationParam:
 				if (Val > 2000000000)
 					Val = 2000000000;
 				else
@@ -619,6 +868,7 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 			
 			case PROC_PARAM_PhaseCorr1ManualRefDataStart:
 			case PROC_PARAM_PhaseCorr1ManualRefProcStart:
+			case PROC_PARAM_ApodizationParam:
 				if ((*((double *) ParamValue)) > 2.0e6)
 					*((double *) ParamValue) = 2.0e6;
 				else
@@ -779,6 +1029,9 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 			if ((size_t) Val < MinDFTLength)
 				Val = MinDFTLength;
 			
+			NMRDataStruct->DFTLengthSet = Val;
+			Val = GetRoundedDFTLength(NMRDataStruct, Val);
+			
 			if ((unsigned long) Val != NMRDataStruct->DFTLength) {
 				NMRDataStruct->DFTLength = Val;
 				MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
@@ -840,6 +1093,11 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 				MarkNMRDataOld(NMRDataStruct, CHECK_Evaluation_DFTAmp, ALL_STEPS);
 				MarkNMRDataOld(NMRDataStruct, CHECK_Evaluation_DFTPhaseCorrReal, ALL_STEPS);
 				MarkNMRDataOld(NMRDataStruct, CHECK_Evaluation_DFTPhaseCorrAmp, ALL_STEPS);
+				
+				/** the downconverted band follows the filter **/
+				if (NMRDataStruct->DFTDownconvert)
+					MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
+				
 				Changed = 1;
 			}
 
@@ -1081,6 +1339,74 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 			}
 			
 			break;
+		
+		case PROC_PARAM_ProcThreads:
+			/** the results do not depend on the number of threads, nothing is to be recalculated **/
+			if ((unsigned long) Val > UINT_MAX)
+				Val = UINT_MAX;
+			
+			NMRDataStruct->ProcThreads = Val;
+			break;
+		
+		case PROC_PARAM_DFTMemoryBudget:
+			/** the results do not depend on the budget, the DFT data are moved to or from the scratch file when they are allocated next time **/
+			if ((unsigned long) Val > SIZE_MAX / DFT_MEMORY_BUDGET_UNIT)
+				Val = SIZE_MAX / DFT_MEMORY_BUDGET_UNIT;
+			
+			NMRDataStruct->DFTMemoryBudget = Val;
+			NMRDataStruct->DFTSpillFailed = 0;
+			break;
+		
+		case PROC_PARAM_DFTDownconvert:
+			if ((NMRDataStruct->DFTDownconvert != 0) != (Val != 0)) {
+				NMRDataStruct->DFTDownconvert = (Val)?(1):(0);
+				MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
+				Changed = 1;
+			}
+			
+			break;
+		
+		case PROC_PARAM_DFTLengthTolerance:
+			if (Val < 0)
+				Val = 0;
+			else
+			if (Val > DFT_LENGTH_MAX_TOLERANCE)
+				Val = DFT_LENGTH_MAX_TOLERANCE;
+			
+			if ((unsigned long) Val != NMRDataStruct->DFTLengthTolerance) {
+				NMRDataStruct->DFTLengthTolerance = Val;
+				/** the length as set is rounded again, it is clamped already **/
+				AuxVal = GetRoundedDFTLength(NMRDataStruct, NMRDataStruct->DFTLengthSet);
+				if ((unsigned long) AuxVal != NMRDataStruct->DFTLength) {
+					NMRDataStruct->DFTLength = AuxVal;
+					MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
+				}
+				Changed = 1;
+			}
+			
+			break;
+		
+		case PROC_PARAM_Apodization:
+			if ((Val < 0) || (Val > APODIZATION_Max))
+				Val = APODIZATION_None;
+			
+			if ((unsigned char) Val != NMRDataStruct->Apodization) {
+				NMRDataStruct->Apodization = (unsigned char) Val;
+				MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
+				Changed = 1;
+			}
+			
+			break;
+		
+		case PROC_PARAM_ApodizationParam:
+			if (Val != NMRDataStruct->ApodizationParam) {
+				NMRDataStruct->ApodizationParam = Val;
+				if (NMRDataStruct->Apodization != APODIZATION_None)
+					MarkNMRDataOld(NMRDataStruct, CHECK_DFTResult, ALL_STEPS);
+				Changed = 1;
+			}
+			
+			break;
 
 		default:
 		/*	RetVal = INVALID_PARAMETER;
@@ -1110,6 +1436,10 @@ EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned
 				*((double *) ParamValue) = 1.0e-6*Val;	/** MHz **/
 				break;
 			
+			case PROC_PARAM_ApodizationParam:
+				*((double *) ParamValue) = 1.0e-3*Val;
+				break;
+			
 			default:
 				*((double *) ParamValue) = Val;
 				break;
@@ -1144,11 +1474,19 @@ EXPORT int CheckProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsign
 	}
 
 	switch (ParamType) {
+		case PROC_PARAM_DFTLength:
+			/** the length as set is adjusted and rounded again, the rounded length would stick otherwise **/
+			Val = NMRDataStruct->DFTLengthSet;
+			
+			if ((RetVal = SetProcParam(NMRDataStruct, ParamType, PARAM_LONG, &Val, pStep)) != DATA_OK)
+				return RetVal;
+			
+			break;
+		
 		case PROC_PARAM_FirstChunk:
 		case PROC_PARAM_LastChunk:
 		case PROC_PARAM_ChunkStart:
 		case PROC_PARAM_ChunkEnd:
-		case PROC_PARAM_DFTLength:
 		case PROC_PARAM_ScaleFirstTDPoint:
 		case PROC_PARAM_RemoveOffset:
 		case PROC_PARAM_Filter:
@@ -1249,6 +1587,15 @@ EXPORT int CheckProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsign
 			
 			break;
 		
+		case PROC_PARAM_ProcThreads:
+		case PROC_PARAM_DFTMemoryBudget:
+		case PROC_PARAM_DFTDownconvert:
+		case PROC_PARAM_DFTLengthTolerance:
+		case PROC_PARAM_Apodization:
+		case PROC_PARAM_ApodizationParam:
+			/** any value is valid **/
+			break;
+		
 		default:
 			return INVALID_PARAMETER;
 	}		
@@ -1334,6 +1681,19 @@ EXPORT int ImportProcParams(NMRData *NMRDataStruct, char *TextFileName) {
 		SetProcParam(NMRDataStruct, PROC_PARAM_RemoveOffset, PARAM_LONG, &ProcParam, &Step);
 	RetVal |= (RVal & ~DATA_EMPTY);
 
+	/** The apodization is optional, older views do not contain it **/
+	RVal = GetAcqusStyleParamValue(NMRDataStruct, TextData, TextLength,"%Apodization" , &ProcParam, PARAM_LONG);
+	if (RVal == DATA_OK)
+		SetProcParam(NMRDataStruct, PROC_PARAM_Apodization, PARAM_LONG, &ProcParam, &Step);
+	if (RVal != (DATA_OLD | DATA_EMPTY))
+		RetVal |= RVal;
+
+	RVal = GetAcqusStyleParamValue(NMRDataStruct, TextData, TextLength,"%ApodizationParam" , &ProcParam, PARAM_LONG);
+	if (RVal == DATA_OK)
+		SetProcParam(NMRDataStruct, PROC_PARAM_ApodizationParam, PARAM_LONG, &ProcParam, &Step);
+	if (RVal != (DATA_OLD | DATA_EMPTY))
+		RetVal |= RVal;
+
 	RVal = GetAcqusStyleParamValue(NMRDataStruct, TextData, TextLength,"%FilterHz", &ProcParam, PARAM_LONG);
 	if (RVal != DATA_OK) {
 		RVal = GetAcqusStyleParamValue(NMRDataStruct, TextData, TextLength,"%filter", &ProcParam, PARAM_LONG);
@@ -1514,7 +1874,7 @@ EXPORT int DataToText(NMRData *NMRDataStruct, FILE *foutput, char **soutput, siz
 	const NMRExportRelation NMRExportFuncSet[11] = {
 		{&AcquInfoToText, CHECK_AcquInfo},
 		{&ProcParamsToText, CHECK_DFTPhaseCorrPrep /** All proc params are verified at this stage **/}, 
-		{&TDDToText, CHECK_ChunkSet}, 
+		{&TDDToText, CHECK_RawData}, 
 		{&ChunkSetToText, CHECK_ChunkSet}, 
 		{&ChunkAvgToText, CHECK_ChunkAvg}, 
 		{&DFTResultToText, CHECK_DFTResult /* CHECK_DFTPhaseCorrPrep */ /** All proc params are verified at this stage **/}, 
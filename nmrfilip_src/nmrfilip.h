@@ -34,15 +34,19 @@ extern "C" {
 #endif
 
 int MarkNMRDataOld(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo);
+int MarkNMRDataValid(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo);
 
-/** Functions intended to be called from application **/
+/** Functions intended to be called from application; separate NMRData structures may be processed by separate threads (with THREADS = 1) **/
 EXPORT int InitNMRData(NMRData *NMRDataStruct);
 EXPORT int CheckNMRData(NMRData *NMRDataStruct, unsigned int NMRDataType, long StepNo);
 EXPORT int RefreshNMRData(NMRData *NMRDataStruct);
 EXPORT int ReloadNMRData(NMRData *NMRDataStruct);
+EXPORT int ReloadNMRDataIncremental(NMRData *NMRDataStruct);
 EXPORT int FreeNMRData(NMRData *NMRDataStruct);
 
 EXPORT void CleanupOnExit();
+EXPORT int LoadDFTWisdom(const char *WisdomFile);
+EXPORT int GetDFTZoom(NMRData *NMRDataStruct, long StepNo, double FreqStart, double FreqEnd, size_t Count, double *Output);
 
 EXPORT int GetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned int type, void *ParamValue, long *StepNo);
 EXPORT int SetProcParam(NMRData *NMRDataStruct, unsigned int ParamType, unsigned int type, void *ParamValue, long *StepNo);
@@ -58,5 +62,6 @@ EXPORT int DataToText(NMRData *NMRDataStruct, FILE *foutput, char **soutput, siz
 #endif
 
 #include "nfulist.h"
+#include "nfcache.h"
 
 #endif
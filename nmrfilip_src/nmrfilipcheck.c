@@ -0,0 +1,903 @@
+/*
+ * NMRFilip CHECK - the NMR data processing software - checks and benchmarks of the core library
+ * Copyright (C) 2026 NMRFilip contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "nmrfilipcheck.h"
+
+
+unsigned int Failures = 0;
+unsigned char Bench = 0;
+char *WorkDir = NULL;
+uint64_t RandomState = 0x9E3779B97F4A7C15ull;
+
+
+void PrintUsage() {
+	printf("Command-line syntax:\n\
+nmrfilipcheck [--bench] [--size=<MiB>] [--workdir=<dir>] [<datadir>...]\n\
+ \n\
+  --bench          Measure the kernels and the processing stages as well\n\
+  --help           Print this command-line parameter list\n\
+  --size=<MiB>     Size of the synthetic datasets for the benchmark (16 MiB \n\
+                    by default)\n\
+  --workdir=<dir>  Write the synthetic datasets to a new directory in <dir> \n\
+                    (TMPDIR or /tmp by default)\n\
+  <datadir>        Check the processing of the NMR dataset in <datadir> too\n\
+  \n\
+The exit status is 1 if any check fails.\n");
+}
+
+/** Prints the result of a single check and counts the failures **/
+void Check(int Passed, const char *Format, ...) {
+	va_list Args;
+	
+	if (!Passed)
+		Failures++;
+	
+	printf("  %s ", (Passed)?("[ok]  "):("[FAIL]"));
+	va_start(Args, Format);
+	vprintf(Format, Args);
+	va_end(Args);
+	printf("\n");
+}
+
+/** Monotonic time in seconds **/
+double CheckClock(void) {
+#ifdef __WIN32__
+	LARGE_INTEGER Count;
+	LARGE_INTEGER Frequency;
+	
+	QueryPerformanceCounter(&Count);
+	QueryPerformanceFrequency(&Frequency);
+	
+	return ((double) Count.QuadPart)/((double) Frequency.QuadPart);
+#else
+	struct timespec Now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	
+	return ((double) Now.tv_sec) + 1.0e-9*((double) Now.tv_nsec);
+#endif
+}
+
+/** Reproducible pseudo-random numbers (xorshift64*) from the State **/
+uint64_t NextRandom(uint64_t *State) {
+	*State ^= *State >> 12;
+	*State ^= *State << 25;
+	*State ^= *State >> 27;
+	
+	return (*State)*0x2545F4914F6CDD1Dull;
+}
+
+uint64_t CheckRandom(void) {
+	return NextRandom(&RandomState);
+}
+
+/** Uniformly distributed in [0, 1) **/
+double CheckRandomDouble(void) {
+	return ((double) (CheckRandom() >> 11))*0x1p-53;
+}
+
+/** Whether the kernels of the instruction set may be run on this CPU **/
+int HasSSE2(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#else
+	return 0;
+#endif
+}
+
+int HasAVX2(void) {
+#if SIMD_X86
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	return 0;
+#endif
+}
+
+/** Bytes of the memory range resident in physical memory, 0 if unknown **/
+size_t ResidentBytes(const void *Start, size_t Length) {
+#ifdef __WIN32__
+	return 0;
+#else
+	unsigned char *Pages = NULL;
+	uintptr_t First = 0;
+	uintptr_t End = 0;
+	size_t PageSize = 0;
+	size_t Resident = 0;
+	size_t i = 0;
+	
+	if ((Start == NULL) || (Length == 0) || (sysconf(_SC_PAGESIZE) <= 0))
+		return 0;
+	
+	PageSize = (size_t) sysconf(_SC_PAGESIZE);
+	First = ((uintptr_t) Start)/PageSize*PageSize;
+	End = (((uintptr_t) Start) + Length + PageSize - 1)/PageSize*PageSize;
+	
+	Pages = (unsigned char *) malloc((End - First)/PageSize);
+	if (Pages == NULL)
+		return 0;
+	
+	if (mincore((void *) First, End - First, (void *) Pages) == 0)
+		for (i = 0; i < (End - First)/PageSize; i++)
+			if (Pages[i] & 1)
+				Resident += PageSize;
+	
+	free(Pages);
+	
+	return Resident;
+#endif
+}
+
+/** Peak resident set size of the process in bytes, 0 if unknown **/
+size_t PeakResidentBytes(void) {
+#ifdef __WIN32__
+	return 0;
+#else
+	struct rusage Usage;
+	
+	if (getrusage(RUSAGE_SELF, &Usage) != 0)
+		return 0;
+	
+#ifdef __APPLE__
+	return (size_t) Usage.ru_maxrss;
+#else
+	return ((size_t) Usage.ru_maxrss)*1024;	/** in KiB **/
+#endif
+#endif
+}
+
+char *CombinePath(const char *Dir, const char *Name) {
+	char *Path = NULL;
+	
+	Path = (char *) malloc(strlen(Dir) + strlen(PATH_SEPARATOR) + strlen(Name) + 1);
+	if (Path == NULL) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	sprintf(Path, "%s%s%s", Dir, PATH_SEPARATOR, Name);
+	
+	return Path;
+}
+
+int MakeDir(const char *Dir) {
+#ifdef __WIN32__
+	return _mkdir(Dir);
+#else
+	return mkdir(Dir, 0755);
+#endif
+}
+
+int RemoveDir(const char *Dir) {
+#ifdef __WIN32__
+	return _rmdir(Dir);
+#else
+	return rmdir(Dir);
+#endif
+}
+
+/** Creates a new directory for the synthetic datasets in Base (or in the default temporary directory if NULL) **/
+int CreateWorkDir(const char *Base) {
+#ifdef __WIN32__
+	char Name[64];
+#endif
+	
+	if (Base == NULL) {
+#ifdef __WIN32__
+		Base = getenv("TEMP");
+		if (Base == NULL)
+			Base = ".";
+#else
+		Base = getenv("TMPDIR");
+		if (Base == NULL)
+			Base = "/tmp";
+#endif
+	}
+
+#ifdef __WIN32__
+	sprintf(Name, "nmrfilipcheck-%d", _getpid());
+	WorkDir = CombinePath(Base, Name);
+	
+	return MakeDir(WorkDir);
+#else
+	WorkDir = CombinePath(Base, "nmrfilipcheck-XXXXXX");
+	
+	return (mkdtemp(WorkDir) != NULL)?(0):(-1);
+#endif
+}
+
+/** Removes the synthetic dataset written to Dir by WriteEchoTrain **/
+void RemoveEchoTrain(const char *Dir) {
+	char *Path = NULL;
+	
+	Path = CombinePath(Dir, "acqus");
+	remove(Path);
+	free(Path);
+	
+	Path = CombinePath(Dir, "ser");
+	remove(Path);
+	free(Path);
+	
+	Path = CombinePath(Dir, "ser" NMRDATA_CACHE_SUFFIX);
+	remove(Path);
+	free(Path);
+	
+	RemoveDir(Dir);
+}
+
+/** Stores the sample to the ser line as int32 or float64 in the byte order of the train **/
+void PutEchoTrainValue(unsigned char *Line, size_t Index, int32_t Value, const EchoTrain *Train) {
+	uint64_t Word = 0;
+	size_t Size = 0;
+	size_t j = 0;
+	double Real = 0.0;
+	
+	if (Train->DTypA == RAW_TYPE_FLOAT64) {
+		Real = (double) Value;
+		memcpy(&Word, &Real, sizeof(double));
+		Size = sizeof(double);
+	} else {
+		Word = (uint32_t) Value;
+		Size = sizeof(int32_t);
+	}
+	
+	for (j = 0; j < Size; j++)
+		Line[Size*Index + ((Train->BigEndian)?(Size - 1 - j):(j))] = (unsigned char) (Word >> (8*j));
+}
+
+/** Writes the echo train as a dataset (acqus and ser) to the new directory Name in WorkDir, returns the directory or NULL on failure.
+    The echoes are Gaussian-shaped oscillations with a little noise, decaying along the train and growing from step to step;
+    all their points are non-zero and all the points between them are zero. The noise depends on the train only,
+    so the same train written as int32 and as float64 holds the same values. **/
+/** The first point of the echo Chunk, shifted by the jitter of the train **/
+size_t EchoTrainStart(const EchoTrain *Train, size_t Chunk) {
+	uint64_t State = 0;
+	
+	if (Train->Jitter == 0)
+		return Train->Offset + Chunk*Train->Period;
+	
+	/** the same shift of the echo every time **/
+	State = 0x9E3779B97F4A7C15ull*((uint64_t) Chunk + 1);
+	
+	return Train->Offset + Chunk*Train->Period + (size_t) (NextRandom(&State) % (2*Train->Jitter + 1)) - Train->Jitter;
+}
+
+char *WriteEchoTrain(const char *Name, const EchoTrain *Train) {
+	FILE *output = NULL;
+	char *Dir = NULL;
+	char *Path = NULL;
+	double *Shape = NULL;
+	unsigned char *Line = NULL;
+	size_t LineValues = 0;
+	size_t ValueSize = 0;
+	size_t Chunk = 0;
+	size_t Start = 0;
+	size_t Pos = 0;
+	size_t n = 0;
+	size_t k = 0;
+	double Scale = 0.0;
+	double Envelope = 0.0;
+	int32_t Re = 0;
+	int32_t Im = 0;
+	uint64_t Noise = 0x2545F4914F6CDD1Dull;
+	
+	Dir = CombinePath(WorkDir, Name);
+	if (MakeDir(Dir) != 0) {
+		fprintf(stderr, "Cannot create the directory \"%s\".\n", Dir);
+		free(Dir);
+		return NULL;
+	}
+	
+	Path = CombinePath(Dir, "acqus");
+	output = fopen(Path, "w");
+	free(Path);
+	if (output == NULL) {
+		fprintf(stderr, "Cannot write the synthetic dataset \"%s\".\n", Dir);
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return NULL;
+	}
+	
+	fprintf(output, "##TITLE= NMRFilip check - synthetic echo train\n##JCAMPDX= 5.0\n##DATATYPE= Parameter Values\n");
+	fprintf(output, "##$BYTORDA= %d\n##$DIGMOD= 0\n##$DTYPA= %d\n##$SFO1= 100\n##$SW_h= 2000000\n##$TD= %lu\n##END=\n", (Train->BigEndian)?(1):(0), (int) Train->DTypA, (unsigned long) Train->TD);
+	fclose(output);
+	
+	/** the lines are aligned to 1024 B **/
+	ValueSize = (Train->DTypA == RAW_TYPE_FLOAT64)?(sizeof(double)):(sizeof(int32_t));
+	LineValues = (Train->TD + 1024/ValueSize - 1)/(1024/ValueSize)*(1024/ValueSize);
+	
+	Shape = (double *) calloc(LineValues, sizeof(double));
+	Line = (unsigned char *) calloc(LineValues, ValueSize);
+	Path = CombinePath(Dir, "ser");
+	output = fopen(Path, "wb");
+	free(Path);
+	if ((Shape == NULL) || (Line == NULL) || (output == NULL)) {
+		fprintf(stderr, "Cannot write the synthetic dataset \"%s\".\n", Dir);
+		free(Shape);
+		free(Line);
+		if (output != NULL)
+			fclose(output);
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return NULL;
+	}
+	
+	/** the shape of the echoes of the first step, the other steps are scaled **/
+	for (Chunk = 0; Chunk < Train->Chunks; Chunk++) {
+		Start = EchoTrainStart(Train, Chunk);
+		
+		for (Pos = 0; (Pos < Train->Length) && (Start + Pos < Train->TD/2); Pos++) {
+			n = Start + Pos;
+			Envelope = exp(-((double) Chunk)/((double) Train->Chunks))*exp(-pow((((double) Pos) - 0.5*((double) Train->Length))/(0.2*((double) Train->Length) + 1.0), 2.0));
+			Shape[2*n] = Envelope*cos(2.0*M_PI*Train->Freq*((double) Pos));
+			Shape[2*n + 1] = Envelope*sin(2.0*M_PI*Train->Freq*((double) Pos));
+		}
+	}
+	
+	for (k = 0; k < Train->Steps; k++) {
+		Scale = 1048576.0*(0.25 + 0.75*((double) (k + 1))/((double) Train->Steps));
+		
+		for (Chunk = 0; Chunk < Train->Chunks; Chunk++) {
+			Start = EchoTrainStart(Train, Chunk);
+			
+			for (Pos = 0; (Pos < Train->Length) && (Start + Pos < Train->TD/2); Pos++) {
+				n = Start + Pos;
+				Re = (int32_t) lround(Scale*Shape[2*n]) + (int32_t) (NextRandom(&Noise) % 17) - 8;
+				Im = (int32_t) lround(Scale*Shape[2*n + 1]) + (int32_t) (NextRandom(&Noise) % 17) - 8;
+				if ((Im == 0) && (Shape[2*n] == 0.0))
+					Im = 1;
+				
+				/** the echo points are all non-zero, so that the chunks are found exactly **/
+				if ((Re == 0) && (Im == 0))
+					Re = 1;
+				
+				PutEchoTrainValue(Line, 2*n, Re, Train);
+				PutEchoTrainValue(Line, 2*n + 1, Im, Train);
+			}
+		}
+		
+		if (fwrite(Line, ValueSize, LineValues, output) != LineValues) {
+			fprintf(stderr, "Cannot write the synthetic dataset \"%s\".\n", Dir);
+			free(Shape);
+			free(Line);
+			fclose(output);
+			RemoveEchoTrain(Dir);
+			free(Dir);
+			return NULL;
+		}
+	}
+	
+	free(Shape);
+	free(Line);
+	
+	if (fclose(output) != 0) {
+		fprintf(stderr, "Cannot write the synthetic dataset \"%s\".\n", Dir);
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return NULL;
+	}
+	
+	return Dir;
+}
+
+/** Initializes the NMRData structure for the dataset in Dir (the ser or fid datafile), the datafile name is freed by CloseDataset **/
+int OpenDataset(NMRData *NMRDataStruct, const char *Dir) {
+	FILE *test = NULL;
+	
+	if (InitNMRData(NMRDataStruct) != DATA_OK)
+		return -1;
+	
+	NMRDataStruct->SerName = CombinePath(Dir, "ser");
+	test = fopen(NMRDataStruct->SerName, "rb");
+	if (test == NULL) {
+		free(NMRDataStruct->SerName);
+		NMRDataStruct->SerName = CombinePath(Dir, "fid");
+		test = fopen(NMRDataStruct->SerName, "rb");
+	}
+	
+	if (test == NULL) {
+		fprintf(stderr, "Cannot access ser nor fid file in \"%s\".\n", Dir);
+		free(NMRDataStruct->SerName);
+		NMRDataStruct->SerName = NULL;
+		return -1;
+	}
+	
+	fclose(test);
+	
+	return 0;
+}
+
+void CloseDataset(NMRData *NMRDataStruct) {
+	FreeNMRData(NMRDataStruct);
+	free(NMRDataStruct->SerName);
+	NMRDataStruct->SerName = NULL;
+}
+
+/** Writes the echo train to the new directory Name in WorkDir and opens it, returns 0 on success; CloseEchoTrain closes and removes it **/
+int OpenEchoTrain(NMRData *NMRDataStruct, const char *Name, const EchoTrain *Train) {
+	char *Dir = NULL;
+	
+	NMRDataStruct->SerName = NULL;
+	
+	Dir = WriteEchoTrain(Name, Train);
+	if (Dir == NULL)
+		return -1;
+	
+	if (OpenDataset(NMRDataStruct, Dir) != 0) {
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return -1;
+	}
+	
+	free(Dir);
+	
+	return 0;
+}
+
+void CloseEchoTrain(NMRData *NMRDataStruct) {
+	char *Dir = NULL;
+	
+	if (NMRDataStruct->SerName == NULL)
+		return;
+	
+	/** the directory of the datafile written as Dir/ser by WriteEchoTrain **/
+	Dir = CombinePath(NMRDataStruct->SerName, "");
+	Dir[strlen(NMRDataStruct->SerName) - strlen(PATH_SEPARATOR) - strlen("ser")] = '\0';
+	
+	CloseDataset(NMRDataStruct);
+	RemoveEchoTrain(Dir);
+	free(Dir);
+}
+
+/** Repeats the function until BENCH_MIN_TIME passes, returns the time of a single call in seconds **/
+double MeasureTime(void (*Func)(void *), void *Arg) {
+	double Start = 0.0;
+	double Elapsed = 0.0;
+	size_t Count = 0;
+	size_t Repeat = 1;
+	size_t i = 0;
+	
+	Start = CheckClock();
+	do {
+		for (i = 0; i < Repeat; i++)
+			Func(Arg);
+		Count += Repeat;
+		Repeat *= 2;
+		Elapsed = CheckClock() - Start;
+	} while (Elapsed < BENCH_MIN_TIME);
+	
+	return Elapsed/((double) Count);
+}
+
+/** Marks the stage Since (and the following ones) old and obtains the stage Stage again, returns the result of CheckNMRData **/
+int RunStage(NMRData *NMRDataStruct, unsigned int Since, unsigned int Stage) {
+	
+	MarkNMRDataOld(NMRDataStruct, Since, ALL_STEPS);
+	return CheckNMRData(NMRDataStruct, Stage, ALL_STEPS);
+}
+
+typedef struct {
+	NMRData *NMRDataStruct;
+	unsigned int Since;
+	unsigned int Stage;
+} StageBenchArg;
+
+void StageBench(void *Arg) {
+	StageBenchArg *Bench = (StageBenchArg *) Arg;
+	
+	RunStage(Bench->NMRDataStruct, Bench->Since, Bench->Stage);
+}
+
+/** The time of a single RunStage in seconds **/
+double MeasureStage(NMRData *NMRDataStruct, unsigned int Since, unsigned int Stage) {
+	StageBenchArg BenchArg;
+	
+	BenchArg.NMRDataStruct = NMRDataStruct;
+	BenchArg.Since = Since;
+	BenchArg.Stage = Stage;
+	
+	return MeasureTime(StageBench, &BenchArg);
+}
+
+void FreeProcResults(ProcResults *Results) {
+	free(Results->Chunks);
+	free(Results->ChunkAvg);
+	free(Results->DFT);
+	memset(Results, 0, sizeof(ProcResults));
+}
+
+/** Copies the chunk set, the chunk averages and the DFT output (all available) **/
+void SaveProcResults(NMRData *NMRDataStruct, ProcResults *Results) {
+	size_t ChunkAvgLength = 0;
+	size_t DFTLength = 0;
+	size_t i = 0;
+	size_t k = 0;
+	
+	memset(Results, 0, sizeof(ProcResults));
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		ChunkAvgLength += 2*ChunkAvgIndexRange(NMRDataStruct, k);
+		DFTLength += 2*DFTIndexRange(NMRDataStruct, k);
+	}
+	
+	Results->ChunkCount = ChunkNoRange(NMRDataStruct);
+	Results->Chunks = (size_t *) malloc((2*Results->ChunkCount + 1)*sizeof(size_t));
+	Results->ChunkAvg = (double *) malloc((ChunkAvgLength + 1)*sizeof(double));
+	Results->DFT = (NMRReal *) malloc((DFTLength + 1)*sizeof(NMRReal));
+	if ((Results->Chunks == NULL) || (Results->ChunkAvg == NULL) || (Results->DFT == NULL)) {
+		fprintf(stderr, "Cannot allocate memory.\n");
+		exit(2);
+	}
+	
+	for (i = 0; i < Results->ChunkCount; i++) {
+		Results->Chunks[2*i] = ChunkDataStart(NMRDataStruct, i);
+		Results->Chunks[2*i + 1] = ChunkIndexRange(NMRDataStruct, i);
+	}
+	
+	ChunkAvgLength = 0;
+	DFTLength = 0;
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		memcpy(Results->ChunkAvg + ChunkAvgLength, &ChunkAvgReal(NMRDataStruct, k, 0), 2*ChunkAvgIndexRange(NMRDataStruct, k)*sizeof(double));
+		ChunkAvgLength += 2*ChunkAvgIndexRange(NMRDataStruct, k);
+		memcpy(Results->DFT + DFTLength, &DFTReal(NMRDataStruct, k, 0), 2*DFTIndexRange(NMRDataStruct, k)*sizeof(NMRReal));
+		DFTLength += 2*DFTIndexRange(NMRDataStruct, k);
+	}
+}
+
+/** Compares the current results with the saved ones, the chunk sets and the chunk averages must be identical, 
+    returns the maximum deviation of the DFT output relative to the maximum amplitude of the step (or infinity if they differ otherwise) **/
+double CompareProcResults(NMRData *NMRDataStruct, const ProcResults *Results) {
+	size_t ChunkAvgLength = 0;
+	size_t DFTLength = 0;
+	size_t i = 0;
+	size_t k = 0;
+	double MaxAmp = 0.0;
+	double Deviation = 0.0;
+	double MaxDeviation = 0.0;
+	
+	if (Results->ChunkCount != ChunkNoRange(NMRDataStruct))
+		return INFINITY;
+	
+	for (i = 0; i < Results->ChunkCount; i++)
+		if ((Results->Chunks[2*i] != ChunkDataStart(NMRDataStruct, i)) || (Results->Chunks[2*i + 1] != ChunkIndexRange(NMRDataStruct, i)))
+			return INFINITY;
+	
+	for (k = 0; k < StepNoRange(NMRDataStruct); k++) {
+		if (memcmp(Results->ChunkAvg + ChunkAvgLength, &ChunkAvgReal(NMRDataStruct, k, 0), 2*ChunkAvgIndexRange(NMRDataStruct, k)*sizeof(double)) != 0)
+			return INFINITY;
+		ChunkAvgLength += 2*ChunkAvgIndexRange(NMRDataStruct, k);
+		
+		MaxAmp = 0.0;
+		for (i = 0; i < DFTIndexRange(NMRDataStruct, k); i++)
+			MaxAmp = ChooseMax(MaxAmp, hypot(Results->DFT[DFTLength + 2*i], Results->DFT[DFTLength + 2*i + 1]));
+		
+		for (i = 0; (i < DFTIndexRange(NMRDataStruct, k)) && (MaxAmp > 0.0); i++) {
+			Deviation = hypot(DFTReal(NMRDataStruct, k, i) - Results->DFT[DFTLength + 2*i], DFTImag(NMRDataStruct, k, i) - Results->DFT[DFTLength + 2*i + 1])/MaxAmp;
+			if (Deviation > MaxDeviation)
+				MaxDeviation = Deviation;
+		}
+		DFTLength += 2*DFTIndexRange(NMRDataStruct, k);
+	}
+	
+	return MaxDeviation;
+}
+
+
+/** The first "##ParamName=" line whose value starts with ValuePrefix found by scanning the whole text, as done before the index; returns the pointer behind the prefix **/
+const char *ReferenceParamValue(const char *Text, const char *ParamName, const char *ValuePrefix) {
+	char Key[300];
+	size_t Length = 0;
+	
+	if (strlen(ParamName) > 256)
+		return NULL;
+	
+	sprintf(Key, "##%s=%s", ParamName, ValuePrefix);
+	Length = strlen(Key);
+	
+	if (strncmp(Text, "\xEF\xBB\xBF", 3) == 0)
+		Text += 3;
+	
+	for (; *Text != '\0'; Text += strcspn(Text, "\r\n")) {
+		Text += strspn(Text, " \t\v\f\r\n");
+		if (strncmp(Text, Key, Length) == 0)
+			return Text + Length;
+	}
+	
+	return NULL;
+}
+
+/** Looks up every parameter name of the text (and a few names not present) through the index and by scanning the text, returns the number of lookups or -1 if any differs **/
+long CompareParamIndex(NMRData *NMRDataStruct, char *Text, size_t TextLength) {
+	const char *Prefixes[] = {" ", " (0.."};
+	ParamIndex *Index = NULL;
+	char ParamName[300];
+	const char *Line = NULL;
+	size_t Length = 0;
+	size_t Variant = 0;
+	size_t p = 0;
+	long Count = 0;
+	
+	if ((Index = GetParamIndex(NMRDataStruct, Text, TextLength)) == NULL)
+		return -1;
+	
+	for (Line = Text; *Line != '\0'; Line += strcspn(Line, "\r\n")) {
+		Line += strspn(Line, " \t\v\f\r\n");
+		if (strncmp(Line, "##", 2) != 0)
+			continue;
+		
+		Length = strcspn(Line + 2, "=\r\n");
+		if ((Length == 0) || (Length > 256))
+			continue;
+		
+		/** the name, the name shortened and the name extended **/
+		for (Variant = 0; Variant < 3; Variant++) {
+			memcpy(ParamName, Line + 2, Length);
+			ParamName[Length] = '\0';
+			if (Variant == 1)
+				ParamName[Length - 1] = '\0';
+			if (Variant == 2)
+				strcat(ParamName, "X");
+			
+			for (p = 0; p < sizeof(Prefixes)/sizeof(Prefixes[0]); p++, Count++) 
+				if ((const char *) FindParamValue(Index, ParamName, (char *) Prefixes[p]) != ReferenceParamValue(Text, ParamName, Prefixes[p]))
+					return -1;
+		}
+	}
+	
+	return Count;
+}
+
+/** Parameter lookups through the index of a text with the corner cases of the acqus-style format **/
+void CheckParamLookup(void) {
+	char Text[] = "\xEF\xBB\xBF##TITLE= lookup check\r\n"
+		"##$TD= 4096\r\n"
+		"  ##$TD0= 1\n"
+		"##$TD= 8192\n"
+		"##$D= (0..3)\n0.1 0.2 0.3 0.4\n"
+		"##$D=(0..1)\n"
+		"##$D= 5\n"
+		"##%VIEW= (0..1)\n1 2\n"
+		"##$NOVALUE\n"
+		"##$EMPTY=\n"
+		"# ##$HIDDEN= 1\n"
+		"##=\n"
+		"\t##$P= (0..63)\n"
+		"##END=\n";
+	NMRData NMRDataStruct;
+	long Count = 0;
+	long Val = 0;
+	
+	printf("Acqus-style parameter lookup\n");
+	
+	InitNMRData(&NMRDataStruct);
+	
+	Count = CompareParamIndex(&NMRDataStruct, Text, strlen(Text));
+	Check(Count > 0, "%ld lookups through the index identical to scanning the text", Count);
+	Check((GetAcqusStyleParamValue(&NMRDataStruct, Text, strlen(Text), "$TD", &Val, PARAM_LONG) == DATA_OK) && (Val == 4096), "the first of the repeated parameters found");
+	
+	FreeNMRData(&NMRDataStruct);
+}
+
+/** The index of acqus must match the text, it is kept while appending steps and rebuilt when acqus is reloaded **/
+void CheckParamIndex(const EchoTrain *Train, const char *Name) {
+	NMRData NMRDataStruct;
+	char *Dir = NULL;
+	char *Path = NULL;
+	unsigned char *Data = NULL;
+	const char Appended[] = "##$NFCHECK= 12345\n";
+	size_t Size = 0;
+	long Count = 0;
+	long Val = 0;
+	
+	printf("Dataset %s, acqus index\n", Name);
+	
+	Dir = WriteEchoTrain("paramindex", Train);
+	if (Dir == NULL) {
+		Check(0, "%s: the dataset cannot be written", Name);
+		return;
+	}
+	
+	Path = CombinePath(Dir, "ser");
+	Data = ReadWholeFile(Path, &Size);
+	
+	if ((Data == NULL) || (Train->Steps < 2) || (WriteWholeFile(Path, Data, Size/Train->Steps*(Train->Steps/2), "wb") != 0) || (OpenDataset(&NMRDataStruct, Dir) != 0)) {
+		Check(0, "%s: the dataset cannot be opened", Name);
+		free(Data);
+		free(Path);
+		RemoveEchoTrain(Dir);
+		free(Dir);
+		return;
+	}
+	
+	if (CheckNMRData(&NMRDataStruct, CHECK_ChunkSet, ALL_STEPS) == DATA_OK) {
+		Count = CompareParamIndex(&NMRDataStruct, NMRDataStruct.AcqusData, NMRDataStruct.AcqusLength);
+		Check((NMRDataStruct.AcqusIndex.Text == NMRDataStruct.AcqusData) && (Count > 0), "%s: %ld acqus lookups through the index identical to scanning the text", Name, Count);
+	} else
+		Check(0, "%s: the first half of the steps cannot be loaded", Name);
+	
+	if ((WriteWholeFile(Path, Data + Size/Train->Steps*(Train->Steps/2), Size - Size/Train->Steps*(Train->Steps/2), "ab") == 0) && 
+		(ReloadNMRDataIncremental(&NMRDataStruct) == DATA_OK) && (CheckNMRData(&NMRDataStruct, CHECK_ChunkSet, ALL_STEPS) == DATA_OK)) {
+		Count = CompareParamIndex(&NMRDataStruct, NMRDataStruct.AcqusData, NMRDataStruct.AcqusLength);
+		Check((StepNoRange(&NMRDataStruct) == Train->Steps) && (NMRDataStruct.AcqusIndex.Text == NMRDataStruct.AcqusData) && (Count > 0), 
+			"%s: acqus index valid after appending steps", Name);
+	} else
+		Check(0, "%s: the appended steps cannot be loaded", Name);
+	
+	free(Path);
+	Path = CombinePath(Dir, "acqus");
+	
+	if ((WriteWholeFile(Path, (const unsigned char *) Appended, strlen(Appended), "ab") == 0) && 
+		(ReloadNMRData(&NMRDataStruct) == DATA_OK) && (CheckNMRData(&NMRDataStruct, CHECK_ChunkSet, ALL_STEPS) == DATA_OK)) {
+		Count = CompareParamIndex(&NMRDataStruct, NMRDataStruct.AcqusData, NMRDataStruct.AcqusLength);
+		Check((GetAcqusParamValue(&NMRDataStruct, "$NFCHECK", &Val, PARAM_LONG) == DATA_OK) && (Val == 12345) && 
+			(NMRDataStruct.AcqusIndex.Text == NMRDataStruct.AcqusData) && (Count > 0), "%s: acqus index rebuilt after reloading the changed acqus", Name);
+	} else
+		Check(0, "%s: the changed acqus cannot be reloaded", Name);
+	
+	CloseDataset(&NMRDataStruct);
+	free(Data);
+	free(Path);
+	RemoveEchoTrain(Dir);
+	free(Dir);
+}
+
+/** Checks the processing stages of the opened dataset **/
+void CheckProcessing(NMRData *NMRDataStruct, const char *Name) {
+	
+	printf("Dataset %s\n", Name);
+	
+	if (CheckNMRData(NMRDataStruct, CHECK_ChunkSet, ALL_STEPS) != DATA_OK) {
+		Check(0, "%s: the data cannot be loaded", Name);
+		return;
+	}
+	
+	Check(CompareParamIndex(NMRDataStruct, NMRDataStruct->AcqusData, NMRDataStruct->AcqusLength) > 0, "%s: acqus lookups through the index identical to scanning the text", Name);
+	CheckChunkSearch(NMRDataStruct, Name);
+	CheckChunkAvg(NMRDataStruct, Name);
+	CheckChunkSums(NMRDataStruct, Name);
+	CheckCompactRawData(NMRDataStruct, Name);
+	CheckEchoPeaks(NMRDataStruct, Name);
+	CheckDFT(NMRDataStruct, Name);
+	CheckDFTOrder(NMRDataStruct, Name);
+	CheckInPlaceDFT(NMRDataStruct, Name);
+	CheckThreads(NMRDataStruct, Name);
+	CheckZoom(NMRDataStruct, Name);
+	CheckPadding(NMRDataStruct, Name);
+	CheckDownconvert(NMRDataStruct, Name);
+	CheckLoader(NMRDataStruct, Name);
+	CheckLazyLoading(NMRDataStruct, Name);
+}
+
+/** Checks the processing stages of the dataset in Dir **/
+void CheckDataset(const char *Dir, const char *Name) {
+	NMRData NMRDataStruct;
+	
+	if (OpenDataset(&NMRDataStruct, Dir) != 0) {
+		Check(0, "%s: the dataset cannot be opened", Name);
+		return;
+	}
+	
+	CheckProcessing(&NMRDataStruct, Name);
+	CloseDataset(&NMRDataStruct);
+}
+
+/** Checks the processing stages of the echo train written as a synthetic dataset **/
+void CheckEchoTrain(const EchoTrain *Train, const char *Name) {
+	NMRData NMRDataStruct;
+	
+	if (OpenEchoTrain(&NMRDataStruct, "train", Train) != 0) {
+		Check(0, "%s: the dataset cannot be written", Name);
+		return;
+	}
+	
+	CheckProcessing(&NMRDataStruct, Name);
+	CloseEchoTrain(&NMRDataStruct);
+}
+
+
+int main(int argc, char * argv[]) {
+	const EchoTrain Train = {4096, 24, 40, 96, 64, 21, 1, 0.0625};
+	const EchoTrain LongTrain = {65536, 4, 128, 8704, 8448, 3, 1, 0.0625};	/** echoes too long for the DFT exceeding the memory budget of 1 MiB by a step to be pruned **/
+	EchoTrain BenchTrain = {65536, 64, 64, 512, 384, 60, 1, 0.03125};	/** for the benchmark only, 16 MiB by default **/
+	NMRData NMRDataStruct;
+	unsigned long Size = 16;
+	char *WorkBase = NULL;
+	int i = 0;
+	
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--help") == 0) {
+			PrintUsage();
+			return 0;
+		}
+		
+		if (strcmp(argv[i], "--bench") == 0)
+			Bench = 1;
+		else
+		if (strncmp(argv[i], "--workdir=", 10) == 0)
+			WorkBase = argv[i] + 10;
+		else
+		if (strncmp(argv[i], "--size=", 7) == 0) {
+			Size = strtoul(argv[i] + 7, NULL, 10);
+			if (Size == 0) {
+				fprintf(stderr, "Invalid size \"%s\".\n", argv[i] + 7);
+				return 2;
+			}
+		} else
+		if (argv[i][0] == '-') {
+			fprintf(stderr, "Unknown option \"%s\".\n", argv[i]);
+			PrintUsage();
+			return 2;
+		}
+	}
+	
+	if (CreateWorkDir(WorkBase) != 0) {
+		fprintf(stderr, "Cannot create the directory for the synthetic datasets \"%s\".\n", WorkDir);
+		return 2;
+	}
+	
+	CheckKernels();
+	CheckEchoPeakSearch();
+	CheckChunkDetection();
+	CheckParamLookup();
+	CheckDFTLengthRounding();
+	
+	CheckEchoTrain(&Train, "synthetic echo train");
+	CheckRawDataTypes(&Train, "synthetic echo train");
+	CheckByteOrders(&Train, "synthetic echo train");
+	CheckIncrementalReload(&Train, "synthetic echo train");
+	CheckCache(&Train, "synthetic echo train");
+	CheckParamIndex(&Train, "synthetic echo train");
+	CheckDFTSpill(&LongTrain, "synthetic long echo train");
+	
+	if (Bench) {
+		BenchTrain.Steps = ChooseMax(Size*1048576/(BenchTrain.TD*sizeof(int32_t)), 1);
+		CheckEchoTrain(&BenchTrain, "synthetic benchmark echo train");
+		
+		/** the same in the other byte order, just loaded **/
+		BenchTrain.BigEndian = !BenchTrain.BigEndian;
+		if (OpenEchoTrain(&NMRDataStruct, "bench", &BenchTrain) == 0) {
+			printf("Dataset synthetic benchmark echo train, the other byte order\n");
+			CheckLoader(&NMRDataStruct, "synthetic benchmark echo train");
+			CloseEchoTrain(&NMRDataStruct);
+		} else
+			Check(0, "the synthetic benchmark echo train cannot be written");
+	}
+	
+	for (i = 1; i < argc; i++)
+		if (argv[i][0] != '-')
+			CheckDataset(argv[i], argv[i]);
+	
+	if (Bench)
+		printf("Peak resident memory %.1f MiB\n", ((double) PeakResidentBytes())/1048576.0);
+	
+	RemoveDir(WorkDir);
+	free(WorkDir);
+	
+	CleanupOnExit();
+	
+	if (Failures > 0) {
+		printf("%u check(s) failed.\n", Failures);
+		return 1;
+	}
+	
+	printf("All checks passed.\n");
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * NMRFilip CHECK - the NMR data processing software - checks and benchmarks of the core library
+ * Copyright (C) 2026 NMRFilip contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef __nmrfilipcheck_h__
+#define __nmrfilipcheck_h__
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include <errno.h>
+#include <inttypes.h>
+#ifdef __WIN32__
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#include <sys/stat.h>
+#include <sys/utime.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <utime.h>
+#endif
+
+#include "nmrfilip.h"
+
+#include "nfio.h"
+#include "nfload.h"
+#include "nfproc.h"
+#include "nfsimd.h"
+#include "nfcache.h"
+
+/** The program links the library objects directly (not the shared library) to reach the internal kernels and processing functions.
+    It checks them against their portable or straightforward counterparts and, with --bench, measures them.
+    The checks run on synthetic datasets written to a temporary directory and on the datasets given on the command line. **/
+
+#ifdef __WIN32__
+#define PATH_SEPARATOR	"\\"
+#else
+#define PATH_SEPARATOR	"/"
+#endif
+
+#define BENCH_MIN_TIME	0.25	/** s, each measured operation is repeated at least for this time **/
+
+#if SINGLE_PRECISION
+#define DFT_TOLERANCE	1.0e-5	/** relative to the maximum amplitude of the step **/
+#define DFT_PRECISION	"single precision"
+#else
+#define DFT_TOLERANCE	1.0e-9
+#define DFT_PRECISION	"double precision"
+#endif
+
+/** Synthetic echo train written as a dataset: Chunks echoes of Length points every Period points from the point Offset in each of Steps lines of TD values **/
+typedef struct {
+	size_t TD;
+	size_t Steps;
+	size_t Offset;
+	size_t Period;
+	size_t Length;
+	size_t Chunks;
+	unsigned char BigEndian;
+	double Freq;	/** frequency of the echo signal relative to the spectral width **/
+	unsigned char DTypA;	/** RAW_TYPE_INT32 (0, the default) or RAW_TYPE_FLOAT64 **/
+	size_t Jitter;	/** the echoes are shifted by up to Jitter points either way (0, the default, for a periodic train); Offset must not be lower and Period - Length must be higher than twice as much **/
+} EchoTrain;
+
+/** Copies of the chunk set, the chunk averages and the DFT output of all the steps compared between the runs **/
+typedef struct {
+	size_t ChunkCount;
+	size_t *Chunks;	/** start and length of each chunk **/
+	double *ChunkAvg;
+	NMRReal *DFT;
+} ProcResults;
+
+extern unsigned int Failures;
+extern unsigned char Bench;
+extern char *WorkDir;
+
+/** nmrfilipcheck.c - the checks, the synthetic datasets and the measurement **/
+void Check(int Passed, const char *Format, ...);
+double CheckClock(void);
+uint64_t NextRandom(uint64_t *State);
+uint64_t CheckRandom(void);
+double CheckRandomDouble(void);
+int HasSSE2(void);
+int HasAVX2(void);
+size_t ResidentBytes(const void *Start, size_t Length);
+size_t PeakResidentBytes(void);
+char *CombinePath(const char *Dir, const char *Name);
+int MakeDir(const char *Dir);
+int RemoveDir(const char *Dir);
+void PutEchoTrainValue(unsigned char *Line, size_t Index, int32_t Value, const EchoTrain *Train);
+size_t EchoTrainStart(const EchoTrain *Train, size_t Chunk);
+char *WriteEchoTrain(const char *Name, const EchoTrain *Train);
+void RemoveEchoTrain(const char *Dir);
+int OpenDataset(NMRData *NMRDataStruct, const char *Dir);
+void CloseDataset(NMRData *NMRDataStruct);
+int OpenEchoTrain(NMRData *NMRDataStruct, const char *Name, const EchoTrain *Train);
+void CloseEchoTrain(NMRData *NMRDataStruct);
+double MeasureTime(void (*Func)(void *), void *Arg);
+int RunStage(NMRData *NMRDataStruct, unsigned int Since, unsigned int Stage);
+double MeasureStage(NMRData *NMRDataStruct, unsigned int Since, unsigned int Stage);
+void SaveProcResults(NMRData *NMRDataStruct, ProcResults *Results);
+double CompareProcResults(NMRData *NMRDataStruct, const ProcResults *Results);
+void FreeProcResults(ProcResults *Results);
+const char *ReferenceParamValue(const char *Text, const char *ParamName, const char *ValuePrefix);
+long CompareParamIndex(NMRData *NMRDataStruct, char *Text, size_t TextLength);
+void CheckParamLookup(void);
+void CheckParamIndex(const EchoTrain *Train, const char *Name);
+
+/** nfcheckkern.c - the vectorized kernels and the echo peak search **/
+void CheckKernels(void);
+double ReferenceEchoPeakInt32(const int32_t *Data, size_t Count, size_t *Peak);
+double ReferenceEchoPeakFloat64(const double *Data, size_t Count, size_t *Peak);
+void CheckEchoPeakSearch(void);
+
+/** nfcheckload.c - the datafile loading **/
+void CheckLoader(NMRData *NMRDataStruct, const char *Name);
+void CheckLazyLoading(NMRData *NMRDataStruct, const char *Name);
+void CheckByteOrders(const EchoTrain *Train, const char *Name);
+void CheckRawDataTypes(const EchoTrain *Train, const char *Name);
+unsigned char *ReadWholeFile(const char *Path, size_t *Size);
+int WriteWholeFile(const char *Path, const unsigned char *Data, size_t Size, const char *Mode);
+void CompareIncrementalReload(NMRData *NMRDataStruct, const char *Dir, unsigned char Mode, const char *Name, const char *What);
+void CheckIncrementalReload(const EchoTrain *Train, const char *Name);
+time_t GetFileMTime(const char *Path);
+int SetFileMTime(const char *Path, time_t Time);
+int LoadCachedDataset(const char *Dir, long IgnoredStep, unsigned long *Flags);
+void CheckCache(const EchoTrain *Train, const char *Name);
+
+/** nfcheckproc.c - the chunk set, the chunk averages and the echo peaks **/
+void CheckChunkDetection(void);
+void CheckChunkSearch(NMRData *NMRDataStruct, const char *Name);
+int CompareChunkSearch(NMRData *NMRDataStruct, double *EstimateTime, double *SearchTime);
+void CheckChunkAvg(NMRData *NMRDataStruct, const char *Name);
+void CheckChunkSums(NMRData *NMRDataStruct, const char *Name);
+void CheckCompactRawData(NMRData *NMRDataStruct, const char *Name);
+void CheckEchoPeaks(NMRData *NMRDataStruct, const char *Name);
+void CheckThreads(NMRData *NMRDataStruct, const char *Name);
+
+/** nfcheckdft.c - the DFT **/
+void CheckDFT(NMRData *NMRDataStruct, const char *Name);
+int ReferenceDFT(NMRData *NMRDataStruct, size_t StepNo, double *Output);
+void CheckDFTOrder(NMRData *NMRDataStruct, const char *Name);
+int ReferenceOutOfPlaceDFT(NMRData *NMRDataStruct, size_t StepNo, NMRReal *Input, NMRReal *Output);
+void CheckInPlaceDFT(NMRData *NMRDataStruct, const char *Name);
+void CheckZoom(NMRData *NMRDataStruct, const char *Name);
+void CheckPadding(NMRData *NMRDataStruct, const char *Name);
+long CountScratchMappings(const char *Dir, long *Deleted);
+void CheckDFTSpill(const EchoTrain *Train, const char *Name);
+void CheckDownconvert(NMRData *NMRDataStruct, const char *Name);
+int IsDFTFriendly(size_t Length);
+void CheckDFTLengthRounding(void);
+
+#endif
@@ -72,6 +72,14 @@ nmrfilipcli [-<parameter>...] [--<output>[=<file>]...] [<other>...] [<datadir>..
   -removeoffset    Remove offset by taking into account the FID start time - \n\
                     see -ph1<FIDstart>\n\
   \n\
+  Apodization\n\
+  -apod=<window>[:<param>]  Multiply the processed part of chunk average \n\
+                    by <window> before Fourier transform: none (default), \n\
+                    exp:<LB> (line broadening of <LB> Hz), gauss:<FWHM> \n\
+                    (Gaussian line of <FWHM> Hz), sine:<phase> (sine bell \n\
+                    starting at <phase> deg) or kaiser:<beta> (Kaiser window \n\
+                    of shape <beta>)\n\
+  \n\
  Save text <output> to specified <file> or to \"export%s<output>.txt\" otherwise:\n\
   --tddata[=<file>]        Save time domain data\n\
   --echopeaks[=<file>]     Save echo peaks envelope\n\
@@ -83,8 +91,34 @@ nmrfilipcli [-<parameter>...] [--<output>[=<file>]...] [<other>...] [<datadir>..
   --evaluation[=<file>]    Save experiment evaluation\n\
   \n\
  The <other> options:\n\
+  --cache          Use the processed data cache stored next to the datafile \n\
+                    (ser.nfcache or fid.nfcache) to skip the processing \n\
+                    already done with the same parameters, update it afterwards\n\
   --cl             Print copyright and license information\n\
+  --compact        Keep just the chunks of time domain data in memory once \n\
+                    they are found (the rest is loaded again if needed)\n\
+  --dftmem=<MiB>   Keep the Fourier transforms in a scratch file (in TMPDIR \n\
+                    or /var/tmp) if they need more than <MiB> of memory and \n\
+                    transform the steps in batches of that size, 0 (default)\n\
+                    for no limit\n\
+  --downconvert    Shift narrow filtered bands to zero frequency, low-pass \n\
+                    filter and decimate the data before a shorter Fourier \n\
+                    transform (the spectrum outside the band is left zero)\n\
   --help           Print this command-line parameter list\n\
+  --mmap           Map the datafile into memory instead of reading it (the \n\
+                    datafile must not be truncated or rewritten meanwhile)\n\
+  --planner=<rigor>  Choose the Fourier transform plans by <rigor>: estimate \n\
+                    (default), measure or patient - the latter two take time \n\
+                    to time the candidate plans, see --wisdom\n\
+  --roundlength=<percent>  Round the Fourier transform length up to the \n\
+                    nearest product of powers of 2, 3, 5 and 7 (transformed \n\
+                    faster) if it grows by <percent> at most, 0 (default) \n\
+                    for the length as set\n\
+  --threads=<n>    Process the steps (and run the Fourier transform if built \n\
+                    with FFTW_THREADS = 1) by at most <n> threads, 0 (default)\n\
+                    for the number of processors online\n\
+  --wisdom=<file>  Load the FFTW wisdom (the plans chosen before) from <file> \n\
+                    and store it back to <file> on exit\n\
   \n\
  The NMR dataset <datadir>s:\n\
   <datadir>    Specifies the NMR dataset directory to use. Default is current\n\
@@ -162,6 +196,7 @@ int main(int argc, char * argv[]) {
 	
 	char *ViewName = NULL;
 	char *OutputName = NULL;
+	char *WisdomName = NULL;
 	char *Pwd = NULL;
 
 	long FirstChunk = 0;
@@ -182,6 +217,17 @@ int main(int argc, char * argv[]) {
 	unsigned short ShallPrintLicenseInfo = 0;
 	unsigned short matched = 0;
 	unsigned short UsePwd = 0;
+	unsigned short UseCache = 0;
+	unsigned short UseCompact = 0;
+	unsigned short UseMmap = 0;
+	unsigned char Planner = DFT_PLANNER_ESTIMATE;
+	long Threads = 0;
+	long DFTMemory = 0;
+	long Downconvert = 0;
+	long LengthTolerance = 0;
+	long Apodization = -1;
+	double ApodizationParam = 0.0;
+	unsigned short ApodizationParamSet = 0;
 	unsigned short failure = 0;
 	unsigned short InGroup = 0;
 
@@ -250,6 +296,128 @@ int main(int argc, char * argv[]) {
 			ShallPrintLicenseInfo = 1;
 		} 
 		
+		if ((!matched) && (strncmp(argv[i], "--cache", 7) == 0)) {
+			matched = 1;
+			UseCache = 1;
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--compact", 9) == 0)) {
+			matched = 1;
+			UseCompact = 1;
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--dftmem=", 9) == 0)) {
+			matched = 1;
+			ptr1 = argv[i] + 9;
+			errno = 0;
+			DFTMemory = strtol(ptr1, &ptr2, 0);
+			if (errno || (ptr1 == ptr2) || (DFTMemory < 0)) {
+				fprintf(stderr, "Invalid memory budget supplied.\n");
+				free(ViewName);
+				free(WisdomName);
+				return -1;
+			}
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--downconvert", 13) == 0)) {
+			matched = 1;
+			Downconvert = 1;
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--mmap", 6) == 0)) {
+			matched = 1;
+			UseMmap = 1;
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "-apod=", 6) == 0)) {
+			matched = 1;
+			ptr1 = argv[i] + 6;
+			if (strncmp(ptr1, "none", 4) == 0) {
+				Apodization = APODIZATION_None;
+				ptr1 += 4;
+			} else if (strncmp(ptr1, "exp", 3) == 0) {
+				Apodization = APODIZATION_Exponential;
+				ptr1 += 3;
+			} else if (strncmp(ptr1, "gauss", 5) == 0) {
+				Apodization = APODIZATION_Gaussian;
+				ptr1 += 5;
+			} else if (strncmp(ptr1, "sine", 4) == 0) {
+				Apodization = APODIZATION_SineBell;
+				ptr1 += 4;
+			} else if (strncmp(ptr1, "kaiser", 6) == 0) {
+				Apodization = APODIZATION_Kaiser;
+				ptr1 += 6;
+			} else
+				Apodization = -1;
+			
+			ApodizationParamSet = 0;
+			if ((Apodization >= 0) && (*ptr1 == ':')) {
+				ptr1++;
+				errno = 0;
+				ApodizationParam = strtod(ptr1, &ptr2);
+				if (errno || (ptr1 == ptr2) || !isfinite(ApodizationParam))
+					Apodization = -1;
+				else
+					ApodizationParamSet = 1;
+			} else if (*ptr1 != '\0')
+				Apodization = -1;
+			
+			if (Apodization < 0) {
+				fprintf(stderr, "Invalid apodization supplied.\n");
+				free(ViewName);
+				free(WisdomName);
+				return -1;
+			}
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--planner=", 10) == 0)) {
+			matched = 1;
+			if (strcmp(argv[i] + 10, "estimate") == 0)
+				Planner = DFT_PLANNER_ESTIMATE;
+			else if (strcmp(argv[i] + 10, "measure") == 0)
+				Planner = DFT_PLANNER_MEASURE;
+			else if (strcmp(argv[i] + 10, "patient") == 0)
+				Planner = DFT_PLANNER_PATIENT;
+			else {
+				fprintf(stderr, "Invalid planner rigor supplied.\n");
+				free(ViewName);
+				free(WisdomName);
+				return -1;
+			}
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--roundlength=", 14) == 0)) {
+			matched = 1;
+			ptr1 = argv[i] + 14;
+			errno = 0;
+			LengthTolerance = strtol(ptr1, &ptr2, 0);
+			if (errno || (ptr1 == ptr2) || (LengthTolerance < 0)) {
+				fprintf(stderr, "Invalid length rounding tolerance supplied.\n");
+				free(ViewName);
+				free(WisdomName);
+				return -1;
+			}
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--threads=", 10) == 0)) {
+			matched = 1;
+			ptr1 = argv[i] + 10;
+			errno = 0;
+			Threads = strtol(ptr1, &ptr2, 0);
+			if (errno || (ptr1 == ptr2) || (Threads < 0)) {
+				fprintf(stderr, "Invalid thread count supplied.\n");
+				free(ViewName);
+				free(WisdomName);
+				return -1;
+			}
+		} 
+		
+		if ((!matched) && (strncmp(argv[i], "--wisdom=", 9) == 0)) {
+			matched = 1;
+			free(WisdomName);
+			WisdomName = strdup(argv[i] + 9);
+		} 
+		
 		for (j = 0; (!matched) && (j < 14); j++) {
 			
 			if (strncmp(argv[i], ParRel[j].Key, strlen(ParRel[j].Key)) == 0) {
@@ -316,8 +484,39 @@ int main(int argc, char * argv[]) {
 	/** No need to process anything **/
 	if (!OutputRequested) {
 		free(ViewName);
+		free(WisdomName);
 		return 0;
 	}
+	
+	/** The wisdom is stored back on exit, when the working directory may be different - relative file name is made absolute **/
+	if ((WisdomName != NULL) && (WisdomName[0] != '\0')) {
+#ifdef __WIN32__
+		if ((WisdomName[0] != '\\') && (WisdomName[0] != '/') && (WisdomName[1] != ':')) {
+			Pwd = _getcwd(NULL, 0);
+#else
+		if (WisdomName[0] != '/') {
+			Pwd = getcwd(NULL, 0);
+#endif
+			OutputName = (Pwd != NULL)?((char *) malloc(strlen(Pwd) + strlen(WisdomName) + 2)):(NULL);
+			if (OutputName != NULL) {
+#ifdef __WIN32__
+				sprintf(OutputName, "%s\\%s", Pwd, WisdomName);
+#else
+				sprintf(OutputName, "%s/%s", Pwd, WisdomName);
+#endif
+				free(WisdomName);
+				WisdomName = OutputName;
+				OutputName = NULL;
+			}
+			free(Pwd);
+			Pwd = NULL;
+		}
+		
+		if ((LoadDFTWisdom(WisdomName) & ~DATA_EMPTY) != DATA_OK)
+			fprintf(stderr, "Cannot load the FFTW wisdom from \"%s\".\n", WisdomName);
+	}
+	free(WisdomName);
+	WisdomName = NULL;
 		
 	for (k = argc - 1, UsePwd = 1; UsePwd && (k > 0); k--) 
 		if (argv[k][0] != '-')
@@ -363,6 +562,14 @@ int main(int argc, char * argv[]) {
 			free(Pwd);
 			return -1;
 		}
+		
+		NMRDataStruct.CompactRawData = UseCompact;
+		NMRDataStruct.LoadMode = (UseMmap)?(RAW_LOAD_MMAP):(RAW_LOAD_READ);
+		NMRDataStruct.DFTPlanner = Planner;
+		SetProcParam(&NMRDataStruct, PROC_PARAM_ProcThreads, PARAM_LONG, &Threads, NULL);
+		SetProcParam(&NMRDataStruct, PROC_PARAM_DFTMemoryBudget, PARAM_LONG, &DFTMemory, NULL);
+		SetProcParam(&NMRDataStruct, PROC_PARAM_DFTDownconvert, PARAM_LONG, &Downconvert, NULL);
+		SetProcParam(&NMRDataStruct, PROC_PARAM_DFTLengthTolerance, PARAM_LONG, &LengthTolerance, NULL);
 
 		test = fopen("ser", "r");
 		if (test) {
@@ -382,6 +589,10 @@ int main(int argc, char * argv[]) {
 		}
 		
 		
+		/** The cached chunk set is needed already for setting the processing parameters **/
+		if (UseCache)
+			LoadNMRDataCache(&NMRDataStruct);
+		
 		/** ...then set the processing parameters or load reasonable defaults... **/
 		if (ViewName) {
 			if (ImportProcParams(&NMRDataStruct, ViewName) != DATA_OK) {
@@ -413,6 +624,17 @@ int main(int argc, char * argv[]) {
 			}
 		}
 		
+		if (Apodization >= 0) {
+			if (SetProcParam(&NMRDataStruct, PROC_PARAM_Apodization, PARAM_LONG, &Apodization, NULL) != DATA_OK)
+				fprintf(stderr, "Setting apodization failed.\n");
+			if (ApodizationParamSet && (SetProcParam(&NMRDataStruct, PROC_PARAM_ApodizationParam, PARAM_DOUBLE, &ApodizationParam, NULL) != DATA_OK))
+				fprintf(stderr, "Setting apodization parameter failed.\n");
+		}
+		
+		/** The processing parameters might have invalidated some of the cached data, take them from the cache again if the parameters match **/
+		if (UseCache)
+			LoadNMRDataCache(&NMRDataStruct);
+		
 		/** ...and finally process the data. **/
 		for (i = 1; i < argc; i++) {
 			output = NULL;
@@ -514,6 +736,9 @@ int main(int argc, char * argv[]) {
 			OutputName = NULL;
 		}
 		
+		if (UseCache && ((SaveNMRDataCache(&NMRDataStruct) & ~DATA_EMPTY) != DATA_OK))
+			fprintf(stderr, "Cannot save the processed data cache.\n");
+		
 		if (FreeNMRData(&NMRDataStruct) != DATA_EMPTY) {
 			fprintf(stderr, "Cannot free NMRData structure.\n");
 			free(ViewName);